@@ -3,34 +3,32 @@
  *
  * Descrio:
  * ----------
- * Este arquivo contm a implementao da classe Ball, que representa uma bola de bilhar no jogo. A classe Ball  responsvel por:
+ * Este arquivo contm a implementao da classe Ball, que representa o modelo de uma bola de bilhar (a malha, o
+ * material e a textura). Cada bola da cena  uma entidade do SceneRegistry criada a partir de um modelo; o movimento,
+ * as colises e o desenho so feitos pelos sistemas da cena (SceneSystems). A classe Ball  responsvel por:
  * - Carregar o modelo 3D da bola a partir de um arquivo .obj e .mtl.
- * - Carregar a textura da bola.
- * - Configurar os buffers e atributos da bola (VAO, VBO).
- * - Renderizar a bola na cena.
- * - Atualizar a posio e estado da bola (movimento, colises).
- * - Verificar colises com outras bolas e com as paredes da mesa.
+ * - Preparar a malha da bola, que  enviada para o buffer de geometria partilhado (GeometryBuffer).
+ * - Criar as entidades das bolas, com os componentes de transformao, malha, material e (para as bolas que rolam)
+ *   corpo rgido.
  *
  * Funes principais:
- * - Ball(const glm::vec3& initialPosition, GLuint textureIndex, GLuint shaderProgram, Camera* camera, Lights* lights, bool isMoving = false, glm::vec3 orientation = glm::vec3(0, 0, 0)): Construtor da classe Ball.
+ * - Ball(GLint textureLayer): Construtor da classe Ball.
  * - Load(const std::string obj_model_filepath): Carrega o modelo 3D da bola.
  * - LoadMTL(char* mtl_model_filepath): Carrega o material da bola.
- * - LoadTexture(const char* textureFileName): Carrega a textura da bola.
- * - Install(): Configura os buffers e atributos da bola.
- * - Render(glm::vec3 position, glm::vec3 orientation): Renderiza a bola.
- * - Update(float deltaTime, const std::vector<Ball>& balls): Atualiza a posio e estado da bola.
- * - IsColliding(const std::vector<Ball>& balls): Verifica colises com outras bolas.
+ * - Install(): Escala a malha da bola e calcula a sua esfera envolvente.
+ * - CreateEntity(SceneRegistry& registry, const glm::vec3& position, const glm::vec3& orientation, const SphereLOD* lod,
+ *   bool dynamic): Cria uma entidade com esta bola.
+ * - GetMaterial(): Retorna o material lido do ficheiro .mtl.
  * - GetBallInitialPositions(): Retorna as posies iniciais de todas as bolas.
  *
  * Variveis e constantes importantes:
- * - BALL_RADIUS: Raio da bola.
+ * - BALL_RADIUS: Raio da bola, usado nas colises.
  * - SPEED: Velocidade de movimento da bola.
- * - position: Posio atual da bola.
- * - orientation: Orientao da bola.
- * - isMoving: Indica se a bola est em movimento.
  * - vertices, uvs, normals: Vetores que armazenam os dados do modelo 3D da bola.
- * - VAO, VBO, ShaderProgram: Variveis para configurao e renderizao da bola.
- * - cameraPtr, lightsPtr: Apontadores para a cmera e as luzes do jogo.
+ * - mesh: Intervalo da malha da bola no buffer de geometria partilhado.
+ * - textureLayer, materialIndex: Camada da textura e ndice do material, copiados para as entidades.
+ * - bounds: Esfera envolvente da malha da bola, usada no recorte por volume de visualizao.
+ * - textureFile: Imagem da textura da bola, carregada no array de texturas em Source.cpp.
  *
  ******************************************************************************/
 
@@ -43,8 +41,8 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/ext.hpp>
 
-#include "stb_image.h"
 #include "Ball.h"
+#include "SceneSystems.h"
 #include "LoadShaders.h"
 
 #include <GL/glew.h>
@@ -57,27 +55,22 @@
 const float Ball::BALL_RADIUS = 0.035f;
 
 /*****************************************************************************
- * Ball::Ball(const glm::vec3& initialPosition, GLuint textureIndex, GLuint shaderProgram,
- * Camera* camera, Lights* lights, bool isMoving = false, glm::vec3 orientation = glm::vec3(0, 0, 0))
+ * Ball::Ball(GLint textureLayer)
  *
  * Descrio:
  * ----------
- * Este  o construtor da classe Ball, responsvel por inicializar uma nova bola de bilhar no jogo.
- * Ele recebe como parmetros a posio inicial da bola, o ndice da textura que ser aplicada,
- * o programa de shader a ser utilizado, um apontador para a cmera e um apontador para as luzes do jogo.
- * Alm disso, tambm recebe parmetros opcionais para indicar se a bola est em movimento (`isMoving`)
- * e a sua orientao (`orientation`), com valores padro para estes.
+ * Este  o construtor da classe Ball, responsvel por inicializar o modelo de
+ * uma bola de bilhar. Recebe a camada do array de texturas com a textura da
+ * bola; a malha e o material so carregados em `Load`, e as bolas da cena so
+ * criadas depois com `CreateEntity`.
  *
  * Retorno:
  * --------
  * - Nenhum (construtor).
  *
  ******************************************************************************/
-Ball::Ball(const glm::vec3& initialPosition, GLuint textureIndex, GLuint shaderProgram, Camera* camera, Lights* lights, bool isMoving, glm::vec3 orientation)
-	: position(initialPosition), textureIndex(textureIndex), ShaderProgram(shaderProgram), cameraPtr(camera), lightsPtr(lights), isMoving(isMoving), orientation(orientation) {
-
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
+Ball::Ball(GLint textureLayer)
+	: mesh({ 0, 0, 0 }), textureLayer(textureLayer), materialIndex(0) {
 }
 
 
@@ -173,10 +166,10 @@ void Ball::Load(const std::string obj_model_filepath) {
  *
  * Descrio:
  * ----------
- * Configura os buffers (Vertex Buffer Objects - VBOs) e atributos de vrtice
- * para a renderizao da bola. Esta funo  essencial para enviar os dados
- * do modelo da bola (vrtices, normais, coordenadas de textura) para a placa
- * grfica (GPU) de forma que ela possa process-los e renderizar a bola no ecr.
+ * Prepara a malha lida do ficheiro .obj: aplica a escala da bola aos vrtices e
+ * calcula a esfera envolvente usada no recorte. A malha j escalada  depois
+ * acrescentada ao buffer de geometria partilhado em Source.cpp; como as 15 bolas
+ * tm a mesma geometria, s  enviada uma cpia para a GPU.
  *
  * Parmetros:
  * -----------
@@ -188,174 +181,97 @@ void Ball::Load(const std::string obj_model_filepath) {
  *
  ******************************************************************************/
 void Ball::Install() {
-
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
 	float scale = 0.040f;
 	for (size_t i = 0; i < vertices.size(); i++) {
 		vertices[i] *= scale;
 	}
 
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-
-	GLuint normalsVBO;
-	glGenBuffers(1, &normalsVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, normalsVBO);
-	glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW);
-
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(1);
-
-	GLuint uvsVBO;
-	glGenBuffers(1, &uvsVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, uvsVBO);
-	glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), uvs.data(), GL_STATIC_DRAW);
-
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(2);
-
-	GLint textura = glGetProgramResourceLocation(ShaderProgram, GL_UNIFORM, "textSampler");
-	glProgramUniform1i(ShaderProgram, textura, 0);
-	GLenum error = glGetError();
-	if (error != GL_NO_ERROR) {
-		std::cout << "OpenGL Error: " << error << std::endl;
-	}
-
+	bounds = ComputeBoundingSphere(vertices);
 }
 
 
 /*****************************************************************************
- * void Ball::Render(glm::vec3 position, glm::vec3 orientation)
+ * Entity Ball::CreateEntity(SceneRegistry& registry, const glm::vec3& position, const glm::vec3& orientation, const SphereLOD* lod, bool dynamic) const
  *
  * Descrio:
  * ----------
- * Esta funo renderiza a bola na cena 3D, ao utilizar as informaes de posio
- * e orientao fornecidas. Ela aplica as transformaes de modelo, visualizao e
- * projeo da cmera, configura as propriedades de iluminao e material da bola
- * e, por fim, desenha os tringulos que compem o modelo da bola no ecr.
+ * Cria no registo da cena uma entidade com esta bola: a transformao, a
+ * malha (com os nveis de detalhe partilhados, a camada da textura e os raios
+ * do recorte e dos impostores) e o material. As bolas da mesa principal
+ * (`dynamic`) tm tambm um corpo rgido, que o PhysicsSystem faz rolar; as
+ * bolas da sala de bilhar ficam paradas e usam o nvel de detalhe da sua mesa.
+ * A mesma bola pode dar origem a vrias entidades, que partilham a malha, o
+ * material e a textura.
  *
  * Parmetros:
  * -----------
+ * - registry: O registo da cena.
  * - position: A posio (x, y, z) da bola no mundo.
- * - orientation: A orientao (x, y, z) da bola em radianos.
+ * - orientation: A orientao (x, y, z) da bola em graus.
+ * - lod: Os nveis de detalhe partilhados pelas bolas (nullptr = sempre a malha original).
+ * - dynamic: true para uma bola que rola (com corpo rgido e nvel de detalhe prprio).
  *
  * Retorno:
  * --------
- * - Nenhum (void).
+ * - Entity: A nova entidade.
  *
  ******************************************************************************/
-void Ball::Render(glm::vec3 position, glm::vec3 orientation) {
-	glBindVertexArray(VAO);
-
-	glm::mat4 Model = cameraPtr->model;
-	Model = glm::translate(Model, position);
-	Model = glm::rotate(Model, glm::radians(orientation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-	Model = glm::rotate(Model, glm::radians(orientation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-	Model = glm::rotate(Model, glm::radians(orientation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-
-	GLint viewId = glGetProgramResourceLocation(ShaderProgram, GL_UNIFORM, "View");
-	glProgramUniformMatrix4fv(ShaderProgram, viewId, 1, GL_FALSE, glm::value_ptr(cameraPtr->view * cameraPtr->getMatrizZoom()));
-
-	GLint projectionId = glGetProgramResourceLocation(ShaderProgram, GL_UNIFORM, "Projection");
-	glProgramUniformMatrix4fv(ShaderProgram, projectionId, 1, GL_FALSE, glm::value_ptr(cameraPtr->proj));
-
-	GLint modelId = glGetProgramResourceLocation(ShaderProgram, GL_UNIFORM, "Model");
-	glProgramUniformMatrix4fv(ShaderProgram, modelId, 1, GL_FALSE, glm::value_ptr(Model));
-
-	glm::mat4 modelView = cameraPtr->view * cameraPtr->getMatrizZoom() * Model;
-	GLint modelViewId = glGetProgramResourceLocation(ShaderProgram, GL_UNIFORM, "ModelView");
-	glProgramUniformMatrix4fv(ShaderProgram, modelViewId, 1, GL_FALSE, glm::value_ptr(modelView));
-
-	glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(modelView));
-	GLint normalMatrixId = glGetProgramResourceLocation(ShaderProgram, GL_UNIFORM, "NormalMatrix");
-	glProgramUniformMatrix3fv(ShaderProgram, normalMatrixId, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-
-	glUniform1i(glGetUniformLocation(ShaderProgram, "ambientLightEnabled"), lightsPtr->isAmbientLightEnabled);
-	glUniform1i(glGetUniformLocation(ShaderProgram, "directionalLightEnabled"), lightsPtr->isDirectionalLightEnabled);
-	glUniform1i(glGetUniformLocation(ShaderProgram, "pointLightEnabled[0]"), lightsPtr->isPointLightEnabled);
-	glUniform1i(glGetUniformLocation(ShaderProgram, "spotLightEnabled"), lightsPtr->isSpotLightEnabled);
-
-	if (lightsPtr->isAmbientLightEnabled) {
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "ambientLight.ambient"), 1, glm::value_ptr(glm::vec3(0.8, 0.8, 0.8)));
-	}
-
-	if (lightsPtr->isDirectionalLightEnabled) {
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "directionalLight.direction"), 1, glm::value_ptr(glm::vec3(1.0, -0.5, 0.0)));
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "directionalLight.ambient"), 1, glm::value_ptr(glm::vec3(0.5, 0.5, 0.5)));
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "directionalLight.diffuse"), 1, glm::value_ptr(glm::vec3(1.0, 1.0, 1.0)));
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "directionalLight.specular"), 1, glm::value_ptr(glm::vec3(1.0, 1.0, 1.0)));
-	}
-
-	if (lightsPtr->isPointLightEnabled) {
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "pointLight[0].position"), 1, glm::value_ptr(glm::vec3(0.0, 0.0, 0.0)));
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "pointLight[0].ambient"), 1, glm::value_ptr(glm::vec3(0.5, 0.5, 0.5)));
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "pointLight[0].diffuse"), 1, glm::value_ptr(glm::vec3(1.0, 1.0, 1.0)));
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "pointLight[0].specular"), 1, glm::value_ptr(glm::vec3(1.0, 1.0, 1.0)));
-		glProgramUniform1f(ShaderProgram, glGetUniformLocation(ShaderProgram, "pointLight[0].constant"), 1.0f);
-		glProgramUniform1f(ShaderProgram, glGetUniformLocation(ShaderProgram, "pointLight[0].linear"), 0.09f);
-		glProgramUniform1f(ShaderProgram, glGetUniformLocation(ShaderProgram, "pointLight[0].quadratic"), 0.032f);
-	}
-
-	if (lightsPtr->isSpotLightEnabled) {
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "spotLight.position"), 1, glm::value_ptr(glm::vec3(0.0, 0.0, 0.0)));
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "spotLight.ambient"), 1, glm::value_ptr(glm::vec3(0.5, 0.5, 0.5)));
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "spotLight.diffuse"), 1, glm::value_ptr(glm::vec3(1.0, 1.0, 1.0)));
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "spotLight.specular"), 1, glm::value_ptr(glm::vec3(1.0, 1.0, 1.0)));
-		glProgramUniform1f(ShaderProgram, glGetUniformLocation(ShaderProgram, "spotLight.constant"), 1.0f);
-		glProgramUniform1f(ShaderProgram, glGetUniformLocation(ShaderProgram, "spotLight.linear"), 0.09f); // Ajuste de atenuao
-		glProgramUniform1f(ShaderProgram, glGetUniformLocation(ShaderProgram, "spotLight.quadratic"), 0.032f); // Ajuste de atenuao
-		glProgramUniform1f(ShaderProgram, glGetUniformLocation(ShaderProgram, "spotLight.spotCutoff"), glm::cos(glm::radians(12.5f)));
-		glProgramUniform1f(ShaderProgram, glGetUniformLocation(ShaderProgram, "spotLight.spotExponent"), 2.0f);
-		glProgramUniform3fv(ShaderProgram, glGetUniformLocation(ShaderProgram, "spotLight.spotDirection"), 1, glm::value_ptr(glm::vec3(0.0f, 0.0f, 0.2f)));
-	}
-
-	glUniform3fv(glGetUniformLocation(ShaderProgram, "material.ambient"), 1, glm::value_ptr(ambientColor));
-	glUniform3fv(glGetUniformLocation(ShaderProgram, "material.diffuse"), 1, glm::value_ptr(diffuseColor));
-	glUniform3fv(glGetUniformLocation(ShaderProgram, "material.specular"), 1, glm::value_ptr(specularColor));
-	glUniform1f(glGetUniformLocation(ShaderProgram, "material.shininess"), shininess);
-
-	glBindTexture(GL_TEXTURE_2D, textureIndex);
-	glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+Entity Ball::CreateEntity(SceneRegistry& registry, const glm::vec3& position, const glm::vec3& orientation, const SphereLOD* lod, bool dynamic) const {
+	Entity entity = registry.Create();
+
+	TransformComponent transform;
+	transform.position = position;
+	transform.orientation = orientation;
+	transform.model = TransformSystem::ComputeModelMatrix(position, orientation);
+	transform.dirty = false;
+	registry.transforms.Add(entity, transform);
+
+	// A distncia do centro da malha  origem  somada ao raio, para que a esfera continue vlida com qualquer orientao
+	RenderableComponent renderable;
+	renderable.mesh = mesh;
+	renderable.lod = lod;
+	renderable.lodLevel = 0;
+	renderable.fixedLOD = !dynamic;
+	renderable.meshRadius = bounds.radius;
+	renderable.boundsRadius = bounds.radius + glm::length(bounds.center);
+	renderable.textureLayer = textureLayer;
+	registry.renderables.Add(entity, renderable);
+
+	registry.materials.Add(entity, { materialIndex });
+
+	if (dynamic)
+		registry.bodies.Add(entity, { BALL_RADIUS, SPEED, false });
+
+	return entity;
 }
 
 
 /*****************************************************************************
- * void Ball::Update(float deltaTime, const std::vector<Ball>& balls)
+ * MaterialBlock Ball::GetMaterial() const
  *
  * Descrio:
  * ----------
- * Esta funo atualiza o estado da bola a cada quadro da simulao. Ela verifica
- * se a bola est em movimento e, em caso afirmativo, atualiza sua posio, rotao
- * e verifica se houve coliso com outras bolas.
+ * Devolve o material lido do ficheiro .mtl, no layout do buffer de materiais.
+ * O material no muda durante o jogo, por isso os materiais de todos os objetos
+ * so juntados num nico buffer imutvel em Source.cpp, indexado por `materialIndex`.
  *
  * Parmetros:
  * -----------
- * - deltaTime: Tempo decorrido desde o ltimo quadro da simulao.
- * - balls: Referncia constante para o vetor de bolas, usado para verificar colises.
+ * - Nenhum.
  *
  * Retorno:
  * --------
- * - Nenhum (void).
+ * - MaterialBlock: O material da bola.
  *
  ******************************************************************************/
-void Ball::Update(float deltaTime, const std::vector<Ball>& balls) {
-
-	if (isMoving) {
-
-		if (IsColliding(balls)) {
-			isMoving = false;
-		}
-
-		position.x += SPEED * deltaTime;
-
-		float distance = SPEED * deltaTime;
-
-		orientation.z -= glm::degrees(distance / BALL_RADIUS);
-	}
+MaterialBlock Ball::GetMaterial() const {
+	MaterialBlock material = {};
+	material.ambient = ambientColor;
+	material.diffuse = diffuseColor;
+	material.specular = specularColor;
+	material.shininess = shininess;
+
+	return material;
 }
 
 
@@ -366,7 +282,8 @@ void Ball::Update(float deltaTime, const std::vector<Ball>& balls) {
  * ----------
  * Carrega as propriedades do material da bola a partir de um arquivo MTL (Material Template Library).
  * O arquivo MTL define as caractersticas visuais do material, como cor ambiente, cor difusa,
- * cor especular, brilho e textura.
+ * cor especular, brilho e textura. A imagem da textura s  carregada depois, no array
+ * de texturas partilhado por todas as bolas.
  *
  * Parmetros:
  * -----------
@@ -408,7 +325,7 @@ void Ball::LoadMTL(char* mtl_model_filepath) {
 		else if (strcmp(lineHeader, "map_Kd") == 0) {
 			char textureFilename[128];
 			fscanf_s(mtlFile, "%s", textureFilename, sizeof(textureFilename));
-			LoadTexture(textureFilename);
+			textureFile = textureFilename;
 		}
 	}
 
@@ -416,94 +333,6 @@ void Ball::LoadMTL(char* mtl_model_filepath) {
 }
 
 
-/*****************************************************************************
- * void Ball::LoadTexture(const char* textureFileName)
- *
- * Descrio:
- * ----------
- * Carrega uma textura 2D a partir de um arquivo de imagem e configura os parmetros
- * da textura para uso na renderizao da bola. A textura  carregada na memria da
- * GPU para ser utilizada no processo de renderizao.
- *
- * Parmetros:
- * -----------
- * - textureFileName: O nome do arquivo de imagem que contm a textura a ser carregada.
- *
- * Retorno:
- * --------
- * - Nenhum (void).
- *
- ******************************************************************************/
-void Ball::LoadTexture(const char* textureFileName) {
-
-	glGenTextures(1, &textureIndex);
-
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, textureIndex);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-	int width, height, nChannels;
-
-	stbi_set_flip_vertically_on_load(true);
-
-	unsigned char* imageData = stbi_load(textureFileName, &width, &height, &nChannels, 0);
-	if (imageData) {
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, nChannels == 4 ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, imageData);
-
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		stbi_image_free(imageData);
-	}
-	else {
-		std::cout << "Error loading texture!" << std::endl;
-	}
-}
-
-
-/*****************************************************************************
- * bool Ball::IsColliding(const std::vector<Ball>& balls)
- *
- * Descrio:
- * ----------
- * Esta funo membro da classe `Ball` verifica se a bola est a colidir com outras
- * bolas na mesa ou com as paredes da mesa. Ela retorna `true` se houver coliso
- * e `false` caso contrrio.
- *
- * Parmetros:
- * -----------
- * - balls: Referncia constante para o vetor de bolas na mesa.
- *
- * Retorno:
- * --------
- * - bool: `true` se a bola estiver a colidir com outra bola ou com as paredes da mesa,
- *   `false` caso contrrio.
- *
- ******************************************************************************/
-bool Ball::IsColliding(const std::vector<Ball>& balls) {
-	for (size_t i = 0; i < balls.size(); i++) {
-		if (&balls[i] != this) {
-			float distance = glm::distance(position, balls[i].position);
-			float minDistance = 2 * BALL_RADIUS;
-			if (distance <= minDistance) {
-				return true;
-			}
-		}
-	}
-
-	if (position.x + BALL_RADIUS > 0.9f || position.x - BALL_RADIUS < -0.9f ||
-		position.z + BALL_RADIUS > 0.45f || position.z - BALL_RADIUS < -0.45f) {
-		return true;
-	}
-
-	return false;
-}
-
-
 /*****************************************************************************
  * std::vector<glm::vec3> Ball::GetBallInitialPositions()
  *
@@ -5,8 +5,11 @@
 #include <string>
 #include <vector>  
 #include <glm/glm.hpp>
-#include "Camera.h"
-#include "Lights.h"
+#include "Frustum.h"
+#include "SphereLOD.h"
+#include "GeometryBuffer.h"
+#include "SceneRegistry.h"
+#include "UniformBlocks.h"
 
 class Ball {
 
@@ -20,19 +23,13 @@ private:
 	static const float BALL_RADIUS; // Raio constante de todas as bolas
 	const float SPEED = 0.1f;     // Velocidade da bola
 
-	Camera* cameraPtr; // Ponteiro para a cmera
-	Lights* lightsPtr; // Ponteiro para as luzes
-
-	GLuint VAO;      // Vertex Array Object (armazena configuraes de vrtices)
-	GLuint VBO;      // Vertex Buffer Object (armazena dados dos vrtices)
-	GLuint ShaderProgram;  // Programa de shader (combina shaders de vrtice e fragmento)
-	GLuint textureIndex;  // ndice da textura da bola
+	MeshRange mesh;        // Malha da bola no buffer de geometria partilhado
+	GLint textureLayer;    // Camada da textura da bola no array de texturas
+	GLint materialIndex;   // ndice do material da bola no buffer de materiais
+	std::string textureFile; // Nome da imagem da textura (map_Kd do ficheiro .mtl)
+	BoundingSphere bounds; // Esfera envolvente da malha (espao do objeto, j escalada)
 
 	void LoadMTL(char* mtl_model_filepath); // Carrega o material da bola (arquivo .mtl)
-	void LoadTexture(const char* textureFileName); // Carrega a textura da bola
-
-	// Funo para verificar coliso com outras bolas
-	bool IsColliding(const std::vector<Ball>& balls);
 
 public:
 
@@ -41,18 +38,19 @@ public:
 	std::vector<glm::vec2> uvs;    // Coordenadas de textura (UV)
 	std::vector<glm::vec3> normals;  // Normais dos vrtices
 
-	glm::vec3 position;  // Posio atual da bola
-	glm::vec3 orientation; // Orientao da bola
-	bool isMoving;    // Indica se a bola est em movimento
-
-	// Construtor da bola
-	Ball(const glm::vec3& initialPosition, GLuint textureIndex, GLuint shaderProgram, Camera* camera, Lights* lights, bool isMoving = false, glm::vec3 orientation = glm::vec3(0, 0, 0));
+	// Construtor do modelo da bola
+	Ball(GLint textureLayer);
 
 	// Funes da bola
 	void Load(const std::string obj_model_filepath); // Carrega o modelo 3D da bola
-	void Install();                // Configura os buffers e atributos da bola
-	void Render(glm::vec3 position, glm::vec3 orientation); // Renderiza a bola
-	void Update(float deltaTime, const std::vector<Ball>& balls); // Atualiza a posio e estado da bola
+	void Install();                // Escala a malha e calcula a esfera envolvente
+	Entity CreateEntity(SceneRegistry& registry, const glm::vec3& position, const glm::vec3& orientation,
+		const SphereLOD* lod, bool dynamic) const; // Cria uma entidade da cena com esta bola
+	void SetMesh(const MeshRange& range) { mesh = range; } // Define a malha da bola no buffer de geometria
+	void SetMaterialIndex(GLint index) { materialIndex = index; } // Define o ndice do material da bola
+	MaterialBlock GetMaterial() const; // Material lido do ficheiro .mtl
+	const BoundingSphere& GetBounds() const { return bounds; } // Esfera envolvente da malha (espao do objeto)
+	const std::string& GetTextureFile() const { return textureFile; } // Imagem da textura da bola
 
 	// Retorna as posies iniciais de todas as bolas
 	static std::vector<glm::vec3> GetBallInitialPositions();
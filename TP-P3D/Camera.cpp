@@ -4,37 +4,56 @@
  * Descrio:
  * ----------
  * Este arquivo contm a implementao da classe Camera, que representa a cmera virtual no jogo. A classe Camera  responsvel por:
- * - Controlar a posio, orientao e zoom da cmera.
+ * - Controlar a posio, orientao e zoom da cmera, que orbita  volta de um alvo (ngulos horizontal e vertical e
+ *   distncia). A vista s  recalculada quando a rbita muda; a cena no tem matriz de modelo prpria.
  * - Responder a eventos do rato e scroll para manipular a cmera.
  * - Calcular as matrizes de visualizao e projeo para renderizar a cena.
  *
  * Funes principais:
- * - Camera(float zoom = 10.0f, const glm::vec3& rotationAngles = glm::vec3(0.0f), const glm::mat4& model = glm::mat4(1.0f), const glm::mat4& proj = glm::mat4(1.0f)): Construtor da classe Camera.
+ * - Camera(float zoom = 10.0f, const glm::vec3& rotationAngles = glm::vec3(0.0f), const glm::mat4& proj = glm::mat4(1.0f)): Construtor da classe Camera.
  * - mouseClickCallback(GLFWwindow* window, int button, int action, int mods): Callback para eventos de clique do rato.
  * - mouseMovementCallback(GLFWwindow* window, double xpos, double ypos): Callback para eventos de movimento do rato.
  * - scrollCallback(GLFWwindow* window, double xoffset, double yoffset): Callback para eventos de rolagem do rato (scroll).
  * - getViewMatrix(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up): Calcula a matriz de visualizao (view matrix).
  * - getMatrizZoom(): Calcula a matriz de zoom.
  * - setupCamera(const glm::vec3& position, const glm::vec3& target, float aspectRatio): Configura a cmera.
+ * - orbit(float deltaYaw, float deltaPitch): Roda a cmera  volta do alvo.
+ * - updateViewMatrix(): Calcula a matriz de visualizao a partir da rbita.
+ * - getScreenRadius(const glm::vec3& eyeCenter, float eyeRadius): Calcula o raio de uma esfera projetado no ecr.
+ * - updateFrameMatrices(): Recalcula as matrizes do quadro (vista com zoom e vista-projeo) quando mudam.
+ * - getNormalMatrix(const glm::mat4& modelView): Calcula a matriz das normais de um objeto.
+ * - getPickRay(const glm::vec2& cursor, const glm::vec2& windowSize, glm::vec3& origin, glm::vec3& direction): Raio
+ *   que passa pelo cursor, para escolher objetos com o rato.
  *
  * Variveis e constantes importantes:
  * - zoom: Nvel de zoom da cmera.
  * - clickPos: Posio do clique do rato.
  * - prevClickPos: Posio anterior do clique do rato.
- * - rotationAngles: ngulos de rotao da cmera (pitch, yaw, roll).
- * - model: Matriz de modelo da cmera.
+ * - rotationAngles: Velocidade da rbita enquanto o boto do rato est premido (pitch, yaw, roll), em graus por quadro.
+ * - target, yaw, pitch, distance: Alvo, ngulos e distncia da rbita.
+ * - MIN_PITCH, MAX_PITCH: Limites do ngulo vertical da rbita.
  * - proj: Matriz de projeo da cmera.
  * - view: Matriz de visualizao da cmera.
+ * - viewportSize: Tamanho do viewport em pxeis.
+ * - nearPlane, farPlane: Distncias dos planos prximo e distante da projeo (usadas tambm pelos clusters de luzes).
+ * - zoomView, viewProjection: Matrizes do quadro, partilhadas pelos objetos, pelas luzes e pelo volume de visualizao.
+ * - matricesDirty: Indica que o zoom, a vista ou a projeo mudaram e as matrizes do quadro tm de ser recalculadas.
  *
  ******************************************************************************/
 
 
-#include "camera.h"
+#include "Camera.h"
+#include <cmath>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/constants.hpp>
+
+const float Camera::MIN_PITCH = glm::radians(5.0f);
+const float Camera::MAX_PITCH = glm::radians(85.0f);
 
 
  /*****************************************************************************
  * Camera::Camera(float zoom = 10.0f, const glm::vec3& rotationAngles = glm::vec3(0.0f),
- *         const glm::mat4& model = glm::mat4(1.0f), const glm::mat4& proj = glm::mat4(1.0f))
+ *         const glm::mat4& proj = glm::mat4(1.0f))
  *
  * Descrio:
  * ----------
@@ -45,7 +64,6 @@
  * -----------
  * - zoom (opcional): O nvel de zoom inicial da cmera (padro: 10.0f).
  * - rotationAngles (opcional): Os ngulos de rotao iniciais da cmera em radianos (padro: glm::vec3(0.0f)).
- * - model (opcional): A matriz de modelo inicial da cmera (padro: glm::mat4(1.0f)).
  * - proj (opcional): A matriz de projeo inicial da cmera (padro: glm::mat4(1.0f)).
  *
  * Retorno:
@@ -61,11 +79,21 @@
  * - Se nenhum valor for fornecido para um parmetro, o construtor usar valores padro.
  *
  ******************************************************************************/
-Camera::Camera(float zoom, const glm::vec3& rotationAngles, const glm::mat4& model, const glm::mat4& proj) :
-	zoom(zoom), rotationAngles(rotationAngles), model(model), proj(proj) {
+Camera::Camera(float zoom, const glm::vec3& rotationAngles, const glm::mat4& proj) :
+	zoom(zoom), rotationAngles(rotationAngles), proj(proj) {
 	clickPos = glm::vec2(0.0f);
 	prevClickPos = glm::vec2(0.0f);
+	target = glm::vec3(0.0f);
+	yaw = 0.0f;
+	pitch = 0.0f;
+	distance = 1.0f;
 	view = glm::mat4(1.0f);
+	viewportSize = glm::vec2(800.0f, 800.0f);
+	nearPlane = 0.1f;
+	farPlane = 100.0f;
+	zoomView = glm::mat4(1.0f);
+	viewProjection = glm::mat4(1.0f);
+	matricesDirty = true;
 }
 
 
@@ -76,7 +104,7 @@ Camera::Camera(float zoom, const glm::vec3& rotationAngles, const glm::mat4& mod
  * ----------
  * Esta  a funo de callback que  chamada pela GLFW sempre que um evento de
  * clique do rato ocorre na janela especificada. A funo  responsvel por
- * capturar a posio do clique e atualizar os ngulos de rotao da cmera,
+ * capturar a posio do clique e, ao largar o boto, parar a rbita da cmera,
  * permite que o utilizador controle a rotao da cmera com o rato.
  *
  * Parmetros:
@@ -102,7 +130,6 @@ void Camera::mouseClickCallback(GLFWwindow* window, int button, int action, int
 		rotationAngles.x = 0.0f;
 		rotationAngles.y = 0.0f;
 	}
-	model = glm::rotate(model, glm::radians(rotationAngles.y), glm::vec3(0.0f, 1.0f, 0.0f));
 }
 
 
@@ -114,7 +141,8 @@ void Camera::mouseClickCallback(GLFWwindow* window, int button, int action, int
  * Esta  a funo de callback chamada pela GLFW sempre que o rato  movido na
  * janela especificada. Ela  responsvel por atualizar os ngulos de rotao da
  * cmera com base no movimento do rato, permite que o utilizador controle a
- * rotao da cmera ao arrastar o rato.
+ * rotao da cmera ao arrastar o rato: o movimento horizontal muda a velocidade
+ * da rbita  volta da mesa e o vertical a velocidade da inclinao.
  *
  * Parmetros:
  * -----------
@@ -133,6 +161,7 @@ void Camera::mouseMovementCallback(GLFWwindow* window, double xpos, double ypos)
 		clickPos = glm::vec2(xpos, ypos);
 		glm::vec2 clickDelta = clickPos - prevClickPos;
 		const float sensitivity = 0.004f;
+		rotationAngles.x += clickDelta.y * sensitivity;
 		rotationAngles.y += clickDelta.x * sensitivity;
 	}
 }
@@ -165,6 +194,7 @@ void Camera::scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 	else if (yoffset == -1) {
 		zoom -= fabs(zoom) * 0.1f;
 	}
+	matricesDirty = true;
 }
 
 
@@ -237,7 +267,9 @@ glm::mat4 Camera::getMatrizZoom() {
  * Descrio:
  * ----------
  * Esta funo configura os parmetros da cmera, como posio, orientao e projeo,
- * para preparar a renderizao da cena a partir do ponto de vista da cmera.
+ * para preparar a renderizao da cena a partir do ponto de vista da cmera. A
+ * posio  guardada como uma rbita  volta do alvo (ngulos e distncia), que
+ * o rato altera depois com `orbit`.
  *
  * Parmetros:
  * -----------
@@ -251,10 +283,169 @@ glm::mat4 Camera::getMatrizZoom() {
  *
  ******************************************************************************/
 void Camera::setupCamera(const glm::vec3& position, const glm::vec3& target, float aspectRatio) {
-	glm::vec3 camFront = position - target;
-	glm::vec3 camRight = glm::cross(camFront, glm::vec3(0.0f, 1.0f, 0.0f));
-	glm::vec3 up = -glm::cross(camFront, camRight);
+	glm::vec3 offset = position - target;
+	this->target = target;
+	distance = glm::length(offset);
+	yaw = std::atan2(offset.x, offset.z);
+	pitch = glm::clamp(std::asin(offset.y / distance), MIN_PITCH, MAX_PITCH);
+
+	proj = glm::perspective(glm::radians(45.0f), aspectRatio, nearPlane, farPlane);
+	updateViewMatrix();
+}
+
+
+/*****************************************************************************
+ * void Camera::orbit(float deltaYaw, float deltaPitch)
+ *
+ * Descrio:
+ * ----------
+ * Roda a cmera  volta do alvo. O ngulo horizontal  mantido entre -pi e pi e
+ * o vertical entre MIN_PITCH e MAX_PITCH, por isso a rbita no acumula erros
+ * de arredondamento, por mais longa que seja a sesso.
+ *
+ * Parmetros:
+ * -----------
+ * - deltaYaw: A rotao  volta do eixo y, em radianos.
+ * - deltaPitch: A variao do ngulo vertical, em radianos.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Camera::orbit(float deltaYaw, float deltaPitch) {
+	yaw = std::remainder(yaw + deltaYaw, glm::two_pi<float>());
+	pitch = glm::clamp(pitch + deltaPitch, MIN_PITCH, MAX_PITCH);
+	updateViewMatrix();
+}
+
 
-	proj = glm::perspective(glm::radians(45.0f), aspectRatio, 0.1f, 100.0f);
-	view = getViewMatrix(position, target, up);
-}
\ No newline at end of file
+/*****************************************************************************
+ * void Camera::updateViewMatrix()
+ *
+ * Descrio:
+ * ----------
+ * Calcula a matriz de visualizao a partir da rbita: a cmera fica 
+ * distncia `distance` do alvo, na direo dada pelos ngulos `yaw` e `pitch`,
+ * e olha para o alvo. A vista  calculada de novo a partir destes valores, nunca
+ * multiplicada pela vista anterior.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Camera::updateViewMatrix() {
+	glm::vec3 direction(std::cos(pitch) * std::sin(yaw), std::sin(pitch), std::cos(pitch) * std::cos(yaw));
+
+	view = getViewMatrix(target + direction * distance, target, glm::vec3(0.0f, 1.0f, 0.0f));
+	matricesDirty = true;
+}
+
+
+/*****************************************************************************
+ * float Camera::getScreenRadius(const glm::vec3& eyeCenter, float eyeRadius) const
+ *
+ * Descrio:
+ * ----------
+ * Esta funo calcula o raio aproximado, em pxeis, de uma esfera projetada no
+ * ecr com a projeo em perspetiva da cmera.  usada para escolher o nvel de
+ * detalhe das bolas.
+ *
+ * Parmetros:
+ * -----------
+ * - eyeCenter: O centro da esfera no espao da cmera (eye space).
+ * - eyeRadius: O raio da esfera no espao da cmera (j com o zoom aplicado).
+ *
+ * Retorno:
+ * --------
+ * - float: O raio projetado no ecr, em pxeis.
+ *
+ ******************************************************************************/
+float Camera::getScreenRadius(const glm::vec3& eyeCenter, float eyeRadius) const {
+	float depth = glm::max(-eyeCenter.z, 0.1f);
+	return eyeRadius * proj[1][1] * 0.5f * viewportSize.y / depth;
+}
+
+
+/*****************************************************************************
+ * void Camera::updateFrameMatrices()
+ *
+ * Descrio:
+ * ----------
+ * Recalcula as matrizes partilhadas por todo o quadro: a vista com o zoom
+ * (`zoomView`) e a vista-projeo (`viewProjection`).  chamada uma vez por
+ * quadro e s faz as multiplicaes quando o zoom, a vista ou a projeo mudaram
+ * (`matricesDirty`); os objetos usam estas matrizes em vez de as calcularem.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Camera::updateFrameMatrices() {
+	if (!matricesDirty)
+		return;
+
+	zoomView = view * getMatrizZoom();
+	viewProjection = proj * zoomView;
+	matricesDirty = false;
+}
+
+
+/*****************************************************************************
+ * glm::mat3x4 Camera::getNormalMatrix(const glm::mat4& modelView)
+ *
+ * Descrio:
+ * ----------
+ * Calcula a matriz que leva as normais de um objeto para o espao da cmera (a
+ * inversa transposta da parte 3x3 da matriz modelo-vista).  calculada uma vez
+ * por objeto na CPU, em vez de uma vez por vrtice nos shaders. Cada coluna
+ * ocupa 16 bytes, como um mat3 nos blocos std430.
+ *
+ * Parmetros:
+ * -----------
+ * - modelView: A matriz modelo-vista do objeto.
+ *
+ * Retorno:
+ * --------
+ * - glm::mat3x4: A matriz das normais (a quarta linha no  usada).
+ *
+ ******************************************************************************/
+glm::mat3x4 Camera::getNormalMatrix(const glm::mat4& modelView) {
+	glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(modelView));
+	return glm::mat3x4(glm::vec4(normalMatrix[0], 0.0f), glm::vec4(normalMatrix[1], 0.0f), glm::vec4(normalMatrix[2], 0.0f));
+}
+
+
+/*****************************************************************************
+ * void Camera::getPickRay(const glm::vec2& cursor, const glm::vec2& windowSize, glm::vec3& origin, glm::vec3& direction) const
+ *
+ * Descrio:
+ * ----------
+ * Calcula o raio que sai da cmera e passa pelo cursor, desprojetando o ponto do
+ * cursor nos planos prximo e distante com a inversa de `viewProjection`. Como
+ * essa matriz inclui o zoom, o raio fica no espao das posies das bolas e da
+ * mesa. Usa as matrizes do ltimo quadro desenhado, que so as que esto no ecr.
+ *
+ * Parmetros:
+ * -----------
+ * - cursor: A posio do cursor na janela (origem no canto superior esquerdo).
+ * - windowSize: O tamanho da janela, nas mesmas unidades do cursor.
+ * - origin: Recebe a origem do raio (no plano prximo).
+ * - direction: Recebe a direo do raio, normalizada.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Camera::getPickRay(const glm::vec2& cursor, const glm::vec2& windowSize, glm::vec3& origin, glm::vec3& direction) const {
+	glm::vec2 ndc(2.0f * cursor.x / windowSize.x - 1.0f, 1.0f - 2.0f * cursor.y / windowSize.y);
+	glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+
+	glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+	origin = glm::vec3(nearPoint) / nearPoint.w;
+	direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+}
@@ -12,13 +12,24 @@ public:
 	GLfloat zoom;      // Nvel de zoom da cmera
 	glm::vec2 clickPos;   // Posio do clique do rato
 	glm::vec2 prevClickPos; // Posio anterior do clique do rato
-	glm::vec3 rotationAngles; // ngulos de rotao da cmera (pitch, yaw, roll)
-	glm::mat4 model;    // Matriz de modelo da cmera (transformaes do objeto)
+	glm::vec3 rotationAngles; // Velocidade da rbita enquanto o boto do rato est premido, em graus por quadro (pitch, yaw, roll)
+	glm::vec3 target;   // Ponto em volta do qual a cmera orbita
+	float yaw;          // ngulo horizontal da rbita ( volta do eixo y), em radianos
+	float pitch;        // ngulo vertical da rbita (acima do plano da mesa), em radianos
+	float distance;     // Distncia da cmera ao alvo
 	glm::mat4 proj;    // Matriz de projeo da cmera (perspectiva)
 	glm::mat4 view;    // Matriz de visualizao da cmera (posio e orientao)
+	glm::vec2 viewportSize; // Tamanho do viewport em pxeis
+	float nearPlane;    // Distncia do plano prximo da projeo
+	float farPlane;     // Distncia do plano distante da projeo
+
+	// Matrizes do quadro, recalculadas por updateFrameMatrices s quando o zoom, a vista ou a projeo mudam
+	glm::mat4 zoomView;       // Vista com o zoom (view * getMatrizZoom()): do espao do mundo para o espao da cmera
+	glm::mat4 viewProjection; // proj * zoomView
+	bool matricesDirty;       // O zoom, a vista ou a projeo mudaram desde o ltimo updateFrameMatrices
 
 	// Construtor
-	Camera(float zoom = 10.0f, const glm::vec3& rotationAngles = glm::vec3(0.0f), const glm::mat4& model = glm::mat4(1.0f), const glm::mat4& proj = glm::mat4(1.0f));
+	Camera(float zoom = 10.0f, const glm::vec3& rotationAngles = glm::vec3(0.0f), const glm::mat4& proj = glm::mat4(1.0f));
 
 	// Funes de callback para eventos do rato e scroll
 	void mouseClickCallback(GLFWwindow* window, int button, int action, int mods);
@@ -29,6 +40,15 @@ public:
 	glm::mat4 getViewMatrix(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up); // Calcula a matriz de visualizao
 	glm::mat4 getMatrizZoom();              // Calcula a matriz de zoom
 	void setupCamera(const glm::vec3& position, const glm::vec3& target, float aspectRatio); // Configura a cmera
+	void orbit(float deltaYaw, float deltaPitch); // Roda a cmera  volta do alvo (ngulos em radianos) e recalcula a vista
+	void updateViewMatrix();                 // Calcula a vista a partir do alvo, dos ngulos e da distncia da rbita
+	float getScreenRadius(const glm::vec3& eyeCenter, float eyeRadius) const; // Raio projetado no ecr, em pxeis
+	void updateFrameMatrices(); // Recalcula zoomView e viewProjection, se estiverem desatualizadas (uma vez por quadro)
+	void getPickRay(const glm::vec2& cursor, const glm::vec2& windowSize, glm::vec3& origin, glm::vec3& direction) const; // Raio do cursor, no espao das posies das bolas
+	static glm::mat3x4 getNormalMatrix(const glm::mat4& modelView); // Matriz das normais de um objeto, no layout de um mat3 std430
+
+	static const float MIN_PITCH; // Limites do ngulo vertical da rbita (a cmera no passa para baixo da mesa nem para o znite)
+	static const float MAX_PITCH;
 };
 
 #endif // CAMERA_H
@@ -0,0 +1,191 @@
+﻿/*****************************************************************************
+ * DynamicResolution.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe DynamicResolution, a resolução interna variável escolhida pelo
+ * QualityGovernor. A classe DynamicResolution é responsável por:
+ * - Criar um framebuffer interno (cor RGBA8 e profundidade de 24 bits) com o tamanho da saída.
+ * - Em cada quadro com uma escala abaixo de 1, desenhar a cena só no canto inferior esquerdo desse framebuffer, com o
+ *   tamanho escalado, para que mudar a escala não obrigue a recriar nada.
+ * - Ampliar esse canto para o framebuffer de saída (a janela ou o framebuffer do modo --headless) com um filtro
+ *   linear, antes da gravação dos quadros e da troca de buffers.
+ *
+ * Funções principais:
+ * - Create(GLsizei width, GLsizei height): Cria o framebuffer interno.
+ * - Begin(float scale, GLuint outputFramebuffer): Liga o framebuffer e o viewport do quadro.
+ * - Resolve(): Amplia o quadro para a saída.
+ *
+ * Variáveis e constantes importantes:
+ * - width, height: Tamanho da saída.
+ * - renderWidth, renderHeight: Tamanho desenhado no quadro atual.
+ * - framebuffer: Framebuffer interno.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "DynamicResolution.h"
+
+
+/*****************************************************************************
+ * DynamicResolution::DynamicResolution()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `DynamicResolution`. O framebuffer é criado em `Create`.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+DynamicResolution::DynamicResolution()
+	: width(0),
+	height(0),
+	renderWidth(0),
+	renderHeight(0),
+	scaled(false),
+	outputFramebuffer(0),
+	framebuffer(0),
+	colorBuffer(0),
+	depthBuffer(0) {
+}
+
+
+/*****************************************************************************
+ * DynamicResolution::~DynamicResolution()
+ *
+ * Descrição:
+ * ----------
+ * Destrutor da classe `DynamicResolution`, que liberta o framebuffer interno.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (destrutor).
+ *
+ ******************************************************************************/
+DynamicResolution::~DynamicResolution() {
+	if (framebuffer != 0) {
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+	}
+}
+
+
+/*****************************************************************************
+ * bool DynamicResolution::Create(GLsizei width, GLsizei height)
+ *
+ * Descrição:
+ * ----------
+ * Cria o framebuffer interno com o tamanho da saída. Todas as escalas usam uma
+ * parte deste framebuffer.
+ *
+ * Parâmetros:
+ * -----------
+ * - width, height: O tamanho do framebuffer de saída, em píxeis.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o framebuffer estiver completo.
+ *
+ ******************************************************************************/
+bool DynamicResolution::Create(GLsizei width, GLsizei height) {
+	this->width = width;
+	this->height = height;
+	renderWidth = width;
+	renderHeight = height;
+
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "Dynamic resolution framebuffer is incomplete (0x" << std::hex << status << std::dec << ")" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+/*****************************************************************************
+ * void DynamicResolution::Begin(float scale, GLuint outputFramebuffer)
+ *
+ * Descrição:
+ * ----------
+ * Prepara o desenho de um quadro: com a escala 1 liga o framebuffer de saída;
+ * abaixo de 1 liga o framebuffer interno. Em ambos os casos define o viewport
+ * com o tamanho desenhado (`GetRenderWidth`, `GetRenderHeight`).
+ *
+ * Parâmetros:
+ * -----------
+ * - scale: A escala da resolução (0 a 1).
+ * - outputFramebuffer: O framebuffer onde o quadro tem de acabar (0 = janela).
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void DynamicResolution::Begin(float scale, GLuint outputFramebuffer) {
+	this->outputFramebuffer = outputFramebuffer;
+	scaled = scale < 1.0f && framebuffer != 0;
+
+	if (scaled) {
+		renderWidth = std::max(1, (int)std::lround(width * scale));
+		renderHeight = std::max(1, (int)std::lround(height * scale));
+	}
+	else {
+		renderWidth = width;
+		renderHeight = height;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, scaled ? framebuffer : outputFramebuffer);
+	glViewport(0, 0, renderWidth, renderHeight);
+}
+
+
+/*****************************************************************************
+ * void DynamicResolution::Resolve()
+ *
+ * Descrição:
+ * ----------
+ * Se o quadro foi desenhado com uma escala abaixo de 1, amplia-o para o
+ * framebuffer de saída com um filtro linear. No fim, o framebuffer de saída
+ * fica ligado (para leitura e desenho) com o viewport inteiro.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void DynamicResolution::Resolve() {
+	if (!scaled)
+		return;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer);
+	glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+	glViewport(0, 0, width, height);
+}
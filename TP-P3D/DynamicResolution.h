@@ -0,0 +1,32 @@
+﻿#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <GL/glew.h>
+
+// Resolução interna variável: com uma escala abaixo de 1, a cena é desenhada num canto de um framebuffer do tamanho da
+// janela (sem recriar texturas quando a escala muda) e depois ampliada para o framebuffer de saída com glBlitFramebuffer.
+// Com a escala 1, a cena é desenhada diretamente no framebuffer de saída.
+class DynamicResolution {
+public:
+	DynamicResolution();
+	~DynamicResolution();
+
+	bool Create(GLsizei width, GLsizei height); // Cria o framebuffer interno com o tamanho da saída
+	void Begin(float scale, GLuint outputFramebuffer); // Liga o framebuffer onde o quadro é desenhado e o viewport
+	void Resolve(); // Amplia o quadro para o framebuffer de saída e deixa-o ligado
+
+	GLsizei GetRenderWidth() const { return renderWidth; }   // Tamanho do quadro desenhado, em píxeis
+	GLsizei GetRenderHeight() const { return renderHeight; }
+	bool IsScaled() const { return scaled; }
+
+private:
+	GLsizei width, height;             // Tamanho da saída
+	GLsizei renderWidth, renderHeight; // Tamanho desenhado no quadro atual
+	bool scaled;                       // O quadro atual é desenhado no framebuffer interno
+	GLuint outputFramebuffer;          // Framebuffer de saída do quadro atual (0 = janela)
+	GLuint framebuffer;
+	GLuint colorBuffer;
+	GLuint depthBuffer;
+};
+
+#endif // DYNAMIC_RESOLUTION_H
@@ -0,0 +1,629 @@
+﻿/*****************************************************************************
+ * FrameCapture.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe FrameCapture, que grava os quadros desenhados sem parar o desenho.
+ * A classe FrameCapture é responsável por:
+ * - Copiar cada quadro com glReadPixels para um anel de pixel buffer objects mapeados de forma persistente, com
+ *   uma fence por cópia, sem esperar que a cópia termine.
+ * - Passar à thread de codificação, nos quadros seguintes, os buffers cuja fence já foi sinalizada. A thread lê
+ *   os píxeis diretamente da memória mapeada e devolve o buffer ao anel quando termina.
+ * - Descartar (e contar) os quadros para os quais não há um buffer livre, em vez de esperar pela GPU ou pela
+ *   codificação, para que a gravação não baixe a taxa de quadros.
+ * - Escrever os quadros como uma sequência de PNG, num ficheiro YUV (I420) ou num processo ffmpeg.
+ *
+ * Funções principais:
+ * - ParseFormat(const char* name, Format& format): Lê o nome de um formato da linha de comandos.
+ * - Start(Format format, GLsizei width, GLsizei height): Cria os buffers e a thread e abre o destino.
+ * - Capture(): Começa a cópia do quadro atual.
+ * - Stop(): Termina a gravação.
+ * - EncoderLoop(): Ciclo da thread de codificação.
+ *
+ * Variáveis e constantes importantes:
+ * - BUFFER_COUNT: Número de buffers do anel.
+ * - FRAME_RATE: Quadros por segundo indicados ao codificador.
+ * - buffers: Anel de pixel buffer objects (livre, em leitura pela GPU ou em codificação).
+ * - stats: Quadros gravados e descartados.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "FrameCapture.h"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+static const char* CAPTURE_YUV_FILE = "Capture.yuv";
+static const char* CAPTURE_VIDEO_FILE = "Capture.mp4";
+
+// Maior bloco sem compressão do deflate
+static const size_t DEFLATE_STORED_BLOCK = 65535;
+
+// CRC-32 dos blocos PNG (polinómio 0xEDB88320)
+static uint32_t Crc32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+	static uint32_t table[256];
+	static bool tableReady = false;
+	if (!tableReady) {
+		for (uint32_t n = 0; n < 256; n++) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+		tableReady = true;
+	}
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void PutBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+	out.push_back((unsigned char)(value >> 24));
+	out.push_back((unsigned char)(value >> 16));
+	out.push_back((unsigned char)(value >> 8));
+	out.push_back((unsigned char)value);
+}
+
+// Escreve um bloco PNG (tamanho, tipo, dados e CRC do tipo e dos dados)
+static bool WritePngChunk(FILE* file, const char* type, const unsigned char* data, size_t size) {
+	std::vector<unsigned char> header;
+	PutBigEndian(header, (uint32_t)size);
+	header.insert(header.end(), type, type + 4);
+
+	std::vector<unsigned char> footer;
+	PutBigEndian(footer, Crc32(data, size, Crc32((const unsigned char*)type, 4)));
+
+	return fwrite(header.data(), 1, header.size(), file) == header.size()
+		&& (size == 0 || fwrite(data, 1, size, file) == size)
+		&& fwrite(footer.data(), 1, footer.size(), file) == footer.size();
+}
+
+
+/*****************************************************************************
+ * FrameCapture::FrameCapture()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `FrameCapture`. Os buffers e a thread só são criados
+ * em `Start`.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+FrameCapture::FrameCapture()
+	: format(FORMAT_PNG),
+	width(0),
+	height(0),
+	recording(false),
+	writeIndex(0),
+	readIndex(0),
+	output(nullptr),
+	encodeFailed(false),
+	stopping(false) {
+	stats = Stats();
+}
+
+
+/*****************************************************************************
+ * FrameCapture::~FrameCapture()
+ *
+ * Descrição:
+ * ----------
+ * Destrutor da classe `FrameCapture`, que termina a gravação em curso.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (destrutor).
+ *
+ ******************************************************************************/
+FrameCapture::~FrameCapture() {
+	Stop();
+}
+
+
+/*****************************************************************************
+ * bool FrameCapture::ParseFormat(const char* name, Format& format)
+ *
+ * Descrição:
+ * ----------
+ * Converte o nome de um formato da linha de comandos (`--capture png`,
+ * `--capture yuv` ou `--capture pipe`).
+ *
+ * Parâmetros:
+ * -----------
+ * - name: O nome do formato.
+ * - format: Recebe o formato, se o nome for conhecido.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o nome for conhecido.
+ *
+ ******************************************************************************/
+bool FrameCapture::ParseFormat(const char* name, Format& format) {
+	if (strcmp(name, "png") == 0)
+		format = FORMAT_PNG;
+	else if (strcmp(name, "yuv") == 0)
+		format = FORMAT_YUV;
+	else if (strcmp(name, "pipe") == 0)
+		format = FORMAT_PIPE;
+	else
+		return false;
+	return true;
+}
+
+
+/*****************************************************************************
+ * bool FrameCapture::Start(Format format, GLsizei width, GLsizei height)
+ *
+ * Descrição:
+ * ----------
+ * Começa uma gravação: abre o destino, cria o anel de BUFFER_COUNT pixel
+ * buffer objects (mapeados uma única vez para leitura, com
+ * `GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT`) e a thread de codificação.
+ *
+ * O YUV 4:2:0 e o vídeo precisam de dimensões pares, por isso nesses formatos
+ * a última linha ou coluna ímpar do quadro não é gravada.
+ *
+ * Parâmetros:
+ * -----------
+ * - format: O destino dos quadros.
+ * - width, height: O tamanho do framebuffer a gravar, em píxeis.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se a gravação começou.
+ *
+ ******************************************************************************/
+bool FrameCapture::Start(Format format, GLsizei width, GLsizei height) {
+	if (recording)
+		return false;
+
+	this->format = format;
+	this->width = format == FORMAT_PNG ? width : width & ~1;
+	this->height = format == FORMAT_PNG ? height : height & ~1;
+	if (this->width <= 0 || this->height <= 0)
+		return false;
+
+	if (format == FORMAT_YUV) {
+		output = fopen(CAPTURE_YUV_FILE, "wb");
+		if (output == nullptr) {
+			std::cout << "Failed to open " << CAPTURE_YUV_FILE << std::endl;
+			return false;
+		}
+	}
+	else if (format == FORMAT_PIPE) {
+		// O ffmpeg recebe os quadros já virados (a primeira linha do OpenGL é a de baixo)
+		std::string command = "ffmpeg -loglevel error -y -f rawvideo -pixel_format rgb24 -video_size "
+			+ std::to_string(this->width) + "x" + std::to_string(this->height)
+			+ " -framerate " + std::to_string(FRAME_RATE) + " -i - -pix_fmt yuv420p " + CAPTURE_VIDEO_FILE;
+#ifdef _WIN32
+		output = popen(command.c_str(), "wb");
+#else
+		output = popen(command.c_str(), "w");
+#endif
+		if (output == nullptr) {
+			std::cout << "Failed to start the encoder: " << command << std::endl;
+			return false;
+		}
+	}
+
+	const GLsizeiptr size = (GLsizeiptr)this->width * this->height * 4;
+	const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	buffers.resize(BUFFER_COUNT);
+	for (CaptureBuffer& capture : buffers) {
+		glGenBuffers(1, &capture.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.buffer);
+		glBufferStorage(GL_PIXEL_PACK_BUFFER, size, nullptr, flags);
+		capture.data = (unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, flags);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	writeIndex = 0;
+	readIndex = 0;
+	stats = Stats();
+	encodeFailed = false;
+	stopping = false;
+	recording = true;
+
+	for (const CaptureBuffer& capture : buffers) {
+		if (capture.data == nullptr) {
+			std::cout << "Failed to map the capture buffers" << std::endl;
+			Stop();
+			return false;
+		}
+	}
+
+	encoder = std::thread(&FrameCapture::EncoderLoop, this);
+
+	const char* destination = format == FORMAT_PNG ? "Capture_*.png" : format == FORMAT_YUV ? CAPTURE_YUV_FILE : CAPTURE_VIDEO_FILE;
+	std::cout << "Recording " << this->width << "x" << this->height << " frames to " << destination << std::endl;
+	return true;
+}
+
+
+/*****************************************************************************
+ * void FrameCapture::Capture()
+ *
+ * Descrição:
+ * ----------
+ * Começa a cópia do framebuffer de leitura atual para o próximo buffer do
+ * anel, sem esperar que termine (glReadPixels para um GL_PIXEL_PACK_BUFFER e
+ * uma fence). Antes, passa à codificação os buffers cuja cópia já terminou.
+ *
+ * Se o próximo buffer ainda estiver em leitura ou em codificação, o quadro é
+ * descartado: a gravação fica com menos quadros, mas o desenho não espera.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void FrameCapture::Capture() {
+	if (!recording)
+		return;
+
+	QueueReadyBuffers(false);
+
+	CaptureBuffer& capture = buffers[writeIndex];
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (capture.state != BUFFER_FREE) {
+			stats.dropped++;
+			return;
+		}
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.buffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	capture.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	capture.frame = stats.captured++;
+	capture.state = BUFFER_READING;
+	writeIndex = (writeIndex + 1) % BUFFER_COUNT;
+}
+
+
+/*****************************************************************************
+ * void FrameCapture::QueueReadyBuffers(bool wait)
+ *
+ * Descrição:
+ * ----------
+ * Passa à thread de codificação, por ordem, os buffers em leitura cuja fence
+ * já foi sinalizada. Como os buffers são usados por ordem, para no primeiro
+ * que ainda não terminou.
+ *
+ * Parâmetros:
+ * -----------
+ * - wait: true para esperar por todas as cópias (só no fim da gravação).
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void FrameCapture::QueueReadyBuffers(bool wait) {
+	const GLuint64 WAIT_TIMEOUT = 1000000000; // 1 s, em nanossegundos
+
+	for (;;) {
+		CaptureBuffer& capture = buffers[readIndex];
+		if (capture.state != BUFFER_READING)
+			return;
+
+		GLenum result = glClientWaitSync(capture.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? WAIT_TIMEOUT : 0);
+		if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED)
+			return;
+
+		glDeleteSync(capture.fence);
+		capture.fence = nullptr;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			capture.state = BUFFER_ENCODING;
+			frames.push_back(readIndex);
+		}
+		frameSignal.notify_one();
+
+		readIndex = (readIndex + 1) % BUFFER_COUNT;
+	}
+}
+
+
+/*****************************************************************************
+ * void FrameCapture::Stop()
+ *
+ * Descrição:
+ * ----------
+ * Termina a gravação: espera pelas cópias em curso, deixa a thread codificar
+ * todos os quadros prontos, fecha o destino e liberta os buffers.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void FrameCapture::Stop() {
+	if (!recording)
+		return;
+
+	if (encoder.joinable()) {
+		QueueReadyBuffers(true);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		frameSignal.notify_all();
+		encoder.join();
+	}
+
+	if (output != nullptr) {
+		if (format == FORMAT_PIPE)
+			pclose(output);
+		else
+			fclose(output);
+		output = nullptr;
+	}
+
+	for (CaptureBuffer& capture : buffers) {
+		if (capture.fence != nullptr)
+			glDeleteSync(capture.fence);
+		if (capture.data != nullptr) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.buffer);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glDeleteBuffers(1, &capture.buffer);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	buffers.clear();
+	frames.clear();
+	recording = false;
+
+	if (encodeFailed)
+		std::cout << "Some captured frames could not be written" << std::endl;
+	std::cout << "Captured " << stats.captured << " frames (" << stats.dropped << " dropped)";
+	if (format == FORMAT_YUV)
+		std::cout << ", play with: ffplay -f rawvideo -pixel_format yuv420p -video_size " << width << "x" << height
+			<< " -framerate " << FRAME_RATE << " " << CAPTURE_YUV_FILE;
+	std::cout << std::endl;
+}
+
+
+/*****************************************************************************
+ * void FrameCapture::EncoderLoop()
+ *
+ * Descrição:
+ * ----------
+ * Ciclo da thread de codificação: espera por um buffer pronto, escreve o
+ * quadro no destino a partir da memória mapeada e devolve o buffer ao anel.
+ * Termina quando `Stop` o pede e não há mais quadros. A thread não faz chamadas
+ * OpenGL.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void FrameCapture::EncoderLoop() {
+	for (;;) {
+		int index;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			frameSignal.wait(lock, [this] { return stopping || !frames.empty(); });
+			if (frames.empty())
+				return;
+			index = frames.front();
+			frames.pop_front();
+		}
+
+		CaptureBuffer& capture = buffers[index];
+		if (!Encode(capture))
+			encodeFailed = true;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		capture.state = BUFFER_FREE;
+	}
+}
+
+
+/*****************************************************************************
+ * bool FrameCapture::Encode(const CaptureBuffer& capture)
+ *
+ * Descrição:
+ * ----------
+ * Escreve um quadro (RGBA, com a primeira linha em baixo, como o devolve o
+ * glReadPixels) no destino da gravação.
+ *
+ * Parâmetros:
+ * -----------
+ * - capture: O buffer com o quadro.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o quadro foi escrito.
+ *
+ ******************************************************************************/
+bool FrameCapture::Encode(const CaptureBuffer& capture) {
+	switch (format) {
+	case FORMAT_PNG:
+		return WritePng(capture.data, capture.frame);
+	case FORMAT_YUV:
+		return WriteYuv(capture.data);
+	case FORMAT_PIPE:
+		return WriteRgb(capture.data);
+	}
+	return false;
+}
+
+
+/*****************************************************************************
+ * bool FrameCapture::WritePng(const unsigned char* pixels, GLuint frame)
+ *
+ * Descrição:
+ * ----------
+ * Escreve um quadro em Capture_NNNNN.png (RGB de 8 bits). A imagem é guardada
+ * em blocos deflate sem compressão: o ficheiro é maior, mas a thread de
+ * codificação acompanha a taxa de quadros sem uma biblioteca de compressão.
+ *
+ * Parâmetros:
+ * -----------
+ * - pixels: Os píxeis RGBA do quadro.
+ * - frame: O número do quadro na gravação.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o ficheiro foi escrito.
+ *
+ ******************************************************************************/
+bool FrameCapture::WritePng(const unsigned char* pixels, GLuint frame) {
+	// Linhas de cima para baixo, cada uma com o filtro 0 (nenhum) seguido dos píxeis RGB
+	const size_t rowSize = 1 + (size_t)width * 3;
+	std::vector<unsigned char> image(rowSize * height);
+	for (GLsizei y = 0; y < height; y++) {
+		const unsigned char* source = pixels + (size_t)(height - 1 - y) * width * 4;
+		unsigned char* row = &image[rowSize * y];
+		row[0] = 0;
+		for (GLsizei x = 0; x < width; x++) {
+			row[1 + x * 3 + 0] = source[x * 4 + 0];
+			row[1 + x * 3 + 1] = source[x * 4 + 1];
+			row[1 + x * 3 + 2] = source[x * 4 + 2];
+		}
+	}
+
+	// Fluxo zlib com blocos sem compressão e o Adler-32 da imagem
+	converted.clear();
+	converted.push_back(0x78);
+	converted.push_back(0x01);
+	uint32_t adlerA = 1, adlerB = 0;
+	for (size_t offset = 0; offset < image.size(); offset += DEFLATE_STORED_BLOCK) {
+		size_t blockSize = std::min(DEFLATE_STORED_BLOCK, image.size() - offset);
+		converted.push_back(offset + blockSize == image.size() ? 1 : 0);
+		converted.push_back((unsigned char)blockSize);
+		converted.push_back((unsigned char)(blockSize >> 8));
+		converted.push_back((unsigned char)~blockSize);
+		converted.push_back((unsigned char)(~blockSize >> 8));
+		converted.insert(converted.end(), image.begin() + offset, image.begin() + offset + blockSize);
+
+		for (size_t i = offset; i < offset + blockSize; i++) {
+			adlerA = (adlerA + image[i]) % 65521;
+			adlerB = (adlerB + adlerA) % 65521;
+		}
+	}
+	PutBigEndian(converted, (adlerB << 16) | adlerA);
+
+	std::vector<unsigned char> header;
+	PutBigEndian(header, (uint32_t)width);
+	PutBigEndian(header, (uint32_t)height);
+	header.push_back(8); // Bits por componente
+	header.push_back(2); // RGB
+	header.push_back(0); // Compressão deflate
+	header.push_back(0); // Filtros adaptativos
+	header.push_back(0); // Sem entrelaçamento
+
+	char fileName[32];
+	snprintf(fileName, sizeof(fileName), "Capture_%05u.png", frame);
+	FILE* file = fopen(fileName, "wb");
+	if (file == nullptr)
+		return false;
+
+	static const unsigned char PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	bool written = fwrite(PNG_SIGNATURE, 1, sizeof(PNG_SIGNATURE), file) == sizeof(PNG_SIGNATURE)
+		&& WritePngChunk(file, "IHDR", header.data(), header.size())
+		&& WritePngChunk(file, "IDAT", converted.data(), converted.size())
+		&& WritePngChunk(file, "IEND", nullptr, 0);
+	return fclose(file) == 0 && written;
+}
+
+
+/*****************************************************************************
+ * bool FrameCapture::WriteYuv(const unsigned char* pixels)
+ *
+ * Descrição:
+ * ----------
+ * Acrescenta um quadro ao ficheiro YUV em I420: o plano Y de cada píxel e os
+ * planos U e V da média de cada bloco de 2x2 píxeis (BT.601, gama limitada).
+ *
+ * Parâmetros:
+ * -----------
+ * - pixels: Os píxeis RGBA do quadro.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o quadro foi escrito.
+ *
+ ******************************************************************************/
+bool FrameCapture::WriteYuv(const unsigned char* pixels) {
+	const size_t lumaSize = (size_t)width * height;
+	const size_t chromaWidth = width / 2;
+	converted.resize(lumaSize + lumaSize / 2);
+	unsigned char* planeY = converted.data();
+	unsigned char* planeU = planeY + lumaSize;
+	unsigned char* planeV = planeU + lumaSize / 4;
+
+	for (GLsizei y = 0; y < height; y++) {
+		const unsigned char* source = pixels + (size_t)(height - 1 - y) * width * 4;
+		for (GLsizei x = 0; x < width; x++) {
+			int r = source[x * 4 + 0], g = source[x * 4 + 1], b = source[x * 4 + 2];
+			planeY[(size_t)y * width + x] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+		}
+	}
+
+	for (GLsizei y = 0; y < height / 2; y++) {
+		const unsigned char* row0 = pixels + (size_t)(height - 1 - 2 * y) * width * 4;
+		const unsigned char* row1 = row0 - (size_t)width * 4;
+		for (size_t x = 0; x < chromaWidth; x++) {
+			int r = (row0[x * 8 + 0] + row0[x * 8 + 4] + row1[x * 8 + 0] + row1[x * 8 + 4] + 2) / 4;
+			int g = (row0[x * 8 + 1] + row0[x * 8 + 5] + row1[x * 8 + 1] + row1[x * 8 + 5] + 2) / 4;
+			int b = (row0[x * 8 + 2] + row0[x * 8 + 6] + row1[x * 8 + 2] + row1[x * 8 + 6] + 2) / 4;
+			planeU[y * chromaWidth + x] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+			planeV[y * chromaWidth + x] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+		}
+	}
+
+	return fwrite(converted.data(), 1, converted.size(), output) == converted.size();
+}
+
+
+/*****************************************************************************
+ * bool FrameCapture::WriteRgb(const unsigned char* pixels)
+ *
+ * Descrição:
+ * ----------
+ * Envia um quadro ao codificador externo em RGB de 24 bits, de cima para baixo.
+ *
+ * Parâmetros:
+ * -----------
+ * - pixels: Os píxeis RGBA do quadro.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o quadro foi enviado.
+ *
+ ******************************************************************************/
+bool FrameCapture::WriteRgb(const unsigned char* pixels) {
+	converted.resize((size_t)width * height * 3);
+	for (GLsizei y = 0; y < height; y++) {
+		const unsigned char* source = pixels + (size_t)(height - 1 - y) * width * 4;
+		unsigned char* row = &converted[(size_t)y * width * 3];
+		for (GLsizei x = 0; x < width; x++) {
+			row[x * 3 + 0] = source[x * 4 + 0];
+			row[x * 3 + 1] = source[x * 4 + 1];
+			row[x * 3 + 2] = source[x * 4 + 2];
+		}
+	}
+
+	return fwrite(converted.data(), 1, converted.size(), output) == converted.size();
+}
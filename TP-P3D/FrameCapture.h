@@ -0,0 +1,82 @@
+﻿#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <GL/glew.h>
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Gravação dos quadros sem parar o desenho: cada quadro é copiado com glReadPixels para um pixel buffer object mapeado
+// de forma persistente, e uma thread de codificação lê-o quando a sua fence é sinalizada (alguns quadros depois) e
+// escreve-o em PNG, num ficheiro YUV ou num codificador externo. Se não houver um buffer livre, o quadro não é gravado.
+class FrameCapture {
+public:
+	static const int BUFFER_COUNT = 6; // Quadros em leitura ou à espera da codificação ao mesmo tempo
+	static const int FRAME_RATE = 60;  // Quadros por segundo indicados ao codificador (o passo do modo --headless)
+
+	// Destino dos quadros gravados
+	enum Format {
+		FORMAT_PNG,  // Capture_00000.png, Capture_00001.png, ...
+		FORMAT_YUV,  // Capture.yuv: I420 (BT.601) de todos os quadros seguidos
+		FORMAT_PIPE  // Vídeo Capture.mp4 escrito pelo ffmpeg, que recebe os quadros em RGB pela entrada padrão
+	};
+
+	// Contadores da gravação atual
+	struct Stats {
+		GLuint captured; // Quadros gravados ou em gravação
+		GLuint dropped;  // Quadros descartados por não haver um buffer livre
+	};
+
+	FrameCapture();
+	~FrameCapture(); // Termina a gravação
+
+	static bool ParseFormat(const char* name, Format& format); // "png", "yuv" ou "pipe"
+
+	bool Start(Format format, GLsizei width, GLsizei height); // Começa a gravar quadros deste tamanho
+	void Stop(); // Espera pelos quadros em leitura e pela codificação, e fecha os ficheiros
+	void Capture(); // Copia o framebuffer de leitura atual (chamada depois de desenhar o quadro, antes da troca)
+
+	bool IsRecording() const { return recording; }
+	const Stats& GetStats() const { return stats; }
+
+private:
+	enum BufferState { BUFFER_FREE, BUFFER_READING, BUFFER_ENCODING };
+
+	// Pixel buffer object do anel, mapeado de forma persistente
+	struct CaptureBuffer {
+		GLuint buffer = 0;
+		unsigned char* data = nullptr; // Memória mapeada, lida pela thread de codificação
+		BufferState state = BUFFER_FREE;
+		GLsync fence = nullptr;        // Sinalizada quando a cópia do quadro para o buffer termina
+		GLuint frame = 0;              // Número do quadro na gravação
+	};
+
+	Format format;
+	GLsizei width, height;
+	bool recording;
+	std::vector<CaptureBuffer> buffers;
+	int writeIndex; // Próximo buffer a receber um quadro (os buffers são usados e libertados por ordem)
+	int readIndex;  // Buffer mais antigo em leitura
+	FILE* output;   // Ficheiro YUV ou processo do codificador
+	std::vector<unsigned char> converted; // Quadro convertido pela thread de codificação (RGB, I420 ou PNG)
+	bool encodeFailed; // Alguma escrita falhou (escrito pela thread de codificação, lido depois de a terminar)
+	Stats stats;
+
+	std::thread encoder;
+	std::mutex mutex;                    // Protege `frames`, `stopping` e o estado dos buffers em codificação
+	std::condition_variable frameSignal; // Acorda a thread de codificação quando há um quadro ou no fim
+	std::deque<int> frames;              // Índices dos buffers prontos, por ordem
+	bool stopping;
+
+	void QueueReadyBuffers(bool wait); // Passa à codificação os buffers cuja cópia terminou
+	void EncoderLoop(); // Ciclo da thread de codificação
+	bool Encode(const CaptureBuffer& capture); // Escreve um quadro no destino (na thread de codificação)
+	bool WritePng(const unsigned char* pixels, GLuint frame);
+	bool WriteYuv(const unsigned char* pixels);
+	bool WriteRgb(const unsigned char* pixels);
+};
+
+#endif // FRAME_CAPTURE_H
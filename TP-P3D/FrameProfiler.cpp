@@ -0,0 +1,523 @@
+﻿/*****************************************************************************
+ * FrameProfiler.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe FrameProfiler, que mede onde é gasto o tempo de cada quadro.
+ * A classe FrameProfiler é responsável por:
+ * - Medir as zonas da CPU (ProfileZone) com o relógio monótono, em qualquer thread.
+ * - Medir as zonas da GPU com conjuntos de consultas GL_TIME_ELAPSED, um por quadro em voo, lidos FRAME_LATENCY
+ *   quadros depois e descartados se ainda não tiverem terminado (a leitura nunca espera pela GPU).
+ * - Guardar os intervalos num anel de tamanho fixo sem locks: cada posição é reservada com um contador atómico e
+ *   tem um número de sequência que permite ler o anel enquanto outra thread escreve.
+ * - Escrever os intervalos guardados no formato JSON de traços do Chrome (eventos "X"), com uma linha por thread
+ *   da CPU e uma linha para a GPU.
+ *
+ * Funções principais:
+ * - Create(): Cria as consultas da GPU.
+ * - BeginFrame(): Lê as consultas de FRAME_LATENCY quadros antes e começa um quadro novo.
+ * - BeginGpuZone() / EndGpuZone(...): Começam e terminam a consulta de uma zona da GPU.
+ * - AddEvent(const ProfileEvent& event): Guarda um intervalo no anel.
+ * - WriteChromeTrace(const std::string& fileName): Escreve os intervalos guardados em JSON.
+ * - Summarize(): Soma os intervalos guardados de cada zona (relatório do modo --headless).
+ * - ProfileZone::Begin(bool gpu) / ProfileZone::End(): Início e fim de uma zona.
+ *
+ * Variáveis e constantes importantes:
+ * - FRAME_LATENCY: Quadros entre uma consulta da GPU e a sua leitura.
+ * - MAX_GPU_ZONES: Zonas da GPU por quadro.
+ * - RING_SIZE: Número de intervalos guardados no anel.
+ * - writeIndex: Contador atómico com o índice do próximo intervalo.
+ * - gpuCursor: Fim da última zona da GPU, usado para colocar as zonas da GPU no traço.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+#include "FrameProfiler.h"
+
+// Índice da thread atual nas linhas do traço (a primeira thread que mede uma zona fica com o índice 1)
+static uint32_t CurrentThreadIndex() {
+	static std::atomic<uint32_t> nextThread(FrameProfiler::GPU_THREAD + 1);
+	thread_local uint32_t threadIndex = nextThread.fetch_add(1);
+	return threadIndex;
+}
+
+// Escreve um nome entre aspas, com as aspas e as barras escapadas
+static void WriteJsonString(std::ofstream& file, const char* text) {
+	file << '"';
+	for (const char* c = text; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\')
+			file << '\\';
+		file << *c;
+	}
+	file << '"';
+}
+
+
+/*****************************************************************************
+ * FrameProfiler::FrameProfiler()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `FrameProfiler`. Reserva o anel de intervalos e marca o
+ * início do relógio do traço. O profiler começa desligado; as consultas da GPU
+ * são criadas em `Create`, depois de o contexto OpenGL existir.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+FrameProfiler::FrameProfiler()
+	: enabled(false),
+	startTime(std::chrono::steady_clock::now()),
+	ring(new Slot[RING_SIZE]),
+	writeIndex(0),
+	queriesCreated(false),
+	gpuZoneActive(false),
+	gpuCursor(0),
+	frame(0) {
+	for (size_t i = 0; i < RING_SIZE; i++)
+		ring[i].sequence.store(0, std::memory_order_relaxed);
+	for (GpuFrame& gpuFrame : gpuFrames) {
+		std::fill(gpuFrame.queries, gpuFrame.queries + MAX_GPU_ZONES, 0);
+		gpuFrame.zoneCount = 0;
+		gpuFrame.frame = 0;
+	}
+	ResetStats();
+}
+
+
+/*****************************************************************************
+ * FrameProfiler::~FrameProfiler()
+ *
+ * Descrição:
+ * ----------
+ * Destrutor da classe `FrameProfiler`, que liberta as consultas da GPU.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (destrutor).
+ *
+ ******************************************************************************/
+FrameProfiler::~FrameProfiler() {
+	if (!queriesCreated)
+		return;
+
+	for (GpuFrame& gpuFrame : gpuFrames)
+		glDeleteQueries(MAX_GPU_ZONES, gpuFrame.queries);
+}
+
+
+/*****************************************************************************
+ * bool FrameProfiler::Create()
+ *
+ * Descrição:
+ * ----------
+ * Cria os FRAME_LATENCY conjuntos de MAX_GPU_ZONES consultas. Sem as consultas,
+ * o profiler continua a medir as zonas da CPU.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se as consultas foram criadas.
+ *
+ ******************************************************************************/
+bool FrameProfiler::Create() {
+	for (GpuFrame& gpuFrame : gpuFrames)
+		glGenQueries(MAX_GPU_ZONES, gpuFrame.queries);
+
+	if (glGetError() != GL_NO_ERROR) {
+		std::cout << "Failed to create profiler queries" << std::endl;
+		return false;
+	}
+
+	queriesCreated = true;
+	return true;
+}
+
+
+/*****************************************************************************
+ * void FrameProfiler::SetEnabled(bool enabled)
+ *
+ * Descrição:
+ * ----------
+ * Liga ou desliga o profiler. As zonas já começadas terminam normalmente; as
+ * consultas de quadros anteriores continuam a ser lidas em `BeginFrame`.
+ *
+ * Parâmetros:
+ * -----------
+ * - enabled: true para medir as zonas seguintes.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void FrameProfiler::SetEnabled(bool enabled) {
+	this->enabled.store(enabled, std::memory_order_relaxed);
+	std::cout << "Profiler " << (enabled ? "enabled" : "disabled") << std::endl;
+}
+
+
+/*****************************************************************************
+ * void FrameProfiler::BeginFrame()
+ *
+ * Descrição:
+ * ----------
+ * Começa um quadro novo. O conjunto de consultas do quadro é o usado
+ * FRAME_LATENCY quadros antes, por isso os tempos dessas consultas são passados
+ * para o anel antes de o conjunto ser reutilizado.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void FrameProfiler::BeginFrame() {
+	uint32_t current = frame.fetch_add(1, std::memory_order_relaxed) + 1;
+
+	GpuFrame& gpuFrame = gpuFrames[current % FRAME_LATENCY];
+	if (gpuFrame.zoneCount > 0)
+		ReadGpuFrame(gpuFrame);
+
+	gpuFrame.zoneCount = 0;
+	gpuFrame.frame = current;
+}
+
+
+/*****************************************************************************
+ * void FrameProfiler::ReadGpuFrame(GpuFrame& gpuFrame)
+ *
+ * Descrição:
+ * ----------
+ * Passa para o anel os tempos das consultas de um quadro. Se alguma ainda não
+ * tiver terminado, o quadro é descartado em vez de esperar pela GPU.
+ *
+ * Como GL_TIME_ELAPSED só dá a duração, cada zona é colocada na linha da GPU a
+ * seguir à anterior, mas nunca antes de ter sido enviada pela CPU nem depois da
+ * leitura (alguns drivers dão um tempo inválido na primeira consulta, que assim
+ * não empurra as zonas seguintes para fora do traço).
+ *
+ * Parâmetros:
+ * -----------
+ * - gpuFrame: O conjunto de consultas a ler.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void FrameProfiler::ReadGpuFrame(GpuFrame& gpuFrame) {
+	// Os resultados ficam disponíveis pela ordem das consultas, por isso basta ver a última
+	GLint available = 0;
+	glGetQueryObjectiv(gpuFrame.queries[gpuFrame.zoneCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		stats.droppedGpuFrames++;
+		return;
+	}
+
+	int64_t now = Now();
+	for (GLint i = 0; i < gpuFrame.zoneCount; i++) {
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(gpuFrame.queries[i], GL_QUERY_RESULT, &elapsed);
+
+		ProfileEvent event;
+		event.name = gpuFrame.names[i];
+		event.duration = std::min((int64_t)(elapsed / 1000), now - gpuFrame.cpuStarts[i]);
+		event.start = std::min(std::max(gpuFrame.cpuStarts[i], gpuCursor), now - event.duration);
+		event.thread = GPU_THREAD;
+		event.frame = gpuFrame.frame;
+		AddEvent(event);
+
+		gpuCursor = event.start + event.duration;
+	}
+}
+
+
+/*****************************************************************************
+ * int64_t FrameProfiler::Now() const
+ *
+ * Retorno:
+ * --------
+ * - int64_t: Os microssegundos passados desde a criação do profiler.
+ *
+ ******************************************************************************/
+int64_t FrameProfiler::Now() const {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+
+/*****************************************************************************
+ * GLint FrameProfiler::BeginGpuZone()
+ *
+ * Descrição:
+ * ----------
+ * Começa a consulta GL_TIME_ELAPSED da próxima zona da GPU do quadro. Só pode
+ * ser chamada na thread do OpenGL, e as zonas da GPU não podem ser encaixadas:
+ * uma zona começada dentro de outra (ou depois de MAX_GPU_ZONES) só é medida na
+ * CPU.
+ *
+ * Retorno:
+ * --------
+ * - GLint: O índice da zona no quadro, ou -1 se a consulta não foi começada.
+ *
+ ******************************************************************************/
+GLint FrameProfiler::BeginGpuZone() {
+	GpuFrame& gpuFrame = gpuFrames[GetFrame() % FRAME_LATENCY];
+	if (!queriesCreated || gpuZoneActive || gpuFrame.zoneCount >= MAX_GPU_ZONES)
+		return -1;
+
+	glBeginQuery(GL_TIME_ELAPSED, gpuFrame.queries[gpuFrame.zoneCount]);
+	gpuZoneActive = true;
+	return gpuFrame.zoneCount++;
+}
+
+
+/*****************************************************************************
+ * void FrameProfiler::EndGpuZone(GLint zone, const char* name, int64_t cpuStart)
+ *
+ * Descrição:
+ * ----------
+ * Termina a consulta de uma zona da GPU. O tempo só é lido FRAME_LATENCY quadros
+ * depois, em `BeginFrame`.
+ *
+ * Parâmetros:
+ * -----------
+ * - zone: O índice devolvido por `BeginGpuZone`.
+ * - name: O nome da zona.
+ * - cpuStart: O início da zona na CPU.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void FrameProfiler::EndGpuZone(GLint zone, const char* name, int64_t cpuStart) {
+	glEndQuery(GL_TIME_ELAPSED);
+	gpuZoneActive = false;
+
+	GpuFrame& gpuFrame = gpuFrames[GetFrame() % FRAME_LATENCY];
+	gpuFrame.names[zone] = name;
+	gpuFrame.cpuStarts[zone] = cpuStart;
+}
+
+
+/*****************************************************************************
+ * void FrameProfiler::AddEvent(const ProfileEvent& event)
+ *
+ * Descrição:
+ * ----------
+ * Guarda um intervalo no anel, substituindo o mais antigo quando está cheio. A
+ * posição é reservada com um fetch_add, por isso várias threads podem guardar
+ * intervalos ao mesmo tempo sem locks. O número de sequência da posição fica
+ * ímpar durante a escrita, para que `WriteChromeTrace` ignore intervalos a meio.
+ *
+ * Parâmetros:
+ * -----------
+ * - event: O intervalo a guardar.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void FrameProfiler::AddEvent(const ProfileEvent& event) {
+	uint64_t index = writeIndex.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = ring[index % RING_SIZE];
+
+	slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.event = event;
+	slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+
+/*****************************************************************************
+ * void FrameProfiler::CopyEvents(std::vector<ProfileEvent>& events) const
+ *
+ * Descrição:
+ * ----------
+ * Copia os intervalos guardados no anel, do mais antigo para o mais recente. O
+ * anel pode continuar a ser escrito durante a cópia: os intervalos cuja
+ * sequência muda durante a leitura são ignorados.
+ *
+ * Parâmetros:
+ * -----------
+ * - events: O vetor onde os intervalos são copiados (substituindo o conteúdo).
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void FrameProfiler::CopyEvents(std::vector<ProfileEvent>& events) const {
+	uint64_t end = writeIndex.load(std::memory_order_acquire);
+	uint64_t begin = end > RING_SIZE ? end - RING_SIZE : 0;
+
+	events.clear();
+	events.reserve((size_t)(end - begin));
+	for (uint64_t index = begin; index < end; index++) {
+		const Slot& slot = ring[index % RING_SIZE];
+		uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		if (sequence != 2 * index + 2)
+			continue;
+
+		ProfileEvent event = slot.event;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+			continue;
+
+		events.push_back(event);
+	}
+}
+
+
+/*****************************************************************************
+ * std::vector<ProfileSummary> FrameProfiler::Summarize() const
+ *
+ * Descrição:
+ * ----------
+ * Soma as durações dos intervalos guardados no anel de cada zona, separando os
+ * tempos da CPU dos da GPU. As zonas ficam pela ordem em que aparecem pela
+ * primeira vez, que é a ordem das etapas do quadro.
+ *
+ * Retorno:
+ * --------
+ * - std::vector<ProfileSummary>: Uma soma por zona e por linha (CPU ou GPU).
+ *
+ ******************************************************************************/
+std::vector<ProfileSummary> FrameProfiler::Summarize() const {
+	std::vector<ProfileEvent> events;
+	CopyEvents(events);
+
+	std::vector<ProfileSummary> summaries;
+	for (const ProfileEvent& event : events) {
+		bool gpu = event.thread == GPU_THREAD;
+		size_t i = 0;
+		while (i < summaries.size() && (summaries[i].gpu != gpu || strcmp(summaries[i].name, event.name) != 0))
+			i++;
+
+		if (i == summaries.size())
+			summaries.push_back({ event.name, gpu, 0, 0 });
+		summaries[i].count++;
+		summaries[i].total += event.duration;
+	}
+	return summaries;
+}
+
+
+/*****************************************************************************
+ * bool FrameProfiler::WriteChromeTrace(const std::string& fileName) const
+ *
+ * Descrição:
+ * ----------
+ * Escreve os intervalos guardados no anel no formato JSON de traços do Chrome,
+ * que pode ser aberto em chrome://tracing ou em ui.perfetto.dev. Cada intervalo
+ * é um evento completo ("ph": "X") com o número do quadro nos argumentos, e as
+ * linhas da GPU e das threads da CPU têm nomes (eventos "M").
+ *
+ * Parâmetros:
+ * -----------
+ * - fileName: O caminho do ficheiro a escrever.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o ficheiro foi escrito.
+ *
+ ******************************************************************************/
+bool FrameProfiler::WriteChromeTrace(const std::string& fileName) const {
+	std::vector<ProfileEvent> events;
+	CopyEvents(events);
+
+	uint32_t threadCount = GPU_THREAD + 1;
+	for (const ProfileEvent& event : events)
+		threadCount = std::max(threadCount, event.thread + 1);
+
+	std::ofstream file(fileName);
+	if (!file) {
+		std::cout << "Failed to write profiler trace " << fileName << std::endl;
+		return false;
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"PoolTable\"}}";
+	for (uint32_t thread = 0; thread < threadCount; thread++) {
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread << ",\"args\":{\"name\":\"";
+		if (thread == GPU_THREAD)
+			file << "GPU";
+		else
+			file << "CPU thread " << thread;
+		file << "\"}}";
+	}
+
+	for (const ProfileEvent& event : events) {
+		file << ",\n{\"name\":";
+		WriteJsonString(file, event.name);
+		file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.start << ",\"dur\":" << event.duration
+			<< ",\"args\":{\"frame\":" << event.frame << "}}";
+	}
+	file << "\n]}\n";
+
+	if (!file) {
+		std::cout << "Failed to write profiler trace " << fileName << std::endl;
+		return false;
+	}
+
+	std::cout << "Wrote " << events.size() << " profiler events to " << fileName << std::endl;
+	return true;
+}
+
+
+/*****************************************************************************
+ * void ProfileZone::Begin(bool gpu)
+ *
+ * Descrição:
+ * ----------
+ * Marca o início de uma zona e, se pedido, começa a sua consulta da GPU. Só é
+ * chamada com o profiler ligado.
+ *
+ * Parâmetros:
+ * -----------
+ * - gpu: true para medir também o tempo da GPU (só na thread do OpenGL).
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void ProfileZone::Begin(bool gpu) {
+	if (gpu)
+		gpuZone = profiler->BeginGpuZone();
+	start = profiler->Now();
+}
+
+
+/*****************************************************************************
+ * void ProfileZone::End()
+ *
+ * Descrição:
+ * ----------
+ * Guarda o intervalo da CPU da zona no anel e termina a consulta da GPU, se a
+ * zona tiver uma.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void ProfileZone::End() {
+	ProfileEvent event;
+	event.name = name;
+	event.start = start;
+	event.duration = profiler->Now() - start;
+	event.thread = CurrentThreadIndex();
+	event.frame = profiler->GetFrame();
+
+	if (gpuZone >= 0)
+		profiler->EndGpuZone(gpuZone, name, start);
+
+	profiler->AddEvent(event);
+}
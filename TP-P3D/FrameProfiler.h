@@ -0,0 +1,124 @@
+﻿#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+#include <GL/glew.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <chrono>
+
+// Intervalo medido, em microssegundos desde a criação do profiler
+struct ProfileEvent {
+	const char* name;  // Nome da zona (texto literal: só o apontador é guardado)
+	int64_t start;     // Início
+	int64_t duration;  // Duração
+	uint32_t thread;   // GPU_THREAD ou o índice da thread da CPU que mediu a zona
+	uint32_t frame;    // Número do quadro (contado por BeginFrame)
+};
+
+// Soma dos intervalos guardados de uma zona, na CPU ou na GPU
+struct ProfileSummary {
+	const char* name;
+	bool gpu;       // Tempos da GPU (linha GPU_THREAD)
+	uint32_t count; // Número de intervalos
+	int64_t total;  // Soma das durações, em microssegundos
+};
+
+// Profiler das etapas de cada quadro: as zonas da CPU são medidas com o relógio e as da GPU com consultas
+// GL_TIME_ELAPSED, lidas FRAME_LATENCY quadros depois sem esperar pela GPU. Os intervalos vão para um anel sem locks e
+// são escritos a pedido no formato JSON do Chrome (chrome://tracing ou Perfetto). Desligado, cada zona só lê um bool.
+class FrameProfiler {
+public:
+	static const int FRAME_LATENCY = 3;    // Quadros entre uma consulta da GPU e a sua leitura (conjuntos de consultas)
+	static const int MAX_GPU_ZONES = 16;   // Zonas da GPU por quadro (as seguintes só são medidas na CPU)
+	static const size_t RING_SIZE = 16384; // Intervalos guardados (os mais antigos são substituídos)
+	static const uint32_t GPU_THREAD = 0;  // Linha do traço com as zonas da GPU
+
+	// Contadores desde o último ResetStats
+	struct Stats {
+		GLuint droppedGpuFrames; // Quadros cujas consultas ainda não tinham terminado quando foram lidas
+	};
+
+	FrameProfiler();
+	~FrameProfiler(); // Liberta as consultas
+
+	bool Create(); // Cria as consultas da GPU (precisa do contexto OpenGL)
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+	void BeginFrame(); // Lê as consultas de FRAME_LATENCY quadros antes e começa um quadro novo
+	bool WriteChromeTrace(const std::string& fileName) const; // Escreve os intervalos guardados em JSON
+	std::vector<ProfileSummary> Summarize() const; // Soma os intervalos guardados por zona (pela ordem da primeira vez)
+
+	int64_t Now() const; // Microssegundos desde a criação do profiler
+	GLint BeginGpuZone(); // Começa uma consulta GL_TIME_ELAPSED; -1 se não houver (ou se outra estiver ativa)
+	void EndGpuZone(GLint zone, const char* name, int64_t cpuStart); // Termina a consulta começada por BeginGpuZone
+	void AddEvent(const ProfileEvent& event); // Guarda um intervalo no anel (pode ser chamada por qualquer thread)
+	uint32_t GetFrame() const { return frame.load(std::memory_order_relaxed); }
+
+	const Stats& GetStats() const { return stats; }
+	void ResetStats() { stats = Stats(); }
+
+private:
+	// Posição do anel: `sequence` é ímpar enquanto o intervalo é escrito e 2 * (índice + 1) depois de escrito
+	struct Slot {
+		std::atomic<uint64_t> sequence;
+		ProfileEvent event;
+	};
+
+	// Consultas de um quadro, lidas FRAME_LATENCY quadros depois
+	struct GpuFrame {
+		GLuint queries[MAX_GPU_ZONES];
+		const char* names[MAX_GPU_ZONES];
+		int64_t cpuStarts[MAX_GPU_ZONES]; // Início de cada zona na CPU (o mais cedo possível para a GPU a começar)
+		GLint zoneCount;
+		uint32_t frame;
+	};
+
+	std::atomic<bool> enabled;
+	std::chrono::steady_clock::time_point startTime;
+	std::unique_ptr<Slot[]> ring;
+	std::atomic<uint64_t> writeIndex; // Índice do próximo intervalo (as posições são reservadas com fetch_add)
+
+	GpuFrame gpuFrames[FRAME_LATENCY];
+	bool queriesCreated;
+	bool gpuZoneActive; // As consultas GL_TIME_ELAPSED não podem ser encaixadas umas nas outras
+	int64_t gpuCursor;  // Fim da última zona da GPU no traço (a GPU executa as zonas pela ordem do envio)
+	std::atomic<uint32_t> frame; // Lido pelas zonas de todas as threads
+	Stats stats;
+
+	void ReadGpuFrame(GpuFrame& gpuFrame); // Passa os tempos das consultas terminadas para o anel
+	void CopyEvents(std::vector<ProfileEvent>& events) const; // Copia os intervalos do anel que não estão a ser escritos
+};
+
+// Zona medida do construtor ao destrutor. Com o profiler desligado, não faz nada além de ler IsEnabled.
+class ProfileZone {
+public:
+	// name: texto literal; gpu: mede também o tempo da GPU dos comandos enviados na zona
+	ProfileZone(FrameProfiler& profiler, const char* name, bool gpu = false)
+		: profiler(profiler.IsEnabled() ? &profiler : nullptr), name(name), start(0), gpuZone(-1) {
+		if (this->profiler != nullptr)
+			Begin(gpu);
+	}
+
+	~ProfileZone() {
+		if (profiler != nullptr)
+			End();
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	FrameProfiler* profiler; // nullptr se o profiler estava desligado no início da zona
+	const char* name;
+	int64_t start;
+	GLint gpuZone;
+
+	void Begin(bool gpu);
+	void End();
+};
+
+#endif // FRAME_PROFILER_H
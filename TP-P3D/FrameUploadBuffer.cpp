@@ -0,0 +1,273 @@
+﻿/*****************************************************************************
+ * FrameUploadBuffer.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe FrameUploadBuffer, o alocador dos dados de cada quadro
+ * (matrizes da câmera, luzes, dados de cada objeto e comandos de desenho indireto). A classe FrameUploadBuffer é responsável por:
+ * - Criar um único buffer com `glBufferStorage` e mapeá-lo uma só vez, de forma persistente
+ *   e coerente, para que a CPU escreva diretamente na memória lida pela GPU.
+ * - Dividir o buffer em FRAME_COUNT regiões usadas em anel: enquanto a GPU lê a região de um quadro,
+ *   a CPU escreve a do quadro seguinte.
+ * - Proteger cada região com uma fence (`glFenceSync`), esperando por ela antes de a voltar a escrever.
+ * - Ligar os intervalos escritos aos pontos de ligação dos blocos de uniforms e de armazenamento dos shaders.
+ *
+ * Funções principais:
+ * - FrameUploadBuffer(): Construtor da classe FrameUploadBuffer.
+ * - ~FrameUploadBuffer(): Destrutor, que apaga as fences e o buffer.
+ * - Create(GLsizeiptr frameSize): Cria e mapeia o buffer.
+ * - BeginFrame(): Passa à região seguinte do anel.
+ * - EndFrame(): Cria a fence da região atual.
+ * - Allocate(const void* data, GLsizeiptr size): Copia dados para a região atual.
+ * - UploadStorage(GLuint binding, const void* data, GLsizeiptr size): Copia um array e liga-o a um bloco de armazenamento.
+ * - Upload(GLuint binding, const T& block): Copia um bloco e liga o seu intervalo (definida em FrameUploadBuffer.h).
+ *
+ * Variáveis e constantes importantes:
+ * - FRAME_COUNT: Número de regiões do anel (3, tripla bufferização).
+ * - alignment: Alinhamento mínimo dos offsets ligados com `glBindBufferRange` (o maior entre uniforms e armazenamento).
+ * - fences: Fence de cada região, que indica quando a GPU terminou de a ler.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <cstring>
+
+#include "FrameUploadBuffer.h"
+
+// Tempo máximo de cada espera por uma fence, em nanossegundos (a espera repete-se até a fence ser sinalizada)
+static const GLuint64 FENCE_TIMEOUT = 1000000000;
+
+
+/*****************************************************************************
+ * FrameUploadBuffer::FrameUploadBuffer()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `FrameUploadBuffer`. Não cria o buffer, porque o contexto
+ * OpenGL pode ainda não existir; isso é feito em `Create`.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+FrameUploadBuffer::FrameUploadBuffer()
+	: buffer(0),
+	mapped(nullptr),
+	frameSize(0),
+	alignment(256),
+	frameIndex(0),
+	head(0),
+	overflowReported(false) {
+	for (int i = 0; i < FRAME_COUNT; i++)
+		fences[i] = 0;
+}
+
+
+/*****************************************************************************
+ * FrameUploadBuffer::~FrameUploadBuffer()
+ *
+ * Descrição:
+ * ----------
+ * Destrutor da classe `FrameUploadBuffer`. Apaga as fences pendentes, desfaz o
+ * mapeamento e apaga o buffer.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (destrutor).
+ *
+ ******************************************************************************/
+FrameUploadBuffer::~FrameUploadBuffer() {
+	for (int i = 0; i < FRAME_COUNT; i++) {
+		if (fences[i] != 0)
+			glDeleteSync(fences[i]);
+	}
+
+	if (buffer != 0) {
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glDeleteBuffers(1, &buffer);
+	}
+}
+
+
+/*****************************************************************************
+ * bool FrameUploadBuffer::Create(GLsizeiptr frameSize)
+ *
+ * Descrição:
+ * ----------
+ * Cria o buffer de uniforms com armazenamento imutável para FRAME_COUNT regiões
+ * e mapeia-o uma única vez com `GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT`.
+ * O apontador obtido é usado durante toda a execução: as escritas da CPU ficam
+ * visíveis para os comandos enviados a seguir, sem cópias feitas pelo driver e
+ * sem sincronizações implícitas como as de `glBufferSubData`.
+ *
+ * Parâmetros:
+ * -----------
+ * - frameSize: O tamanho de cada região, em bytes (é arredondado ao alinhamento dos offsets).
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se o buffer foi criado e mapeado, `false` caso contrário.
+ *
+ ******************************************************************************/
+bool FrameUploadBuffer::Create(GLsizeiptr frameSize) {
+	GLint storageAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+
+	// Ambos os alinhamentos são potências de 2, por isso o maior é múltiplo do outro
+	if (storageAlignment > alignment)
+		alignment = storageAlignment;
+
+	this->frameSize = (frameSize + alignment - 1) / alignment * alignment;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferStorage(GL_UNIFORM_BUFFER, this->frameSize * FRAME_COUNT, nullptr, flags);
+	mapped = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, this->frameSize * FRAME_COUNT, flags);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	if (mapped == nullptr) {
+		std::cout << "Failed to map the frame upload buffer" << std::endl;
+		return false;
+	}
+
+	frameIndex = 0;
+	head = 0;
+	return true;
+}
+
+
+/*****************************************************************************
+ * void FrameUploadBuffer::BeginFrame()
+ *
+ * Descrição:
+ * ----------
+ * Passa à região seguinte do anel. Se a GPU ainda estiver a ler essa região
+ * (a fence criada FRAME_COUNT quadros antes ainda não foi sinalizada), espera
+ * por ela; com três regiões isto só acontece se a CPU estiver mais de dois
+ * quadros à frente da GPU.
+ *
+ * Parâmetros:
+ * -----------
+ * - Nenhum.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void FrameUploadBuffer::BeginFrame() {
+	frameIndex = (frameIndex + 1) % FRAME_COUNT;
+	head = 0;
+
+	GLsync fence = fences[frameIndex];
+	if (fence == 0)
+		return;
+
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+	while (result == GL_TIMEOUT_EXPIRED)
+		result = glClientWaitSync(fence, 0, FENCE_TIMEOUT);
+
+	if (result == GL_WAIT_FAILED)
+		std::cout << "Failed to wait for the frame upload buffer fence" << std::endl;
+
+	glDeleteSync(fence);
+	fences[frameIndex] = 0;
+}
+
+
+/*****************************************************************************
+ * void FrameUploadBuffer::EndFrame()
+ *
+ * Descrição:
+ * ----------
+ * Cria a fence da região atual, depois de todos os comandos que a leem. Deve
+ * ser chamada depois do último desenho do quadro.
+ *
+ * Parâmetros:
+ * -----------
+ * - Nenhum.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void FrameUploadBuffer::EndFrame() {
+	if (fences[frameIndex] != 0)
+		glDeleteSync(fences[frameIndex]);
+
+	fences[frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+
+/*****************************************************************************
+ * GLintptr FrameUploadBuffer::Allocate(const void* data, GLsizeiptr size)
+ *
+ * Descrição:
+ * ----------
+ * Reserva `size` bytes na região atual, com o offset alinhado ao maior entre
+ * GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT e GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT,
+ * e copia os dados para a memória mapeada.
+ *
+ * Parâmetros:
+ * -----------
+ * - data: Os dados a copiar.
+ * - size: O número de bytes a copiar.
+ *
+ * Retorno:
+ * --------
+ * - GLintptr: O offset dos dados no buffer, ou -1 se a região do quadro estiver cheia.
+ *
+ ******************************************************************************/
+GLintptr FrameUploadBuffer::Allocate(const void* data, GLsizeiptr size) {
+	GLintptr offset = (head + alignment - 1) / alignment * alignment;
+
+	if (mapped == nullptr || offset + size > frameSize) {
+		if (!overflowReported) {
+			std::cout << "Frame upload buffer is full, skipping draw" << std::endl;
+			overflowReported = true;
+		}
+		return -1;
+	}
+
+	head = offset + size;
+
+	GLintptr bufferOffset = frameIndex * frameSize + offset;
+	memcpy(mapped + bufferOffset, data, size);
+	return bufferOffset;
+}
+
+
+/*****************************************************************************
+ * GLintptr FrameUploadBuffer::UploadStorage(GLuint binding, const void* data, GLsizeiptr size)
+ *
+ * Descrição:
+ * ----------
+ * Copia um array de dados para a região atual e liga esse intervalo ao ponto de
+ * ligação de um bloco de armazenamento (GL_SHADER_STORAGE_BUFFER). É usada para
+ * os dados dos objetos de um lote, que podem ser demasiados para um bloco de uniforms.
+ *
+ * Parâmetros:
+ * -----------
+ * - binding: O ponto de ligação do bloco de armazenamento.
+ * - data: Os dados a copiar.
+ * - size: O número de bytes a copiar.
+ *
+ * Retorno:
+ * --------
+ * - GLintptr: O offset dos dados no buffer, ou -1 se a região do quadro estiver cheia.
+ *
+ ******************************************************************************/
+GLintptr FrameUploadBuffer::UploadStorage(GLuint binding, const void* data, GLsizeiptr size) {
+	GLintptr offset = Allocate(data, size);
+	if (offset >= 0)
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, buffer, offset, size);
+
+	return offset;
+}
@@ -0,0 +1,44 @@
+﻿#ifndef FRAME_UPLOAD_BUFFER_H
+#define FRAME_UPLOAD_BUFFER_H
+
+#include <GL/glew.h>
+
+// Buffer mapeado de forma persistente, dividido em FRAME_COUNT regiões usadas em anel (uma por quadro),
+// de onde são lidos os blocos de uniforms, os blocos de armazenamento (SSBO) e os comandos de desenho indireto
+class FrameUploadBuffer {
+public:
+	static const int FRAME_COUNT = 3; // Quadros que a CPU pode estar à frente da GPU
+
+	FrameUploadBuffer();
+	~FrameUploadBuffer();
+
+	bool Create(GLsizeiptr frameSize); // Cria o buffer com uma região de frameSize bytes por quadro
+	void BeginFrame(); // Passa à região seguinte, esperando que a GPU a tenha libertado
+	void EndFrame();   // Marca o fim dos comandos que leem a região atual
+	GLintptr Allocate(const void* data, GLsizeiptr size); // Copia os dados para a região atual e devolve o offset (-1 se estiver cheia)
+	GLintptr UploadStorage(GLuint binding, const void* data, GLsizeiptr size); // Copia um array e liga-o a um bloco de armazenamento
+	GLuint GetBuffer() const { return buffer; } // Buffer OpenGL (para o ligar como GL_DRAW_INDIRECT_BUFFER)
+
+	// Copia um bloco de uniforms para a região atual e liga esse intervalo ao ponto de ligação indicado
+	template <typename T>
+	bool Upload(GLuint binding, const T& block) {
+		GLintptr offset = Allocate(&block, sizeof(T));
+		if (offset < 0)
+			return false;
+
+		glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, sizeof(T));
+		return true;
+	}
+
+private:
+	GLuint buffer;                 // Buffer de uniforms com armazenamento imutável
+	unsigned char* mapped;         // Apontador persistente para o início do buffer
+	GLsizeiptr frameSize;          // Tamanho de cada região, em bytes
+	GLint alignment;               // Maior alinhamento exigido aos offsets (blocos de uniforms e de armazenamento)
+	int frameIndex;                // Região usada no quadro atual
+	GLintptr head;                 // Próximo byte livre da região atual (relativo ao início da região)
+	GLsync fences[FRAME_COUNT];    // Fence de cada região, criada no fim do quadro que a usou
+	bool overflowReported;         // Evita repetir o aviso de região cheia em todos os quadros
+};
+
+#endif // FRAME_UPLOAD_BUFFER_H
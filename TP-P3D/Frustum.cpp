@@ -0,0 +1,386 @@
+﻿/*****************************************************************************
+ * Frustum.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação do recorte por volume de visualização (frustum culling) do jogo. É responsável por:
+ * - Calcular a esfera envolvente de uma malha a partir dos seus vértices.
+ * - Extrair os seis planos do volume de visualização a partir da matriz `proj * view * zoom` da câmera.
+ * - Testar esferas envolventes contra esses planos, uma a uma ou em lotes de 4 com instruções SIMD (SSE).
+ *
+ * Funções principais:
+ * - ComputeBoundingSphere(const std::vector<glm::vec3>& vertices): Calcula a esfera envolvente de uma malha.
+ * - ComputeBoundingSphere(const float* vertices, size_t vertexCount, size_t stride): Igual, para arrays intercalados.
+ * - SphereBatch::Add(const glm::vec3& center, float radius): Adiciona uma esfera ao lote SoA.
+ * - Frustum::Extract(const glm::mat4& viewProj): Extrai os planos do volume de visualização.
+ * - Frustum::IsSphereVisible(const glm::vec3& center, float radius): Testa uma única esfera.
+ * - Frustum::CullSpheres(const SphereBatch& batch, std::vector<int>& visible): Testa um lote de esferas.
+ * - Frustum::CullSpheres(const Frustum* frustums, size_t frustumCount, ...): Testa um lote contra a união de vários volumes.
+ *
+ * Variáveis e constantes importantes:
+ * - planes: Os seis planos normalizados do volume de visualização.
+ * - x, y, z, r: Arrays SoA com os centros e raios das esferas do lote.
+ *
+ ******************************************************************************/
+
+#include <cfloat>
+#include "Frustum.h"
+
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(__SSE__)
+#include <xmmintrin.h>
+#define FRUSTUM_USE_SSE
+#endif
+
+
+/*****************************************************************************
+ * BoundingSphere ComputeBoundingSphere(const std::vector<glm::vec3>& vertices)
+ *
+ * Descrição:
+ * ----------
+ * Calcula uma esfera envolvente para um conjunto de vértices. O centro é o centro
+ * da caixa alinhada aos eixos (AABB) dos vértices e o raio é a maior distância
+ * desse centro a um vértice, o que dá uma esfera justa para as bolas e para a mesa.
+ *
+ * Parâmetros:
+ * -----------
+ * - vertices: Os vértices da malha, no espaço do objeto.
+ *
+ * Retorno:
+ * --------
+ * - BoundingSphere: A esfera envolvente calculada.
+ *
+ ******************************************************************************/
+BoundingSphere ComputeBoundingSphere(const std::vector<glm::vec3>& vertices) {
+	if (vertices.empty())
+		return { glm::vec3(0.0f), 0.0f };
+
+	return ComputeBoundingSphere(&vertices[0].x, vertices.size(), 3);
+}
+
+
+/*****************************************************************************
+ * BoundingSphere ComputeBoundingSphere(const float* vertices, size_t vertexCount, size_t stride)
+ *
+ * Descrição:
+ * ----------
+ * Versão da função anterior para arrays de floats intercalados (por exemplo,
+ * posição seguida da normal, como os vértices da mesa).
+ *
+ * Parâmetros:
+ * -----------
+ * - vertices: Apontador para o primeiro float da posição do primeiro vértice.
+ * - vertexCount: Número de vértices.
+ * - stride: Número de floats entre o início de dois vértices consecutivos.
+ *
+ * Retorno:
+ * --------
+ * - BoundingSphere: A esfera envolvente calculada.
+ *
+ ******************************************************************************/
+BoundingSphere ComputeBoundingSphere(const float* vertices, size_t vertexCount, size_t stride) {
+	if (vertices == nullptr || vertexCount == 0)
+		return { glm::vec3(0.0f), 0.0f };
+
+	glm::vec3 minCorner(FLT_MAX);
+	glm::vec3 maxCorner(-FLT_MAX);
+	for (size_t i = 0; i < vertexCount; i++) {
+		glm::vec3 v(vertices[i * stride], vertices[i * stride + 1], vertices[i * stride + 2]);
+		minCorner = glm::min(minCorner, v);
+		maxCorner = glm::max(maxCorner, v);
+	}
+
+	BoundingSphere sphere;
+	sphere.center = (minCorner + maxCorner) * 0.5f;
+	sphere.radius = 0.0f;
+	for (size_t i = 0; i < vertexCount; i++) {
+		glm::vec3 v(vertices[i * stride], vertices[i * stride + 1], vertices[i * stride + 2]);
+		sphere.radius = glm::max(sphere.radius, glm::distance(sphere.center, v));
+	}
+
+	return sphere;
+}
+
+
+/*****************************************************************************
+ * void SphereBatch::Clear()
+ *
+ * Descrição:
+ * ----------
+ * Esvazia o lote sem libertar a memória, para que possa ser reutilizado em cada
+ * quadro sem novas alocações.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void SphereBatch::Clear() {
+	x.clear();
+	y.clear();
+	z.clear();
+	r.clear();
+	count = 0;
+}
+
+
+/*****************************************************************************
+ * size_t SphereBatch::Add(const glm::vec3& center, float radius)
+ *
+ * Descrição:
+ * ----------
+ * Adiciona uma esfera ao lote. Os arrays crescem sempre em blocos de 4 elementos,
+ * para que o teste SIMD possa ler 4 esferas de cada vez sem sair dos limites.
+ *
+ * Parâmetros:
+ * -----------
+ * - center: O centro da esfera.
+ * - radius: O raio da esfera.
+ *
+ * Retorno:
+ * --------
+ * - size_t: O índice da esfera no lote.
+ *
+ ******************************************************************************/
+size_t SphereBatch::Add(const glm::vec3& center, float radius) {
+	if (count % 4 == 0) {
+		x.resize(count + 4, 0.0f);
+		y.resize(count + 4, 0.0f);
+		z.resize(count + 4, 0.0f);
+		r.resize(count + 4, 0.0f);
+	}
+
+	x[count] = center.x;
+	y[count] = center.y;
+	z[count] = center.z;
+	r[count] = radius;
+
+	return count++;
+}
+
+
+/*****************************************************************************
+ * Frustum::Frustum()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `Frustum`. Inicializa os planos a zero, o que faz com que
+ * qualquer esfera seja considerada visível até à primeira chamada a `Extract`.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+Frustum::Frustum() {
+	for (int i = 0; i < 6; i++)
+		planes[i] = glm::vec4(0.0f);
+}
+
+
+/*****************************************************************************
+ * void Frustum::Extract(const glm::mat4& viewProj)
+ *
+ * Descrição:
+ * ----------
+ * Extrai os seis planos do volume de visualização a partir da matriz combinada
+ * (método de Gribb/Hartmann). Se a matriz incluir o zoom, os planos ficam no
+ * mesmo espaço que as posições das bolas e da mesa.
+ * Os planos são normalizados para que a distância a um ponto possa ser comparada
+ * diretamente com o raio de uma esfera.
+ *
+ * Parâmetros:
+ * -----------
+ * - viewProj: A matriz `proj * view * zoom` da câmera.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Frustum::Extract(const glm::mat4& viewProj) {
+	glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+	glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+	glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+	glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+	planes[0] = row3 + row0; // Esquerda
+	planes[1] = row3 - row0; // Direita
+	planes[2] = row3 + row1; // Baixo
+	planes[3] = row3 - row1; // Cima
+	planes[4] = row3 + row2; // Perto
+	planes[5] = row3 - row2; // Longe
+
+	for (int i = 0; i < 6; i++) {
+		float length = glm::length(glm::vec3(planes[i]));
+		if (length > 0.0f)
+			planes[i] /= length;
+	}
+}
+
+
+/*****************************************************************************
+ * bool Frustum::IsSphereVisible(const glm::vec3& center, float radius)
+ *
+ * Descrição:
+ * ----------
+ * Verifica se uma esfera interseta o volume de visualização. A esfera só é
+ * rejeitada quando está totalmente do lado de fora de pelo menos um plano.
+ *
+ * Parâmetros:
+ * -----------
+ * - center: O centro da esfera.
+ * - radius: O raio da esfera.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se a esfera for (pelo menos parcialmente) visível, `false` caso contrário.
+ *
+ ******************************************************************************/
+bool Frustum::IsSphereVisible(const glm::vec3& center, float radius) const {
+	for (int i = 0; i < 6; i++) {
+		if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+bool Frustum::IsSphereVisible(const BoundingSphere& sphere) const {
+	return IsSphereVisible(sphere.center, sphere.radius);
+}
+
+
+/*****************************************************************************
+ * void Frustum::CullSpheres(const SphereBatch& batch, std::vector<int>& visible)
+ *
+ * Descrição:
+ * ----------
+ * Testa todas as esferas de um lote contra o volume de visualização e escreve
+ * em `visible` os índices das esferas visíveis, por ordem crescente. Com SSE
+ * disponível, são testadas 4 esferas de cada vez (uma por canal) contra cada
+ * plano; caso contrário é usado o teste escalar.
+ *
+ * Parâmetros:
+ * -----------
+ * - batch: O lote de esferas, em layout SoA.
+ * - visible: Vetor de saída com os índices das esferas visíveis (é esvaziado primeiro).
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Frustum::CullSpheres(const SphereBatch& batch, std::vector<int>& visible) const {
+	visible.clear();
+
+	const size_t count = batch.Size();
+
+#ifdef FRUSTUM_USE_SSE
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++) {
+		planeX[p] = _mm_set1_ps(planes[p].x);
+		planeY[p] = _mm_set1_ps(planes[p].y);
+		planeZ[p] = _mm_set1_ps(planes[p].z);
+		planeW[p] = _mm_set1_ps(planes[p].w);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+
+	for (size_t i = 0; i < count; i += 4) {
+		__m128 cx = _mm_loadu_ps(&batch.x[i]);
+		__m128 cy = _mm_loadu_ps(&batch.y[i]);
+		__m128 cz = _mm_loadu_ps(&batch.z[i]);
+		__m128 negRadius = _mm_sub_ps(zero, _mm_loadu_ps(&batch.r[i]));
+
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4 && i + lane < count; lane++) {
+			if (mask & (1 << lane))
+				visible.push_back((int)(i + lane));
+		}
+	}
+#else
+	for (size_t i = 0; i < count; i++) {
+		if (IsSphereVisible(glm::vec3(batch.x[i], batch.y[i], batch.z[i]), batch.r[i]))
+			visible.push_back((int)i);
+	}
+#endif
+}
+
+
+/*****************************************************************************
+ * void Frustum::CullSpheres(const Frustum* frustums, size_t frustumCount, const SphereBatch& batch, std::vector<int>& visible)
+ *
+ * Descrição:
+ * ----------
+ * Testa todas as esferas de um lote contra a união de vários volumes de
+ * visualização (as vistas desenhadas na mesma passagem) e escreve em `visible`
+ * os índices das esferas visíveis em pelo menos um deles, por ordem crescente.
+ * Cada esfera é lida uma única vez; com SSE, as máscaras dos 4 canais de cada
+ * volume são juntadas com um OU, e os volumes seguintes só são testados
+ * enquanto algum canal ainda estiver fora de todos.
+ *
+ * Parâmetros:
+ * -----------
+ * - frustums: Os volumes de visualização.
+ * - frustumCount: O número de volumes.
+ * - batch: O lote de esferas, em layout SoA.
+ * - visible: Vetor de saída com os índices das esferas visíveis (é esvaziado primeiro).
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Frustum::CullSpheres(const Frustum* frustums, size_t frustumCount, const SphereBatch& batch, std::vector<int>& visible) {
+	visible.clear();
+
+	const size_t count = batch.Size();
+
+#ifdef FRUSTUM_USE_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const int allLanes = 0xF;
+
+	for (size_t i = 0; i < count; i += 4) {
+		__m128 cx = _mm_loadu_ps(&batch.x[i]);
+		__m128 cy = _mm_loadu_ps(&batch.y[i]);
+		__m128 cz = _mm_loadu_ps(&batch.z[i]);
+		__m128 negRadius = _mm_sub_ps(zero, _mm_loadu_ps(&batch.r[i]));
+
+		int mask = 0;
+		for (size_t f = 0; f < frustumCount && mask != allLanes; f++) {
+			const glm::vec4* planes = frustums[f].planes;
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (int p = 0; p < 6; p++) {
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].x), cx), _mm_mul_ps(_mm_set1_ps(planes[p].y), cy)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].z), cz), _mm_set1_ps(planes[p].w)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+			}
+			mask |= _mm_movemask_ps(inside);
+		}
+
+		for (int lane = 0; lane < 4 && i + lane < count; lane++) {
+			if (mask & (1 << lane))
+				visible.push_back((int)(i + lane));
+		}
+	}
+#else
+	for (size_t i = 0; i < count; i++) {
+		glm::vec3 center(batch.x[i], batch.y[i], batch.z[i]);
+		for (size_t f = 0; f < frustumCount; f++) {
+			if (frustums[f].IsSphereVisible(center, batch.r[i])) {
+				visible.push_back((int)i);
+				break;
+			}
+		}
+	}
+#endif
+}
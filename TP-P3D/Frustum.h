@@ -0,0 +1,45 @@
+﻿#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+// Esfera envolvente (centro e raio) usada nos testes de visibilidade
+struct BoundingSphere {
+	glm::vec3 center; // Centro da esfera
+	float radius;     // Raio da esfera
+};
+
+// Calcula a esfera envolvente de um conjunto de vértices
+BoundingSphere ComputeBoundingSphere(const std::vector<glm::vec3>& vertices);
+BoundingSphere ComputeBoundingSphere(const float* vertices, size_t vertexCount, size_t stride);
+
+// Lote de esferas em layout SoA (x[], y[], z[], r[]) para o teste SIMD, com padding para múltiplos de 4
+class SphereBatch {
+public:
+	std::vector<float> x, y, z, r; // Componentes das esferas, uma por índice
+
+	void Clear();                                    // Esvazia o lote
+	size_t Add(const glm::vec3& center, float radius); // Adiciona uma esfera e devolve o seu índice
+	size_t Size() const { return count; }             // Número de esferas válidas no lote
+
+private:
+	size_t count = 0; // Número de esferas válidas (os restantes elementos são padding)
+};
+
+class Frustum {
+public:
+	glm::vec4 planes[6]; // Planos (a, b, c, d) normalizados: esquerda, direita, baixo, cima, perto, longe
+
+	Frustum();
+
+	void Extract(const glm::mat4& viewProj); // Extrai os planos da matriz de projeção combinada
+	bool IsSphereVisible(const glm::vec3& center, float radius) const; // Teste de uma única esfera
+	bool IsSphereVisible(const BoundingSphere& sphere) const;
+	void CullSpheres(const SphereBatch& batch, std::vector<int>& visible) const; // Preenche os índices visíveis do lote
+
+	// Preenche os índices das esferas do lote visíveis em pelo menos um dos volumes (união dos volumes)
+	static void CullSpheres(const Frustum* frustums, size_t frustumCount, const SphereBatch& batch, std::vector<int>& visible);
+};
+
+#endif // FRUSTUM_H
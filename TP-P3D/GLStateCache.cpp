@@ -0,0 +1,277 @@
+﻿/*****************************************************************************
+ * GLStateCache.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe GLStateCache, uma cópia na CPU do estado OpenGL que muda entre
+ * desenhos (programa, VAO, texturas e intervalos de buffers ligados). A classe GLStateCache é responsável por:
+ * - Enviar ao OpenGL apenas as mudanças de estado que alteram alguma coisa, evitando trocas de programa e
+ *   ligações redundantes quando desenhos seguidos usam o mesmo estado.
+ * - Contar, em cada quadro, as chamadas enviadas e as chamadas evitadas.
+ *
+ * Funções principais:
+ * - GLStateCache(): Construtor da classe GLStateCache.
+ * - BeginFrame(): Reinicia os contadores do quadro.
+ * - Invalidate(): Esquece o estado conhecido.
+ * - UseProgram(GLuint program): Usa um programa de shader.
+ * - BindVertexArray(GLuint vertexArray): Liga um VAO.
+ * - BindTexture(GLuint unit, GLenum target, GLuint texture): Liga uma textura a uma unidade.
+ * - BindBuffer(GLenum target, GLuint buffer): Liga um buffer de comandos de desenho indireto.
+ * - BindUniformRange(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size): Liga um intervalo de um buffer a um bloco de uniforms.
+ *
+ * Variáveis e constantes importantes:
+ * - UNKNOWN: Valor guardado quando o estado é desconhecido, que obriga a próxima chamada a ser enviada.
+ * - counters: Chamadas enviadas (issued) e evitadas (saved) no quadro atual.
+ *
+ ******************************************************************************/
+
+#include "GLStateCache.h"
+
+
+/*****************************************************************************
+ * GLStateCache::GLStateCache()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `GLStateCache`. O estado começa desconhecido, por isso a
+ * primeira chamada de cada tipo é sempre enviada ao OpenGL.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+GLStateCache::GLStateCache() {
+	Invalidate();
+	BeginFrame();
+}
+
+
+/*****************************************************************************
+ * void GLStateCache::BeginFrame()
+ *
+ * Descrição:
+ * ----------
+ * Reinicia os contadores do quadro. O estado conhecido mantém-se, porque o
+ * estado OpenGL também se mantém de um quadro para o seguinte.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void GLStateCache::BeginFrame() {
+	counters.issued = 0;
+	counters.saved = 0;
+}
+
+
+/*****************************************************************************
+ * void GLStateCache::Invalidate()
+ *
+ * Descrição:
+ * ----------
+ * Esquece o estado conhecido. Deve ser chamada depois de código que altere o
+ * estado seguido pela cache sem passar por ela.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void GLStateCache::Invalidate() {
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	activeUnit = UNKNOWN;
+	drawIndirectBuffer = UNKNOWN;
+
+	for (GLuint i = 0; i < MAX_TEXTURE_UNITS; i++)
+		textures[i] = UNKNOWN;
+
+	for (GLuint i = 0; i < MAX_UNIFORM_BINDINGS; i++)
+		uniformRanges[i] = { UNKNOWN, 0, 0 };
+}
+
+
+/*****************************************************************************
+ * bool GLStateCache::Track(bool changed)
+ *
+ * Descrição:
+ * ----------
+ * Conta uma chamada pedida à cache como enviada ou evitada.
+ *
+ * Parâmetros:
+ * -----------
+ * - changed: `true` se o estado pedido for diferente do estado conhecido.
+ *
+ * Retorno:
+ * --------
+ * - bool: O próprio `changed`, ou seja, se a chamada deve ser enviada ao OpenGL.
+ *
+ ******************************************************************************/
+bool GLStateCache::Track(bool changed) {
+	if (changed)
+		counters.issued++;
+	else
+		counters.saved++;
+
+	return changed;
+}
+
+
+/*****************************************************************************
+ * void GLStateCache::UseProgram(GLuint program)
+ *
+ * Descrição:
+ * ----------
+ * Usa um programa de shader, se ainda não estiver em uso.
+ *
+ * Parâmetros:
+ * -----------
+ * - program: O programa de shader.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void GLStateCache::UseProgram(GLuint program) {
+	if (Track(this->program != program)) {
+		glUseProgram(program);
+		this->program = program;
+	}
+}
+
+
+/*****************************************************************************
+ * void GLStateCache::BindVertexArray(GLuint vertexArray)
+ *
+ * Descrição:
+ * ----------
+ * Liga um VAO, se ainda não estiver ligado.
+ *
+ * Parâmetros:
+ * -----------
+ * - vertexArray: O VAO.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void GLStateCache::BindVertexArray(GLuint vertexArray) {
+	if (Track(this->vertexArray != vertexArray)) {
+		glBindVertexArray(vertexArray);
+		this->vertexArray = vertexArray;
+	}
+}
+
+
+/*****************************************************************************
+ * void GLStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture)
+ *
+ * Descrição:
+ * ----------
+ * Liga uma textura a uma unidade de textura, se ainda não estiver ligada. A
+ * unidade ativa só é trocada quando é preciso ligar a textura. A cache guarda
+ * uma textura por unidade, por isso cada unidade deve ser usada com um só alvo.
+ *
+ * Parâmetros:
+ * -----------
+ * - unit: A unidade de textura (0 para GL_TEXTURE0).
+ * - target: O alvo da textura (por exemplo GL_TEXTURE_2D_ARRAY).
+ * - texture: A textura.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void GLStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture) {
+	if (unit >= MAX_TEXTURE_UNITS) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, texture);
+		activeUnit = unit;
+		counters.issued += 2;
+		return;
+	}
+
+	if (!Track(textures[unit] != texture))
+		return;
+
+	if (Track(activeUnit != unit)) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		activeUnit = unit;
+	}
+
+	glBindTexture(target, texture);
+	textures[unit] = texture;
+}
+
+
+/*****************************************************************************
+ * void GLStateCache::BindBuffer(GLenum target, GLuint buffer)
+ *
+ * Descrição:
+ * ----------
+ * Liga um buffer a GL_DRAW_INDIRECT_BUFFER, se ainda não estiver ligado. Os
+ * outros alvos são enviados sempre ao OpenGL, porque GL_ELEMENT_ARRAY_BUFFER faz
+ * parte do VAO e os restantes não são usados nos desenhos.
+ *
+ * Parâmetros:
+ * -----------
+ * - target: O alvo do buffer.
+ * - buffer: O buffer.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void GLStateCache::BindBuffer(GLenum target, GLuint buffer) {
+	if (target != GL_DRAW_INDIRECT_BUFFER) {
+		glBindBuffer(target, buffer);
+		counters.issued++;
+		return;
+	}
+
+	if (Track(drawIndirectBuffer != buffer)) {
+		glBindBuffer(target, buffer);
+		drawIndirectBuffer = buffer;
+	}
+}
+
+
+/*****************************************************************************
+ * void GLStateCache::BindUniformRange(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size)
+ *
+ * Descrição:
+ * ----------
+ * Liga um intervalo de um buffer a um ponto de ligação de blocos de uniforms,
+ * se esse intervalo ainda não estiver ligado.
+ *
+ * Parâmetros:
+ * -----------
+ * - binding: O ponto de ligação (layout(binding = N) dos shaders).
+ * - buffer: O buffer.
+ * - offset: O início do intervalo, em bytes.
+ * - size: O tamanho do intervalo, em bytes.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void GLStateCache::BindUniformRange(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	if (binding >= MAX_UNIFORM_BINDINGS) {
+		glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+		counters.issued++;
+		return;
+	}
+
+	UniformRange& range = uniformRanges[binding];
+	if (Track(range.buffer != buffer || range.offset != offset || range.size != size)) {
+		glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+		range = { buffer, offset, size };
+	}
+}
@@ -0,0 +1,53 @@
+﻿#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <GL/glew.h>
+
+// Cópia na CPU do estado OpenGL que muda entre desenhos, para não repetir chamadas que não alteram nada.
+// Só é fiável se todas as mudanças deste estado passarem pela cache (ou se for chamado Invalidate).
+class GLStateCache {
+public:
+	static const GLuint MAX_TEXTURE_UNITS = 8;   // Unidades de textura seguidas pela cache
+	static const GLuint MAX_UNIFORM_BINDINGS = 8; // Pontos de ligação de blocos de uniforms seguidos pela cache
+
+	// Contadores de um quadro
+	struct Counters {
+		GLuint issued; // Chamadas enviadas ao OpenGL
+		GLuint saved;  // Chamadas evitadas por o estado já ser o pedido
+	};
+
+	GLStateCache();
+
+	void BeginFrame(); // Reinicia os contadores do quadro
+	void Invalidate(); // Esquece o estado conhecido (depois de chamadas OpenGL feitas fora da cache)
+
+	void UseProgram(GLuint program);
+	void BindVertexArray(GLuint vertexArray);
+	void BindTexture(GLuint unit, GLenum target, GLuint texture);
+	void BindBuffer(GLenum target, GLuint buffer); // Só GL_DRAW_INDIRECT_BUFFER (os outros alvos fazem parte do VAO)
+	void BindUniformRange(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+	const Counters& GetCounters() const { return counters; } // Contadores do quadro atual
+
+private:
+	static const GLuint UNKNOWN = 0xFFFFFFFF; // Valor que não corresponde a nenhum objeto (estado desconhecido)
+
+	// Intervalo ligado a um ponto de ligação de blocos de uniforms
+	struct UniformRange {
+		GLuint buffer;
+		GLintptr offset;
+		GLsizeiptr size;
+	};
+
+	GLuint program;                                  // Programa em uso
+	GLuint vertexArray;                              // VAO ligado
+	GLuint activeUnit;                               // Unidade de textura ativa
+	GLuint textures[MAX_TEXTURE_UNITS];              // Textura ligada em cada unidade (um alvo por unidade)
+	GLuint drawIndirectBuffer;                       // Buffer ligado a GL_DRAW_INDIRECT_BUFFER
+	UniformRange uniformRanges[MAX_UNIFORM_BINDINGS]; // Intervalo ligado a cada ponto de ligação
+	Counters counters;                               // Contadores do quadro atual
+
+	bool Track(bool changed); // Atualiza os contadores e devolve se a chamada deve ser feita
+};
+
+#endif // GL_STATE_CACHE_H
@@ -0,0 +1,288 @@
+﻿/*****************************************************************************
+ * GeometryBuffer.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe GeometryBuffer, o buffer de geometria partilhado pela cena. A classe GeometryBuffer é responsável por:
+ * - Juntar as malhas estáticas (bola, níveis de detalhe e mesa) num único buffer de vértices e num único buffer de índices,
+ *   onde cada malha é identificada pelo seu primeiro índice e pelo seu vértice base.
+ * - Comprimir os vértices para 16 bytes (PackedVertex): posição em 16 bits normalizados dentro da caixa envolvente da
+ *   malha, normal em GL_INT_2_10_10_10_REV e coordenada de textura em meio float. As caixas envolventes são guardadas
+ *   num buffer de armazenamento (bloco MeshData), que os shaders usam para recuperar a posição.
+ * - Converter os triângulos soltos lidos dos ficheiros .obj numa malha indexada, juntando os vértices repetidos.
+ * - Criar um único VAO com o formato de vértice comprimido, descrito pela tabela PACKED_VERTEX_FORMAT, para que todas
+ *   as malhas sejam desenhadas sem trocar de VAO.
+ * - Fornecer um atributo por instância com o índice do objeto (atributo 3), que com o baseInstance de cada comando
+ *   de desenho indireto permite aos shaders encontrar os dados do seu objeto.
+ *
+ * Funções principais:
+ * - GeometryBuffer(): Construtor da classe GeometryBuffer.
+ * - ~GeometryBuffer(): Destrutor, que liberta o VAO e os buffers.
+ * - AddMesh(const std::vector<Vertex>& meshVertices, const std::vector<GLuint>& meshIndices): Adiciona uma malha indexada.
+ * - AddTriangles(positions, normals, uvs): Adiciona uma malha de triângulos soltos.
+ * - Upload(): Envia a geometria para a GPU e configura o VAO.
+ * - GetVertexArray(): Devolve o VAO partilhado.
+ *
+ * Variáveis e constantes importantes:
+ * - MAX_DRAWS: Número máximo de objetos num lote de desenho.
+ * - PACKED_VERTEX_FORMAT: Descrição dos atributos do vértice comprimido.
+ * - vertices, indices: Geometria acumulada (já comprimida) antes de `Upload`.
+ * - meshes: Caixa envolvente de cada malha, enviada para o buffer meshBuffer.
+ * - drawIdBuffer: Buffer com os identificadores dos objetos (0, 1, 2, ...).
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <cstddef>
+#include <map>
+#include <tuple>
+#include <glm/gtc/packing.hpp>
+
+#include "GeometryBuffer.h"
+
+// Atributos do vértice comprimido; os shaders continuam a receber vec3/vec2, porque a conversão é feita na leitura
+static const VertexAttributeFormat PACKED_VERTEX_FORMAT[] = {
+	{ 0, 3, GL_UNSIGNED_SHORT,          GL_TRUE,  offsetof(PackedVertex, position) }, // Posição em [0, 1] dentro da caixa da malha
+	{ 1, 4, GL_INT_2_10_10_10_REV,      GL_TRUE,  offsetof(PackedVertex, normal) },   // Normal em [-1, 1] (o w não é usado)
+	{ 2, 2, GL_HALF_FLOAT,              GL_FALSE, offsetof(PackedVertex, uv) },       // Coordenada de textura
+};
+
+
+/*****************************************************************************
+ * GeometryBuffer::GeometryBuffer()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `GeometryBuffer`. O buffer começa vazio; as malhas são
+ * adicionadas com `AddMesh`/`AddTriangles` e enviadas para a GPU com `Upload`.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+GeometryBuffer::GeometryBuffer() : VAO(0), VBO(0), EBO(0), drawIdBuffer(0), meshBuffer(0) {
+}
+
+
+/*****************************************************************************
+ * GeometryBuffer::~GeometryBuffer()
+ *
+ * Descrição:
+ * ----------
+ * Destrutor da classe `GeometryBuffer`, que liberta o VAO e os buffers.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (destrutor).
+ *
+ ******************************************************************************/
+GeometryBuffer::~GeometryBuffer() {
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	glDeleteBuffers(1, &drawIdBuffer);
+	glDeleteBuffers(1, &meshBuffer);
+}
+
+
+/*****************************************************************************
+ * MeshRange GeometryBuffer::AddMesh(const std::vector<Vertex>& meshVertices, const std::vector<GLuint>& meshIndices)
+ *
+ * Descrição:
+ * ----------
+ * Acrescenta uma malha indexada ao buffer. Os índices da malha ficam relativos
+ * ao seu primeiro vértice, que é guardado como vértice base do comando de desenho.
+ * Cada malha recebe também um número, que a fila de desenho usa para juntar os
+ * objetos com a mesma malha e os shaders usam para encontrar a sua caixa envolvente.
+ *
+ * Os vértices são comprimidos logo aqui: a posição passa a ser a fração da caixa
+ * envolvente da malha em 16 bits (precisão de 1/65535 do tamanho da malha), a
+ * normal passa a 10 bits com sinal por componente e a coordenada de textura a
+ * meio float.
+ *
+ * Parâmetros:
+ * -----------
+ * - meshVertices: Os vértices da malha.
+ * - meshIndices: Os índices dos triângulos, relativos ao primeiro vértice da malha.
+ *
+ * Retorno:
+ * --------
+ * - MeshRange: O intervalo da malha dentro do buffer partilhado.
+ *
+ ******************************************************************************/
+MeshRange GeometryBuffer::AddMesh(const std::vector<Vertex>& meshVertices, const std::vector<GLuint>& meshIndices) {
+	MeshRange range;
+	range.firstIndex = (GLuint)indices.size();
+	range.indexCount = (GLuint)meshIndices.size();
+	range.baseVertex = (GLint)vertices.size();
+	range.meshId = (GLuint)meshes.size();
+
+	glm::vec3 minimum(0.0f), maximum(0.0f);
+	if (!meshVertices.empty()) {
+		minimum = maximum = meshVertices[0].position;
+		for (size_t i = 1; i < meshVertices.size(); i++) {
+			minimum = glm::min(minimum, meshVertices[i].position);
+			maximum = glm::max(maximum, meshVertices[i].position);
+		}
+	}
+
+	// Uma malha plana tem tamanho zero num dos eixos; evita a divisão por zero sem mudar a posição recuperada
+	glm::vec3 scale = glm::max(maximum - minimum, glm::vec3(1e-6f));
+
+	MeshBlock meshBlock = {};
+	meshBlock.positionOffset = minimum;
+	meshBlock.positionScale = scale;
+	meshes.push_back(meshBlock);
+
+	for (const Vertex& vertex : meshVertices) {
+		glm::vec3 position = (vertex.position - minimum) / scale;
+
+		PackedVertex packed;
+		packed.position[0] = glm::packUnorm1x16(position.x);
+		packed.position[1] = glm::packUnorm1x16(position.y);
+		packed.position[2] = glm::packUnorm1x16(position.z);
+		packed.position[3] = 0;
+		packed.normal = glm::packSnorm3x10_1x2(glm::vec4(glm::normalize(vertex.normal), 0.0f));
+		packed.uv[0] = glm::packHalf1x16(vertex.uv.x);
+		packed.uv[1] = glm::packHalf1x16(vertex.uv.y);
+		vertices.push_back(packed);
+	}
+
+	indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+
+	return range;
+}
+
+
+/*****************************************************************************
+ * MeshRange GeometryBuffer::AddTriangles(const std::vector<glm::vec3>& positions,
+ * const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& uvs)
+ *
+ * Descrição:
+ * ----------
+ * Acrescenta uma malha definida por triângulos soltos (três vértices por
+ * triângulo, como os lidos dos ficheiros .obj). Os vértices com a mesma posição,
+ * normal e coordenada de textura são juntados num só, o que reduz a malha da
+ * bola de 24192 vértices para os vértices realmente distintos.
+ *
+ * Parâmetros:
+ * -----------
+ * - positions: As posições dos vértices.
+ * - normals: As normais dos vértices.
+ * - uvs: As coordenadas de textura dos vértices.
+ *
+ * Retorno:
+ * --------
+ * - MeshRange: O intervalo da malha dentro do buffer partilhado.
+ *
+ ******************************************************************************/
+MeshRange GeometryBuffer::AddTriangles(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& uvs) {
+	typedef std::tuple<float, float, float, float, float, float, float, float> VertexKey;
+
+	std::map<VertexKey, GLuint> uniqueVertices;
+	std::vector<Vertex> meshVertices;
+	std::vector<GLuint> meshIndices;
+	meshIndices.reserve(positions.size());
+
+	for (size_t i = 0; i < positions.size(); i++) {
+		const glm::vec3& p = positions[i];
+		const glm::vec3& n = normals[i];
+		const glm::vec2& t = uvs[i];
+		VertexKey key(p.x, p.y, p.z, n.x, n.y, n.z, t.x, t.y);
+
+		std::map<VertexKey, GLuint>::iterator it = uniqueVertices.find(key);
+		if (it == uniqueVertices.end()) {
+			GLuint index = (GLuint)meshVertices.size();
+			uniqueVertices[key] = index;
+			meshVertices.push_back({ p, n, t });
+			meshIndices.push_back(index);
+		}
+		else {
+			meshIndices.push_back(it->second);
+		}
+	}
+
+	return AddMesh(meshVertices, meshIndices);
+}
+
+
+/*****************************************************************************
+ * void GeometryBuffer::Upload()
+ *
+ * Descrição:
+ * ----------
+ * Envia os vértices e os índices acumulados para buffers imutáveis e configura
+ * o VAO partilhado a partir da tabela PACKED_VERTEX_FORMAT (`glVertexAttribFormat`).
+ * As caixas envolventes das malhas vão para um buffer de armazenamento estático,
+ * ligado ao bloco MeshData. O
+ * atributo 3 lê o buffer de identificadores com divisor 1, por isso cada
+ * instância recebe o valor `baseInstance + gl_InstanceID`, ou seja, o índice do
+ * seu objeto nos dados do lote.
+ *
+ * Parâmetros:
+ * -----------
+ * - Nenhum.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void GeometryBuffer::Upload() {
+	std::vector<GLuint> drawIds(MAX_DRAWS);
+	for (GLuint i = 0; i < MAX_DRAWS; i++)
+		drawIds[i] = i;
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+	glGenBuffers(1, &drawIdBuffer);
+
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferStorage(GL_ARRAY_BUFFER, vertices.size() * sizeof(PackedVertex), vertices.data(), 0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+	glBufferStorage(GL_ARRAY_BUFFER, drawIds.size() * sizeof(GLuint), drawIds.data(), 0);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), 0);
+
+	// Ponto de ligação 0: vértices comprimidos e intercalados
+	glBindVertexBuffer(0, VBO, 0, sizeof(PackedVertex));
+
+	for (const VertexAttributeFormat& attribute : PACKED_VERTEX_FORMAT) {
+		glVertexAttribFormat(attribute.location, attribute.size, attribute.type, attribute.normalized, attribute.offset);
+		glVertexAttribBinding(attribute.location, 0);
+		glEnableVertexAttribArray(attribute.location);
+	}
+
+	// Ponto de ligação 1: índice do objeto, um valor por instância
+	glBindVertexBuffer(1, drawIdBuffer, 0, sizeof(GLuint));
+	glVertexBindingDivisor(1, 1);
+
+	glVertexAttribIFormat(3, 1, GL_UNSIGNED_INT, 0);
+	glVertexAttribBinding(3, 1);
+	glEnableVertexAttribArray(3);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &meshBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, meshBuffer);
+	glBufferStorage(GL_SHADER_STORAGE_BUFFER, meshes.size() * sizeof(MeshBlock), meshes.data(), 0);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_BLOCK_BINDING, meshBuffer);
+
+	std::cout << "Geometry buffer: " << vertices.size() << " vertices, " << vertices.size() * sizeof(PackedVertex) / 1024
+		<< " KB (" << vertices.size() * sizeof(Vertex) / 1024 << " KB unpacked)" << std::endl;
+
+	// Os dados já estão na GPU
+	std::vector<PackedVertex>().swap(vertices);
+	std::vector<GLuint>().swap(indices);
+	std::vector<MeshBlock>().swap(meshes);
+}
+
@@ -0,0 +1,65 @@
+﻿#ifndef GEOMETRY_BUFFER_H
+#define GEOMETRY_BUFFER_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "UniformBlocks.h"
+
+// Vértice de entrada das malhas, em floats (atributos 0 = posição, 1 = normal, 2 = coordenada de textura)
+struct Vertex {
+	glm::vec3 position; // Posição do vértice
+	glm::vec3 normal;   // Normal do vértice
+	glm::vec2 uv;       // Coordenada de textura do vértice
+};
+
+// Vértice comprimido guardado na GPU: 16 bytes em vez dos 32 de Vertex
+struct PackedVertex {
+	GLushort position[4]; // Posição normalizada (0..65535) dentro da caixa envolvente da malha; o quarto valor não é usado
+	GLuint normal;        // Normal em GL_INT_2_10_10_10_REV (10 bits com sinal por componente)
+	GLushort uv[2];       // Coordenada de textura em meio float (GL_HALF_FLOAT)
+};
+
+// Descrição de um atributo de vértice, aplicada ao VAO com glVertexAttribFormat
+struct VertexAttributeFormat {
+	GLuint location;      // Localização do atributo nos shaders
+	GLint size;           // Número de componentes
+	GLenum type;          // Tipo de cada componente
+	GLboolean normalized; // Converte os inteiros para [0, 1] ou [-1, 1]
+	GLuint offset;        // Offset do atributo dentro do vértice
+};
+
+// Intervalo de uma malha dentro do buffer partilhado, no formato dos comandos de desenho indireto
+struct MeshRange {
+	GLuint firstIndex; // Primeiro índice da malha no buffer de índices
+	GLuint indexCount; // Número de índices da malha
+	GLint baseVertex;  // Vértice somado a cada índice da malha
+	GLuint meshId;     // Número da malha no buffer, pela ordem em que foi adicionada (usado na ordenação dos desenhos)
+};
+
+// Buffer único com a geometria estática de todas as malhas da cena, desenhada com um único VAO
+class GeometryBuffer {
+public:
+	static const GLuint MAX_DRAWS = 16384; // Número máximo de objetos num lote (tamanho do buffer de identificadores)
+
+	GeometryBuffer();
+	~GeometryBuffer();
+
+	MeshRange AddMesh(const std::vector<Vertex>& meshVertices, const std::vector<GLuint>& meshIndices); // Adiciona uma malha indexada
+	MeshRange AddTriangles(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& uvs); // Adiciona triângulos soltos, juntando os vértices repetidos
+	void Upload(); // Envia todas as malhas para a GPU e cria o VAO
+	GLuint GetVertexArray() const { return VAO; } // VAO partilhado
+
+private:
+	std::vector<PackedVertex> vertices; // Vértices comprimidos de todas as malhas (libertados depois de Upload)
+	std::vector<MeshBlock> meshes;      // Caixa envolvente de cada malha, indexada por MeshRange::meshId
+	std::vector<GLuint> indices;  // Índices de todas as malhas, relativos ao baseVertex de cada malha
+
+	GLuint VAO;          // Vertex Array Object partilhado por todas as malhas
+	GLuint VBO;          // Buffer de vértices
+	GLuint EBO;          // Buffer de índices
+	GLuint drawIdBuffer; // Identificadores 0..MAX_DRAWS - 1, lidos como atributo por instância (atributo 3)
+	GLuint meshBuffer;   // Buffer de armazenamento estático com as caixas envolventes (bloco MeshData)
+};
+
+#endif // GEOMETRY_BUFFER_H
@@ -0,0 +1,284 @@
+﻿/*****************************************************************************
+ * HeadlessContext.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe HeadlessContext, o contexto OpenGL do modo --headless.
+ * A classe HeadlessContext é responsável por:
+ * - Criar um contexto OpenGL core sem janela: com EGL sem superfície em Linux (EGL_MESA_platform_surfaceless e
+ *   EGL_KHR_surfaceless_context), para correr em servidores sem ecrã com o llvmpipe do Mesa, ou com uma janela GLFW
+ *   escondida nos outros sistemas.
+ * - Criar o framebuffer (cor RGBA8 e profundidade de 24 bits) onde a cena é desenhada em vez da janela.
+ *
+ * Funções principais:
+ * - Create(int major, int minor): Cria o contexto e torna-o atual.
+ * - CreateFramebuffer(GLsizei width, GLsizei height): Cria o framebuffer da cena.
+ *
+ * Variáveis e constantes importantes:
+ * - display / context: Ligação ao EGL e contexto criado (Linux).
+ * - window: Janela GLFW escondida que tem o contexto (outros sistemas).
+ * - framebuffer: Framebuffer onde a cena é desenhada.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <cstring>
+
+#include "HeadlessContext.h"
+
+#ifndef _WIN32
+#include <EGL/eglext.h>
+#endif
+
+
+/*****************************************************************************
+ * HeadlessContext::HeadlessContext()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `HeadlessContext`. O contexto é criado em `Create`.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+HeadlessContext::HeadlessContext()
+	:
+#ifdef _WIN32
+	window(nullptr),
+#else
+	display(EGL_NO_DISPLAY),
+	context(EGL_NO_CONTEXT),
+#endif
+	framebuffer(0),
+	colorBuffer(0),
+	depthBuffer(0) {
+}
+
+
+/*****************************************************************************
+ * HeadlessContext::~HeadlessContext()
+ *
+ * Descrição:
+ * ----------
+ * Destrutor da classe `HeadlessContext`, que liberta o framebuffer e destrói o
+ * contexto.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (destrutor).
+ *
+ ******************************************************************************/
+HeadlessContext::~HeadlessContext() {
+	if (framebuffer != 0) {
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+	}
+
+#ifdef _WIN32
+	if (window != nullptr) {
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+#else
+	if (display != EGL_NO_DISPLAY) {
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (context != EGL_NO_CONTEXT)
+			eglDestroyContext(display, context);
+		eglTerminate(display);
+	}
+#endif
+}
+
+
+#ifdef _WIN32
+
+/*****************************************************************************
+ * bool HeadlessContext::Create(int major, int minor)
+ *
+ * Descrição:
+ * ----------
+ * Cria uma janela GLFW escondida com um contexto core da versão pedida e torna
+ * o contexto atual. A janela nunca é mostrada: a cena é desenhada no framebuffer
+ * criado por `CreateFramebuffer`.
+ *
+ * Parâmetros:
+ * -----------
+ * - major, minor: A versão do OpenGL pedida.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o contexto foi criado.
+ *
+ ******************************************************************************/
+bool HeadlessContext::Create(int major, int minor) {
+	if (!glfwInit())
+		return false;
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	window = glfwCreateWindow(1, 1, "PoolTable (headless)", NULL, NULL);
+	if (window == nullptr) {
+		glfwTerminate();
+		return false;
+	}
+
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0);
+
+	description = "hidden GLFW window, OpenGL " + std::to_string(major) + "." + std::to_string(minor) + " core";
+	return true;
+}
+
+#else
+
+/*****************************************************************************
+ * bool HeadlessContext::InitializeDisplay()
+ *
+ * Descrição:
+ * ----------
+ * Liga-se ao EGL. Usa a plataforma sem superfície do Mesa quando existe (não
+ * precisa de um servidor gráfico nem de um dispositivo de ecrã), e o ecrã por
+ * omissão nos outros casos.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o EGL foi inicializado com suporte para OpenGL.
+ *
+ ******************************************************************************/
+bool HeadlessContext::InitializeDisplay() {
+	if (display != EGL_NO_DISPLAY)
+		return true;
+
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (clientExtensions != nullptr && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != nullptr) {
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay != nullptr)
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint eglMajor, eglMinor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor)) {
+		std::cout << "Failed to initialize EGL" << std::endl;
+		display = EGL_NO_DISPLAY;
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		std::cout << "EGL does not support desktop OpenGL" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+/*****************************************************************************
+ * bool HeadlessContext::Create(int major, int minor)
+ *
+ * Descrição:
+ * ----------
+ * Cria um contexto EGL core da versão pedida e torna-o atual sem nenhuma
+ * superfície (EGL_KHR_surfaceless_context). Pode ser chamada de novo com uma
+ * versão mais baixa se a primeira falhar (o llvmpipe só tem o OpenGL 4.5).
+ *
+ * Parâmetros:
+ * -----------
+ * - major, minor: A versão do OpenGL pedida.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o contexto foi criado.
+ *
+ ******************************************************************************/
+bool HeadlessContext::Create(int major, int minor) {
+	if (!InitializeDisplay())
+		return false;
+
+	const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+	if (extensions == nullptr || strstr(extensions, "EGL_KHR_surfaceless_context") == nullptr) {
+		std::cout << "EGL_KHR_surfaceless_context is not supported" << std::endl;
+		return false;
+	}
+
+	// Sem EGL_KHR_no_config_context é escolhida uma configuração qualquer com OpenGL (não há superfícies)
+	EGLConfig config = EGL_NO_CONFIG_KHR;
+	if (strstr(extensions, "EGL_KHR_no_config_context") == nullptr) {
+		const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		EGLint configCount = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+			return false;
+	}
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, major,
+		EGL_CONTEXT_MINOR_VERSION, minor,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT)
+		return false;
+
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		eglDestroyContext(display, context);
+		context = EGL_NO_CONTEXT;
+		return false;
+	}
+
+	description = "surfaceless EGL, OpenGL " + std::to_string(major) + "." + std::to_string(minor) + " core";
+	return true;
+}
+
+#endif
+
+
+/*****************************************************************************
+ * bool HeadlessContext::CreateFramebuffer(GLsizei width, GLsizei height)
+ *
+ * Descrição:
+ * ----------
+ * Cria o framebuffer onde a cena é desenhada, com uma cor RGBA8 e uma
+ * profundidade de 24 bits, e liga-o como framebuffer atual com o viewport do
+ * seu tamanho. Tem de ser chamada depois do `glewInit`.
+ *
+ * Parâmetros:
+ * -----------
+ * - width, height: O tamanho do framebuffer, em píxeis.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o framebuffer estiver completo.
+ *
+ ******************************************************************************/
+bool HeadlessContext::CreateFramebuffer(GLsizei width, GLsizei height) {
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "Headless framebuffer is incomplete (0x" << std::hex << status << std::dec << ")" << std::endl;
+		return false;
+	}
+
+	glViewport(0, 0, width, height);
+	return true;
+}
@@ -0,0 +1,41 @@
+﻿#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <GL/glew.h>
+#include <string>
+
+#ifdef _WIN32
+#include <GLFW/glfw3.h>
+#else
+#include <EGL/egl.h>
+#endif
+
+// Contexto OpenGL sem janela do modo --headless: EGL sem superfície em Linux (funciona sem servidor gráfico, por exemplo
+// com o llvmpipe do Mesa) ou uma janela GLFW escondida nos outros sistemas. A cena é desenhada num framebuffer próprio.
+class HeadlessContext {
+public:
+	HeadlessContext();
+	~HeadlessContext(); // Liberta o framebuffer e o contexto
+
+	bool Create(int major, int minor); // Cria o contexto core da versão pedida e torna-o atual
+	bool CreateFramebuffer(GLsizei width, GLsizei height); // Cria o framebuffer de cor e profundidade (depois do glewInit)
+
+	GLuint GetFramebuffer() const { return framebuffer; }
+	const std::string& GetDescription() const { return description; } // API e versão do contexto, para o relatório
+
+private:
+#ifdef _WIN32
+	GLFWwindow* window;
+#else
+	EGLDisplay display;
+	EGLContext context;
+
+	bool InitializeDisplay(); // Prefere a plataforma sem superfície do Mesa, que não precisa de um servidor gráfico
+#endif
+	GLuint framebuffer;
+	GLuint colorBuffer;
+	GLuint depthBuffer;
+	std::string description;
+};
+
+#endif // HEADLESS_CONTEXT_H
@@ -0,0 +1,185 @@
+﻿/*****************************************************************************
+ * IndirectBatch.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe IndirectBatch, que desenha um conjunto de objetos com uma única
+ * chamada de desenho indireto. A classe IndirectBatch é responsável por:
+ * - Acumular, em cada quadro, os dados de cada objeto (bloco ObjectData) e o comando de desenho da sua malha.
+ * - Juntar objetos consecutivos com a mesma malha num só comando instanciado.
+ * - Com várias vistas na mesma passagem (MultiView), desenhar cada objeto uma vez por vista no mesmo comando: o
+ *   identificador lido pelo atributo 3 passa a ser objeto * viewCount + vista.
+ * - Escrever os objetos e os comandos no buffer de uniforms do quadro (FrameUploadBuffer) e desenhar tudo com
+ *   `glMultiDrawElementsIndirect`, ou com uma chamada instanciada no caso dos impostores.
+ *
+ * Funções principais:
+ * - Clear(): Esvazia o lote.
+ * - Add(const MeshRange& mesh, const ObjectBlock& object): Adiciona um objeto ao lote.
+ * - Submit(FrameUploadBuffer& uploadBuffer, GLStateCache& cache): Desenha as malhas do lote.
+ * - SubmitImpostors(FrameUploadBuffer& uploadBuffer): Desenha um impostor por objeto do lote.
+ * - SetViewCount(GLuint viewCount): Define as instâncias de cada objeto (uma por vista).
+ *
+ * Variáveis e constantes importantes:
+ * - commands: Comandos de desenho indireto (DrawElementsIndirectCommand).
+ * - objects: Dados dos objetos; o baseInstance de cada comando indica o seu primeiro objeto.
+ *
+ ******************************************************************************/
+
+#include "IndirectBatch.h"
+
+
+/*****************************************************************************
+ * void IndirectBatch::Clear()
+ *
+ * Descrição:
+ * ----------
+ * Esvazia o lote sem libertar a memória, para que possa ser reutilizado em cada
+ * quadro sem novas alocações.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void IndirectBatch::Clear() {
+	commands.clear();
+	objects.clear();
+}
+
+
+/*****************************************************************************
+ * bool IndirectBatch::Add(const MeshRange& mesh, const ObjectBlock& object)
+ *
+ * Descrição:
+ * ----------
+ * Adiciona um objeto ao lote. Se o comando anterior usar a mesma malha, o objeto
+ * passa a ser mais uma instância desse comando (os objetos de um comando são
+ * consecutivos, a partir do seu baseInstance); caso contrário é criado um novo
+ * comando. O índice da malha é copiado para os dados do objeto, para que o vertex
+ * shader possa recuperar as posições comprimidas.
+ *
+ * Com mais de uma vista, cada objeto ocupa viewCount instâncias seguidas e o
+ * baseInstance é multiplicado por viewCount: o atributo 3 (baseInstance mais o
+ * número da instância) dá o objeto e a vista, sem mudar o VAO partilhado.
+ *
+ * Parâmetros:
+ * -----------
+ * - mesh: A malha a desenhar para o objeto.
+ * - object: Os dados do objeto (matrizes, camada de textura e material).
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se o objeto foi adicionado, `false` se o lote já tiver GeometryBuffer::MAX_DRAWS instâncias.
+ *
+ ******************************************************************************/
+bool IndirectBatch::Add(const MeshRange& mesh, const ObjectBlock& object) {
+	if ((objects.size() + 1) * viewCount > GeometryBuffer::MAX_DRAWS)
+		return false;
+
+	GLuint objectIndex = (GLuint)objects.size();
+	objects.push_back(object);
+	objects.back().meshIndex = (GLint)mesh.meshId;
+
+	if (!commands.empty()) {
+		DrawElementsIndirectCommand& last = commands.back();
+		if (last.firstIndex == mesh.firstIndex && last.count == mesh.indexCount && last.baseVertex == mesh.baseVertex) {
+			last.instanceCount += viewCount;
+			return true;
+		}
+	}
+
+	DrawElementsIndirectCommand command;
+	command.count = mesh.indexCount;
+	command.instanceCount = viewCount;
+	command.firstIndex = mesh.firstIndex;
+	command.baseVertex = mesh.baseVertex;
+	command.baseInstance = objectIndex * viewCount;
+	commands.push_back(command);
+
+	return true;
+}
+
+
+/*****************************************************************************
+ * bool IndirectBatch::UploadObjects(FrameUploadBuffer& uploadBuffer)
+ *
+ * Descrição:
+ * ----------
+ * Escreve os dados dos objetos no buffer do quadro e liga esse intervalo ao
+ * bloco de armazenamento ObjectData (std430) dos shaders.
+ *
+ * Parâmetros:
+ * -----------
+ * - uploadBuffer: O buffer de uniforms do quadro.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se os objetos foram escritos, `false` se o lote estiver vazio ou o buffer cheio.
+ *
+ ******************************************************************************/
+bool IndirectBatch::UploadObjects(FrameUploadBuffer& uploadBuffer) const {
+	if (objects.empty())
+		return false;
+
+	return uploadBuffer.UploadStorage(OBJECT_BLOCK_BINDING, objects.data(), objects.size() * sizeof(ObjectBlock)) >= 0;
+}
+
+
+/*****************************************************************************
+ * void IndirectBatch::Submit(FrameUploadBuffer& uploadBuffer, GLStateCache& cache)
+ *
+ * Descrição:
+ * ----------
+ * Desenha todos os objetos do lote com uma única chamada a
+ * `glMultiDrawElementsIndirect`. Os comandos são escritos no buffer do quadro,
+ * que é ligado como GL_DRAW_INDIRECT_BUFFER através da cache de estado (o buffer
+ * é o mesmo em todos os lotes, por isso só é ligado uma vez). O VAO da geometria
+ * partilhada e o programa de shader já devem estar ligados.
+ *
+ * Parâmetros:
+ * -----------
+ * - uploadBuffer: O buffer de uniforms do quadro.
+ * - cache: A cache do estado OpenGL.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void IndirectBatch::Submit(FrameUploadBuffer& uploadBuffer, GLStateCache& cache) const {
+	if (!UploadObjects(uploadBuffer))
+		return;
+
+	GLintptr commandOffset = uploadBuffer.Allocate(commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand));
+	if (commandOffset < 0)
+		return;
+
+	cache.BindBuffer(GL_DRAW_INDIRECT_BUFFER, uploadBuffer.GetBuffer());
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)commandOffset, (GLsizei)commands.size(), 0);
+}
+
+
+/*****************************************************************************
+ * void IndirectBatch::SubmitImpostors(FrameUploadBuffer& uploadBuffer)
+ *
+ * Descrição:
+ * ----------
+ * Desenha um impostor por objeto do lote: um quadrado de 4 vértices gerado a
+ * partir de gl_VertexID, com uma instância por objeto. As malhas dos comandos
+ * são ignoradas.
+ *
+ * Parâmetros:
+ * -----------
+ * - uploadBuffer: O buffer de uniforms do quadro.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void IndirectBatch::SubmitImpostors(FrameUploadBuffer& uploadBuffer) const {
+	if (!UploadObjects(uploadBuffer))
+		return;
+
+	glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)(objects.size() * viewCount), 0);
+}
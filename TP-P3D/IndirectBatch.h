@@ -0,0 +1,40 @@
+﻿#ifndef INDIRECT_BATCH_H
+#define INDIRECT_BATCH_H
+
+#include <GL/glew.h>
+#include <vector>
+#include "GeometryBuffer.h"
+#include "FrameUploadBuffer.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+
+// Comando de desenho indireto com índices, no layout lido por glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+	GLuint count;         // Número de índices
+	GLuint instanceCount; // Número de instâncias (objetos consecutivos com a mesma malha, vezes o número de vistas)
+	GLuint firstIndex;    // Primeiro índice da malha
+	GLint baseVertex;     // Vértice base da malha
+	GLuint baseInstance;  // Índice do primeiro objeto do comando nos dados do lote (vezes o número de vistas)
+};
+
+// Lote de objetos construído na CPU e desenhado com uma única chamada de desenho indireto
+class IndirectBatch {
+public:
+	void Clear(); // Esvazia o lote para o quadro seguinte
+	void SetViewCount(GLuint viewCount) { this->viewCount = viewCount; } // Instâncias por objeto (uma por vista); só com o lote vazio
+	bool Add(const MeshRange& mesh, const ObjectBlock& object); // Adiciona um objeto (false se o lote estiver cheio)
+	size_t Size() const { return objects.size(); } // Número de objetos no lote
+	size_t GetCommandCount() const { return commands.size(); } // Número de comandos gerados
+
+	void Submit(FrameUploadBuffer& uploadBuffer, GLStateCache& cache) const; // Desenha as malhas com glMultiDrawElementsIndirect
+	void SubmitImpostors(FrameUploadBuffer& uploadBuffer) const; // Desenha um quadrado por objeto (impostores)
+
+private:
+	std::vector<DrawElementsIndirectCommand> commands; // Comandos de desenho, pela ordem de Add
+	std::vector<ObjectBlock> objects;                  // Dados de cada objeto, indexados pelo atributo 3 dos shaders
+	GLuint viewCount = 1;                              // Vistas desenhadas por objeto (o atributo 3 é objeto * viewCount + vista)
+
+	bool UploadObjects(FrameUploadBuffer& uploadBuffer) const; // Escreve os objetos no buffer do quadro e liga-os ao bloco ObjectData
+};
+
+#endif // INDIRECT_BATCH_H
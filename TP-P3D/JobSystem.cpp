@@ -0,0 +1,234 @@
+﻿/*****************************************************************************
+ * JobSystem.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe JobSystem, as threads de trabalho usadas pelos sistemas da cena
+ * (SceneSystems). A classe JobSystem é responsável por:
+ * - Manter um conjunto fixo de threads, criadas uma vez no arranque e adormecidas entre trabalhos.
+ * - Dividir um intervalo de índices em blocos, que as threads e a thread que chama vão buscando com um contador
+ *   atómico, para que os blocos mais lentos não atrasem os outros.
+ * - Correr os intervalos pequenos diretamente na thread que chama, sem acordar nenhuma thread.
+ *
+ * Funções principais:
+ * - Start(unsigned int workerCount): Cria as threads de trabalho.
+ * - ParallelFor(size_t count, size_t batchSize, const RangeJob& job): Corre um trabalho em blocos e espera pelo fim.
+ * - GetDefaultWorkerCount(): Número de threads adequado à máquina.
+ *
+ * Variáveis e constantes importantes:
+ * - job, count, batchSize: Trabalho atual e os seus blocos.
+ * - nextIndex, pendingBatches: Próximo bloco por fazer e blocos por acabar.
+ * - activeWorkers: Threads que ainda podem ler o trabalho atual; um trabalho novo só é publicado com 0.
+ *
+ ******************************************************************************/
+
+#include <algorithm>
+
+#include "JobSystem.h"
+
+
+/*****************************************************************************
+ * JobSystem::JobSystem()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `JobSystem`. Sem `Start`, todos os trabalhos correm na
+ * thread que chama `ParallelFor`.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+JobSystem::JobSystem()
+	: job(nullptr),
+	count(0),
+	batchSize(1),
+	nextIndex(0),
+	pendingBatches(0),
+	activeWorkers(0),
+	generation(0),
+	stopping(false) {
+}
+
+
+/*****************************************************************************
+ * JobSystem::~JobSystem()
+ *
+ * Descrição:
+ * ----------
+ * Destrutor da classe `JobSystem`, que acorda as threads de trabalho e espera
+ * que terminem.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (destrutor).
+ *
+ ******************************************************************************/
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+
+/*****************************************************************************
+ * void JobSystem::Start(unsigned int workerCount)
+ *
+ * Descrição:
+ * ----------
+ * Cria as threads de trabalho. Só pode ser chamada uma vez, antes do primeiro
+ * `ParallelFor`.
+ *
+ * Parâmetros:
+ * -----------
+ * - workerCount: O número de threads, além da thread que chama `ParallelFor`.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void JobSystem::Start(unsigned int workerCount) {
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.push_back(std::thread(&JobSystem::WorkerLoop, this));
+}
+
+
+/*****************************************************************************
+ * unsigned int JobSystem::GetDefaultWorkerCount()
+ *
+ * Descrição:
+ * ----------
+ * Devolve o número de threads de trabalho adequado à máquina: um por núcleo,
+ * sem contar o da thread principal (que também faz blocos em `ParallelFor`).
+ *
+ * Retorno:
+ * --------
+ * - unsigned int: O número de threads (0 numa máquina com um só núcleo).
+ *
+ ******************************************************************************/
+unsigned int JobSystem::GetDefaultWorkerCount() {
+	unsigned int cores = std::thread::hardware_concurrency();
+	return cores > 1 ? cores - 1 : 0;
+}
+
+
+/*****************************************************************************
+ * void JobSystem::ParallelFor(size_t count, size_t batchSize, const RangeJob& job)
+ *
+ * Descrição:
+ * ----------
+ * Corre `job` sobre o intervalo [0, count), em blocos de batchSize índices
+ * (o último pode ser menor), e só volta quando todos os blocos acabaram. Cada
+ * índice é visto por uma única chamada, por isso o trabalho pode escrever sem
+ * locks nos elementos dos seus índices. Com um único bloco ou sem threads, o
+ * trabalho corre diretamente na thread que chama.
+ *
+ * Parâmetros:
+ * -----------
+ * - count: O número de índices.
+ * - batchSize: O número de índices de cada bloco.
+ * - job: O trabalho de cada bloco.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void JobSystem::ParallelFor(size_t count, size_t batchSize, const RangeJob& job) {
+	if (count == 0)
+		return;
+
+	batchSize = std::max(batchSize, (size_t)1);
+	if (workers.empty() || count <= batchSize) {
+		job(0, count);
+		return;
+	}
+
+	{
+		// Uma thread atrasada do trabalho anterior ainda pode estar a ler os campos; só são trocados sem nenhuma ativa
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return activeWorkers == 0; });
+		this->job = &job;
+		this->count = count;
+		this->batchSize = batchSize;
+		nextIndex = 0;
+		pendingBatches = (count + batchSize - 1) / batchSize;
+		generation++;
+	}
+	wake.notify_all();
+
+	RunBatches();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return pendingBatches == 0 && activeWorkers == 0; });
+	this->job = nullptr;
+}
+
+
+/*****************************************************************************
+ * void JobSystem::RunBatches()
+ *
+ * Descrição:
+ * ----------
+ * Vai buscando blocos do trabalho atual até não haver mais. Quem acabar o
+ * último bloco acorda a thread que chamou `ParallelFor`.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void JobSystem::RunBatches() {
+	for (;;) {
+		size_t begin = nextIndex.fetch_add(batchSize);
+		if (begin >= count)
+			break;
+
+		(*job)(begin, std::min(begin + batchSize, count));
+		if (--pendingBatches == 0) {
+			std::lock_guard<std::mutex> lock(mutex);
+			done.notify_all();
+		}
+	}
+}
+
+
+/*****************************************************************************
+ * void JobSystem::WorkerLoop()
+ *
+ * Descrição:
+ * ----------
+ * Ciclo de cada thread de trabalho: dorme até haver um trabalho novo, faz
+ * blocos desse trabalho e volta a dormir, até o `JobSystem` ser destruído.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void JobSystem::WorkerLoop() {
+	unsigned int seenGeneration = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this, seenGeneration] { return stopping || generation != seenGeneration; });
+			if (stopping)
+				return;
+			seenGeneration = generation;
+			activeWorkers++;
+		}
+
+		RunBatches();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--activeWorkers == 0)
+			done.notify_all();
+	}
+}
@@ -0,0 +1,45 @@
+﻿#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Conjunto fixo de threads de trabalho para os sistemas da cena: ParallelFor divide um intervalo de índices em blocos,
+// que as threads e a thread que chama vão buscando até acabarem; a chamada só volta com todos os blocos feitos
+class JobSystem {
+public:
+	// Trabalho de um bloco: recebe o intervalo [begin, end) de índices
+	typedef std::function<void(size_t begin, size_t end)> RangeJob;
+
+	JobSystem();
+	~JobSystem(); // Termina as threads
+
+	void Start(unsigned int workerCount); // Cria as threads (0 = tudo na thread que chama)
+	void ParallelFor(size_t count, size_t batchSize, const RangeJob& job); // Corre job em blocos de batchSize índices
+	unsigned int GetWorkerCount() const { return (unsigned int)workers.size(); }
+
+	static unsigned int GetDefaultWorkerCount(); // Núcleos da máquina menos a thread principal
+
+private:
+	std::vector<std::thread> workers;  // Threads de trabalho
+	std::mutex mutex;                  // Protege o trabalho atual e os contadores de threads
+	std::condition_variable wake;      // Acorda as threads quando há um trabalho novo (ou no fim)
+	std::condition_variable done;      // Acorda a thread que chamou quando o último bloco acaba
+	const RangeJob* job;               // Trabalho atual (válido durante ParallelFor)
+	size_t count, batchSize;           // Intervalo e tamanho dos blocos do trabalho atual
+	std::atomic<size_t> nextIndex;     // Início do próximo bloco por fazer
+	std::atomic<size_t> pendingBatches; // Blocos ainda por acabar
+	unsigned int activeWorkers;        // Threads a ler o trabalho atual
+	unsigned int generation;           // Incrementado a cada trabalho novo
+	bool stopping;                     // As threads devem terminar
+
+	void WorkerLoop();
+	void RunBatches(); // Faz blocos do trabalho atual até não haver mais
+};
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,72 @@
+﻿#ifndef KTX2_H
+#define KTX2_H
+
+#include <cstdint>
+
+// Estruturas do contentor KTX2 (Khronos Texture 2.0), partilhadas pelo TextureCooker (que escreve os ficheiros)
+// e pelo TextureArray (que os lê). Os valores estão em little-endian, como no ficheiro.
+namespace KTX2 {
+
+	// Identificador no início de todos os ficheiros KTX2 («KTX 20» entre delimitadores)
+	const unsigned char IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	// Formatos Vulkan (VkFormat) dos blocos comprimidos suportados
+	enum Format : uint32_t {
+		FORMAT_BC1_RGB_UNORM = 131,        // BC1 (DXT1) RGB, 4x4 texels em 8 bytes
+		FORMAT_BC7_UNORM = 145,            // BC7 RGBA, 4x4 texels em 16 bytes
+		FORMAT_ETC2_R8G8B8_UNORM = 147     // ETC2 RGB, 4x4 texels em 8 bytes
+	};
+
+	// Modelo de cor do descritor de formato (Khronos Data Format) para BC1
+	const uint8_t DFD_MODEL_BC1A = 128;
+
+	// Cabeçalho do ficheiro (80 bytes), seguido do índice dos níveis de mipmap
+	struct Header {
+		unsigned char identifier[12];
+		uint32_t vkFormat;               // Formato dos texels (enum Format)
+		uint32_t typeSize;               // 1 nos formatos comprimidos
+		uint32_t pixelWidth;             // Largura do nível 0
+		uint32_t pixelHeight;            // Altura do nível 0
+		uint32_t pixelDepth;             // 0 nas texturas 2D
+		uint32_t layerCount;             // Número de camadas (0 se não for um array)
+		uint32_t faceCount;              // 1 (6 nos cubemaps)
+		uint32_t levelCount;             // Número de níveis de mipmap guardados
+		uint32_t supercompressionScheme; // 0: sem supercompressão
+		uint32_t dfdByteOffset;          // Descritor do formato dos dados
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;          // Dados chave/valor
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;          // Dados globais da supercompressão
+		uint64_t sgdByteLength;
+	};
+
+	// Posição de um nível de mipmap no ficheiro (todas as camadas do nível são contíguas)
+	struct LevelIndex {
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	static_assert(sizeof(Header) == 80, "KTX2 header must be 80 bytes");
+	static_assert(sizeof(LevelIndex) == 24, "KTX2 level index entries must be 24 bytes");
+
+	// Número de bytes de cada bloco de 4x4 texels do formato (0 se o formato não for suportado)
+	inline uint32_t BlockSize(uint32_t vkFormat) {
+		switch (vkFormat) {
+		case FORMAT_BC1_RGB_UNORM:
+		case FORMAT_ETC2_R8G8B8_UNORM:
+			return 8;
+		case FORMAT_BC7_UNORM:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	// Tamanho, em bytes, de uma camada de um nível de mipmap com as dimensões dadas
+	inline uint64_t LevelSize(uint32_t vkFormat, uint32_t width, uint32_t height) {
+		return (uint64_t)((width + 3) / 4) * ((height + 3) / 4) * BlockSize(vkFormat);
+	}
+}
+
+#endif // KTX2_H
@@ -0,0 +1,273 @@
+﻿/*****************************************************************************
+ * LightClusters.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe LightClusters, que faz a atribuição das luzes pontuais aos clusters
+ * do volume de visualização (iluminação "clustered forward"). A classe LightClusters é responsável por:
+ * - Dividir o volume de visualização numa grelha de GRID_X x GRID_Y blocos do ecrã e GRID_Z fatias de profundidade
+ *   exponenciais (froxels).
+ * - Encontrar, em cada quadro e na CPU, os clusters tocados pela esfera de alcance de cada luz.
+ * - Construir a lista compacta de luzes de cada cluster (primeiro índice e número de luzes, mais um array de índices),
+ *   para que os fragment shaders só percorram as luzes do cluster do fragmento.
+ * - Acrescentar um cluster extra, a seguir aos da grelha, com todas as luzes, para os fragmentos fora do volume de
+ *   visualização da câmera principal (desenhados pelas outras vistas do MultiView).
+ * - Escrever as luzes, os clusters e os índices no buffer do quadro, ligados aos blocos de armazenamento dos shaders.
+ *
+ * Funções principais:
+ * - Build(eyeLights, projection, nearPlane, farPlane, viewportSize): Atribui as luzes aos clusters.
+ * - FillBlock(LightBlock& block): Escreve os parâmetros da grelha no bloco LightData.
+ * - Upload(FrameUploadBuffer& uploadBuffer): Escreve as listas no buffer do quadro.
+ * - DepthSlice(float depth): Calcula a fatia de profundidade de uma distância.
+ * - ComputeRange(...): Calcula os clusters tocados por uma luz.
+ *
+ * Variáveis e constantes importantes:
+ * - GRID_X, GRID_Y, GRID_Z: Dimensões da grelha de clusters.
+ * - lights: Luzes pontuais do quadro, no espaço da câmera.
+ * - clusters: Primeiro índice e número de luzes de cada cluster.
+ * - indices: Índices das luzes de todos os clusters, seguidos.
+ *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+
+#include "LightClusters.h"
+
+
+/*****************************************************************************
+ * GLuint LightClusters::DepthSlice(float depth) const
+ *
+ * Descrição:
+ * ----------
+ * Calcula a fatia de profundidade de uma distância à câmera. As fatias são
+ * exponenciais, para que os clusters próximos da câmera não sejam muito mais
+ * compridos do que largos. É a mesma fórmula usada pelos fragment shaders.
+ *
+ * Parâmetros:
+ * -----------
+ * - depth: A distância à câmera ao longo da direção de visão (positiva).
+ *
+ * Retorno:
+ * --------
+ * - GLuint: A fatia, entre 0 e GRID_Z - 1.
+ *
+ ******************************************************************************/
+GLuint LightClusters::DepthSlice(float depth) const {
+	float slice = std::log(std::max(depth, 1e-4f)) * depthScale + depthBias;
+	return (GLuint)std::min(std::max(slice, 0.0f), (float)(GRID_Z - 1));
+}
+
+
+/*****************************************************************************
+ * bool LightClusters::ComputeRange(const PointLightBlock& light, const glm::mat4& projection,
+ * float nearPlane, float farPlane, ClusterRange& range) const
+ *
+ * Descrição:
+ * ----------
+ * Calcula o intervalo de clusters tocado pela esfera de alcance de uma luz. As
+ * fatias de profundidade vêm da profundidade mínima e máxima da esfera; os
+ * blocos do ecrã vêm da projeção dos 8 cantos da caixa que envolve a esfera, o
+ * que é conservador (pode incluir alguns clusters a mais, nunca a menos). Se a
+ * esfera atravessar o plano próximo, são usados todos os blocos do ecrã.
+ *
+ * Parâmetros:
+ * -----------
+ * - light: A luz, no espaço da câmera.
+ * - projection: A matriz de projeção.
+ * - nearPlane, farPlane: As distâncias dos planos próximo e distante.
+ * - range: Recebe o intervalo de clusters.
+ *
+ * Retorno:
+ * --------
+ * - bool: `false` se a esfera estiver toda fora do intervalo de profundidades visível.
+ *
+ ******************************************************************************/
+bool LightClusters::ComputeRange(const PointLightBlock& light, const glm::mat4& projection, float nearPlane, float farPlane, ClusterRange& range) const {
+	glm::vec3 center = light.position;
+	float radius = light.range;
+
+	// No espaço da câmera a direção de visão é -z
+	float minDepth = -center.z - radius;
+	float maxDepth = -center.z + radius;
+	if (maxDepth < nearPlane || minDepth > farPlane)
+		return false;
+
+	range.minZ = DepthSlice(std::max(minDepth, nearPlane));
+	range.maxZ = DepthSlice(std::min(maxDepth, farPlane));
+
+	range.minX = 0;
+	range.maxX = GRID_X - 1;
+	range.minY = 0;
+	range.maxY = GRID_Y - 1;
+
+	if (minDepth <= nearPlane)
+		return true;
+
+	glm::vec2 ndcMin(1.0f), ndcMax(-1.0f);
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 corner = center + glm::vec3((i & 1) ? radius : -radius, (i & 2) ? radius : -radius, (i & 4) ? radius : -radius);
+		glm::vec4 clip = projection * glm::vec4(corner, 1.0f);
+		glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+
+	if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f)
+		return false;
+
+	// De [-1, 1] para o índice do bloco, com a mesma divisão que gl_FragCoord / clusterTileSize nos shaders
+	auto tile = [](float ndc, GLuint count) {
+		float t = (ndc * 0.5f + 0.5f) * count;
+		return (GLuint)std::min(std::max(t, 0.0f), (float)(count - 1));
+	};
+
+	range.minX = tile(ndcMin.x, GRID_X);
+	range.maxX = tile(ndcMax.x, GRID_X);
+	range.minY = tile(ndcMin.y, GRID_Y);
+	range.maxY = tile(ndcMax.y, GRID_Y);
+
+	return true;
+}
+
+
+/*****************************************************************************
+ * void LightClusters::Build(const std::vector<PointLightBlock>& eyeLights, const glm::mat4& projection,
+ * float nearPlane, float farPlane, const glm::vec2& viewportSize)
+ *
+ * Descrição:
+ * ----------
+ * Atribui as luzes aos clusters em duas passagens: a primeira conta as luzes de
+ * cada cluster, o que dá o primeiro índice de cada um (soma prefixa); a segunda
+ * escreve os índices das luzes. O resultado é uma lista compacta, sem limite fixo
+ * de luzes por cluster. O cluster CLUSTER_COUNT, fora da grelha, lista todas as
+ * luzes. Os vetores são reutilizados entre quadros.
+ *
+ * Parâmetros:
+ * -----------
+ * - eyeLights: As luzes pontuais, no espaço da câmera.
+ * - projection: A matriz de projeção.
+ * - nearPlane, farPlane: As distâncias dos planos próximo e distante da projeção.
+ * - viewportSize: O tamanho do viewport, em píxeis.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void LightClusters::Build(const std::vector<PointLightBlock>& eyeLights, const glm::mat4& projection, float nearPlane, float farPlane, const glm::vec2& viewportSize) {
+	lights = eyeLights;
+
+	this->projection = projection;
+	tileSize = viewportSize / glm::vec2((float)GRID_X, (float)GRID_Y);
+	depthScale = GRID_Z / std::log(farPlane / nearPlane);
+	depthBias = -GRID_Z * std::log(nearPlane) / std::log(farPlane / nearPlane);
+
+	clusters.assign((CLUSTER_COUNT + 1) * 2, 0);
+	ranges.resize(lights.size());
+
+	// Primeira passagem: número de luzes de cada cluster (guardado no segundo valor do par)
+	for (size_t i = 0; i < lights.size(); i++) {
+		ClusterRange& range = ranges[i];
+		if (!ComputeRange(lights[i], projection, nearPlane, farPlane, range)) {
+			range.minZ = 1;
+			range.maxZ = 0;
+			continue;
+		}
+
+		for (GLuint z = range.minZ; z <= range.maxZ; z++)
+			for (GLuint y = range.minY; y <= range.maxY; y++)
+				for (GLuint x = range.minX; x <= range.maxX; x++)
+					clusters[(x + GRID_X * (y + GRID_Y * z)) * 2 + 1]++;
+	}
+
+	// Primeiro índice de cada cluster; o número volta a zero para servir de cursor na segunda passagem
+	GLuint total = 0;
+	for (GLuint c = 0; c < CLUSTER_COUNT; c++) {
+		clusters[c * 2] = total;
+		total += clusters[c * 2 + 1];
+		clusters[c * 2 + 1] = 0;
+	}
+
+	// Segunda passagem: índices das luzes, seguidos dos do cluster extra (todas as luzes)
+	indices.resize(total + lights.size());
+	for (size_t i = 0; i < lights.size(); i++) {
+		const ClusterRange& range = ranges[i];
+		for (GLuint z = range.minZ; z <= range.maxZ; z++)
+			for (GLuint y = range.minY; y <= range.maxY; y++)
+				for (GLuint x = range.minX; x <= range.maxX; x++) {
+					GLuint c = (x + GRID_X * (y + GRID_Y * z)) * 2;
+					indices[clusters[c] + clusters[c + 1]++] = (GLuint)i;
+				}
+	}
+
+	clusters[CLUSTER_COUNT * 2] = total;
+	clusters[CLUSTER_COUNT * 2 + 1] = (GLuint)lights.size();
+	for (size_t i = 0; i < lights.size(); i++)
+		indices[total + i] = (GLuint)i;
+}
+
+
+/*****************************************************************************
+ * void LightClusters::FillBlock(LightBlock& block) const
+ *
+ * Descrição:
+ * ----------
+ * Escreve no bloco LightData os parâmetros da grelha usados pelos fragment
+ * shaders para encontrar o cluster de cada fragmento: o tamanho dos blocos no
+ * ecrã (gl_FragCoord) ou, nas variantes MULTI_VIEW, a própria projeção.
+ *
+ * Parâmetros:
+ * -----------
+ * - block: O bloco de luzes a completar.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void LightClusters::FillBlock(LightBlock& block) const {
+	block.clusterGrid[0] = GRID_X;
+	block.clusterGrid[1] = GRID_Y;
+	block.clusterGrid[2] = GRID_Z;
+	block.pointLightCount = (GLuint)lights.size();
+	block.clusterTileSize = tileSize;
+	block.clusterScale = depthScale;
+	block.clusterBias = depthBias;
+	block.clusterProjection = projection;
+}
+
+
+/*****************************************************************************
+ * bool LightClusters::Upload(FrameUploadBuffer& uploadBuffer) const
+ *
+ * Descrição:
+ * ----------
+ * Escreve as luzes, os clusters e os índices no buffer do quadro e liga-os aos
+ * blocos PointLightData, ClusterData e LightIndexData. Um intervalo ligado não
+ * pode ter tamanho zero, por isso as listas vazias são enviadas com um elemento,
+ * que os shaders nunca leem (os clusters indicam zero luzes).
+ *
+ * Parâmetros:
+ * -----------
+ * - uploadBuffer: O buffer do quadro.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se as três listas foram escritas, `false` se o buffer do quadro estiver cheio.
+ *
+ ******************************************************************************/
+bool LightClusters::Upload(FrameUploadBuffer& uploadBuffer) const {
+	static const PointLightBlock emptyLight = {};
+	static const GLuint emptyIndex = 0;
+
+	const void* lightData = lights.empty() ? (const void*)&emptyLight : (const void*)lights.data();
+	GLsizeiptr lightSize = std::max<size_t>(lights.size(), 1) * sizeof(PointLightBlock);
+
+	const void* indexData = indices.empty() ? (const void*)&emptyIndex : (const void*)indices.data();
+	GLsizeiptr indexSize = std::max<size_t>(indices.size(), 1) * sizeof(GLuint);
+
+	return uploadBuffer.UploadStorage(POINT_LIGHT_BLOCK_BINDING, lightData, lightSize) >= 0 &&
+		uploadBuffer.UploadStorage(CLUSTER_BLOCK_BINDING, clusters.data(), clusters.size() * sizeof(GLuint)) >= 0 &&
+		uploadBuffer.UploadStorage(LIGHT_INDEX_BLOCK_BINDING, indexData, indexSize) >= 0;
+}
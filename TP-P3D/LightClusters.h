@@ -0,0 +1,48 @@
+﻿#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "FrameUploadBuffer.h"
+#include "UniformBlocks.h"
+
+// Grelha de clusters (froxels) do volume de visualização, com a lista das luzes pontuais que tocam cada cluster
+class LightClusters {
+public:
+	static const GLuint GRID_X = 16; // Clusters na horizontal do ecrã
+	static const GLuint GRID_Y = 16; // Clusters na vertical do ecrã
+	static const GLuint GRID_Z = 24; // Fatias de profundidade (exponenciais entre os planos próximo e distante)
+	static const GLuint CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z; // Clusters da grelha (o cluster CLUSTER_COUNT tem todas as luzes)
+
+	// Atribui as luzes (no espaço da câmera) aos clusters que as suas esferas de alcance tocam
+	void Build(const std::vector<PointLightBlock>& eyeLights, const glm::mat4& projection, float nearPlane, float farPlane, const glm::vec2& viewportSize);
+	void FillBlock(LightBlock& block) const; // Escreve os parâmetros da grelha no bloco LightData
+	bool Upload(FrameUploadBuffer& uploadBuffer) const; // Escreve as luzes, os clusters e os índices no buffer do quadro
+
+	size_t GetLightCount() const { return lights.size(); } // Luzes pontuais do quadro
+	size_t GetIndexCount() const { return indices.size(); } // Total de referências a luzes em todos os clusters
+
+private:
+	// Intervalo de clusters tocados por uma luz (inclusivo)
+	struct ClusterRange {
+		GLuint minX, maxX;
+		GLuint minY, maxY;
+		GLuint minZ, maxZ;
+	};
+
+	std::vector<PointLightBlock> lights; // Luzes do quadro, no espaço da câmera
+	std::vector<GLuint> clusters;        // Pares (primeiro índice, número de luzes) de cada cluster
+	std::vector<GLuint> indices;         // Índices das luzes, agrupados por cluster
+	std::vector<ClusterRange> ranges;    // Clusters tocados por cada luz (reutilizado entre quadros)
+
+	glm::mat4 projection;  // Projeção com que a grelha foi construída
+	glm::vec2 tileSize;    // Tamanho de cada cluster no ecrã, em píxeis
+	float depthScale;      // Fatia = log(profundidade) * depthScale + depthBias
+	float depthBias;
+
+	GLuint DepthSlice(float depth) const; // Fatia de profundidade de uma distância à câmera
+	bool ComputeRange(const PointLightBlock& light, const glm::mat4& projection, float nearPlane, float farPlane, ClusterRange& range) const;
+};
+
+#endif // LIGHT_CLUSTERS_H
@@ -6,22 +6,51 @@
  * Este arquivo contm a implementao da classe Lights, que gere as diferentes fontes de luz no jogo. A classe Lights  responsvel por:
  * - Controlar o estado (ligado/desligado) de cada tipo de luz: ambiente, direcional, luz pontual e spot.
  * - Alternar o estado das luzes atravs da funo ToggleLight, que  chamada quando o utilizador pressiona as teclas correspondentes.
+ * - Preencher os blocos de uniforms (LightData) com os parmetros das luzes das bolas e da mesa, escritos uma vez por quadro.
+ * - Guardar a lista de luzes pontuais da cena (a luz pontual e os candeeiros da sala) e, em cada quadro, pass-las para
+ *   o espao da cmera e atribu-las aos clusters do volume de visualizao (LightClusters), para que cada fragmento
+ *   s calcule as luzes que lhe chegam.
+ * - Calcular, em cada quadro, as matrizes de vista e projeo das luzes direcional e spot, usadas para desenhar e
+ *   ler os mapas de sombras (ShadowMaps).
  *
  * Funes principais:
  * - Lights(): Construtor da classe Lights, que inicializa os estados das luzes.
  * - ToggleLight(int key): Alterna o estado de uma luz especfica com base na tecla pressionada.
+ * - GetBallLights(): Devolve o bloco de luzes dos shaders das bolas.
+ * - GetTableLights(): Devolve o bloco de luzes do shader da mesa.
+ * - Update(...): Passa as luzes pontuais ativas para o espao da cmera e constri os clusters.
+ * - Upload(FrameUploadBuffer& uploadBuffer): Escreve as luzes pontuais e os clusters no buffer do quadro.
+ * - AddHallLights(): Cria a grelha de candeeiros por cima da mesa.
+ * - IsShadowLightEnabled(int light): Indica se a luz de um mapa de sombras est ligada.
+ * - GetShaderVariant(): Devolve a variante dos shaders de iluminao para as luzes ligadas.
+ * - GetShaderVariantDefines(int variant): Devolve as macros com que uma variante  compilada.
+ * - SetQualityLimits(bool allowHallLights, bool allowSpotLight): Desliga temporariamente as luzes mais caras.
+ * - FillShadowMatrices(LightBlock& block): Escreve as matrizes das sombras no bloco LightData.
  *
  * Variveis e constantes importantes:
  * - isAmbientLightEnabled: Indica se a luz ambiente est ligada (true) ou desligada (false).
  * - isDirectionalLightEnabled: Indica se a luz direcional est ligada (true) ou desligada (false).
  * - isPointLightEnabled: Indica se a luz pontual est ligada (true) ou desligada (false).
  * - isSpotLightEnabled: Indica se a luz spot est ligada (true) ou desligada (false).
+ * - isHallLightsEnabled: Indica se os candeeiros da sala esto ligados (true) ou desligados (false).
+ * - pointLights: Lista das luzes pontuais da cena; a primeira  a luz pontual da tecla 3.
+ * - HALL_LIGHTS_X, HALL_LIGHTS_Z: Dimenses da grelha de candeeiros.
+ * - directionalDirection, spotPosition, spotDirection, spotCutoff: Parmetros das luzes direcional e spot,
+ *   partilhados pelas bolas, pela mesa e pelos mapas de sombras.
+ * - stateVersion: Contador das mudanas feitas por ToggleLight e SetQualityLimits (invalida os mapas de sombras guardados).
+ * - hallLightsAllowed, spotLightAllowed: Limites do QualityGovernor; uma luz s  desenhada se estiver ligada e permitida.
+ * - VARIANT_AMBIENT, VARIANT_DIRECTIONAL, VARIANT_POINT, VARIANT_SPOT: Bits do ndice das variantes dos shaders.
+ * - SHADOW_RADIUS: Raio da esfera, centrada na mesa, coberta pelo mapa de sombras da luz direcional.
  *
  ******************************************************************************/
 
 
 #include "Lights.h"
 #include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Raio da esfera centrada na origem que contm a mesa e as bolas (coberta pelo mapa de sombras da luz direcional)
+static const float SHADOW_RADIUS = 1.1f;
 
 
  /*****************************************************************************
@@ -53,7 +82,72 @@ Lights::Lights()
 	: isAmbientLightEnabled(true),
 	isDirectionalLightEnabled(false),
 	isPointLightEnabled(false),
-	isSpotLightEnabled(false) {
+	isSpotLightEnabled(false),
+	isHallLightsEnabled(false),
+	directionalDirection(1.0f, -0.5f, 0.0f),
+	spotPosition(0.0f, 0.8f, 0.0f),
+	spotDirection(0.0f, -1.0f, 0.0f),
+	spotCutoff(glm::radians(30.0f)),
+	stateVersion(0),
+	hallLightsAllowed(true),
+	spotLightAllowed(true) {
+	for (int i = 0; i < SHADOW_LIGHT_COUNT; i++) {
+		shadowViewProjection[i] = glm::mat4(1.0f);
+		shadowMatrix[i] = glm::mat4(1.0f);
+	}
+
+	// Luz pontual da tecla 3, por cima do centro da mesa
+	PointLight light;
+	light.position = glm::vec3(0.0f, 0.6f, 0.0f);
+	light.ambient = glm::vec3(0.1f, 0.1f, 0.1f);
+	light.diffuse = glm::vec3(1.5f, 1.5f, 1.5f);
+	light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+	light.constant = 1.0f;
+	light.linear = 0.09f;
+	light.quadratic = 0.032f;
+	light.range = 1000.0f; // Sem limite prtico: toca todos os clusters
+	pointLights.push_back(light);
+
+	AddHallLights();
+}
+
+
+/*****************************************************************************
+ * void Lights::AddHallLights()
+ *
+ * Descrio:
+ * ----------
+ * Cria uma grelha de HALL_LIGHTS_X x HALL_LIGHTS_Z pequenos candeeiros logo por
+ * cima da mesa, com cores quentes ligeiramente diferentes. Cada candeeiro tem um
+ * raio de alcance curto, por isso cada ponto da mesa s recebe a luz de poucos
+ * candeeiros, apesar de serem centenas.
+ *
+ * Parmetros:
+ * -----------
+ * - Nenhum.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Lights::AddHallLights() {
+	for (int z = 0; z < HALL_LIGHTS_Z; z++) {
+		for (int x = 0; x < HALL_LIGHTS_X; x++) {
+			float tint = (float)((x + z) % 3) * 0.05f;
+
+			PointLight lamp;
+			lamp.position = glm::vec3(-0.9f + 1.8f * x / (HALL_LIGHTS_X - 1), 0.15f, -0.45f + 0.9f * z / (HALL_LIGHTS_Z - 1));
+			lamp.ambient = glm::vec3(0.0f);
+			lamp.diffuse = glm::vec3(0.25f, 0.2f - tint, 0.12f + tint);
+			lamp.specular = glm::vec3(0.1f);
+			lamp.constant = 1.0f;
+			lamp.linear = 0.0f;
+			lamp.quadratic = 0.0f;
+			lamp.range = 0.15f;
+			pointLights.push_back(lamp);
+		}
+	}
 }
 
 
@@ -66,11 +160,15 @@ Lights::Lights()
  * (ligado/desligado) de um tipo de luz especfico com base em um valor de tecla
  * fornecido como entrada. A funo utiliza uma estrutura `switch` para determinar
  * qual luz deve ser alternada e, em seguida, inverte o estado da luz correspondente.
+ * Os shaders no leem o estado das luzes: a mudana altera a variante devolvida
+ * por `GetShaderVariant`, e as bolas e a mesa passam a ser desenhadas com o
+ * programa dessa variante.
  *
  * Parmetros:
  * -----------
  * - key: Um valor inteiro que representa a tecla pressionada pelo utilizador. Cada valor
- *  corresponde a um tipo especfico de luz (1 para ambiente, 2 para direcional, 3 para luz pontual e 4 para spot).
+ *  corresponde a um tipo especfico de luz (1 para ambiente, 2 para direcional, 3 para luz pontual, 4 para spot
+ *  e 5 para os candeeiros da sala).
  *
  * Retorno:
  * --------
@@ -99,9 +197,345 @@ void Lights::ToggleLight(int key) {
 		std::cout << "Spot light toggled. Now ";
 		std::cout << (isSpotLightEnabled ? "enabled" : "disabled") << std::endl;
 		break;
-	default:
+	case 5:
+		isHallLightsEnabled = !isHallLightsEnabled;
+		std::cout << "Hall lights (" << pointLights.size() - 1 << " lamps) toggled. Now ";
+		std::cout << (isHallLightsEnabled ? "enabled" : "disabled") << std::endl;
 		break;
+	default:
+		return;
+	}
+
+	stateVersion++;
+}
+
+
+/*****************************************************************************
+ * int Lights::GetShaderVariant() const
+ *
+ * Descrio:
+ * ----------
+ * Devolve o ndice da variante dos shaders de iluminao que corresponde s
+ * luzes ligadas (um bit ShaderVariantBit por tipo de luz). A luz pontual e os
+ * candeeiros da sala partilham o bit VARIANT_POINT, porque ambos so lidos dos
+ * clusters.
+ *
+ * Retorno:
+ * --------
+ * - int: O ndice da variante, de 0 a VARIANT_COUNT - 1.
+ *
+ ******************************************************************************/
+int Lights::GetShaderVariant() const {
+	int variant = 0;
+	if (isAmbientLightEnabled)
+		variant |= VARIANT_AMBIENT;
+	if (isDirectionalLightEnabled)
+		variant |= VARIANT_DIRECTIONAL;
+	if (isPointLightEnabled || IsHallLightsActive())
+		variant |= VARIANT_POINT;
+	if (IsSpotLightActive())
+		variant |= VARIANT_SPOT;
+	return variant;
+}
+
+
+/*****************************************************************************
+ * std::string Lights::GetShaderVariantDefines(int variant)
+ *
+ * Descrio:
+ * ----------
+ * Devolve as linhas `#define` com que os shaders de uma variante so
+ * compilados (uma macro por tipo de luz ligado), passadas a `LoadShaderVariants`.
+ *
+ * Parmetros:
+ * -----------
+ * - variant: O ndice da variante.
+ *
+ * Retorno:
+ * --------
+ * - std::string: As linhas `#define` da variante.
+ *
+ ******************************************************************************/
+std::string Lights::GetShaderVariantDefines(int variant) {
+	std::string defines;
+	if (variant & VARIANT_AMBIENT)
+		defines += "#define AMBIENT_LIGHT\n";
+	if (variant & VARIANT_DIRECTIONAL)
+		defines += "#define DIRECTIONAL_LIGHT\n";
+	if (variant & VARIANT_POINT)
+		defines += "#define POINT_LIGHTS\n";
+	if (variant & VARIANT_SPOT)
+		defines += "#define SPOT_LIGHT\n";
+	return defines;
+}
+
+
+/*****************************************************************************
+ * void Lights::SetQualityLimits(bool allowHallLights, bool allowSpotLight)
+ *
+ * Descrio:
+ * ----------
+ * Permite ou impede o desenho das luzes mais caras: os candeeiros da sala
+ * (centenas de luzes nos clusters) e a luz spot (cone e mapa de sombras). 
+ * chamada pelo QualityGovernor em cada quadro; o estado pedido pelas teclas no
+ * muda, por isso as luzes voltam quando a qualidade sobe. Uma mudana efetiva
+ * conta como uma mudana de estado (invalida os mapas de sombras guardados).
+ *
+ * Parmetros:
+ * -----------
+ * - allowHallLights: true para permitir os candeeiros da sala.
+ * - allowSpotLight: true para permitir a luz spot.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Lights::SetQualityLimits(bool allowHallLights, bool allowSpotLight) {
+	if (allowHallLights == hallLightsAllowed && allowSpotLight == spotLightAllowed)
+		return;
+
+	hallLightsAllowed = allowHallLights;
+	spotLightAllowed = allowSpotLight;
+	stateVersion++;
+}
+
+
+/*****************************************************************************
+ * void Lights::Update(const glm::mat4& worldToEye, float eyeScale,
+ * const glm::mat4& projection, float nearPlane, float farPlane, const glm::vec2& viewportSize)
+ *
+ * Descrio:
+ * ----------
+ * Passa as luzes pontuais ativas para o espao da cmera e atribui-as aos
+ * clusters do volume de visualizao. Calcula tambm as matrizes das luzes
+ * direcional e spot: a vista e projeo de cada luz no espao do mundo (para
+ * desenhar os mapas de sombras) e a matriz que leva um ponto do
+ * espao da cmera s coordenadas do mapa (para os ler nos shaders). Deve ser
+ * chamada uma vez por quadro, depois de a cmera ser atualizada e antes de
+ * `Upload` e de `GetBallLights`/`GetTableLights`.
+ *
+ * Todas as luzes esto no espao do mundo, que  tambm o espao das posies
+ * das bolas e da mesa (a cena no tem matriz de modelo prpria), como
+ * nos shaders.
+ *
+ * Parmetros:
+ * -----------
+ * - worldToEye: Matriz do espao do mundo para o espao da cmera (vista e zoom).
+ * - eyeScale: Escala uniforme dessa matriz (o zoom), aplicada ao raio de alcance das luzes.
+ * - projection: A matriz de projeo.
+ * - nearPlane, farPlane: As distncias dos planos prximo e distante da projeo.
+ * - viewportSize: O tamanho do viewport, em pxeis.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Lights::Update(const glm::mat4& worldToEye, float eyeScale, const glm::mat4& projection, float nearPlane, float farPlane, const glm::vec2& viewportSize) {
+	eyeLights.clear();
+
+	for (size_t i = 0; i < pointLights.size(); i++) {
+		bool enabled = (i == 0) ? isPointLightEnabled : IsHallLightsActive();
+		if (!enabled)
+			continue;
+
+		const PointLight& light = pointLights[i];
+
+		PointLightBlock block;
+		block.position = glm::vec3(worldToEye * glm::vec4(light.position, 1.0f));
+		block.range = light.range * glm::abs(eyeScale);
+		block.ambient = light.ambient;
+		block.constant = light.constant;
+		block.diffuse = light.diffuse;
+		block.linear = light.linear;
+		block.specular = light.specular;
+		block.quadratic = light.quadratic;
+		eyeLights.push_back(block);
+	}
+
+	clusters.Build(eyeLights, projection, nearPlane, farPlane, viewportSize);
+
+	// Luz direcional: projeo ortogrfica que cobre a esfera da mesa, vista de fora dela ao longo da direo da luz
+	glm::vec3 direction = glm::normalize(directionalDirection);
+	glm::mat4 directionalView = glm::lookAt(-direction * (2.0f * SHADOW_RADIUS), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 directionalProjection = glm::ortho(-SHADOW_RADIUS, SHADOW_RADIUS, -SHADOW_RADIUS, SHADOW_RADIUS, 0.0f, 4.0f * SHADOW_RADIUS);
+
+	// Luz spot: projeo em perspetiva com o ngulo do cone
+	glm::mat4 spotView = glm::lookAt(spotPosition, spotPosition + spotDirection, glm::vec3(0.0f, 0.0f, -1.0f));
+	glm::mat4 spotProjection = glm::perspective(2.0f * spotCutoff, 1.0f, 0.05f, 4.0f * SHADOW_RADIUS);
+
+	glm::mat4 worldViewProjection[SHADOW_LIGHT_COUNT] = {
+		directionalProjection * directionalView,
+		spotProjection * spotView
+	};
+
+	// De [-1, 1] (coordenadas normalizadas) para [0, 1] (coordenadas de textura e profundidade)
+	glm::mat4 bias = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)), glm::vec3(0.5f));
+	glm::mat4 eyeToWorld = glm::inverse(worldToEye);
+
+	for (int i = 0; i < SHADOW_LIGHT_COUNT; i++) {
+		shadowViewProjection[i] = worldViewProjection[i];
+		shadowMatrix[i] = bias * worldViewProjection[i] * eyeToWorld;
 	}
 }
 
 
+/*****************************************************************************
+ * bool Lights::IsShadowLightEnabled(int light) const
+ *
+ * Descrio:
+ * ----------
+ * Indica se a luz de um mapa de sombras est ligada. Os mapas das luzes
+ * desligadas no so desenhados.
+ *
+ * Parmetros:
+ * -----------
+ * - light: A luz (SHADOW_DIRECTIONAL ou SHADOW_SPOT).
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se a luz estiver ligada.
+ *
+ ******************************************************************************/
+bool Lights::IsShadowLightEnabled(int light) const {
+	return light == SHADOW_DIRECTIONAL ? isDirectionalLightEnabled : IsSpotLightActive();
+}
+
+
+/*****************************************************************************
+ * void Lights::FillShadowMatrices(LightBlock& block) const
+ *
+ * Descrio:
+ * ----------
+ * Escreve no bloco LightData as matrizes que levam um ponto do espao da cmera
+ * s coordenadas dos mapas de sombras, calculadas em `Update`.
+ *
+ * Parmetros:
+ * -----------
+ * - block: O bloco de luzes a completar.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Lights::FillShadowMatrices(LightBlock& block) const {
+	for (int i = 0; i < SHADOW_LIGHT_COUNT; i++)
+		block.shadowMatrix[i] = shadowMatrix[i];
+}
+
+
+/*****************************************************************************
+ * bool Lights::Upload(FrameUploadBuffer& uploadBuffer) const
+ *
+ * Descrio:
+ * ----------
+ * Escreve as luzes pontuais do quadro e a sua atribuio aos clusters no buffer
+ * do quadro, ligadas aos blocos de armazenamento lidos pelos fragment shaders.
+ *
+ * Parmetros:
+ * -----------
+ * - uploadBuffer: O buffer do quadro.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se os dados foram escritos, `false` se o buffer do quadro estiver cheio.
+ *
+ ******************************************************************************/
+bool Lights::Upload(FrameUploadBuffer& uploadBuffer) const {
+	return clusters.Upload(uploadBuffer);
+}
+
+
+/*****************************************************************************
+ * LightBlock Lights::GetBallLights() const
+ *
+ * Descrio:
+ * ----------
+ * Preenche o bloco de uniforms `LightData` lido pelos shaders das bolas (malha e
+ * impostores) com o estado atual das luzes e os parmetros de cada uma. O bloco
+ *  escrito uma vez por quadro e partilhado por todas as bolas. As luzes pontuais
+ * no esto no bloco: o bloco indica apenas a grelha de clusters construda em `Update`.
+ *
+ * Parmetros:
+ * -----------
+ * - Nenhum.
+ *
+ * Retorno:
+ * --------
+ * - LightBlock: O bloco de luzes das bolas.
+ *
+ ******************************************************************************/
+LightBlock Lights::GetBallLights() const {
+	LightBlock block = {};
+
+	block.ambientLight.ambient = glm::vec3(0.8f, 0.8f, 0.8f);
+
+	block.directionalLight.direction = directionalDirection;
+	block.directionalLight.ambient = glm::vec3(0.5f, 0.5f, 0.5f);
+	block.directionalLight.diffuse = glm::vec3(1.0f, 1.0f, 1.0f);
+	block.directionalLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+
+	block.spotLight.position = spotPosition;
+	block.spotLight.ambient = glm::vec3(0.5f, 0.5f, 0.5f);
+	block.spotLight.diffuse = glm::vec3(2.0f, 2.0f, 2.0f);
+	block.spotLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+	block.spotLight.constant = 1.0f;
+	block.spotLight.linear = 0.09f; // Ajuste de atenuao
+	block.spotLight.quadratic = 0.032f; // Ajuste de atenuao
+	block.spotLight.spotCutoff = spotCutoff;
+	block.spotLight.spotExponent = 2.0f;
+	block.spotLight.spotDirection = spotDirection;
+
+	clusters.FillBlock(block);
+	FillShadowMatrices(block);
+
+	return block;
+}
+
+
+/*****************************************************************************
+ * LightBlock Lights::GetTableLights() const
+ *
+ * Descrio:
+ * ----------
+ * Preenche o bloco de uniforms `LightData` lido pelo shader da mesa. A mesa usa
+ * as mesmas luzes que as bolas, mas com intensidades diferentes. A luz spot fica
+ * por cima da mesa, virada para baixo, e  a mesma que ilumina as bolas.
+ *
+ * Parmetros:
+ * -----------
+ * - Nenhum.
+ *
+ * Retorno:
+ * --------
+ * - LightBlock: O bloco de luzes da mesa.
+ *
+ ******************************************************************************/
+LightBlock Lights::GetTableLights() const {
+	LightBlock block = {};
+
+	block.ambientLight.ambient = glm::vec3(0.8f, 0.8f, 0.8f);
+
+	block.directionalLight.direction = directionalDirection;
+	block.directionalLight.ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+	block.directionalLight.diffuse = glm::vec3(1.0f, 1.0f, 1.0f);
+	block.directionalLight.specular = glm::vec3(0.5f, 0.5f, 0.5f);
+
+	block.spotLight.position = spotPosition; // Posio da luz (acima da mesa)
+	block.spotLight.ambient = glm::vec3(0.1f, 0.1f, 0.1f);
+	block.spotLight.diffuse = glm::vec3(2.0f, 2.0f, 2.0f);
+	block.spotLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+	block.spotLight.constant = 1.0f;
+	block.spotLight.linear = 0.09f;
+	block.spotLight.quadratic = 0.032f;
+	block.spotLight.spotCutoff = spotCutoff;
+	block.spotLight.spotExponent = 0.0f;
+	block.spotLight.spotDirection = spotDirection;
+
+	clusters.FillBlock(block);
+	FillShadowMatrices(block);
+
+	return block;
+}
@@ -1,7 +1,24 @@
 #ifndef LIGHTS_H
 #define LIGHTS_H
 
+#include <vector>
+#include <string>
 #include <glm/glm.hpp>
+#include "UniformBlocks.h"
+#include "LightClusters.h"
+#include "FrameUploadBuffer.h"
+
+// Luz pontual da cena, no espao do mundo
+struct PointLight {
+	glm::vec3 position; // Posio da luz
+	glm::vec3 ambient;  // Componente de luz ambiente
+	glm::vec3 diffuse;  // Componente de luz difusa
+	glm::vec3 specular; // Componente de luz especular
+	float constant;     // Coeficiente de atenuao constante
+	float linear;       // Coeficiente de atenuao linear
+	float quadratic;    // Coeficiente de atenuao quadrtica
+	float range;        // Raio de alcance (a luz  ignorada fora dele)
+};
 
 class Lights {
 public:
@@ -9,12 +26,65 @@ public:
 	bool isDirectionalLightEnabled; // Indica se a luz direcional est ativa
 	bool isPointLightEnabled;   // Indica se a luz pontual est ativa
 	bool isSpotLightEnabled;    // Indica se a luz spot est ativa
+	bool isHallLightsEnabled;   // Indica se os candeeiros da sala esto ativos
+
+	std::vector<PointLight> pointLights; // Luzes pontuais: a primeira  a da tecla 3, as restantes so os candeeiros
+
+	glm::vec3 directionalDirection; // Direo da luz direcional (espao do mundo)
+	glm::vec3 spotPosition;         // Posio da luz spot (espao do mundo)
+	glm::vec3 spotDirection;        // Direo da luz spot (espao do mundo)
+	float spotCutoff;               // ngulo de corte da luz spot, em radianos
+
+	// Luzes com mapa de sombras (camadas dos mapas de sombras)
+	enum ShadowLight {
+		SHADOW_DIRECTIONAL = 0,
+		SHADOW_SPOT = 1,
+		SHADOW_LIGHT_COUNT = 2
+	};
+
+	// Bits do ndice da variante dos shaders de iluminao: cada combinao de tipos de luz ligados tem o seu programa,
+	// compilado com as macros de GetShaderVariantDefines, sem ramos nem clculos das luzes desligadas
+	enum ShaderVariantBit {
+		VARIANT_AMBIENT = 1,     // AMBIENT_LIGHT
+		VARIANT_DIRECTIONAL = 2, // DIRECTIONAL_LIGHT
+		VARIANT_POINT = 4,       // POINT_LIGHTS (luz pontual ou candeeiros da sala)
+		VARIANT_SPOT = 8,        // SPOT_LIGHT
+		VARIANT_COUNT = 16
+	};
+
+	static const int HALL_LIGHTS_X = 24; // Candeeiros ao longo da mesa
+	static const int HALL_LIGHTS_Z = 12; // Candeeiros ao longo da largura da mesa
 
 	Lights(); // Construtor da classe Lights
 
 	void ToggleLight(int key); // Alterna o estado de uma luz com base na tecla pressionada
+	void Update(const glm::mat4& worldToEye, float eyeScale, const glm::mat4& projection, float nearPlane, float farPlane, const glm::vec2& viewportSize); // Passa as luzes ativas para o espao da cmera, atribui-as aos clusters e calcula as matrizes das sombras
+	bool Upload(FrameUploadBuffer& uploadBuffer) const; // Escreve as luzes pontuais e os clusters no buffer do quadro
+	LightBlock GetBallLights() const;  // Bloco de luzes usado pelos shaders das bolas
+	LightBlock GetTableLights() const; // Bloco de luzes usado pelo shader da mesa
+
+	bool IsShadowLightEnabled(int light) const; // Indica se a luz de um mapa de sombras est ativa
+	const glm::mat4& GetShadowViewProjection(int light) const { return shadowViewProjection[light]; } // Matriz da luz, no espao do mundo
+	unsigned int GetStateVersion() const { return stateVersion; } // Muda sempre que uma luz  ligada ou desligada
+	int GetShaderVariant() const; // Variante dos shaders de iluminao para as luzes ligadas (ndice dos programas)
+	void SetQualityLimits(bool allowHallLights, bool allowSpotLight); // Desliga as luzes caras pedidas pelo QualityGovernor, sem mudar o estado das teclas
+	static std::string GetShaderVariantDefines(int variant); // Linhas #define de uma variante
+
+private:
+	LightClusters clusters;                  // Atribuio das luzes pontuais aos clusters do volume de visualizao
+	std::vector<PointLightBlock> eyeLights;  // Luzes pontuais ativas no espao da cmera (reutilizado entre quadros)
+	glm::mat4 shadowViewProjection[SHADOW_LIGHT_COUNT]; // Vista e projeo de cada luz com sombras, no espao do mundo
+	glm::mat4 shadowMatrix[SHADOW_LIGHT_COUNT];         // Do espao da cmera para as coordenadas de textura de cada mapa de sombras
+	unsigned int stateVersion; // Contador das mudanas de estado feitas por ToggleLight e SetQualityLimits
+	bool hallLightsAllowed;    // Os candeeiros da sala podem ser desenhados (limite do QualityGovernor)
+	bool spotLightAllowed;     // A luz spot pode ser desenhada (limite do QualityGovernor)
+
+	bool IsHallLightsActive() const { return isHallLightsEnabled && hallLightsAllowed; } // Ligados e permitidos
+	bool IsSpotLightActive() const { return isSpotLightEnabled && spotLightAllowed; }   // Ligada e permitida
 
+	void FillShadowMatrices(LightBlock& block) const; // Escreve as matrizes das sombras no bloco LightData
 
+	void AddHallLights(); // Cria a grelha de candeeiros por cima da mesa
 };
 
 #endif // LIGHTS_H
@@ -5,12 +5,19 @@
  * ----------
  * Este arquivo contém a implementação das funções `ReadShader` e `LoadShaders`, que são responsáveis por:
  * - Ler o código fonte dos shaders a partir de arquivos.
- * - Compilar os shaders.
+ * - Compilar os shaders, opcionalmente em várias variantes, cada uma com as suas macros `#define`.
  * - Criar e linkar um programa de shader, que combina os shaders de vértice e fragmento.
+ * - Guardar o binário do programa linkado num ficheiro de cache e, nos arranques seguintes, carregá-lo com
+ *   `glProgramBinary` em vez de compilar, enquanto o código dos shaders e o driver forem os mesmos.
  * - Retornar um identificador para o programa de shader criado.
  *
  * Funções principais:
  * - ReadShader(const char* filename): Lê o código fonte de um shader a partir de um arquivo.
+ * - ComputeProgramKey(...): Calcula a chave da cache a partir do código dos shaders e do driver.
+ * - LoadProgramBinary(GLuint program, uint64_t key): Tenta criar o programa a partir do binário guardado.
+ * - SaveProgramBinary(GLuint program, uint64_t key): Guarda o binário de um programa linkado.
+ * - SetShaderSource(GLuint shader, const GLchar* source, const char* defines): Insere as macros de uma variante.
+ * - LoadShaderVariants(...): Cria um programa por variante (macros `#define`), compilados em paralelo.
  * - LoadShaders(ShaderInfo* shaders): Carrega, compila e linka os shaders, cria um programa de shader.
  *
  * Estruturas de dados importantes:
@@ -18,6 +25,8 @@
  *
  * Variáveis e constantes importantes:
  * - _DEBUG: Macro que ativa o modo de depuração, para exibir mensagens de erro detalhadas.
+ * - PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_EXTENSION: Identificador e extensão dos ficheiros da cache de programas.
+ * - ProgramCacheHeader: Cabeçalho de cada ficheiro da cache (chave, formato e tamanho do binário).
  *
  ******************************************************************************/
 
@@ -26,12 +35,31 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
 
 #define GLEW_STATIC
-#include <GL\glew.h>
+#include <GL/glew.h>
 #include "LoadShaders.h"
 
 
+// Identificador no início dos ficheiros da cache de programas («PBIN») e extensão dos ficheiros
+const uint32_t PROGRAM_CACHE_MAGIC = 0x4E494250;
+const char* PROGRAM_CACHE_EXTENSION = ".progbin";
+
+// Cabeçalho de um ficheiro da cache, seguido do binário devolvido por glGetProgramBinary
+struct ProgramCacheHeader {
+	uint32_t magic;        // PROGRAM_CACHE_MAGIC
+	uint32_t binaryFormat; // Formato do binário, a passar a glProgramBinary
+	uint64_t key;          // Chave do programa (repetida, para detetar ficheiros trocados)
+	uint64_t length;       // Tamanho do binário, em bytes
+};
+
+
  /*****************************************************************************
  * static const GLchar* ReadShader(const char* filename)
  *
@@ -74,97 +102,417 @@ static const GLchar* ReadShader(const char* filename) {
 
 
 /*****************************************************************************
- * GLuint LoadShaders(ShaderInfo* shaders)
+ * static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
  *
  * Descrição:
  * ----------
- * Esta função carrega, compila e vincula shaders GLSL (OpenGL Shading Language), cria
- * um programa de shader que pode ser usado para renderizar objetos na cena.
- * Ela recebe um array de estruturas `ShaderInfo`, onde cada estrutura descreve
- * um shader (tipo, nome do arquivo).
+ * Acrescenta bytes a um hash FNV-1a de 64 bits. Não é um hash criptográfico,
+ * mas chega para distinguir versões do código dos shaders.
  *
  * Parâmetros:
  * -----------
- * - shaders: Um array de estruturas `ShaderInfo` que descrevem os shaders a serem carregados
- *  e compilados.
+ * - hash: O hash dos bytes anteriores (ou o valor inicial FNV).
+ * - data: Os bytes a acrescentar.
+ * - size: O número de bytes.
  *
  * Retorno:
  * --------
- * - GLuint: O identificador do programa de shader criado e vinculado com sucesso, ou 0 em caso de erro.
+ * - uint64_t: O novo hash.
  *
  ******************************************************************************/
-GLuint LoadShaders(ShaderInfo* shaders) {
-	if (shaders == nullptr) return 0;
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
 
-	GLuint program = glCreateProgram();
 
-	for (GLint i = 0; shaders[i].type != GL_NONE; i++) {
-		shaders[i].shader = glCreateShader(shaders[i].type);
+/*****************************************************************************
+ * static uint64_t ComputeProgramKey(const ShaderInfo* shaders, const std::vector<const GLchar*>& sources, const char* defines)
+ *
+ * Descrição:
+ * ----------
+ * Calcula a chave da cache de um programa: o hash do tipo e do código de cada
+ * shader, das macros da variante e das strings GL_VENDOR, GL_RENDERER e
+ * GL_VERSION. Os binários só
+ * servem no mesmo driver, por isso uma atualização do driver ou outra placa
+ * gráfica mudam a chave, tal como uma alteração em qualquer shader.
+ *
+ * Parâmetros:
+ * -----------
+ * - shaders: O array de estruturas `ShaderInfo` (terminado em GL_NONE).
+ * - sources: O código de cada shader, pela mesma ordem.
+ * - defines: As macros da variante (ou nullptr).
+ *
+ * Retorno:
+ * --------
+ * - uint64_t: A chave do programa.
+ *
+ ******************************************************************************/
+static uint64_t ComputeProgramKey(const ShaderInfo* shaders, const std::vector<const GLchar*>& sources, const char* defines) {
+	uint64_t key = 14695981039346656037ull;
 
-		const GLchar* source = ReadShader(shaders[i].filename);
-		if (source == NULL) {
-			for (int j = 0; shaders[j].type != GL_NONE; j++) {
-				if (shaders[j].shader != 0)
-					glDeleteShader(shaders[j].shader);
-				shaders[j].shader = 0;
-			}
+	const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (GLenum name : driverStrings) {
+		const char* value = (const char*)glGetString(name);
+		if (value != nullptr)
+			key = HashBytes(key, value, std::strlen(value) + 1);
+	}
 
-			return 0;
-		}
+	for (size_t i = 0; i < sources.size(); i++) {
+		key = HashBytes(key, &shaders[i].type, sizeof(shaders[i].type));
+		key = HashBytes(key, sources[i], std::strlen(sources[i]) + 1);
+	}
 
-		glShaderSource(shaders[i].shader, 1, &source, NULL);
-		delete[] source;
+	if (defines != nullptr)
+		key = HashBytes(key, defines, std::strlen(defines) + 1);
+	return key;
+}
+
+
+/*****************************************************************************
+ * static std::string ProgramCacheFile(uint64_t key)
+ *
+ * Descrição:
+ * ----------
+ * Devolve o nome do ficheiro da cache de um programa: a chave em hexadecimal,
+ * na pasta de trabalho (a mesma das texturas preparadas pelo TextureCooker).
+ *
+ * Parâmetros:
+ * -----------
+ * - key: A chave do programa.
+ *
+ * Retorno:
+ * --------
+ * - std::string: O nome do ficheiro.
+ *
+ ******************************************************************************/
+static std::string ProgramCacheFile(uint64_t key) {
+	std::ostringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << key << PROGRAM_CACHE_EXTENSION;
+	return name.str();
+}
+
+
+/*****************************************************************************
+ * static bool LoadProgramBinary(GLuint program, uint64_t key)
+ *
+ * Descrição:
+ * ----------
+ * Tenta criar o programa a partir do binário guardado com a mesma chave. O
+ * driver pode recusar um binário mesmo com a chave certa (por exemplo, depois
+ * de uma atualização que não mudou a string da versão), por isso o resultado
+ * de `glProgramBinary` é sempre verificado com GL_LINK_STATUS.
+ *
+ * Parâmetros:
+ * -----------
+ * - program: O programa, ainda sem shaders.
+ * - key: A chave do programa.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se o programa ficou linkado, `false` se não houver binário ou o driver o recusar.
+ *
+ ******************************************************************************/
+static bool LoadProgramBinary(GLuint program, uint64_t key) {
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	if (formatCount <= 0)
+		return false;
+
+	std::ifstream file(ProgramCacheFile(key), std::ios::binary);
+	if (!file)
+		return false;
+
+	ProgramCacheHeader header;
+	if (!file.read((char*)&header, sizeof(header)) || header.magic != PROGRAM_CACHE_MAGIC || header.key != key || header.length == 0)
+		return false;
+
+	std::vector<char> binary((size_t)header.length);
+	if (!file.read(binary.data(), (std::streamsize)binary.size()))
+		return false;
+
+	glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+
+	GLint linked;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	return linked == GL_TRUE;
+}
+
+
+/*****************************************************************************
+ * static void SaveProgramBinary(GLuint program, uint64_t key)
+ *
+ * Descrição:
+ * ----------
+ * Guarda o binário de um programa acabado de linkar no ficheiro da sua chave,
+ * para os arranques seguintes. Se o driver não tiver formatos de binário, ou o
+ * ficheiro não puder ser escrito, o programa continua a ser compilado em cada
+ * arranque.
+ *
+ * Parâmetros:
+ * -----------
+ * - program: O programa linkado (com GL_PROGRAM_BINARY_RETRIEVABLE_HINT).
+ * - key: A chave do programa.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+static void SaveProgramBinary(GLuint program, uint64_t key) {
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLenum binaryFormat;
+	glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+	if (length <= 0)
+		return;
+
+	ProgramCacheHeader header;
+	header.magic = PROGRAM_CACHE_MAGIC;
+	header.binaryFormat = binaryFormat;
+	header.key = key;
+	header.length = (uint64_t)length;
+
+	std::ofstream file(ProgramCacheFile(key), std::ios::binary | std::ios::trunc);
+	if (!file)
+		return;
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), length);
+}
+
+
+/*****************************************************************************
+ * static void SetShaderSource(GLuint shader, const GLchar* source, const char* defines)
+ *
+ * Descrição:
+ * ----------
+ * Define o código de um shader, com as macros de uma variante inseridas logo a
+ * seguir à linha `#version` (que tem de ser a primeira). A diretiva `#line 2`
+ * no fim das macros mantém os números das linhas das mensagens de erro iguais
+ * aos do ficheiro. Sem macros, o código é usado tal como está.
+ *
+ * Parâmetros:
+ * -----------
+ * - shader: O objeto shader.
+ * - source: O código lido do ficheiro.
+ * - defines: As linhas `#define` da variante (ou nullptr).
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+static void SetShaderSource(GLuint shader, const GLchar* source, const char* defines) {
+	const GLchar* versionEnd = std::strchr(source, '\n');
+	if (defines == nullptr || defines[0] == '\0' || versionEnd == nullptr || std::strncmp(source, "#version", 8) != 0) {
+		glShaderSource(shader, 1, &source, NULL);
+		return;
+	}
+
+	std::string version(source, versionEnd + 1);
+	std::string variant = std::string(defines) + "#line 2\n";
+	const GLchar* strings[] = { version.c_str(), variant.c_str(), versionEnd + 1 };
+	glShaderSource(shader, 3, strings, NULL);
+}
 
-		glCompileShader(shaders[i].shader);
 
+/*****************************************************************************
+ * static void ReportErrors(GLuint program, const std::vector<GLuint>& programShaders)
+ *
+ * Descrição:
+ * ----------
+ * Mostra o registo de compilação dos shaders de um programa que não linkou, ou
+ * o registo do link se todos os shaders tiverem compilado (só com _DEBUG).
+ *
+ * Parâmetros:
+ * -----------
+ * - program: O programa.
+ * - programShaders: Os shaders compilados para o programa.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+static void ReportErrors(GLuint program, const std::vector<GLuint>& programShaders) {
+#ifdef _DEBUG
+	for (GLuint shader : programShaders) {
 		GLint compiled;
-		glGetShaderiv(shaders[i].shader, GL_COMPILE_STATUS, &compiled);
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
 		if (!compiled) {
-#ifdef _DEBUG
 			GLsizei len;
-			glGetShaderiv(shaders[i].shader, GL_INFO_LOG_LENGTH, &len);
+			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &len);
 
 			GLchar* log = new GLchar[len + 1];
-			glGetShaderInfoLog(shaders[i].shader, len, &len, log);
+			glGetShaderInfoLog(shader, len, &len, log);
 			std::cerr << "Shader compilation failed: " << log << std::endl;
 			delete[] log;
+			return;
+		}
+	}
+
+	GLsizei len;
+	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &len);
+
+	GLchar* log = new GLchar[len + 1];
+	glGetProgramInfoLog(program, len, &len, log);
+	std::cerr << "Shader linking failed: " << log << std::endl;
+	delete[] log;
 #endif /* DEBUG */
+}
+
+
+/*****************************************************************************
+ * bool LoadShaderVariants(ShaderInfo* shaders, const char* const* defines, GLsizei count, GLuint* programs)
+ *
+ * Descrição:
+ * ----------
+ * Cria `count` programas a partir dos mesmos shaders, cada um com as macros
+ * `#define` de uma variante, para que o código que uma variante não usa seja
+ * eliminado na compilação em vez de ser saltado com um `if` em cada fragmento.
+ *
+ * O código de todos os shaders é lido uma única vez. Para cada variante, se
+ * existir um binário com a chave da variante (código, macros e driver) e o
+ * driver o aceitar, o programa é criado a partir dele, sem compilar; caso
+ * contrário, os shaders são compilados e o programa é linkado. Os resultados
+ * só são consultados depois de todas as variantes terem sido pedidas, para que,
+ * com GL_KHR_parallel_shader_compile, o driver as compile em paralelo. O
+ * binário de cada programa compilado é guardado para o arranque seguinte, e os
+ * objetos shader são apagados depois do link (os campos `shader` ficam a 0).
+ *
+ * Parâmetros:
+ * -----------
+ * - shaders: Um array de estruturas `ShaderInfo` que descrevem os shaders a serem carregados
+ *  e compilados.
+ * - defines: As linhas `#define` de cada variante (nullptr: uma variante sem macros).
+ * - count: O número de variantes.
+ * - programs: Recebe o programa de cada variante.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se todas as variantes foram criadas, `false` em caso de erro (nenhum programa fica criado).
+ *
+ ******************************************************************************/
+bool LoadShaderVariants(ShaderInfo* shaders, const char* const* defines, GLsizei count, GLuint* programs) {
+	if (shaders == nullptr || programs == nullptr || count <= 0) return false;
 
-			for (int j = 0; shaders[j].type != GL_NONE; j++) {
-				if (shaders[j].shader != 0)
-					glDeleteShader(shaders[j].shader);
-				shaders[j].shader = 0;
-			}
+	std::vector<const GLchar*> sources;
+	bool readOk = true;
+	for (GLint i = 0; shaders[i].type != GL_NONE; i++) {
+		shaders[i].shader = 0;
 
-			return 0;
+		const GLchar* source = ReadShader(shaders[i].filename);
+		if (source == NULL) {
+			readOk = false;
+			break;
 		}
+		sources.push_back(source);
+	}
 
-		glAttachShader(program, shaders[i].shader);
+	if (!readOk) {
+		for (const GLchar* source : sources)
+			delete[] source;
+		return false;
 	}
 
-	glLinkProgram(program);
+	// Deixa o driver usar todas as threads de compilação que tiver
+	if (GLEW_KHR_parallel_shader_compile)
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
 
-	GLint linked;
-	glGetProgramiv(program, GL_LINK_STATUS, &linked);
-	if (!linked) {
-#ifdef _DEBUG
-		GLsizei len;
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &len);
+	std::vector<uint64_t> keys(count);
+	std::vector<std::vector<GLuint>> variantShaders(count); // Vazio nas variantes criadas a partir do binário
+	for (GLsizei v = 0; v < count; v++) {
+		const char* variantDefines = (defines != nullptr) ? defines[v] : nullptr;
 
-		GLchar* log = new GLchar[len + 1];
-		glGetProgramInfoLog(program, len, &len, log);
-		std::cerr << "Shader linking failed: " << log << std::endl;
-		delete[] log;
-#endif /* DEBUG */
+		programs[v] = glCreateProgram();
+		keys[v] = ComputeProgramKey(shaders, sources, variantDefines);
+		if (LoadProgramBinary(programs[v], keys[v]))
+			continue;
 
-		for (int j = 0; shaders[j].type != GL_NONE; j++) {
-			if (shaders[j].shader != 0)
-				glDeleteShader(shaders[j].shader);
-			shaders[j].shader = 0;
+		for (size_t i = 0; i < sources.size(); i++) {
+			GLuint shader = glCreateShader(shaders[i].type);
+			SetShaderSource(shader, sources[i], variantDefines);
+			glCompileShader(shader);
+			glAttachShader(programs[v], shader);
+			variantShaders[v].push_back(shader);
 		}
 
-		return 0;
+		// O binário só pode ser lido depois do link se o programa for marcado antes
+		glProgramParameteri(programs[v], GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(programs[v]);
+	}
+
+	for (const GLchar* source : sources)
+		delete[] source;
+
+	// O estado do link espera pela compilação de cada variante
+	bool linkedAll = true;
+	for (GLsizei v = 0; v < count; v++) {
+		if (variantShaders[v].empty())
+			continue;
+
+		GLint linked;
+		glGetProgramiv(programs[v], GL_LINK_STATUS, &linked);
+		if (linked)
+			SaveProgramBinary(programs[v], keys[v]);
+		else if (linkedAll) {
+			ReportErrors(programs[v], variantShaders[v]);
+			linkedAll = false;
+		}
+
+		for (GLuint shader : variantShaders[v]) {
+			glDetachShader(programs[v], shader);
+			glDeleteShader(shader);
+		}
 	}
 
+	if (!linkedAll) {
+		for (GLsizei v = 0; v < count; v++) {
+			glDeleteProgram(programs[v]);
+			programs[v] = 0;
+		}
+		return false;
+	}
+
+	return true;
+}
+
+
+/*****************************************************************************
+ * GLuint LoadShaders(ShaderInfo* shaders)
+ *
+ * Descrição:
+ * ----------
+ * Esta função carrega, compila e vincula shaders GLSL (OpenGL Shading Language), cria
+ * um programa de shader que pode ser usado para renderizar objetos na cena.
+ * Ela recebe um array de estruturas `ShaderInfo`, onde cada estrutura descreve
+ * um shader (tipo, nome do arquivo).
+ *
+ * É uma variante única, sem macros, de `LoadShaderVariants`: o programa é
+ * criado a partir do binário guardado se o código dos shaders e o driver não
+ * tiverem mudado, ou compilado e guardado para o arranque seguinte.
+ *
+ * Parâmetros:
+ * -----------
+ * - shaders: Um array de estruturas `ShaderInfo` que descrevem os shaders a serem carregados
+ *  e compilados.
+ *
+ * Retorno:
+ * --------
+ * - GLuint: O identificador do programa de shader criado e vinculado com sucesso, ou 0 em caso de erro.
+ *
+ ******************************************************************************/
+GLuint LoadShaders(ShaderInfo* shaders) {
+	GLuint program;
+	if (!LoadShaderVariants(shaders, nullptr, 1, &program))
+		return 0;
 	return program;
 }
@@ -1,7 +1,7 @@
 ﻿#ifndef LOAD_SHADERS_H
 #define LOAD_SHADERS_H
 
-#include <GL\glew.h>
+#include <GL/glew.h>
 
 /*****************************************************************************
 				 GLuint LoadShaders(ShaderInfo*);
@@ -12,7 +12,7 @@ Recebe um array de estruturas ShaderInfo.
 Cada estrutura contém:
 - tipo de shader (GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, etc.)
 - apontador para uma C-string, que contém o nome do ficheiro com código do shader
-- valor que referencia o objeto shader criado
+- valor que referencia o objeto shader criado (os objetos shader são apagados depois do link, por isso fica a zero)
 
 O array de estruturas deverá terminar com o valor GL_NONE no campo 'type'.
 Exemplo:
@@ -22,6 +22,10 @@ ShaderInfo shaders[] = {
  { GL_NONE, NULL }
 };
 
+O binário de cada programa linkado é guardado num ficheiro .progbin (chave: código dos shaders e
+GL_VENDOR/GL_RENDERER/GL_VERSION); nos arranques seguintes o programa é criado a partir desse binário,
+sem compilar, e o campo 'shader' fica a zero.
+
 Retorno:
 --------
 Em caso de sucesso, a função retorna o valor que referencia o objeto programa.
@@ -40,4 +44,22 @@ typedef struct {
 
 GLuint LoadShaders(ShaderInfo*);
 
+/*****************************************************************************
+	bool LoadShaderVariants(ShaderInfo*, const char* const* defines, GLsizei count, GLuint* programs);
+
+Descrição:
+----------
+Cria 'count' programas a partir dos mesmos shaders, cada um com as linhas '#define' de defines[i]
+inseridas a seguir à linha '#version' de todos os shaders. As variantes são todas pedidas ao driver
+antes de o resultado de alguma ser consultado (compilação em paralelo com GL_KHR_parallel_shader_compile),
+e usam a mesma cache de binários de LoadShaders.
+
+Retorno:
+--------
+Em caso de sucesso, retorna true e programs[i] é o programa da variante i.
+Em caso de erro, retorna false e nenhum programa fica criado.
+
+*****************************************************************************/
+bool LoadShaderVariants(ShaderInfo* shaders, const char* const* defines, GLsizei count, GLuint* programs);
+
 #endif // LOAD_SHADERS_H
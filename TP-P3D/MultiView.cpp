@@ -0,0 +1,315 @@
+﻿/*****************************************************************************
+ * MultiView.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe MultiView, que desenha quatro vistas da mesa (livre, de cima, de lado
+ * e atrás da bola escolhida) numa grelha 2x2 da janela, na mesma passagem. A classe MultiView é responsável por:
+ * - Calcular, em cada quadro, a vista e a projeção de cada câmera e o seu volume de visualização, no espaço das
+ *   posições das bolas; a vista livre é a câmera principal.
+ * - Escrever o bloco MultiViewData com a matriz de cada vista a partir do espaço da câmera principal, porque os
+ *   dados dos objetos (ObjectBlock::modelView) e a iluminação continuam nesse espaço.
+ * - Recortar as esferas envolventes uma única vez contra a união dos volumes das vistas.
+ * - Escolher o volume dos clusters das luzes: com as vistas extra, uma projeção da câmera principal que cobre a mesa
+   inteira, para que os fragmentos das outras vistas também encontrem o seu cluster.
+ * - Definir um viewport por vista (glViewportIndexedf), escolhido no vertex shader com gl_ViewportIndex.
+ *
+ * Funções principais:
+ * - IsSupported(): Indica se o driver tem as extensões necessárias.
+ * - SetEnabled(bool enabled): Liga ou desliga as vistas extra.
+ * - Update(const Camera& camera, const BoundingSphere& scene, const glm::vec3& followTarget): Matrizes e volumes.
+ * - Upload(FrameUploadBuffer& uploadBuffer): Escreve o bloco MultiViewData.
+ * - SetViewports(GLsizei width, GLsizei height): Define os viewports das vistas.
+ * - CullSpheres(const SphereBatch& batch, std::vector<int>& visible): Recorte contra a união dos volumes.
+ *
+ * Variáveis e constantes importantes:
+ * - frustums: Volume de visualização de cada vista.
+ * - block: Matrizes e posições das câmeras das vistas, no layout do bloco MultiViewData.
+ * - clusterProjection, clusterNear, clusterFar: Volume dos clusters das luzes.
+ * - SIDE_DIRECTION, SIDE_DISTANCE: Posição da câmera da vista lateral em relação à mesa.
+ * - FOLLOW_OFFSET, FOLLOW_LOOK_AHEAD: Posição da câmera da vista de seguimento e ponto visado, em relação à bola.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <cfloat>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "MultiView.h"
+
+// Vista lateral: direção da câmera a partir do centro da mesa (do lado comprido, um pouco acima do tampo) e distância,
+// em raios da esfera envolvente da mesa
+static const glm::vec3 SIDE_DIRECTION(0.0f, 0.12f, 1.0f);
+static const float SIDE_DISTANCE = 2.4f;
+
+// Vista de seguimento: câmera atrás da bola (as bolas rolam em +x) e ponto visado à frente dela, em unidades do mundo
+static const glm::vec3 FOLLOW_OFFSET(-0.3f, 0.12f, 0.0f);
+static const glm::vec3 FOLLOW_LOOK_AHEAD(0.4f, 0.0f, 0.0f);
+
+// Campo de visão vertical das vistas com perspetiva (lateral e de seguimento)
+static const float VIEW_FOV = glm::radians(45.0f);
+
+
+/*****************************************************************************
+ * MultiView::MultiView()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `MultiView`. Começa desligado, só com a vista livre.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+MultiView::MultiView()
+	: enabled(false),
+	block(),
+	clusterProjection(1.0f),
+	clusterNear(0.1f),
+	clusterFar(100.0f) {
+}
+
+
+/*****************************************************************************
+ * bool MultiView::IsSupported()
+ *
+ * Descrição:
+ * ----------
+ * Indica se as vistas podem ser desenhadas na mesma passagem: são precisos os
+ * viewports indexados (GL_ARB_viewport_array, parte do OpenGL 4.1) e a escrita
+ * de gl_ViewportIndex no vertex shader (GL_ARB_shader_viewport_layer_array).
+ * Sem a segunda, seria preciso um geometry shader para repetir os triângulos.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se as duas extensões estiverem disponíveis.
+ *
+ ******************************************************************************/
+bool MultiView::IsSupported() {
+	return (GLEW_VERSION_4_1 || GLEW_ARB_viewport_array) && GLEW_ARB_shader_viewport_layer_array;
+}
+
+
+/*****************************************************************************
+ * void MultiView::SetEnabled(bool enabled)
+ *
+ * Descrição:
+ * ----------
+ * Liga ou desliga as vistas extra. Os programas das bolas e da mesa têm de ser
+ * trocados pelas variantes MULTI_VIEW (ou repostos) ao mesmo tempo.
+ *
+ * Parâmetros:
+ * -----------
+ * - enabled: true para desenhar as MAX_VIEWS vistas.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void MultiView::SetEnabled(bool enabled) {
+	this->enabled = enabled;
+	std::cout << "Multi-view rendering: " << (enabled ? "free, top, side and follow views" : "free view only") << std::endl;
+}
+
+
+/*****************************************************************************
+ * glm::vec2 MultiView::GetViewSize(GLsizei width, GLsizei height) const
+ *
+ * Descrição:
+ * ----------
+ * Devolve o tamanho do viewport de cada vista: o quadro inteiro, ou um quarto
+ * dele com as vistas extra ligadas. Todas as vistas têm a proporção do quadro.
+ *
+ * Parâmetros:
+ * -----------
+ * - width, height: O tamanho do quadro desenhado, em píxeis.
+ *
+ * Retorno:
+ * --------
+ * - glm::vec2: O tamanho de cada viewport, em píxeis.
+ *
+ ******************************************************************************/
+glm::vec2 MultiView::GetViewSize(GLsizei width, GLsizei height) const {
+	glm::vec2 size((float)width, (float)height);
+	return enabled ? size * 0.5f : size;
+}
+
+
+/*****************************************************************************
+ * void MultiView::Update(const Camera& camera, const BoundingSphere& scene, const glm::vec3& followTarget)
+ *
+ * Descrição:
+ * ----------
+ * Calcula as matrizes e os volumes de visualização das vistas no quadro atual.
+ * A vista livre usa as matrizes da câmera principal (já atualizadas por
+ * `updateFrameMatrices`); as outras são colocadas em relação à mesa e à bola
+ * seguida, sem o zoom. A matriz de cada vista no bloco MultiViewData parte do
+ * espaço da câmera principal (inversa de zoomView), para que os vértices, as
+ * normais e as luzes sejam calculados uma única vez para todas as vistas.
+ *
+ * Os clusters das luzes continuam no espaço da câmera principal, mas com as
+ * vistas extra o seu volume passa a ser a pirâmide dessa câmera que envolve a
+ * esfera da mesa (onde estão todos os objetos desenhados). Se a câmera estiver
+ * dentro da esfera, fica o volume da câmera e os fragmentos de fora usam o
+ * cluster extra, com todas as luzes.
+ *
+ * Parâmetros:
+ * -----------
+ * - camera: A câmera principal, com o tamanho do viewport de cada vista.
+ * - scene: A esfera envolvente da mesa, enquadrada pelas vistas de cima e de lado.
+ * - followTarget: A posição da bola seguida pela vista de seguimento.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void MultiView::Update(const Camera& camera, const BoundingSphere& scene, const glm::vec3& followTarget) {
+	frustums[VIEW_FREE].Extract(camera.viewProjection);
+	block.views[VIEW_FREE].clipFromEye = camera.proj;
+	block.views[VIEW_FREE].eyePosition = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	block.viewCount = GetViewCount();
+	clusterProjection = camera.proj;
+	clusterNear = camera.nearPlane;
+	clusterFar = camera.farPlane;
+	if (!enabled)
+		return;
+
+	glm::vec3 eyeCenter(camera.zoomView * glm::vec4(scene.center, 1.0f));
+	float eyeRadius = scene.radius * glm::abs(camera.zoom);
+	if (-eyeCenter.z - eyeRadius > camera.nearPlane) {
+		// Cantos da caixa da esfera projetados no plano z = -1 (todos à frente da câmera)
+		glm::vec2 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+		for (int i = 0; i < 8; i++) {
+			glm::vec3 corner = eyeCenter + glm::vec3((i & 1) ? eyeRadius : -eyeRadius, (i & 2) ? eyeRadius : -eyeRadius, (i & 4) ? eyeRadius : -eyeRadius);
+			glm::vec2 projected = glm::vec2(corner.x, corner.y) / -corner.z;
+			boundsMin = glm::min(boundsMin, projected);
+			boundsMax = glm::max(boundsMax, projected);
+		}
+
+		clusterNear = -eyeCenter.z - eyeRadius;
+		clusterFar = -eyeCenter.z + eyeRadius;
+		clusterProjection = glm::frustum(boundsMin.x * clusterNear, boundsMax.x * clusterNear,
+			boundsMin.y * clusterNear, boundsMax.y * clusterNear, clusterNear, clusterFar);
+	}
+
+	float aspect = camera.viewportSize.y > 0.0f ? camera.viewportSize.x / camera.viewportSize.y : 1.0f;
+	float radius = scene.radius;
+	glm::vec3 eyes[MAX_VIEWS];
+	glm::mat4 viewProjections[MAX_VIEWS];
+
+	// De cima: projeção ortográfica com a esfera da mesa inteira, com o lado comprido da mesa na horizontal
+	eyes[VIEW_TOP] = scene.center + glm::vec3(0.0f, 2.0f * radius, 0.0f);
+	viewProjections[VIEW_TOP] = glm::ortho(-radius * aspect, radius * aspect, -radius, radius, radius, 3.0f * radius)
+		* glm::lookAt(eyes[VIEW_TOP], scene.center, glm::vec3(0.0f, 0.0f, -1.0f));
+
+	eyes[VIEW_SIDE] = scene.center + glm::normalize(SIDE_DIRECTION) * (SIDE_DISTANCE * radius);
+	viewProjections[VIEW_SIDE] = glm::perspective(VIEW_FOV, aspect, 0.05f * radius, 4.0f * SIDE_DISTANCE * radius)
+		* glm::lookAt(eyes[VIEW_SIDE], scene.center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+	eyes[VIEW_FOLLOW] = followTarget + FOLLOW_OFFSET;
+	viewProjections[VIEW_FOLLOW] = glm::perspective(VIEW_FOV, aspect, 0.01f, 4.0f * radius)
+		* glm::lookAt(eyes[VIEW_FOLLOW], followTarget + FOLLOW_LOOK_AHEAD, glm::vec3(0.0f, 1.0f, 0.0f));
+
+	glm::mat4 worldFromEye = glm::inverse(camera.zoomView);
+	for (int view = VIEW_TOP; view < (int)MAX_VIEWS; view++) {
+		frustums[view].Extract(viewProjections[view]);
+		block.views[view].clipFromEye = viewProjections[view] * worldFromEye;
+		block.views[view].eyePosition = camera.zoomView * glm::vec4(eyes[view], 1.0f);
+	}
+}
+
+
+/*****************************************************************************
+ * bool MultiView::Upload(FrameUploadBuffer& uploadBuffer) const
+ *
+ * Descrição:
+ * ----------
+ * Escreve o bloco MultiViewData no buffer do quadro, lido pelas variantes
+ * MULTI_VIEW dos shaders. Sem as vistas extra, os shaders não o leem e nada é
+ * escrito.
+ *
+ * Parâmetros:
+ * -----------
+ * - uploadBuffer: O buffer do quadro.
+ *
+ * Retorno:
+ * --------
+ * - bool: false se o buffer do quadro estiver cheio.
+ *
+ ******************************************************************************/
+bool MultiView::Upload(FrameUploadBuffer& uploadBuffer) const {
+	if (!enabled)
+		return true;
+
+	return uploadBuffer.Upload(MULTI_VIEW_BLOCK_BINDING, block);
+}
+
+
+/*****************************************************************************
+ * void MultiView::SetViewports(GLsizei width, GLsizei height) const
+ *
+ * Descrição:
+ * ----------
+ * Define o viewport de cada vista numa grelha 2x2 do quadro: a vista livre e
+ * a de cima em cima, a lateral e a de seguimento em baixo. Um `glViewport`
+ * posterior (por exemplo, o do início do quadro seguinte) repõe todos os
+ * viewports. Sem as vistas extra, não faz nada.
+ *
+ * Parâmetros:
+ * -----------
+ * - width, height: O tamanho do quadro desenhado, em píxeis.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void MultiView::SetViewports(GLsizei width, GLsizei height) const {
+	if (!enabled)
+		return;
+
+	glm::vec2 size = GetViewSize(width, height);
+	GLfloat viewports[MAX_VIEWS * 4] = {
+		0.0f, size.y, size.x, size.y,   // Livre (em cima, à esquerda)
+		size.x, size.y, size.x, size.y, // De cima (em cima, à direita)
+		0.0f, 0.0f, size.x, size.y,     // Lateral (em baixo, à esquerda)
+		size.x, 0.0f, size.x, size.y    // Seguimento (em baixo, à direita)
+	};
+	glViewportArrayv(0, MAX_VIEWS, viewports);
+}
+
+
+/*****************************************************************************
+ * void MultiView::CullSpheres(const SphereBatch& batch, std::vector<int>& visible) const
+ *
+ * Descrição:
+ * ----------
+ * Escreve em `visible` os índices das esferas visíveis em pelo menos uma das
+ * vistas desenhadas. Cada objeto visível é enviado uma única vez, com uma
+ * instância por vista; nas vistas onde está fora do volume, os seus triângulos
+ * são descartados no recorte da GPU.
+ *
+ * Parâmetros:
+ * -----------
+ * - batch: O lote de esferas, em layout SoA.
+ * - visible: Vetor de saída com os índices das esferas visíveis.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void MultiView::CullSpheres(const SphereBatch& batch, std::vector<int>& visible) const {
+	Frustum::CullSpheres(frustums, GetViewCount(), batch, visible);
+}
+
+bool MultiView::IsSphereVisible(const BoundingSphere& sphere) const {
+	for (GLuint view = 0; view < GetViewCount(); view++)
+		if (frustums[view].IsSphereVisible(sphere))
+			return true;
+
+	return false;
+}
@@ -0,0 +1,53 @@
+﻿#ifndef MULTI_VIEW_H
+#define MULTI_VIEW_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Camera.h"
+#include "Frustum.h"
+#include "FrameUploadBuffer.h"
+#include "UniformBlocks.h"
+
+// Várias vistas da mesa desenhadas na mesma passagem, cada uma no seu viewport (GL_ARB_viewport_array): os objetos são
+// recortados uma vez contra a união dos volumes das vistas e cada objeto visível é enviado uma única vez, com uma
+// instância por vista; o vertex shader (variantes MULTI_VIEW) escolhe a matriz e o viewport pela instância.
+// Sem MultiView ligado, só existe a vista livre (a câmera principal).
+class MultiView {
+public:
+	// Vistas, pela ordem das instâncias e dos viewports (grelha 2x2, a vista livre no canto superior esquerdo)
+	enum ViewIndex {
+		VIEW_FREE = 0, // Câmera principal (órbita com o rato)
+		VIEW_TOP,      // Vista de cima, ortográfica, com a mesa inteira
+		VIEW_SIDE,     // Vista do lado comprido da mesa, um pouco acima dela
+		VIEW_FOLLOW    // Atrás da bola escolhida, a olhar na direção em que ela rola
+	};
+
+	MultiView();
+
+	static bool IsSupported(); // O driver permite escolher o viewport no vertex shader
+
+	void SetEnabled(bool enabled); // Liga ou desliga as vistas extra
+	bool IsEnabled() const { return enabled; }
+	GLuint GetViewCount() const { return enabled ? MAX_VIEWS : 1; } // Instâncias por objeto
+
+	glm::vec2 GetViewSize(GLsizei width, GLsizei height) const; // Tamanho de cada viewport, em píxeis
+	void Update(const Camera& camera, const BoundingSphere& scene, const glm::vec3& followTarget); // Matrizes e volumes do quadro
+	const glm::mat4& GetClusterProjection() const { return clusterProjection; } // Volume dos clusters das luzes
+	float GetClusterNear() const { return clusterNear; }
+	float GetClusterFar() const { return clusterFar; }
+	bool Upload(FrameUploadBuffer& uploadBuffer) const; // Escreve o bloco MultiViewData
+	void SetViewports(GLsizei width, GLsizei height) const; // Define os viewports das vistas (um por índice)
+
+	void CullSpheres(const SphereBatch& batch, std::vector<int>& visible) const; // Esferas visíveis em alguma vista
+	bool IsSphereVisible(const BoundingSphere& sphere) const;
+
+private:
+	bool enabled;                 // As vistas extra estão ligadas
+	Frustum frustums[MAX_VIEWS];  // Volume de cada vista, no espaço das posições das bolas
+	MultiViewBlock block;         // Matrizes de cada vista, a partir do espaço da câmera principal
+	glm::mat4 clusterProjection;  // Projeção dos clusters das luzes, no espaço da câmera principal
+	float clusterNear, clusterFar; // Planos próximo e distante dessa projeção
+};
+
+#endif // MULTI_VIEW_H
@@ -0,0 +1,242 @@
+﻿/*****************************************************************************
+ * PoolHall.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe PoolHall, a sala de bilhar com muitas mesas à volta da mesa principal
+ * (tecla H, --hall N). A classe PoolHall é responsável por:
+ * - Distribuir as mesas numa grelha, das células mais próximas da mesa principal para as mais distantes, e preparar
+ *   as bolas de cada mesa (as posições iniciais das bolas principais, com as bolas trocadas e rodadas por mesa).
+ * - Recortar numa primeira passagem as esferas das mesas e, só nas mesas visíveis, as esferas das suas bolas.
+ * - Escolher o nível de detalhe das bolas uma vez por mesa, a partir da bola mais próxima da câmera, e deixar de
+ *   desenhar as bolas das mesas onde ficariam com menos de um píxel.
+ * - Criar as bolas como entidades do registo da cena a partir dos modelos das bolas principais (malha, material e
+ *   textura), para que o RenderListSystem as junte às bolas principais no mesmo comando de desenho indireto.
+ *
+ * Funções principais:
+ * - Build(int tableCount, const BoundingSphere& tableBounds, const std::vector<glm::vec3>& rack,
+ *   const std::vector<Ball>& balls, const SphereLOD* lod, SceneRegistry& registry): Cria as mesas e as bolas da sala.
+ * - GetUploadSize(int tableCount, size_t ballsPerTable): Espaço dos objetos da sala no buffer de cada quadro.
+ * - Cull(const MultiView& views, const Camera& camera, const SphereLOD& lod, SceneRegistry& registry): Recorte
+ *   hierárquico e nível de detalhe.
+ *
+ * Variáveis e constantes importantes:
+ * - TABLE_SPACING: Distância entre os centros das mesas vizinhas.
+ * - MIN_BALL_SCREEN_RADIUS: Raio no ecrã abaixo do qual as bolas de uma mesa não são desenhadas.
+ * - RACK_SEED: Semente da ordem e da orientação das bolas de cada mesa.
+ * - tableBounds, ballBounds: Esferas das mesas (fixas) e das bolas das mesas visíveis (de cada quadro).
+ * - tableLevels: Nível de detalhe das bolas de cada mesa, com a histerese do SphereLOD.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <cmath>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <glm/gtc/constants.hpp>
+
+#include "PoolHall.h"
+
+const glm::vec2 PoolHall::TABLE_SPACING(2.6f, 1.8f);
+const float PoolHall::MIN_BALL_SCREEN_RADIUS = 0.5f;
+const unsigned int PoolHall::RACK_SEED = 2024;
+
+
+/*****************************************************************************
+ * PoolHall::PoolHall()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `PoolHall`. A sala começa vazia; as mesas são criadas em
+ * `Build`, quando a sala é pedida pela primeira vez.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+PoolHall::PoolHall()
+	: ballsPerTable(0),
+	ballRadius(0.0f),
+	tableRadius(0.0f) {
+}
+
+
+/*****************************************************************************
+ * void PoolHall::Build(int tableCount, const BoundingSphere& tableBounds, const std::vector<glm::vec3>& rack,
+ *                      const std::vector<Ball>& balls, const SphereLOD* lod, SceneRegistry& registry)
+ *
+ * Descrição:
+ * ----------
+ * Cria as mesas da sala. As células de uma grelha com TABLE_SPACING à volta da
+ * mesa principal são ordenadas pela distância à origem e as tableCount mais
+ * próximas (sem a da origem, que é a mesa principal) recebem uma mesa. Cada
+ * mesa tem uma bola em cada posição de `rack`, com as bolas trocadas e rodadas
+ * de forma diferente em cada mesa. As bolas são entidades paradas (sem corpo
+ * rígido), por isso as matrizes de modelo só são calculadas quando são criadas.
+ *
+ * Parâmetros:
+ * -----------
+ * - tableCount: O número de mesas, sem contar a mesa principal.
+ * - tableBounds: A esfera envolvente da mesa principal.
+ * - rack: As posições das bolas numa mesa (a bola i usa o modelo da bola principal i).
+ * - balls: Os modelos das bolas principais.
+ * - lod: Os níveis de detalhe partilhados pelas bolas.
+ * - registry: O registo da cena onde as bolas são criadas.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void PoolHall::Build(int tableCount, const BoundingSphere& tableBounds, const std::vector<glm::vec3>& rack,
+	const std::vector<Ball>& balls, const SphereLOD* lod, SceneRegistry& registry) {
+	for (Entity entity : ballEntities)
+		registry.Destroy(entity);
+
+	tableOffsets.clear();
+	this->tableBounds.Clear();
+	ballEntities.clear();
+	ballsPerTable = rack.size();
+	if (tableCount <= 0 || ballsPerTable == 0)
+		return;
+
+	// Um círculo com a área de tableCount + 1 células, alargado em duas células, contém as células escolhidas
+	float radius = std::sqrt((tableCount + 1) * TABLE_SPACING.x * TABLE_SPACING.y / glm::pi<float>())
+		+ 2.0f * std::max(TABLE_SPACING.x, TABLE_SPACING.y);
+	int halfColumns = (int)std::ceil(radius / TABLE_SPACING.x);
+	int halfRows = (int)std::ceil(radius / TABLE_SPACING.y);
+
+	std::vector<glm::vec3> cells;
+	for (int row = -halfRows; row <= halfRows; row++)
+		for (int column = -halfColumns; column <= halfColumns; column++)
+			if (row != 0 || column != 0)
+				cells.push_back(glm::vec3(column * TABLE_SPACING.x, 0.0f, row * TABLE_SPACING.y));
+
+	std::stable_sort(cells.begin(), cells.end(), [](const glm::vec3& a, const glm::vec3& b) {
+		return glm::dot(a, a) < glm::dot(b, b);
+		});
+	cells.resize(std::min(cells.size(), (size_t)tableCount));
+
+	// A esfera de cada mesa inclui as suas bolas, para que o primeiro recorte nunca esconda uma bola visível
+	Entity first = balls[0].CreateEntity(registry, rack[0], glm::vec3(0.0f), lod, false);
+	ballRadius = registry.renderables.Get(first).boundsRadius;
+	registry.Destroy(first);
+
+	tableRadius = tableBounds.radius;
+	for (const glm::vec3& position : rack)
+		tableRadius = std::max(tableRadius, glm::length(position - tableBounds.center) + ballRadius);
+
+	std::mt19937 random(RACK_SEED);
+	std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+	std::vector<int> order(ballsPerTable);
+
+	for (size_t table = 0; table < cells.size(); table++) {
+		tableOffsets.push_back(cells[table]);
+		this->tableBounds.Add(cells[table] + tableBounds.center, tableRadius);
+
+		std::iota(order.begin(), order.end(), 0);
+		std::shuffle(order.begin(), order.end(), random);
+		for (size_t slot = 0; slot < ballsPerTable; slot++) {
+			glm::vec3 orientation;
+			orientation.x = angle(random);
+			orientation.y = angle(random);
+			orientation.z = angle(random);
+			ballEntities.push_back(balls[order[slot]].CreateEntity(registry, cells[table] + rack[slot], orientation, lod, false));
+		}
+	}
+
+	tableLevels.assign(tableOffsets.size(), -1);
+
+	std::cout << "Pool hall: " << tableOffsets.size() << " tables, " << ballEntities.size() << " balls" << std::endl;
+}
+
+
+/*****************************************************************************
+ * GLsizeiptr PoolHall::GetUploadSize(int tableCount, size_t ballsPerTable)
+ *
+ * Descrição:
+ * ----------
+ * Devolve o espaço que os dados dos objetos da sala podem ocupar num quadro do
+ * buffer de uniforms (um ObjectBlock por mesa e por bola), para que o buffer
+ * seja criado com espaço para a sala.
+ *
+ * Parâmetros:
+ * -----------
+ * - tableCount: O número de mesas da sala.
+ * - ballsPerTable: O número de bolas de cada mesa.
+ *
+ * Retorno:
+ * --------
+ * - GLsizeiptr: O espaço, em bytes.
+ *
+ ******************************************************************************/
+GLsizeiptr PoolHall::GetUploadSize(int tableCount, size_t ballsPerTable) {
+	return (GLsizeiptr)std::max(tableCount, 0) * (GLsizeiptr)(ballsPerTable + 1) * (GLsizeiptr)sizeof(ObjectBlock);
+}
+
+
+/*****************************************************************************
+ * void PoolHall::Cull(const MultiView& views, const Camera& camera, const SphereLOD& lod, SceneRegistry& registry)
+ *
+ * Descrição:
+ * ----------
+ * Recorte hierárquico da sala. As esferas das mesas são testadas primeiro (em
+ * SIMD, contra a união das vistas); em cada mesa visível, o nível de detalhe
+ * das bolas é escolhido pela bola mais próxima possível da câmera (a frente da
+ * esfera da mesa) e, se essa bola tiver menos de MIN_BALL_SCREEN_RADIUS píxeis,
+ * as bolas da mesa não são desenhadas. Só as bolas das mesas que ficam
+ * recebem o nível da mesa e são juntadas num lote e testadas uma a uma; as
+ * visíveis são depois passadas ao RenderListSystem.
+ *
+ * Parâmetros:
+ * -----------
+ * - views: As vistas do quadro (só a câmera principal, sem MultiView ligado).
+ * - camera: A câmera principal, com as matrizes do quadro.
+ * - lod: Os níveis de detalhe das bolas.
+ * - registry: O registo da cena com as bolas da sala.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void PoolHall::Cull(const MultiView& views, const Camera& camera, const SphereLOD& lod, SceneRegistry& registry) {
+	visibleOffsets.clear();
+	ballBounds.Clear();
+	ballCandidates.clear();
+	visibleBalls.clear();
+	if (!IsBuilt())
+		return;
+
+	views.CullSpheres(tableBounds, visibleTables);
+
+	float zoom = glm::abs(camera.zoom);
+	for (int table : visibleTables) {
+		visibleOffsets.push_back(tableOffsets[table]);
+
+		glm::vec3 center(tableBounds.x[table], tableBounds.y[table], tableBounds.z[table]);
+		glm::vec3 eyeCenter(camera.zoomView * glm::vec4(center, 1.0f));
+		eyeCenter.z += tableRadius * zoom;
+		float screenRadius = camera.getScreenRadius(eyeCenter, ballRadius * zoom);
+		if (screenRadius < MIN_BALL_SCREEN_RADIUS) {
+			tableLevels[table] = -1;
+			continue;
+		}
+
+		// Uma mesa cujas bolas estavam escondidas estava longe: a histerese parte do nível mais simples
+		int currentLevel = tableLevels[table] >= 0 ? tableLevels[table] : SphereLOD::LEVEL_COUNT - 1;
+		tableLevels[table] = lod.SelectLevel(screenRadius, currentLevel);
+
+		for (size_t ball = table * ballsPerTable; ball < (table + 1) * ballsPerTable; ball++) {
+			Entity entity = ballEntities[ball];
+			registry.renderables.Get(entity).lodLevel = tableLevels[table];
+			ballBounds.Add(registry.transforms.Get(entity).position, ballRadius);
+			ballCandidates.push_back(entity);
+		}
+	}
+
+	views.CullSpheres(ballBounds, visibleBalls);
+}
+
@@ -0,0 +1,58 @@
+﻿#ifndef POOL_HALL_H
+#define POOL_HALL_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Ball.h"
+#include "Camera.h"
+#include "Frustum.h"
+#include "MultiView.h"
+#include "SceneRegistry.h"
+#include "SphereLOD.h"
+#include "UniformBlocks.h"
+
+// Sala de bilhar: cópias da mesa numa grelha à volta da mesa principal, cada uma com as suas bolas paradas. As bolas
+// são entidades do registo da cena, criadas a partir dos modelos das bolas principais, e as mesas são desenhadas com a
+// malha e o material da mesa principal, por isso todas as mesas (e as bolas com o mesmo nível de detalhe) entram no
+// mesmo lote da fila de desenho. O recorte e o nível de detalhe são decididos primeiro por mesa e só depois, nas mesas
+// visíveis, por bola.
+class PoolHall {
+public:
+	static const int DEFAULT_TABLE_COUNT = 1000; // Mesas da sala sem --hall N
+
+	PoolHall();
+
+	void Build(int tableCount, const BoundingSphere& tableBounds, const std::vector<glm::vec3>& rack,
+		const std::vector<Ball>& balls, const SphereLOD* lod, SceneRegistry& registry); // Distribui as mesas e cria as bolas
+	bool IsBuilt() const { return !tableOffsets.empty(); }
+	size_t GetTableCount() const { return tableOffsets.size(); }
+	static GLsizeiptr GetUploadSize(int tableCount, size_t ballsPerTable); // Dados dos objetos da sala num quadro, em bytes
+
+	void Cull(const MultiView& views, const Camera& camera, const SphereLOD& lod, SceneRegistry& registry); // Mesas e bolas visíveis e detalhe de cada mesa
+	const std::vector<glm::vec3>& GetVisibleTableOffsets() const { return visibleOffsets; } // Posições das mesas visíveis
+	const std::vector<Entity>& GetBallCandidates() const { return ballCandidates; } // Bolas das mesas visíveis com bolas
+	const std::vector<int>& GetVisibleBalls() const { return visibleBalls; } // Índices (em GetBallCandidates) das bolas visíveis
+	size_t GetVisibleBallCount() const { return visibleBalls.size(); }
+
+private:
+	static const glm::vec2 TABLE_SPACING;     // Distância entre os centros das mesas em x e em z
+	static const float MIN_BALL_SCREEN_RADIUS; // Abaixo deste raio no ecrã (píxeis), as bolas da mesa não são desenhadas
+	static const unsigned int RACK_SEED;       // Semente das bolas de cada mesa (a sala é sempre a mesma)
+
+	std::vector<glm::vec3> tableOffsets; // Posição de cada mesa (a mesa principal, na origem, não está incluída)
+	SphereBatch tableBounds;             // Esferas das mesas com as suas bolas, testadas antes das bolas
+	std::vector<Entity> ballEntities;    // Bolas de todas as mesas, agrupadas por mesa
+	size_t ballsPerTable;                // Bolas de cada mesa
+	float ballRadius;                    // Raio das esferas envolventes das bolas
+	float tableRadius;                   // Raio das esferas das mesas
+
+	std::vector<int> tableLevels;        // Nível de detalhe das bolas de cada mesa no último quadro (-1 = sem bolas)
+	std::vector<int> visibleTables;      // Índices das mesas visíveis no quadro atual
+	std::vector<glm::vec3> visibleOffsets; // Posições dessas mesas, pela mesma ordem
+	SphereBatch ballBounds;              // Esferas das bolas das mesas visíveis com bolas
+	std::vector<Entity> ballCandidates;  // Entidade de cada esfera de ballBounds
+	std::vector<int> visibleBalls;       // Índices (em ballBounds) das bolas visíveis
+};
+
+#endif // POOL_HALL_H
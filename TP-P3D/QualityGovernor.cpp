@@ -0,0 +1,203 @@
+﻿/*****************************************************************************
+ * QualityGovernor.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe QualityGovernor, que ajusta a qualidade do desenho à duração dos
+ * quadros (por exemplo com renderizadores por software ou GPUs fracas). A classe QualityGovernor é responsável por:
+ * - Agrupar as durações dos quadros em janelas de WINDOW_FRAMES quadros e usar a mediana de cada janela.
+ * - Descer um nível de qualidade logo que uma janela fique acima de DOWNGRADE_RATIO vezes a duração pedida.
+ * - Subir um nível só depois de upgradeWindows janelas seguidas abaixo de UPGRADE_RATIO vezes a duração pedida.
+ *   Entre os dois limites o nível mantém-se. Se uma subida for desfeita na janela seguinte, a espera duplica (até
+ *   MAX_UPGRADE_WINDOWS), para que o nível não oscile entre dois valores; uma subida confirmada repõe a espera.
+ * - Ignorar SETTLE_FRAMES quadros depois de cada mudança, que ainda incluem a troca de programas e de texturas.
+ * - Escrever cada decisão (duração medida, nível e definições do nível) na consola.
+ *
+ * Funções principais:
+ * - SetEnabled(bool enabled): Liga ou desliga o regulador.
+ * - Update(double frameTime): Regista a duração de um quadro e decide o nível.
+ * - GetSettings(): Devolve as definições do nível atual.
+ *
+ * Variáveis e constantes importantes:
+ * - LEVELS: Resolução interna, escala do detalhe das bolas e luzes permitidas em cada nível. A resolução desce
+ *   primeiro, porque com muitos píxeis o custo dos fragmentos domina; os candeeiros da sala (centenas de luzes nos
+ *   clusters) e depois a luz spot só são desligados nos últimos níveis.
+ * - DOWNGRADE_RATIO, UPGRADE_RATIO: Limites da histerese, relativos à duração pedida.
+ * - WINDOW_FRAMES, SETTLE_FRAMES, MIN_UPGRADE_WINDOWS, MAX_UPGRADE_WINDOWS: Tamanho das janelas e esperas.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <algorithm>
+
+#include "QualityGovernor.h"
+
+const QualityLevel QualityGovernor::LEVELS[QualityGovernor::LEVEL_COUNT] = {
+	{ 1.00f, 1.0f, true, true },
+	{ 0.85f, 1.0f, true, true },
+	{ 0.70f, 0.7f, true, true },
+	{ 0.60f, 0.5f, false, true },
+	{ 0.50f, 0.35f, false, false }
+};
+
+const float QualityGovernor::DOWNGRADE_RATIO = 1.2f;
+const float QualityGovernor::UPGRADE_RATIO = 1.05f;
+
+
+/*****************************************************************************
+ * QualityGovernor::QualityGovernor()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `QualityGovernor`. Começa desligado, no nível 0, com a
+ * duração de um quadro a 60 Hz.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+QualityGovernor::QualityGovernor()
+	: enabled(false),
+	targetFrameTime(1.0 / 60.0),
+	level(0),
+	windowFrames(0),
+	settleFrames(SETTLE_FRAMES),
+	fastWindows(0),
+	upgradeWindows(MIN_UPGRADE_WINDOWS),
+	probing(false) {
+}
+
+
+/*****************************************************************************
+ * void QualityGovernor::SetEnabled(bool enabled)
+ *
+ * Descrição:
+ * ----------
+ * Liga ou desliga o regulador. Ao desligar, a qualidade volta ao nível 0; ao
+ * ligar, as medições começam de novo depois de SETTLE_FRAMES quadros.
+ *
+ * Parâmetros:
+ * -----------
+ * - enabled: true para ligar o regulador.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void QualityGovernor::SetEnabled(bool enabled) {
+	this->enabled = enabled;
+	level = 0;
+	windowFrames = 0;
+	settleFrames = SETTLE_FRAMES;
+	fastWindows = 0;
+	upgradeWindows = MIN_UPGRADE_WINDOWS;
+	probing = false;
+
+	if (enabled)
+		std::cout << "Quality governor enabled, target " << targetFrameTime * 1000.0 << " ms per frame" << std::endl;
+	else
+		std::cout << "Quality governor disabled" << std::endl;
+}
+
+
+/*****************************************************************************
+ * bool QualityGovernor::Update(double frameTime)
+ *
+ * Descrição:
+ * ----------
+ * Regista a duração de um quadro (o intervalo entre o início de dois quadros,
+ * que inclui a espera pela troca de buffers). No fim de cada janela compara a
+ * mediana com a duração pedida e desce, sobe ou mantém o nível.
+ *
+ * Parâmetros:
+ * -----------
+ * - frameTime: A duração do último quadro, em segundos.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o nível mudou (as novas definições valem a partir deste quadro).
+ *
+ ******************************************************************************/
+bool QualityGovernor::Update(double frameTime) {
+	if (!enabled)
+		return false;
+
+	if (settleFrames > 0) {
+		settleFrames--;
+		return false;
+	}
+
+	window[windowFrames++] = (float)frameTime;
+	if (windowFrames < WINDOW_FRAMES)
+		return false;
+	windowFrames = 0;
+
+	std::nth_element(window, window + WINDOW_FRAMES / 2, window + WINDOW_FRAMES);
+	double median = window[WINDOW_FRAMES / 2];
+
+	if (median > targetFrameTime * DOWNGRADE_RATIO) {
+		fastWindows = 0;
+		if (level == LEVEL_COUNT - 1)
+			return false;
+
+		// Uma subida desfeita logo a seguir: o nível de cima não chega, por isso a próxima tentativa espera o dobro
+		if (probing)
+			upgradeWindows = std::min(upgradeWindows * 2, MAX_UPGRADE_WINDOWS);
+		probing = false;
+		SetLevel(level + 1, median, "slow");
+		return true;
+	}
+
+	if (probing) {
+		upgradeWindows = MIN_UPGRADE_WINDOWS;
+		probing = false;
+	}
+
+	if (median > targetFrameTime * UPGRADE_RATIO) {
+		fastWindows = 0;
+		return false;
+	}
+
+	if (level == 0 || ++fastWindows < upgradeWindows)
+		return false;
+
+	fastWindows = 0;
+	probing = true;
+	SetLevel(level - 1, median, "fast");
+	return true;
+}
+
+
+/*****************************************************************************
+ * void QualityGovernor::SetLevel(int newLevel, double median, const char* reason)
+ *
+ * Descrição:
+ * ----------
+ * Muda o nível de qualidade, recomeça a espera de SETTLE_FRAMES quadros e
+ * escreve na consola a medição que levou à decisão e as definições do nível.
+ *
+ * Parâmetros:
+ * -----------
+ * - newLevel: O novo nível.
+ * - median: A mediana da janela que levou à decisão, em segundos.
+ * - reason: "slow" ou "fast".
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void QualityGovernor::SetLevel(int newLevel, double median, const char* reason) {
+	level = newLevel;
+	settleFrames = SETTLE_FRAMES;
+
+	const QualityLevel& settings = LEVELS[level];
+	std::cout << "Quality governor: " << reason << " frames (median " << median * 1000.0 << " ms, target " << targetFrameTime * 1000.0
+		<< " ms) -> level " << level << ": render scale " << settings.renderScale * 100.0f << "%, ball detail " << settings.lodScale * 100.0f
+		<< "%, hall lights " << (settings.hallLights ? "allowed" : "off") << ", spot light " << (settings.spotLight ? "allowed" : "off");
+	if (level > 0 && !probing)
+		std::cout << " (upgrade after " << upgradeWindows << " fast windows)";
+	std::cout << std::endl;
+}
@@ -0,0 +1,52 @@
+﻿#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+// Definições de um nível de qualidade
+struct QualityLevel {
+	float renderScale; // Escala da resolução interna (1 = resolução da janela)
+	float lodScale;    // Escala do raio no ecrã usada para escolher o nível de detalhe das bolas
+	bool hallLights;   // Os candeeiros da sala podem ser desenhados
+	bool spotLight;    // A luz spot (e o seu mapa de sombras) pode ser desenhada
+};
+
+// Regulador da qualidade: mede a duração dos quadros e desce ou sobe um nível de qualidade (resolução interna, detalhe
+// das bolas e luzes caras) para manter a duração pedida. Desce depressa quando os quadros são lentos e só sobe depois
+// de várias janelas de quadros rápidos, com uma espera cada vez maior se uma subida tiver de ser desfeita.
+class QualityGovernor {
+public:
+	static const int LEVEL_COUNT = 5;          // Nível 0 = qualidade máxima
+	static const int WINDOW_FRAMES = 30;       // Quadros de cada decisão (é usada a mediana, que ignora picos isolados)
+	static const int SETTLE_FRAMES = 10;       // Quadros ignorados depois de uma mudança de nível
+	static const int MIN_UPGRADE_WINDOWS = 4;  // Janelas rápidas seguidas antes de subir de nível
+	static const int MAX_UPGRADE_WINDOWS = 32; // Limite da espera depois de subidas desfeitas
+
+	QualityGovernor();
+
+	void SetTargetFrameTime(double seconds) { targetFrameTime = seconds; }
+	double GetTargetFrameTime() const { return targetFrameTime; }
+	void SetEnabled(bool enabled); // Desligado, fica no nível 0
+	bool IsEnabled() const { return enabled; }
+
+	bool Update(double frameTime); // Regista a duração de um quadro; devolve true se o nível mudou
+	int GetLevel() const { return level; }
+	const QualityLevel& GetSettings() const { return LEVELS[level]; }
+
+private:
+	static const QualityLevel LEVELS[LEVEL_COUNT];
+	static const float DOWNGRADE_RATIO; // Mediana acima de target * DOWNGRADE_RATIO: desce um nível
+	static const float UPGRADE_RATIO;   // Mediana abaixo de target * UPGRADE_RATIO: a janela conta para subir
+
+	bool enabled;
+	double targetFrameTime;              // Duração pedida para cada quadro, em segundos
+	int level;
+	float window[WINDOW_FRAMES];         // Durações dos quadros da janela atual
+	int windowFrames;
+	int settleFrames;                    // Quadros que ainda são ignorados depois da última mudança
+	int fastWindows;                     // Janelas rápidas seguidas
+	int upgradeWindows;                  // Janelas rápidas necessárias para subir
+	bool probing;                        // A última mudança foi uma subida que ainda não foi confirmada
+
+	void SetLevel(int newLevel, double median, const char* reason); // Muda de nível e escreve a decisão
+};
+
+#endif // QUALITY_GOVERNOR_H
@@ -0,0 +1,179 @@
+﻿/*****************************************************************************
+ * RenderQueue.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe RenderQueue, a fila de desenho de cada quadro. A classe RenderQueue
+ * é responsável por:
+ * - Guardar os objetos a desenhar no quadro, cada um com o seu estado OpenGL (DrawState), malha e dados de objeto.
+ * - Ordenar os objetos por uma chave de 64 bits, para que os objetos com o mesmo programa, textura e malha fiquem
+ *   seguidos e, dentro de cada malha, sejam desenhados da frente para trás.
+ * - Desenhar cada sequência de objetos com o mesmo estado num único lote de desenho indireto (IndirectBatch),
+ *   mudando o estado através de uma GLStateCache, que descarta as ligações redundantes.
+ *
+ * Funções principais:
+ * - Add(const DrawState& state, const MeshRange& mesh, const ObjectBlock& object): Adiciona um objeto à fila.
+ * - Flush(GLStateCache& cache, FrameUploadBuffer& uploadBuffer): Ordena, desenha e esvazia a fila.
+ * - MakeSortKey(const DrawState& state, const MeshRange& mesh, float depth): Calcula a chave de ordenação.
+ *
+ * Variáveis e constantes importantes:
+ * - items: Objetos adicionados no quadro.
+ * - sortEntries: Pares (chave, índice do objeto) ordenados em Flush.
+ * - batch: Lote de desenho indireto reutilizado por cada sequência de objetos.
+ *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+
+#include "RenderQueue.h"
+
+
+/*****************************************************************************
+ * bool DrawState::operator==(const DrawState& other) const
+ *
+ * Descrição:
+ * ----------
+ * Compara dois estados de desenho. Os objetos seguidos com estados iguais são
+ * desenhados no mesmo lote.
+ *
+ * Parâmetros:
+ * -----------
+ * - other: O outro estado.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se os estados forem iguais.
+ *
+ ******************************************************************************/
+bool DrawState::operator==(const DrawState& other) const {
+	return program == other.program && vertexArray == other.vertexArray && texture == other.texture &&
+		lightOffset == other.lightOffset && impostor == other.impostor && viewCount == other.viewCount;
+}
+
+
+/*****************************************************************************
+ * uint64_t RenderQueue::MakeSortKey(const DrawState& state, const MeshRange& mesh, float depth)
+ *
+ * Descrição:
+ * ----------
+ * Calcula a chave de ordenação de um objeto. Os campos estão ordenados do mais
+ * caro de mudar para o mais barato:
+ * - bits 52 a 63: programa de shader;
+ * - bits 40 a 51: textura;
+ * - bits 24 a 39: malha (objetos com a mesma malha formam um só comando instanciado);
+ * - bits 0 a 23: profundidade, para desenhar da frente para trás e aproveitar o teste de profundidade.
+ * A profundidade usa os bits mais altos do float: para valores positivos a
+ * ordem dos bits é a ordem dos números, por isso não é preciso um plano distante.
+ *
+ * Parâmetros:
+ * -----------
+ * - state: O estado de desenho do objeto.
+ * - mesh: A malha do objeto.
+ * - depth: A distância do objeto à câmera ao longo da direção de visão.
+ *
+ * Retorno:
+ * --------
+ * - uint64_t: A chave de ordenação.
+ *
+ ******************************************************************************/
+uint64_t RenderQueue::MakeSortKey(const DrawState& state, const MeshRange& mesh, float depth) {
+	depth = std::max(depth, 0.0f);
+
+	uint32_t depthBits;
+	std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	uint64_t key = 0;
+	key |= (uint64_t)(state.program & 0xFFF) << 52;
+	key |= (uint64_t)(state.texture & 0xFFF) << 40;
+	key |= (uint64_t)(mesh.meshId & 0xFFFF) << 24;
+	key |= (uint64_t)(depthBits >> 8);
+
+	return key;
+}
+
+
+/*****************************************************************************
+ * void RenderQueue::Add(const DrawState& state, const MeshRange& mesh, const ObjectBlock& object)
+ *
+ * Descrição:
+ * ----------
+ * Adiciona um objeto à fila do quadro. A profundidade usada na chave é a do
+ * centro do objeto no espaço da câmera (object.modelView[3]).
+ *
+ * Parâmetros:
+ * -----------
+ * - state: O estado de desenho do objeto.
+ * - mesh: A malha a desenhar (ignorada no caso dos impostores).
+ * - object: Os dados do objeto (matrizes, raio, camada de textura e material).
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void RenderQueue::Add(const DrawState& state, const MeshRange& mesh, const ObjectBlock& object) {
+	SortEntry entry;
+	entry.key = MakeSortKey(state, mesh, -object.modelView[3].z);
+	entry.index = (GLuint)items.size();
+	sortEntries.push_back(entry);
+
+	items.push_back({ state, mesh, object });
+}
+
+
+/*****************************************************************************
+ * void RenderQueue::Flush(GLStateCache& cache, FrameUploadBuffer& uploadBuffer)
+ *
+ * Descrição:
+ * ----------
+ * Ordena os objetos da fila pela chave e desenha-os. Cada sequência de objetos
+ * com o mesmo estado é juntada num lote e desenhada com uma única chamada; entre
+ * sequências, o programa, o VAO, a textura e o bloco de luzes são mudados através
+ * da cache, que só envia ao OpenGL o que for diferente. No fim a fila fica vazia,
+ * pronta para o quadro seguinte, sem libertar a memória.
+ *
+ * Parâmetros:
+ * -----------
+ * - cache: A cache do estado OpenGL.
+ * - uploadBuffer: O buffer do quadro, onde são escritos os dados dos objetos e os comandos.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void RenderQueue::Flush(GLStateCache& cache, FrameUploadBuffer& uploadBuffer) {
+	std::sort(sortEntries.begin(), sortEntries.end(), [](const SortEntry& a, const SortEntry& b) {
+		return a.key < b.key;
+		});
+
+	size_t next = 0;
+	while (next < sortEntries.size()) {
+		const DrawState& state = items[sortEntries[next].index].state;
+
+		batch.Clear();
+		batch.SetViewCount(state.viewCount);
+		while (next < sortEntries.size()) {
+			const RenderItem& item = items[sortEntries[next].index];
+			if (item.state != state || !batch.Add(item.mesh, item.object))
+				break;
+			next++;
+		}
+
+		cache.UseProgram(state.program);
+		cache.BindVertexArray(state.vertexArray);
+		if (state.texture != 0)
+			cache.BindTexture(0, GL_TEXTURE_2D_ARRAY, state.texture);
+		if (state.lightOffset >= 0)
+			cache.BindUniformRange(LIGHT_BLOCK_BINDING, uploadBuffer.GetBuffer(), state.lightOffset, sizeof(LightBlock));
+
+		if (state.impostor)
+			batch.SubmitImpostors(uploadBuffer);
+		else
+			batch.Submit(uploadBuffer, cache);
+	}
+
+	items.clear();
+	sortEntries.clear();
+}
@@ -0,0 +1,55 @@
+﻿#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
+#include "GeometryBuffer.h"
+#include "IndirectBatch.h"
+#include "FrameUploadBuffer.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+
+// Estado OpenGL com que um objeto é desenhado; objetos com o mesmo estado são desenhados no mesmo lote
+struct DrawState {
+	GLuint program;      // Programa de shader
+	GLuint vertexArray;  // VAO (o do buffer de geometria partilhado)
+	GLuint texture;      // Array de texturas ligado à unidade 0 (0 = sem textura)
+	GLintptr lightOffset; // Offset do bloco LightData no buffer do quadro (-1 = manter o bloco ligado)
+	bool impostor;       // Desenha um quadrado por objeto em vez da malha
+	GLuint viewCount;    // Vistas desenhadas por objeto na mesma passagem (1 sem MultiView)
+
+	bool operator==(const DrawState& other) const;
+	bool operator!=(const DrawState& other) const { return !(*this == other); }
+};
+
+// Fila de desenho de um quadro: os objetos são adicionados por qualquer ordem e desenhados ordenados por uma
+// chave de 64 bits (programa, textura, malha, profundidade), com as mudanças de estado feitas por uma GLStateCache
+class RenderQueue {
+public:
+	void Add(const DrawState& state, const MeshRange& mesh, const ObjectBlock& object); // Adiciona um objeto à fila
+	void Flush(GLStateCache& cache, FrameUploadBuffer& uploadBuffer); // Ordena, desenha e esvazia a fila
+	size_t Size() const { return items.size(); } // Número de objetos na fila
+
+	static uint64_t MakeSortKey(const DrawState& state, const MeshRange& mesh, float depth); // Chave de ordenação de um objeto
+
+private:
+	// Objeto à espera de ser desenhado
+	struct RenderItem {
+		DrawState state;
+		MeshRange mesh;
+		ObjectBlock object;
+	};
+
+	// Entrada ordenada: só a chave e o índice do objeto, para não mover os objetos na ordenação
+	struct SortEntry {
+		uint64_t key;
+		GLuint index;
+	};
+
+	std::vector<RenderItem> items;     // Objetos do quadro, pela ordem de Add
+	std::vector<SortEntry> sortEntries; // Chaves dos objetos, ordenadas em Flush
+	IndirectBatch batch;               // Lote reutilizado para cada sequência de objetos com o mesmo estado
+};
+
+#endif // RENDER_QUEUE_H
@@ -0,0 +1,91 @@
+﻿/*****************************************************************************
+ * SceneRegistry.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe SceneRegistry, o registo das entidades da cena (as bolas da mesa
+ * principal e as da sala de bilhar). A classe SceneRegistry é responsável por:
+ * - Dar identificadores às entidades, reutilizando os das entidades destruídas.
+ * - Guardar os componentes (transformação, corpo rígido, malha e material) em arrays densos, um por tipo, que os
+ *   sistemas percorrem sem chamadas virtuais nem estado OpenGL por objeto.
+ *
+ * Funções principais:
+ * - Create(): Cria uma entidade sem componentes.
+ * - Destroy(Entity entity): Remove os componentes de uma entidade e liberta o identificador.
+ *
+ * Variáveis e constantes importantes:
+ * - transforms, bodies, renderables, materials: Arrays densos de cada tipo de componente.
+ * - nextEntity, freeEntities: Identificadores por usar e por reutilizar.
+ *
+ ******************************************************************************/
+
+#include "SceneRegistry.h"
+
+
+/*****************************************************************************
+ * SceneRegistry::SceneRegistry()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `SceneRegistry`. O registo começa sem entidades.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+SceneRegistry::SceneRegistry()
+	: nextEntity(0) {
+}
+
+
+/*****************************************************************************
+ * Entity SceneRegistry::Create()
+ *
+ * Descrição:
+ * ----------
+ * Cria uma entidade sem componentes, com o identificador de uma entidade
+ * destruída, se houver, para que os índices esparsos dos arrays não cresçam.
+ *
+ * Retorno:
+ * --------
+ * - Entity: O identificador da nova entidade.
+ *
+ ******************************************************************************/
+Entity SceneRegistry::Create() {
+	if (!freeEntities.empty()) {
+		Entity entity = freeEntities.back();
+		freeEntities.pop_back();
+		return entity;
+	}
+
+	return nextEntity++;
+}
+
+
+/*****************************************************************************
+ * void SceneRegistry::Destroy(Entity entity)
+ *
+ * Descrição:
+ * ----------
+ * Remove todos os componentes de uma entidade e guarda o identificador para
+ * ser reutilizado. Os componentes de outras entidades podem mudar de posição
+ * nos arrays, por isso as posições densas não podem ser guardadas entre
+ * quadros (os identificadores podem).
+ *
+ * Parâmetros:
+ * -----------
+ * - entity: A entidade a destruir.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void SceneRegistry::Destroy(Entity entity) {
+	transforms.Remove(entity);
+	bodies.Remove(entity);
+	renderables.Remove(entity);
+	materials.Remove(entity);
+	freeEntities.push_back(entity);
+}
@@ -0,0 +1,112 @@
+﻿#ifndef SCENE_REGISTRY_H
+#define SCENE_REGISTRY_H
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "GeometryBuffer.h"
+#include "SphereLOD.h"
+
+// Identificador de um objeto da cena: só um índice, os dados ficam nos arrays de componentes
+typedef uint32_t Entity;
+const Entity INVALID_ENTITY = 0xFFFFFFFFu;
+const uint32_t INVALID_COMPONENT_INDEX = 0xFFFFFFFFu; // Entidade sem o componente, no índice esparso de um ComponentArray
+
+// Posição e orientação de um objeto, com a matriz de modelo calculada pelo TransformSystem quando mudam
+struct TransformComponent {
+	glm::vec3 position;    // Posição no mundo
+	glm::vec3 orientation; // Rotações em x, y e z, em graus
+	glm::mat4 model;       // Matriz de modelo (translação e as três rotações)
+	bool dirty;            // A posição ou a orientação mudaram desde o último cálculo da matriz
+};
+
+// Corpo rígido de uma bola: o PhysicsSystem fá-la rolar em x até tocar noutra bola ou numa tabela
+struct PhysicsBodyComponent {
+	float radius;  // Raio usado nas colisões
+	float speed;   // Velocidade em x, em unidades por segundo
+	bool isMoving; // A bola está a rolar
+};
+
+// Malha com que um objeto é desenhado e os dados de que o recorte e o nível de detalhe precisam
+struct RenderableComponent {
+	MeshRange mesh;        // Malha original no buffer de geometria partilhado (nível 0)
+	const SphereLOD* lod;  // Níveis de detalhe partilhados (nullptr = sempre a malha original)
+	int lodLevel;          // Nível usado no último quadro
+	bool fixedLOD;         // O nível é escolhido por quem agrupa o objeto (as mesas da PoolHall), não por objeto
+	float meshRadius;      // Raio da malha (o raio dos impostores)
+	float boundsRadius;    // Raio da esfera envolvente à volta da posição, válido com qualquer orientação
+	GLint textureLayer;    // Camada do array de texturas das bolas
+};
+
+// Índice do material do objeto no buffer de materiais da cena
+struct MaterialComponent {
+	GLint materialIndex;
+};
+
+// Array denso de componentes de um tipo: os componentes ficam contíguos, pela ordem em que foram adicionados (a remoção
+// troca o último para o lugar do removido), e um índice esparso dá a posição do componente de cada entidade
+template <typename T>
+class ComponentArray {
+public:
+	T& Add(Entity entity, const T& component) {
+		if (entity >= indices.size())
+			indices.resize(entity + 1, INVALID_COMPONENT_INDEX);
+		if (indices[entity] != INVALID_COMPONENT_INDEX)
+			return components[indices[entity]] = component;
+
+		indices[entity] = (uint32_t)components.size();
+		components.push_back(component);
+		entities.push_back(entity);
+		return components.back();
+	}
+
+	void Remove(Entity entity) {
+		if (!Has(entity))
+			return;
+
+		uint32_t index = indices[entity];
+		components[index] = components.back();
+		entities[index] = entities.back();
+		indices[entities[index]] = index;
+		components.pop_back();
+		entities.pop_back();
+		indices[entity] = INVALID_COMPONENT_INDEX;
+	}
+
+	bool Has(Entity entity) const { return entity < indices.size() && indices[entity] != INVALID_COMPONENT_INDEX; }
+	T& Get(Entity entity) { return components[indices[entity]]; }             // A entidade tem de ter o componente
+	const T& Get(Entity entity) const { return components[indices[entity]]; }
+
+	size_t Size() const { return components.size(); }                 // Número de componentes
+	T& At(size_t index) { return components[index]; }                  // Componente na posição densa `index`
+	const T& At(size_t index) const { return components[index]; }
+	Entity EntityAt(size_t index) const { return entities[index]; }    // Entidade dona do componente na posição `index`
+
+private:
+	std::vector<T> components;    // Componentes, contíguos
+	std::vector<Entity> entities; // Entidade de cada componente, pela mesma ordem
+	std::vector<uint32_t> indices; // Posição do componente de cada entidade em `components` (INVALID_COMPONENT_INDEX = sem componente)
+};
+
+// Registo dos objetos da cena: cria e destrói entidades e guarda os seus componentes em arrays densos, percorridos
+// pelos sistemas (SceneSystems). Um tipo de objeto novo é só uma combinação de componentes, sem funções virtuais
+class SceneRegistry {
+public:
+	SceneRegistry();
+
+	Entity Create();              // Nova entidade sem componentes
+	void Destroy(Entity entity);  // Remove todos os componentes; o identificador é reutilizado
+	size_t GetEntityCount() const { return nextEntity - freeEntities.size(); } // Entidades vivas
+
+	ComponentArray<TransformComponent> transforms;
+	ComponentArray<PhysicsBodyComponent> bodies;
+	ComponentArray<RenderableComponent> renderables;
+	ComponentArray<MaterialComponent> materials;
+
+private:
+	Entity nextEntity;                 // Próximo identificador nunca usado
+	std::vector<Entity> freeEntities;  // Identificadores de entidades destruídas, por reutilizar
+};
+
+#endif // SCENE_REGISTRY_H
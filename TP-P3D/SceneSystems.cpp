@@ -0,0 +1,335 @@
+﻿/*****************************************************************************
+ * SceneSystems.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém os sistemas que percorrem os componentes do SceneRegistry em cada quadro. Os sistemas são
+ * responsáveis por:
+ * - TransformSystem: Recalcular as matrizes de modelo das entidades que se moveram.
+ * - PhysicsSystem: Fazer rolar as bolas em movimento e pará-las quando tocam noutra bola ou numa tabela. As
+ *   colisões são testadas contra as posições do início do passo, por isso o resultado não depende da ordem.
+ * - CullingSystem: Juntar as esferas envolventes das entidades num lote SoA para o recorte em SIMD.
+ * - RenderListSystem: Calcular os dados de desenho das entidades visíveis em paralelo e passá-los à fila de desenho.
+ * Os sistemas dividem o trabalho por blocos no JobSystem; as escritas de cada bloco só tocam nos componentes e nos
+ * itens dos seus índices, e o que é partilhado (a fila de desenho e os pedidos de texturas) fica na thread principal.
+ *
+ * Funções principais:
+ * - TransformSystem::Update(SceneRegistry& registry, JobSystem& jobs): Matrizes das transformações que mudaram.
+ * - PhysicsSystem::Update(SceneRegistry& registry, float deltaTime, JobSystem& jobs): Passo da simulação.
+ * - PhysicsSystem::IsAnyMoving(const SceneRegistry& registry): Indica se algum corpo está em movimento.
+ * - CullingSystem::GatherBounds(const SceneRegistry& registry, const std::vector<Entity>& entities, SphereBatch& bounds):
+ *   Esferas envolventes de uma lista de entidades.
+ * - RenderListSystem::Build(...): Dados de desenho das entidades visíveis.
+ * - RenderListSystem::Submit(RenderQueue& queue, const DrawState& state, TextureResidency* textures): Envia-os à fila.
+ * - RenderListSystem::GatherShadowCasters(...): Entidades como objetos que projetam sombras.
+ *
+ * Variáveis e constantes importantes:
+ * - TABLE_HALF_EXTENT: Limites da mesa principal usados nas colisões com as tabelas.
+ * - TRANSFORM_BATCH, PHYSICS_BATCH, RENDER_BATCH: Tamanho dos blocos de cada sistema no JobSystem.
+ *
+ ******************************************************************************/
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "SceneSystems.h"
+
+const glm::vec2 PhysicsSystem::TABLE_HALF_EXTENT(0.9f, 0.45f);
+
+// Entidades por bloco do JobSystem: abaixo disto, o trabalho de um bloco não paga o custo de acordar uma thread
+static const size_t TRANSFORM_BATCH = 1024;
+static const size_t PHYSICS_BATCH = 256;
+static const size_t RENDER_BATCH = 512;
+
+
+/*****************************************************************************
+ * glm::mat4 TransformSystem::ComputeModelMatrix(const glm::vec3& position, const glm::vec3& orientation)
+ *
+ * Descrição:
+ * ----------
+ * Calcula a matriz de modelo de uma entidade: a translação para a posição e as
+ * rotações em x, y e z. A cena não tem matriz de modelo própria (a câmera
+ * orbita à volta da mesa), por isso é também a matriz usada nos mapas de sombras.
+ *
+ * Parâmetros:
+ * -----------
+ * - position: A posição (x, y, z) no mundo.
+ * - orientation: A orientação (x, y, z) em graus.
+ *
+ * Retorno:
+ * --------
+ * - glm::mat4: A matriz de modelo.
+ *
+ ******************************************************************************/
+glm::mat4 TransformSystem::ComputeModelMatrix(const glm::vec3& position, const glm::vec3& orientation) {
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+	model = glm::rotate(model, glm::radians(orientation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+	model = glm::rotate(model, glm::radians(orientation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+	model = glm::rotate(model, glm::radians(orientation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+
+	return model;
+}
+
+
+/*****************************************************************************
+ * void TransformSystem::Update(SceneRegistry& registry, JobSystem& jobs)
+ *
+ * Descrição:
+ * ----------
+ * Recalcula as matrizes de modelo das transformações marcadas como mudadas
+ * (`dirty`), em paralelo. As bolas paradas (todas as da sala de bilhar) ficam
+ * com a matriz calculada quando foram criadas.
+ *
+ * Parâmetros:
+ * -----------
+ * - registry: O registo da cena.
+ * - jobs: As threads de trabalho.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void TransformSystem::Update(SceneRegistry& registry, JobSystem& jobs) {
+	ComponentArray<TransformComponent>& transforms = registry.transforms;
+	jobs.ParallelFor(transforms.Size(), TRANSFORM_BATCH, [&transforms](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			TransformComponent& transform = transforms.At(i);
+			if (transform.dirty) {
+				transform.model = ComputeModelMatrix(transform.position, transform.orientation);
+				transform.dirty = false;
+			}
+		}
+		});
+}
+
+
+/*****************************************************************************
+ * void PhysicsSystem::Update(SceneRegistry& registry, float deltaTime, JobSystem& jobs)
+ *
+ * Descrição:
+ * ----------
+ * Avança a simulação um passo. Primeiro são copiadas as posições de todos os
+ * corpos; depois, em paralelo, cada corpo em movimento é testado contra essas
+ * posições (as outras bolas e as tabelas) e para se tocar em alguma, e rola em
+ * x (a posição avança e a bola roda em z), mesmo no passo em que para.
+ *
+ * Parâmetros:
+ * -----------
+ * - registry: O registo da cena.
+ * - deltaTime: Tempo decorrido desde o último passo, em segundos.
+ * - jobs: As threads de trabalho.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void PhysicsSystem::Update(SceneRegistry& registry, float deltaTime, JobSystem& jobs) {
+	ComponentArray<PhysicsBodyComponent>& bodies = registry.bodies;
+	ComponentArray<TransformComponent>& transforms = registry.transforms;
+
+	bodyPositions.resize(bodies.Size());
+	for (size_t i = 0; i < bodies.Size(); i++)
+		bodyPositions[i] = glm::vec4(transforms.Get(bodies.EntityAt(i)).position, bodies.At(i).radius);
+
+	const std::vector<glm::vec4>& positions = bodyPositions;
+	jobs.ParallelFor(bodies.Size(), PHYSICS_BATCH, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			PhysicsBodyComponent& body = bodies.At(i);
+			if (!body.isMoving)
+				continue;
+
+			glm::vec3 position(positions[i]);
+			bool colliding = position.x + body.radius > TABLE_HALF_EXTENT.x || position.x - body.radius < -TABLE_HALF_EXTENT.x ||
+				position.z + body.radius > TABLE_HALF_EXTENT.y || position.z - body.radius < -TABLE_HALF_EXTENT.y;
+			for (size_t other = 0; other < positions.size() && !colliding; other++)
+				colliding = other != i && glm::distance(position, glm::vec3(positions[other])) <= body.radius + positions[other].w;
+
+			if (colliding)
+				body.isMoving = false;
+
+			float distance = body.speed * deltaTime;
+			TransformComponent& transform = transforms.Get(bodies.EntityAt(i));
+			transform.position.x += distance;
+			transform.orientation.z -= glm::degrees(distance / body.radius);
+			transform.dirty = true;
+		}
+		});
+}
+
+
+/*****************************************************************************
+ * bool PhysicsSystem::IsAnyMoving(const SceneRegistry& registry)
+ *
+ * Descrição:
+ * ----------
+ * Indica se algum corpo da cena está em movimento (a janela tem de continuar
+ * a desenhar enquanto houver).
+ *
+ * Parâmetros:
+ * -----------
+ * - registry: O registo da cena.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se algum corpo estiver em movimento.
+ *
+ ******************************************************************************/
+bool PhysicsSystem::IsAnyMoving(const SceneRegistry& registry) {
+	for (size_t i = 0; i < registry.bodies.Size(); i++)
+		if (registry.bodies.At(i).isMoving)
+			return true;
+
+	return false;
+}
+
+
+/*****************************************************************************
+ * void CullingSystem::GatherBounds(const SceneRegistry& registry, const std::vector<Entity>& entities, SphereBatch& bounds)
+ *
+ * Descrição:
+ * ----------
+ * Preenche um lote SoA com as esferas envolventes de uma lista de entidades (a
+ * posição e o raio que cobre qualquer orientação), pela ordem da lista, para
+ * que os índices devolvidos pelo recorte e pela SphereGrid sejam os da lista.
+ *
+ * Parâmetros:
+ * -----------
+ * - registry: O registo da cena.
+ * - entities: As entidades (com transformação e malha).
+ * - bounds: Recebe as esferas.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void CullingSystem::GatherBounds(const SceneRegistry& registry, const std::vector<Entity>& entities, SphereBatch& bounds) {
+	bounds.Clear();
+	for (Entity entity : entities)
+		bounds.Add(registry.transforms.Get(entity).position, registry.renderables.Get(entity).boundsRadius);
+}
+
+
+/*****************************************************************************
+ * void RenderListSystem::Build(SceneRegistry& registry, const std::vector<Entity>& entities, const std::vector<int>& visible,
+ *                              const Camera& camera, const TextureResidency* textures, JobSystem& jobs)
+ *
+ * Descrição:
+ * ----------
+ * Acrescenta à lista os dados de desenho das entidades visíveis, calculados em
+ * paralelo: as matrizes modelo-vista e das normais, o raio no espaço da câmera
+ * (o zoom é uma escala uniforme), a camada da textura (a cor provisória
+ * enquanto os mipmaps pequenos não chegam) e o nível de detalhe, escolhido a
+ * partir do raio no ecrã com a histerese do SphereLOD, exceto nas entidades com
+ * `fixedLOD`. Cada bloco só escreve nos itens e nos componentes dos seus índices.
+ *
+ * Parâmetros:
+ * -----------
+ * - registry: O registo da cena.
+ * - entities: Uma lista de entidades.
+ * - visible: Os índices, nessa lista, das entidades visíveis.
+ * - camera: A câmera principal, com as matrizes do quadro.
+ * - textures: As texturas das bolas (nullptr = as camadas estão sempre carregadas).
+ * - jobs: As threads de trabalho.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void RenderListSystem::Build(SceneRegistry& registry, const std::vector<Entity>& entities, const std::vector<int>& visible,
+	const Camera& camera, const TextureResidency* textures, JobSystem& jobs) {
+	size_t first = items.size();
+	items.resize(first + visible.size());
+
+	float zoom = glm::abs(camera.zoom);
+	jobs.ParallelFor(visible.size(), RENDER_BATCH, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			Entity entity = entities[visible[i]];
+			const TransformComponent& transform = registry.transforms.Get(entity);
+			RenderableComponent& renderable = registry.renderables.Get(entity);
+
+			Item& item = items[first + i];
+			ObjectBlock& object = item.object;
+			object = ObjectBlock();
+			object.model = transform.model;
+			object.modelView = camera.zoomView * transform.model;
+			object.normalMatrix = Camera::getNormalMatrix(object.modelView);
+			object.textureLayer = (textures == nullptr || textures->IsLayerResident(renderable.textureLayer)) ? renderable.textureLayer : PLACEHOLDER_TEXTURE_LAYER;
+			object.materialIndex = registry.materials.Has(entity) ? registry.materials.Get(entity).materialIndex : 0;
+			object.radius = renderable.meshRadius * zoom;
+
+			item.screenRadius = camera.getScreenRadius(glm::vec3(object.modelView[3]), object.radius);
+			if (renderable.lod != nullptr && !renderable.fixedLOD)
+				renderable.lodLevel = renderable.lod->SelectLevel(item.screenRadius, renderable.lodLevel);
+			item.mesh = (renderable.lod != nullptr && renderable.lodLevel > 0) ? renderable.lod->GetMesh(renderable.lodLevel) : renderable.mesh;
+		}
+		});
+}
+
+
+/*****************************************************************************
+ * void RenderListSystem::Submit(RenderQueue& queue, const DrawState& state, TextureResidency* textures)
+ *
+ * Descrição:
+ * ----------
+ * Passa os itens da lista para a fila de desenho, pela ordem em que foram
+ * acrescentados, com o mesmo estado, e pede às texturas os níveis de que cada
+ * item precisa. No fim a lista fica vazia, sem libertar a memória.
+ *
+ * Parâmetros:
+ * -----------
+ * - queue: A fila de desenho do quadro.
+ * - state: O estado de desenho dos itens.
+ * - textures: As texturas das bolas (nullptr = não há pedidos).
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void RenderListSystem::Submit(RenderQueue& queue, const DrawState& state, TextureResidency* textures) {
+	for (const Item& item : items) {
+		if (textures != nullptr && item.object.textureLayer != PLACEHOLDER_TEXTURE_LAYER)
+			textures->Request(item.object.textureLayer, item.screenRadius);
+		queue.Add(state, item.mesh, item.object);
+	}
+
+	items.clear();
+}
+
+
+/*****************************************************************************
+ * void RenderListSystem::GatherShadowCasters(const SceneRegistry& registry, const std::vector<Entity>& entities,
+ *                                            std::vector<ShadowCaster>& casters)
+ *
+ * Descrição:
+ * ----------
+ * Acrescenta as entidades como objetos que projetam sombras, com a malha do
+ * nível de detalhe escolhido no último quadro. As entidades sem corpo ou com o
+ * corpo parado vão para o mapa de sombras guardado; as outras são desenhadas
+ * por cima em cada quadro.
+ *
+ * Parâmetros:
+ * -----------
+ * - registry: O registo da cena.
+ * - entities: As entidades (com transformação e malha).
+ * - casters: Recebe os objetos.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void RenderListSystem::GatherShadowCasters(const SceneRegistry& registry, const std::vector<Entity>& entities, std::vector<ShadowCaster>& casters) {
+	for (Entity entity : entities) {
+		const RenderableComponent& renderable = registry.renderables.Get(entity);
+
+		ShadowCaster caster;
+		caster.mesh = (renderable.lod != nullptr && renderable.lodLevel > 0) ? renderable.lod->GetMesh(renderable.lodLevel) : renderable.mesh;
+		caster.model = registry.transforms.Get(entity).model;
+		caster.isStatic = !registry.bodies.Has(entity) || !registry.bodies.Get(entity).isMoving;
+		casters.push_back(caster);
+	}
+}
@@ -0,0 +1,63 @@
+﻿#ifndef SCENE_SYSTEMS_H
+#define SCENE_SYSTEMS_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "SceneRegistry.h"
+#include "JobSystem.h"
+#include "Camera.h"
+#include "Frustum.h"
+#include "RenderQueue.h"
+#include "ShadowMaps.h"
+#include "TextureResidency.h"
+#include "UniformBlocks.h"
+
+// Matrizes de modelo das transformações que mudaram (as entidades paradas não são recalculadas)
+class TransformSystem {
+public:
+	static void Update(SceneRegistry& registry, JobSystem& jobs);
+	static glm::mat4 ComputeModelMatrix(const glm::vec3& position, const glm::vec3& orientation);
+};
+
+// Bolas a rolar: cada corpo em movimento para ao tocar noutro corpo ou nas tabelas da mesa principal
+class PhysicsSystem {
+public:
+	static const glm::vec2 TABLE_HALF_EXTENT; // Metade do tamanho da mesa em x e em z (as tabelas)
+
+	void Update(SceneRegistry& registry, float deltaTime, JobSystem& jobs);
+	static bool IsAnyMoving(const SceneRegistry& registry); // Algum corpo está em movimento?
+
+private:
+	std::vector<glm::vec4> bodyPositions; // Posição (xyz) e raio (w) dos corpos no início do passo
+	std::vector<char> colliding;          // Resultado do teste de colisão de cada corpo
+};
+
+// Esferas envolventes de uma lista de entidades, pela ordem da lista, para o recorte em SIMD e para a SphereGrid
+class CullingSystem {
+public:
+	static void GatherBounds(const SceneRegistry& registry, const std::vector<Entity>& entities, SphereBatch& bounds);
+};
+
+// Dados de desenho das entidades visíveis: as matrizes, o nível de detalhe e a camada de textura de cada entidade são
+// calculados em paralelo, e a fila de desenho (que não é partilhada entre threads) recebe-os depois, por ordem
+class RenderListSystem {
+public:
+	void Build(SceneRegistry& registry, const std::vector<Entity>& entities, const std::vector<int>& visible,
+		const Camera& camera, const TextureResidency* textures, JobSystem& jobs); // Acrescenta as entidades visíveis
+	void Submit(RenderQueue& queue, const DrawState& state, TextureResidency* textures); // Passa tudo para a fila e esvazia a lista
+	size_t Size() const { return items.size(); }
+
+	static void GatherShadowCasters(const SceneRegistry& registry, const std::vector<Entity>& entities, std::vector<ShadowCaster>& casters);
+
+private:
+	// Entidade pronta a entrar na fila
+	struct Item {
+		MeshRange mesh;      // Malha do nível de detalhe escolhido
+		ObjectBlock object;  // Dados do objeto para o bloco ObjectData
+		float screenRadius;  // Raio no ecrã, para pedir os níveis da textura
+	};
+
+	std::vector<Item> items; // Itens do quadro (reutilizado entre quadros)
+};
+
+#endif // SCENE_SYSTEMS_H
@@ -1,26 +1,89 @@
 #version 440 core
+#ifdef MULTI_VIEW
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
 
-layout(location = 0) in vec3 aPosition; // Posio do vrtice
+layout(location = 0) in vec3 aPosition; // Posio do vrtice, normalizada dentro da caixa envolvente da malha
 layout(location = 1) in vec3 aNormal;   // Normal do vrtice
 layout(location = 2) in vec2 aTexCoord; // Coordenada de textura do vrtice
+layout(location = 3) in uint aDrawID;   // ndice do objeto nos dados do lote
 
 out vec3 vPositionEyeSpace; // Posio do vrtice no espao da cmera
 out vec3 vNormalEyeSpace;   // Normal do vrtice no espao da cmera
 out vec2 textureCoord;      // Coordenada de textura do vrtice
 out vec3 vLightPosEyeSpace; // Posio da luz no espao da cmera (varying)
+flat out int vTextureLayer; // Camada do array de texturas da bola
+flat out int vMaterialIndex; // ndice do material da bola
+
+layout(std140, binding = 0) uniform CameraData {
+    mat4 View;
+    mat4 Projection;
+};
+
+struct Object {
+    mat4 Model;
+    mat4 ModelView;
+    mat3 NormalMatrix; // Inversa transposta da modelo-vista, calculada uma vez por bola na CPU
+    float Radius;
+    int TextureLayer;
+    int MaterialIndex;
+    int MeshIndex;
+};
+
+struct Mesh {
+    vec3 PositionOffset; // Canto mnimo da caixa envolvente da malha
+    vec3 PositionScale;  // Tamanho da caixa envolvente
+};
+
+// Dados de todos os objetos do lote, indexados pelo atributo aDrawID (baseInstance + gl_InstanceID)
+layout(std430, binding = 2) readonly buffer ObjectData {
+    Object objects[];
+};
+
+// Caixas envolventes das malhas, para recuperar as posies comprimidas em 16 bits
+layout(std430, binding = 4) readonly buffer MeshData {
+    Mesh meshes[];
+};
+
+#ifdef MULTI_VIEW
+struct ViewTransform {
+    mat4 ClipFromEye; // Do espao da cmera principal para o espao de recorte da vista
+    vec4 EyePosition; // Posio da cmera da vista no espao da cmera principal
+};
+
+// Vistas desenhadas na mesma passagem (MultiView): cada objeto tem uma instncia por vista
+layout(std140, binding = 9) uniform MultiViewData {
+    ViewTransform views[4];
+    uint ViewCount;
+};
+
+flat out vec3 vEyePosition; // Posio da cmera da vista, para a iluminao especular
+#endif
 
-uniform mat4 Model;
-uniform mat4 View;
-uniform mat4 Projection;
 uniform vec3 LightPos; // Posio da luz no espao do mundo
 
 void main() {
+#ifdef MULTI_VIEW
+    // O atributo  objeto * ViewCount + vista (IndirectBatch)
+    uint drawID = aDrawID / ViewCount;
+    uint view = aDrawID % ViewCount;
+#else
+    uint drawID = aDrawID;
+#endif
+
+    mat4 ModelView = objects[drawID].ModelView;
+    vTextureLayer = objects[drawID].TextureLayer;
+    vMaterialIndex = objects[drawID].MaterialIndex;
+
+    Mesh mesh = meshes[objects[drawID].MeshIndex];
+    vec3 position = mesh.PositionOffset + aPosition * mesh.PositionScale;
+
     // Calcula a posio do vrtice no espao da cmera
-    vec4 positionEyeSpace = View * Model * vec4(aPosition, 1.0);
+    vec4 positionEyeSpace = ModelView * vec4(position, 1.0);
     vPositionEyeSpace = positionEyeSpace.xyz;
 
     // Calcula a normal do vrtice no espao da cmera
-    vNormalEyeSpace = normalize(mat3(transpose(inverse(View * Model))) * aNormal);
+    vNormalEyeSpace = normalize(objects[drawID].NormalMatrix * aNormal);
 
     // Passa a coordenada de textura para o fragment shader
     textureCoord = aTexCoord;
@@ -29,6 +92,12 @@ void main() {
     vec4 lightPosEyeSpace = View * vec4(LightPos, 1.0);
     vLightPosEyeSpace = lightPosEyeSpace.xyz;
 
-    // Calcula a posio do vrtice no espao de projeo
+    // Calcula a posio do vrtice no espao de projeo (da vista da instncia, no seu viewport, com MultiView)
+#ifdef MULTI_VIEW
+    gl_ViewportIndex = int(view);
+    gl_Position = views[view].ClipFromEye * positionEyeSpace;
+    vEyePosition = views[view].EyePosition.xyz;
+#else
     gl_Position = Projection * positionEyeSpace;
+#endif
 }
@@ -0,0 +1,78 @@
+#version 440 core
+
+// Impostor de uma bola: interseta o raio de visão com a esfera de forma analítica e escreve
+// a profundidade, a normal e as coordenadas de textura esféricas do ponto atingido.
+
+in vec3 vQuadEyeSpace;
+flat in vec3 vCenterEyeSpace;
+flat in uint vDrawID;
+
+layout(std140, binding = 0) uniform CameraData {
+    mat4 View;
+    mat4 Projection;
+};
+
+struct Object {
+    mat4 Model;
+    mat4 ModelView;
+    mat3 NormalMatrix;
+    float Radius;
+    int TextureLayer;
+    int MaterialIndex;
+    int MeshIndex;
+};
+
+layout(std430, binding = 2) readonly buffer ObjectData {
+    Object objects[];
+};
+
+layout (location = 0) out vec4 fColor;
+
+// Definidas em ballLighting.frag
+vec3 sampleBall(vec2 uv, vec2 uvDx, vec2 uvDy, int layer);
+vec4 shadeBall(vec3 position, vec3 normal, vec3 baseColor, int materialIndex);
+
+const float PI = 3.14159265358979;
+
+// Deslocamento da longitude usado nas coordenadas de textura das malhas Ball*.obj
+const float U_OFFSET = 0.765625;
+
+void main() {
+    float Radius = objects[vDrawID].Radius;
+    mat4 ModelView = objects[vDrawID].ModelView;
+
+    // Raio a partir da câmera (origem do espaço da câmera) que passa por este fragmento
+    vec3 rayDirection = normalize(vQuadEyeSpace);
+
+    float b = dot(rayDirection, vCenterEyeSpace);
+    float c = dot(vCenterEyeSpace, vCenterEyeSpace) - Radius * Radius;
+    float discriminant = b * b - c;
+    if (discriminant < 0.0)
+        discard;
+
+    vec3 hitEyeSpace = rayDirection * (b - sqrt(discriminant));
+    vec3 normalEyeSpace = (hitEyeSpace - vCenterEyeSpace) / Radius;
+
+    // Profundidade do ponto da esfera (e não do quadrado), para que as interseções com a mesa fiquem corretas
+    vec4 clip = Projection * vec4(hitEyeSpace, 1.0);
+    gl_FragDepth = (gl_DepthRange.diff * (clip.z / clip.w) + gl_DepthRange.near + gl_DepthRange.far) * 0.5;
+
+    // A normal no espaço do objeto inclui a rotação da bola; mat3(ModelView) é uma rotação com escala uniforme (zoom)
+    vec3 normalObject = normalize(transpose(mat3(ModelView)) * normalEyeSpace);
+
+    // Mesmo mapeamento das malhas Ball*.obj: u = 0.765625 - longitude / 2pi, v = 1 - latitude / pi
+    float longitude = atan(normalObject.z, normalObject.x) / (2.0 * PI);
+    vec2 uv = vec2(fract(U_OFFSET - longitude), 1.0 - acos(clamp(normalObject.y, -1.0, 1.0)) / PI);
+
+    // Na costura u salta de 1 para 0; usa as derivadas de um u deslocado meia volta para não escolher o mip errado
+    float uShifted = fract(U_OFFSET - longitude + 0.5) - 0.5;
+    vec2 uvDx = dFdx(uv);
+    vec2 uvDy = dFdy(uv);
+    if (fwidth(uShifted) < fwidth(uv.x)) {
+        uvDx.x = dFdx(uShifted);
+        uvDy.x = dFdy(uShifted);
+    }
+
+    vec3 baseColor = sampleBall(uv, uvDx, uvDy, objects[vDrawID].TextureLayer);
+    fColor = shadeBall(hitEyeSpace, normalEyeSpace, baseColor, objects[vDrawID].MaterialIndex);
+}
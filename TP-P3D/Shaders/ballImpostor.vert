@@ -0,0 +1,50 @@
+#version 440 core
+
+// Impostor de uma bola: um quadrado virado para a câmera, gerado a partir de gl_VertexID
+// (4 vértices em GL_TRIANGLE_STRIP), que cobre toda a silhueta da esfera. Cada instância é uma bola.
+
+layout(location = 3) in uint aDrawID; // Índice do objeto nos dados do lote
+
+layout(std140, binding = 0) uniform CameraData {
+    mat4 View;
+    mat4 Projection;
+};
+
+struct Object {
+    mat4 Model;
+    mat4 ModelView;    // Matriz modelo-vista da bola (o centro da esfera é ModelView[3])
+    mat3 NormalMatrix;
+    float Radius;      // Raio da esfera no espaço da câmera
+    int TextureLayer;
+    int MaterialIndex;
+    int MeshIndex;
+};
+
+layout(std430, binding = 2) readonly buffer ObjectData {
+    Object objects[];
+};
+
+out vec3 vQuadEyeSpace;          // Ponto do quadrado no espaço da câmera
+flat out vec3 vCenterEyeSpace;   // Centro da esfera no espaço da câmera
+flat out uint vDrawID;           // Índice do objeto, para o fragment shader
+
+void main() {
+    float Radius = objects[aDrawID].Radius;
+    vec3 center = objects[aDrawID].ModelView[3].xyz;
+    vec2 corner = vec2((gl_VertexID & 1) != 0 ? 1.0 : -1.0, (gl_VertexID & 2) != 0 ? 1.0 : -1.0);
+
+    // O quadrado fica perpendicular ao raio câmera -> centro, para cobrir o cone da silhueta mesmo fora do eixo
+    float dist = length(center);
+    vec3 forward = center / dist;
+    vec3 right = normalize(cross(forward, abs(forward.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+    vec3 up = cross(right, forward);
+
+    // Meia largura da secção do cone tangente à esfera, no plano que passa pelo centro
+    float halfSize = Radius * dist / sqrt(max(dist * dist - Radius * Radius, 1e-6));
+
+    vQuadEyeSpace = center + (right * corner.x + up * corner.y) * halfSize;
+    vCenterEyeSpace = center;
+    vDrawID = aDrawID;
+
+    gl_Position = Projection * vec4(vQuadEyeSpace, 1.0);
+}
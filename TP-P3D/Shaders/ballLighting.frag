@@ -0,0 +1,287 @@
+#version 440 core
+
+// Iluminação e amostragem das texturas das bolas, partilhadas pelo shader da malha (ball.frag) e pelo dos impostores
+// (ballImpostor.frag).
+// Este ficheiro é ligado como um segundo objeto de fragment shader em cada um desses programas.
+
+struct AmbientLight {
+  vec3 ambient;
+};
+
+struct DirectionalLight {
+  vec3 direction;
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+};
+
+// Luz pontual no espaço da câmera (layout std430 de PointLightBlock); range é o raio de alcance
+struct PointLight {
+  vec3 position;
+  float range;
+  vec3 ambient;
+  float constant;
+  vec3 diffuse;
+  float linear;
+  vec3 specular;
+  float quadratic;
+};
+
+struct SpotLight {
+  vec3 position;
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+  float constant;
+  float linear;
+  float quadratic;
+  float spotCutoff;
+  float spotExponent;
+  vec3 spotDirection;
+};
+
+struct Material {
+  vec3 emissive;
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+  float shininess;
+};
+
+// Níveis carregados da textura de uma bola (layout std430 de TextureResidencyBlock)
+struct TextureResidency {
+  int detailLayer;      // Camada em DetailSampler com os níveis detalhados (-1 se nenhum)
+  float detailMinLevel; // Nível mais detalhado carregado nessa camada
+  float tailFirstLevel; // Nível da textura completa que corresponde ao nível 0 de TexSampler
+  float pad;
+};
+
+// Blocos de uniforms escritos pela CPU no FrameUploadBuffer (layout em UniformBlocks.h)
+layout(std140, binding = 0) uniform CameraData {
+  mat4 View;
+  mat4 Projection;
+};
+
+layout(std140, binding = 1) uniform LightData {
+  AmbientLight ambientLight;
+  DirectionalLight directionalLight;
+  SpotLight spotLight;
+  uvec3 clusterGrid;
+  uint pointLightCount;
+  vec2 clusterTileSize;
+  float clusterScale;
+  float clusterBias;
+  mat4 shadowMatrix[2];
+  mat4 clusterProjection; // Projeção dos clusters, que com MultiView cobre a mesa inteira
+};
+
+// Mapas de sombras das luzes direcional (camada 0) e spot (camada 1), desenhados por ShadowMaps
+layout(binding = 1) uniform sampler2DArrayShadow ShadowMap;
+
+// Luzes pontuais do quadro e a sua atribuição aos clusters, construídas pela CPU (LightClusters)
+layout(std430, binding = 5) readonly buffer PointLightData {
+  PointLight pointLights[];
+};
+
+// Primeiro índice e número de luzes de cada cluster
+layout(std430, binding = 6) readonly buffer ClusterData {
+  uvec2 clusters[];
+};
+
+layout(std430, binding = 7) readonly buffer LightIndexData {
+  uint lightIndices[];
+};
+
+// Materiais de todos os objetos da cena, num buffer estático (indexados por Object.MaterialIndex)
+layout(std430, binding = 3) readonly buffer MaterialData {
+  Material materials[];
+};
+
+// Mipmaps menos detalhados de todas as bolas (sempre carregados), uma camada por bola, e níveis detalhados das bolas
+// que os pediram, numa camada do conjunto de TextureResidency
+uniform sampler2DArray TexSampler;
+layout(binding = 2) uniform sampler2DArray DetailSampler;
+
+// Camada do conjunto e níveis carregados de cada bola (indexados pela camada da bola), escritos em cada quadro
+layout(std430, binding = 8) readonly buffer TextureResidencyData {
+  TextureResidency residency[];
+};
+
+// Posição da câmera que vê o fragmento, no espaço da câmera principal: a origem, ou a câmera da vista com MultiView
+#ifdef MULTI_VIEW
+flat in vec3 vEyePosition;
+#define EYE_POSITION vEyePosition
+#else
+#define EYE_POSITION vec3(0.0)
+#endif
+
+// Cor das bolas cuja camada ainda não foi carregada (camada PLACEHOLDER_TEXTURE_LAYER)
+const vec3 PLACEHOLDER_COLOR = vec3(0.75);
+
+uint clusterIndex(vec3 position);
+float calcShadow(int layer, vec3 position);
+vec4 calcAmbientLight(AmbientLight light);
+vec4 calcDirectionalLight(DirectionalLight light, out vec4 ambient);
+vec4 calcPointLight(PointLight light, out vec4 ambient);
+vec4 calcSpotLight(SpotLight light, vec3 viewDir, vec3 normal, vec3 fragPos, out vec4 ambientOut);
+
+// Cor da textura de uma bola num ponto. O nível de mipmap é calculado a partir das derivadas das coordenadas, no
+// tamanho da textura completa; os níveis mais detalhados do que tailFirstLevel vêm da camada do conjunto, nunca abaixo
+// do nível mais detalhado já carregado, e os restantes vêm de TexSampler.
+// - uv: coordenadas de textura
+// - uvDx, uvDy: derivadas das coordenadas no ecrã
+// - layer: camada da bola (PLACEHOLDER_TEXTURE_LAYER enquanto os mipmaps menos detalhados não chegam)
+vec3 sampleBall(vec2 uv, vec2 uvDx, vec2 uvDy, int layer) {
+    if (layer < 0)
+        return PLACEHOLDER_COLOR;
+
+    TextureResidency r = residency[layer];
+    vec2 size = vec2(textureSize(TexSampler, 0).xy) * exp2(r.tailFirstLevel);
+    vec2 dx = uvDx * size;
+    vec2 dy = uvDy * size;
+    float lod = max(0.5 * log2(max(dot(dx, dx), dot(dy, dy))), 0.0);
+
+    if (r.detailLayer >= 0 && lod < r.tailFirstLevel)
+        return textureLod(DetailSampler, vec3(uv, r.detailLayer), max(lod, r.detailMinLevel)).rgb;
+    return textureLod(TexSampler, vec3(uv, layer), max(lod - r.tailFirstLevel, 0.0)).rgb;
+}
+
+// Atributos do fragmento a iluminar, definidos por shadeBall (espaço da câmera)
+vec3 diffuseColor;
+vec3 positionEyeSpace;
+vec3 normalEyeSpace;
+Material material;
+
+// Calcula a cor final de um ponto da bola com as luzes ativas (só as da variante são compiladas)
+// - position: posição do ponto no espaço da câmera
+// - normal: normal do ponto no espaço da câmera
+// - baseColor: cor difusa do ponto (amostra da textura)
+// - materialIndex: índice do material da bola em MaterialData
+vec4 shadeBall(vec3 position, vec3 normal, vec3 baseColor, int materialIndex) {
+    material = materials[materialIndex];
+    diffuseColor = baseColor;
+    positionEyeSpace = position;
+    normalEyeSpace = normal;
+
+    vec4 color = vec4(0.0);
+    vec4 ambientTmp;
+
+#ifdef AMBIENT_LIGHT
+    color += calcAmbientLight(ambientLight);
+#endif
+
+#ifdef DIRECTIONAL_LIGHT
+    color += calcDirectionalLight(directionalLight, ambientTmp) * calcShadow(0, positionEyeSpace);
+#endif
+
+#ifdef POINT_LIGHTS
+    // Só as luzes pontuais que tocam o cluster do fragmento
+    uvec2 cluster = clusters[clusterIndex(positionEyeSpace)];
+    for (uint i = 0u; i < cluster.y; ++i) {
+        color += calcPointLight(pointLights[lightIndices[cluster.x + i]], ambientTmp);
+    }
+#endif
+
+#ifdef SPOT_LIGHT
+    color += calcSpotLight(spotLight, normalize(EYE_POSITION - positionEyeSpace), normalize(normalEyeSpace), positionEyeSpace, ambientTmp) * calcShadow(1, positionEyeSpace);
+#endif
+
+    return color;
+}
+
+// Cluster de um fragmento: bloco do ecrã a partir de gl_FragCoord e fatia a partir da profundidade
+// (a mesma divisão usada por LightClusters na CPU). Com MultiView, o fragmento pode estar noutra vista: o bloco vem da
+// projeção dos clusters e os fragmentos fora do seu volume usam o cluster extra, que tem todas as luzes.
+uint clusterIndex(vec3 position) {
+#ifdef MULTI_VIEW
+    vec4 clip = clusterProjection * vec4(position, 1.0);
+    if (clip.w <= 0.0 || any(greaterThan(abs(clip.xyz), vec3(clip.w))))
+        return clusterGrid.x * clusterGrid.y * clusterGrid.z;
+    uvec2 tile = min(uvec2((clip.xy / clip.w * 0.5 + 0.5) * vec2(clusterGrid.xy)), clusterGrid.xy - 1u);
+#else
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterTileSize), clusterGrid.xy - 1u);
+#endif
+    uint slice = uint(clamp(log(-position.z) * clusterScale + clusterBias, 0.0, float(clusterGrid.z - 1u)));
+    return tile.x + clusterGrid.x * (tile.y + clusterGrid.y * slice);
+}
+
+// Fração da luz (0 a 1) que chega a um ponto, lida do mapa de sombras de uma luz.
+// Os pontos fora do volume do mapa não têm sombra.
+float calcShadow(int layer, vec3 position) {
+    vec4 shadowCoord = shadowMatrix[layer] * vec4(position, 1.0);
+    shadowCoord.xyz /= shadowCoord.w;
+    if (any(lessThan(shadowCoord.xyz, vec3(0.0))) || any(greaterThan(shadowCoord.xyz, vec3(1.0))))
+        return 1.0;
+    return texture(ShadowMap, vec4(shadowCoord.xy, float(layer), shadowCoord.z));
+}
+
+vec4 calcAmbientLight(AmbientLight light) {
+    return vec4(diffuseColor * light.ambient, 1.0);
+}
+
+vec4 calcDirectionalLight(DirectionalLight light, out vec4 ambient) {
+    ambient = vec4(material.ambient * light.ambient, 1.0);
+
+    vec3 lightDirectionEyeSpace = (View * vec4(light.direction, 0.0)).xyz;
+    vec3 L = normalize(-lightDirectionEyeSpace);
+    vec3 N = normalize(normalEyeSpace);
+    float NdotL = max(dot(N, L), 0.0);
+    vec4 diffuse = vec4(diffuseColor * light.diffuse, 1.0) * NdotL;
+
+    vec3 V = normalize(EYE_POSITION - positionEyeSpace);
+    vec3 R = reflect(-L, N);
+    float RdotV = max(dot(R, V), 0.0);
+    vec4 specular = pow(RdotV, material.shininess) * vec4(light.specular * material.specular, 1.0);
+
+    return diffuse + specular;
+}
+
+vec4 calcPointLight(PointLight light, out vec4 ambientOut) {
+    // A luz apaga-se suavemente até ao raio de alcance, para que os clusters fora dele possam ignorá-la
+    float distance = length(light.position - positionEyeSpace);
+    float window = pow(clamp(1.0 - pow(distance / light.range, 4.0), 0.0, 1.0), 2.0);
+
+    ambientOut = window * vec4(material.ambient * light.ambient, 1.0);
+
+    vec3 lightDirection = normalize(light.position - positionEyeSpace);
+    float NdotL = max(dot(normalEyeSpace, lightDirection), 0.0);
+    vec4 diffuse = vec4(diffuseColor * light.diffuse, 1.0) * NdotL;
+
+    vec3 viewDirection = normalize(EYE_POSITION - positionEyeSpace);
+    vec3 reflectDirection = reflect(-lightDirection, normalEyeSpace);
+    float RdotV = max(dot(reflectDirection, viewDirection), 0.0);
+    vec4 specular = pow(RdotV, material.shininess) * vec4(light.specular * material.specular, 1.0);
+
+    float attenuation = window / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    vec4 lightColor = attenuation * (diffuse + specular);
+    return lightColor + ambientOut;
+}
+
+vec4 calcSpotLight(SpotLight light, vec3 viewDir, vec3 normal, vec3 fragPos, out vec4 ambientOut) {
+    ambientOut = vec4(material.ambient * light.ambient, 1.0);
+
+    vec3 lightPositionEyeSpace = (View * vec4(light.position, 1.0)).xyz;
+    vec3 L = normalize(lightPositionEyeSpace - fragPos);
+
+    vec3 spotDirectionEyeSpace = (View * vec4(light.spotDirection, 0.0)).xyz;
+    float spotEffect = dot(normalize(spotDirectionEyeSpace), -L);
+
+    if (spotEffect > cos(light.spotCutoff)) {
+        float NdotL = max(dot(normal, L), 0.0);
+        vec4 diffuse = vec4(diffuseColor * light.diffuse, 1.0) * NdotL;
+
+        vec3 V = normalize(viewDir);
+        vec3 R = reflect(-L, normal);
+        float RdotV = max(dot(R, V), 0.0);
+        vec4 specular = pow(RdotV, material.shininess) * vec4(light.specular * material.specular, 1.0);
+
+        float dist = length(lightPositionEyeSpace - fragPos);
+        float attenuation = 1.0 / (light.constant + light.linear * dist + light.quadratic * (dist * dist));
+
+        return attenuation * (diffuse + specular);
+    } else {
+        return vec4(0.0);
+    }
+}
+
@@ -0,0 +1,5 @@
+#version 440 core
+
+// Os mapas de sombras só guardam a profundidade, escrita pela rasterização
+void main() {
+}
@@ -0,0 +1,43 @@
+#version 440 core
+
+// Profundidade dos objetos vistos de uma luz, para os mapas de sombras (ShadowMaps)
+
+layout(location = 0) in vec3 aPosition; // Posição do vértice, normalizada dentro da caixa envolvente da malha
+layout(location = 3) in uint aDrawID;   // Índice do objeto nos dados do lote
+
+// Nos mapas de sombras, View é a matriz da luz e Projection é a identidade
+layout(std140, binding = 0) uniform CameraData {
+    mat4 View;
+    mat4 Projection;
+};
+
+struct Object {
+    mat4 Model;
+    mat4 ModelView;
+    mat3 NormalMatrix;
+    float Radius;
+    int TextureLayer;
+    int MaterialIndex;
+    int MeshIndex;
+};
+
+struct Mesh {
+    vec3 PositionOffset; // Canto mínimo da caixa envolvente da malha
+    vec3 PositionScale;  // Tamanho da caixa envolvente
+};
+
+layout(std430, binding = 2) readonly buffer ObjectData {
+    Object objects[];
+};
+
+layout(std430, binding = 4) readonly buffer MeshData {
+    Mesh meshes[];
+};
+
+void main() {
+    Mesh mesh = meshes[objects[aDrawID].MeshIndex];
+    vec3 position = mesh.PositionOffset + aPosition * mesh.PositionScale;
+
+    // Só produtos matriz-vetor por vértice
+    gl_Position = Projection * (View * (objects[aDrawID].Model * vec4(position, 1.0)));
+}
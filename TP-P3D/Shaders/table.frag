@@ -4,12 +4,7 @@ out vec4 FragColor; // Saída da cor do fragmento
 
 in vec3 vs_normal;  // Normal interpolada do vértice
 in vec3 vs_position; // Posição interpolada do vértice
-
-// Uniforms para habilitar/desabilitar tipos de luz
-uniform bool ambientLightEnabled;
-uniform bool directionalLightEnabled;
-uniform bool pointLightEnabled; // Apenas uma fonte de luz pontual
-uniform bool spotLightEnabled;
+flat in int vMaterialIndex; // Índice do material da mesa
 
 // Cor fixa da mesa
 const vec3 mesaColor = vec3(0.0, 0.4, 0.0); // Cor verde
@@ -18,7 +13,6 @@ const vec3 mesaColor = vec3(0.0, 0.4, 0.0); // Cor verde
 struct AmbientLight {
   vec3 ambient; // Componente de luz ambiente global
 };
-uniform AmbientLight ambientLight; // Fonte de luz ambiente global
 
 // Estrutura de uma fonte de luz direcional
 struct DirectionalLight {
@@ -27,19 +21,18 @@ struct DirectionalLight {
   vec3 diffuse; // Componente de luz difusa
   vec3 specular; // Componente de luz especular
 };
-uniform DirectionalLight directionalLight; // Fonte de luz direcional
 
-// Estrutura de uma fonte de luz pontual
+// Estrutura de uma fonte de luz pontual (layout std430 de PointLightBlock)
 struct PointLight {
-  vec3 position; // Posição do luz pontual, espaço do mundo
+  vec3 position; // Posição do luz pontual, espaço da câmera
+  float range; // Raio de alcance da luz
   vec3 ambient; // Componente de luz ambiente
-  vec3 diffuse; // Componente de luz difusa
-  vec3 specular; // Componente de luz especular
   float constant; // Coeficiente de atenuação constante
+  vec3 diffuse; // Componente de luz difusa
   float linear; // Coeficiente de atenuação linear
+  vec3 specular; // Componente de luz especular
   float quadratic; // Coeficiente de atenuação quadrática
 };
-uniform PointLight pointLight; // Apenas uma fonte de luz pontual
 
 // Estrutura de uma fonte de luz cônica
 struct SpotLight {
@@ -54,19 +47,77 @@ struct SpotLight {
   float exponent; // Expoente do foco de luz
   vec3 direction; // Direção do foco de luz
 };
-uniform SpotLight spotLight; // Fonte de luz cônica
 
 // Estrutura do material
 struct Material {
+  vec3 emissive;
   vec3 ambient;
   vec3 diffuse;
   vec3 specular;
   float shininess;
 };
-uniform Material material;
 
-// Uniform para a matriz de visualização
-uniform mat4 view;
+// Matrizes da câmera, escritas uma vez por quadro
+layout(std140, binding = 0) uniform CameraData {
+  mat4 View;
+  mat4 Projection;
+};
+
+// Luzes da mesa (o mesmo layout das bolas)
+layout(std140, binding = 1) uniform LightData {
+  AmbientLight ambientLight; // Fonte de luz ambiente global
+  DirectionalLight directionalLight; // Fonte de luz direcional
+  SpotLight spotLight; // Fonte de luz cônica
+  uvec3 clusterGrid; // Número de clusters em x, y e z
+  uint pointLightCount; // Número de luzes pontuais do quadro
+  vec2 clusterTileSize; // Tamanho de cada cluster no ecrã, em píxeis
+  float clusterScale; // Fatia = log(profundidade) * clusterScale + clusterBias
+  float clusterBias;
+  mat4 shadowMatrix[2]; // Do espaço da câmera para as coordenadas dos mapas de sombras
+  mat4 clusterProjection; // Projeção dos clusters, que com MultiView cobre a mesa inteira
+};
+
+// Posição da câmera que vê o fragmento, no espaço da câmera principal: a origem, ou a câmera da vista com MultiView
+#ifdef MULTI_VIEW
+flat in vec3 vEyePosition;
+#define EYE_POSITION vEyePosition
+#else
+#define EYE_POSITION vec3(0.0)
+#endif
+
+// Mapas de sombras das luzes direcional (camada 0) e spot (camada 1)
+layout(binding = 1) uniform sampler2DArrayShadow ShadowMap;
+
+// Luzes pontuais do quadro, no espaço da câmera
+layout(std430, binding = 5) readonly buffer PointLightData {
+  PointLight pointLights[];
+};
+
+// Primeiro índice e número de luzes de cada cluster
+layout(std430, binding = 6) readonly buffer ClusterData {
+  uvec2 clusters[];
+};
+
+// Índices das luzes de todos os clusters, seguidos
+layout(std430, binding = 7) readonly buffer LightIndexData {
+  uint lightIndices[];
+};
+
+// Materiais de todos os objetos da cena, num buffer estático
+layout(std430, binding = 3) readonly buffer MaterialData {
+  Material materials[];
+};
+
+Material material; // Material da mesa, lido em main
+
+// Função para calcular a fração da luz que chega ao fragmento, lida do mapa de sombras de uma luz
+float calcShadow(int layer) {
+  vec4 shadowCoord = shadowMatrix[layer] * vec4(vs_position, 1.0);
+  shadowCoord.xyz /= shadowCoord.w;
+  if (any(lessThan(shadowCoord.xyz, vec3(0.0))) || any(greaterThan(shadowCoord.xyz, vec3(1.0))))
+    return 1.0; // Fora do volume do mapa não há sombra
+  return texture(ShadowMap, vec4(shadowCoord.xy, float(layer), shadowCoord.z));
+}
 
 // Função para calcular a contribuição da luz ambiente
 vec4 calcAmbientLight(AmbientLight light) {
@@ -77,11 +128,11 @@ vec4 calcAmbientLight(AmbientLight light) {
 vec4 calcDirectionalLight(DirectionalLight light, out vec4 ambientOut) {
   ambientOut = vec4(light.ambient, 1.0) * vec4(mesaColor, 1.0); // Cálculo da luz ambiente
 
-  vec3 L = normalize(-light.direction); // Direção inversa à da luz
+  vec3 L = normalize(-(View * vec4(light.direction, 0.0)).xyz); // Direção inversa à da luz, no espaço da câmera
   float NdotL = max(dot(vs_normal, L), 0.0); // Produto escalar entre a normal e a direção da luz
   vec4 diffuse = vec4(light.diffuse, 1.0) * NdotL * vec4(mesaColor, 1.0); // Cálculo da luz difusa
 
-  vec3 V = normalize(-vs_position); // Vetor de visualização apontando para a câmera
+  vec3 V = normalize(EYE_POSITION - vs_position); // Vetor de visualização apontando para a câmera
   vec3 R = reflect(-L, vs_normal); // Vetor de reflexão
   float RdotV = max(dot(R, V), 0.0); // Produto escalar entre a reflexão e o vetor de visualização
   vec4 specular = vec4(light.specular, 1.0) * pow(RdotV, material.shininess) * vec4(mesaColor, 1.0); // Cálculo da luz especular
@@ -89,23 +140,39 @@ vec4 calcDirectionalLight(DirectionalLight light, out vec4 ambientOut) {
   return (diffuse + specular);
 }
 
+// Função para encontrar o cluster do fragmento (a mesma divisão usada por LightClusters na CPU). Com MultiView, o bloco
+// vem da projeção dos clusters, e os fragmentos fora do seu volume usam o cluster extra, com todas as luzes
+uint clusterIndex() {
+#ifdef MULTI_VIEW
+  vec4 clip = clusterProjection * vec4(vs_position, 1.0);
+  if (clip.w <= 0.0 || any(greaterThan(abs(clip.xyz), vec3(clip.w))))
+    return clusterGrid.x * clusterGrid.y * clusterGrid.z;
+  uvec2 tile = min(uvec2((clip.xy / clip.w * 0.5 + 0.5) * vec2(clusterGrid.xy)), clusterGrid.xy - 1u);
+#else
+  uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterTileSize), clusterGrid.xy - 1u);
+#endif
+  uint slice = uint(clamp(log(-vs_position.z) * clusterScale + clusterBias, 0.0, float(clusterGrid.z - 1u)));
+  return tile.x + clusterGrid.x * (tile.y + clusterGrid.y * slice);
+}
+
 // Função para calcular a contribuição da luz pontual
 vec4 calcPointLight(PointLight light, out vec4 ambientOut) {
-  ambientOut = vec4(light.ambient, 1.0) * vec4(mesaColor, 1.0);
+  float dist = length(light.position - vs_position);
+  float window = pow(clamp(1.0 - pow(dist / light.range, 4.0), 0.0, 1.0), 2.0); // Apaga a luz até ao raio de alcance
 
-  vec3 lightPositionEyeSpace = (view * vec4(light.position, 1.0)).xyz;
-  vec3 L = normalize(lightPositionEyeSpace - vs_position);
+  ambientOut = window * vec4(light.ambient, 1.0) * vec4(mesaColor, 1.0);
+
+  vec3 L = normalize(light.position - vs_position);
   vec3 N = normalize(vs_normal);
   float NdotL = max(dot(N, L), 0.0);
   vec4 diffuse = vec4(light.diffuse, 1.0) * NdotL * vec4(mesaColor, 1.0);
 
-  vec3 V = normalize(-vs_position);
+  vec3 V = normalize(EYE_POSITION - vs_position);
   vec3 R = reflect(-L, N);
   float RdotV = max(dot(R, V), 0.0);
   vec4 specular = vec4(light.specular, 1.0) * pow(RdotV, material.shininess) * vec4(mesaColor, 1.0);
 
-  float dist = length(lightPositionEyeSpace - vs_position);
-  float attenuation = 1.0 / (light.constant + light.linear * dist + light.quadratic * (dist * dist));
+  float attenuation = window / (light.constant + light.linear * dist + light.quadratic * (dist * dist));
 
   return attenuation * (diffuse + specular);
 }
@@ -114,17 +181,18 @@ vec4 calcPointLight(PointLight light, out vec4 ambientOut) {
 vec4 calcSpotLight(SpotLight light, out vec4 ambientOut) {
   ambientOut = vec4(light.ambient, 1.0) * vec4(mesaColor, 1.0);
 
-  vec3 lightPositionEyeSpace = (view * vec4(light.position, 1.0)).xyz;
+  vec3 lightPositionEyeSpace = (View * vec4(light.position, 1.0)).xyz;
   vec3 L = normalize(lightPositionEyeSpace - vs_position);
 
-  float spotEffect = dot(normalize(light.direction), -L);
+  vec3 directionEyeSpace = (View * vec4(light.direction, 0.0)).xyz;
+  float spotEffect = dot(normalize(directionEyeSpace), -L);
 
   if (spotEffect > cos(light.cutoff)) {
     vec3 N = normalize(vs_normal);
     float NdotL = max(dot(N, L), 0.0);
     vec4 diffuse = vec4(light.diffuse, 1.0) * NdotL * vec4(mesaColor, 1.0);
 
-    vec3 V = normalize(-vs_position);
+    vec3 V = normalize(EYE_POSITION - vs_position);
     vec3 R = reflect(-L, N);
     float RdotV = max(dot(R, V), 0.0);
     vec4 specular = vec4(light.specular, 1.0) * pow(RdotV, material.shininess) * vec4(mesaColor, 1.0);
@@ -139,28 +207,34 @@ vec4 calcSpotLight(SpotLight light, out vec4 ambientOut) {
 }
 
 void main() {
-  vec4 ambient = vec4(0.0);
-  vec4 light[3] = {vec4(0.0), vec4(0.0), vec4(0.0)};
-  vec4 ambientTmp;
-
-  if (ambientLightEnabled) {
-    ambient += calcAmbientLight(ambientLight);
-  }
+  material = materials[vMaterialIndex];
 
-  if (directionalLightEnabled) {
-    light[0] = calcDirectionalLight(directionalLight, ambientTmp);
-    ambient += ambientTmp;
-  }
+  // Só as luzes da variante são compiladas; a componente ambiente de cada luz também é somada
+  vec4 color = vec4(0.0);
+  vec4 ambientTmp;
 
-  if (pointLightEnabled) {
-    light[1] = calcPointLight(pointLight, ambientTmp);
-    ambient += ambientTmp;
+#ifdef AMBIENT_LIGHT
+  color += calcAmbientLight(ambientLight);
+#endif
+
+#ifdef DIRECTIONAL_LIGHT
+  color += calcDirectionalLight(directionalLight, ambientTmp) * calcShadow(0);
+  color += ambientTmp;
+#endif
+
+#ifdef POINT_LIGHTS
+  // Só as luzes pontuais que tocam o cluster do fragmento
+  uvec2 cluster = clusters[clusterIndex()];
+  for (uint i = 0u; i < cluster.y; ++i) {
+    color += calcPointLight(pointLights[lightIndices[cluster.x + i]], ambientTmp);
+    color += ambientTmp;
   }
+#endif
 
-  if (spotLightEnabled) {
-    light[2] = calcSpotLight(spotLight, ambientTmp);
-    ambient += ambientTmp;
-  }
+#ifdef SPOT_LIGHT
+  color += calcSpotLight(spotLight, ambientTmp) * calcShadow(1);
+  color += ambientTmp;
+#endif
 
-  FragColor = ambient + light[0] + light[1] + light[2];
+  FragColor = color;
 }
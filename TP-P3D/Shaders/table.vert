@@ -1,21 +1,88 @@
 #version 440 core
+#ifdef MULTI_VIEW
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
 
-layout (location = 0) in vec3 position;  // Posio do vrtice
+layout (location = 0) in vec3 packedPosition; // Posio do vrtice, normalizada dentro da caixa envolvente da malha
 layout (location = 1) in vec3 normal;   // Normal do vrtice
 layout (location = 2) in vec2 texCoord;  // Coordenada de textura do vrtice
+layout (location = 3) in uint drawID;    // ndice do objeto nos dados do lote
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 proj;
+layout(std140, binding = 0) uniform CameraData {
+  mat4 View;
+  mat4 Projection;
+};
+
+struct Object {
+  mat4 Model;
+  mat4 ModelView;
+  mat3 NormalMatrix; // Inversa transposta da modelo-vista, calculada uma vez por objeto na CPU
+  float Radius;
+  int TextureLayer;
+  int MaterialIndex;
+  int MeshIndex;
+};
+
+struct Mesh {
+  vec3 PositionOffset; // Canto mnimo da caixa envolvente da malha
+  vec3 PositionScale;  // Tamanho da caixa envolvente
+};
+
+layout(std430, binding = 2) readonly buffer ObjectData {
+  Object objects[];
+};
+
+// Caixas envolventes das malhas, para recuperar as posies comprimidas em 16 bits
+layout(std430, binding = 4) readonly buffer MeshData {
+  Mesh meshes[];
+};
+
+#ifdef MULTI_VIEW
+struct ViewTransform {
+  mat4 ClipFromEye; // Do espao da cmera principal para o espao de recorte da vista
+  vec4 EyePosition; // Posio da cmera da vista no espao da cmera principal
+};
+
+// Vistas desenhadas na mesma passagem (MultiView): cada objeto tem uma instncia por vista
+layout(std140, binding = 9) uniform MultiViewData {
+  ViewTransform views[4];
+  uint ViewCount;
+};
+
+flat out vec3 vEyePosition; // Posio da cmera da vista, para a iluminao especular
+#endif
 
 out vec3 vs_normal;    // Normal para o fragment shader
 out vec3 vs_position;   // Posio para o fragment shader
 out vec2 textureCoord;   // Coordenada de textura para o fragment shader
+flat out int vMaterialIndex; // ndice do material para o fragment shader
 
 void main()
 {
-  gl_Position = proj * view * model * vec4(position, 1.0);
-  vs_normal = mat3(transpose(inverse(model))) * normal;
-  vs_position = vec3(view * model * vec4(position, 1.0));
+#ifdef MULTI_VIEW
+  // O atributo  objeto * ViewCount + vista (IndirectBatch)
+  uint objectIndex = drawID / ViewCount;
+  uint view = drawID % ViewCount;
+#else
+  uint objectIndex = drawID;
+#endif
+
+  mat4 Model = objects[objectIndex].Model;
+  mat4 ModelView = objects[objectIndex].ModelView;
+
+  Mesh mesh = meshes[objects[objectIndex].MeshIndex];
+  vec3 position = mesh.PositionOffset + packedPosition * mesh.PositionScale;
+
+  vec4 positionEyeSpace = ModelView * vec4(position, 1.0);
+#ifdef MULTI_VIEW
+  gl_ViewportIndex = int(view);
+  gl_Position = views[view].ClipFromEye * positionEyeSpace;
+  vEyePosition = views[view].EyePosition.xyz;
+#else
+  gl_Position = Projection * positionEyeSpace;
+#endif
+  vs_normal = normalize(objects[objectIndex].NormalMatrix * normal); // Normal no espao da cmera, como a posio
+  vs_position = positionEyeSpace.xyz;
   textureCoord = texCoord;
+  vMaterialIndex = objects[objectIndex].MaterialIndex;
 }
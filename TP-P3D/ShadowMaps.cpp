@@ -0,0 +1,441 @@
+﻿/*****************************************************************************
+ * ShadowMaps.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe ShadowMaps, os mapas de sombras das luzes direcional e spot.
+ * A classe ShadowMaps é responsável por:
+ * - Criar um array de texturas de profundidade com uma camada por luz e o framebuffer usado para as desenhar.
+ * - Guardar a profundidade dos objetos parados (a mesa e as bolas paradas) num mapa que só é desenhado de novo
+ *   quando uma luz se move, quando ToggleLight muda o estado das luzes ou quando uma bola começa ou deixa de se mover.
+ * - Em cada quadro, copiar o mapa guardado e desenhar por cima apenas as bolas em movimento (modo CACHED), ou
+ *   desenhar todos os objetos (modo FULL_REDRAW), para comparar o custo dos dois modos.
+ * - Medir o tempo de CPU e de GPU (consultas GL_TIME_ELAPSED) gasto nos mapas.
+ *
+ * Funções principais:
+ * - ShadowMaps(): Construtor da classe ShadowMaps.
+ * - ~ShadowMaps(): Destrutor, que liberta as texturas, o framebuffer e as consultas.
+ * - Create(GLuint shadowProgram): Cria as texturas de profundidade e o framebuffer.
+ * - Render(...): Atualiza os mapas das luzes ativas.
+ * - ToggleMode(): Alterna entre os modos CACHED e FULL_REDRAW.
+ * - ResetStats(): Recomeça a contagem do custo.
+ *
+ * Variáveis e constantes importantes:
+ * - SIZE: Largura e altura de cada mapa, em píxeis.
+ * - TEXTURE_UNIT: Unidade de textura onde os shaders leem os mapas.
+ * - staticMap: Profundidade dos objetos parados, guardada entre quadros.
+ * - dynamicMap: Mapa do quadro com os objetos em movimento (ou com todos os objetos em FULL_REDRAW).
+ * - stats: Tempo de CPU e de GPU e número de vezes que o mapa guardado foi desenhado.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <chrono>
+
+#include "ShadowMaps.h"
+
+// Deslocamento da profundidade ao desenhar os mapas, para evitar que as superfícies se sombreiem a si próprias
+static const GLfloat SHADOW_OFFSET_FACTOR = 2.0f;
+static const GLfloat SHADOW_OFFSET_UNITS = 4.0f;
+
+
+/*****************************************************************************
+ * ShadowMaps::ShadowMaps()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `ShadowMaps`. As texturas são criadas em `Create`, depois
+ * de o contexto OpenGL existir.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+ShadowMaps::ShadowMaps()
+	: program(0),
+	framebuffer(0),
+	staticMap(0),
+	dynamicMap(0),
+	sampledMap(0),
+	mode(CACHED),
+	staticValid(false),
+	lightVersion(0),
+	queryIndex(0) {
+	for (GLuint i = 0; i < QUERY_COUNT; i++) {
+		queries[i] = 0;
+		queryPending[i] = false;
+	}
+	ResetStats();
+}
+
+
+/*****************************************************************************
+ * ShadowMaps::~ShadowMaps()
+ *
+ * Descrição:
+ * ----------
+ * Destrutor da classe `ShadowMaps`, que liberta as texturas, o framebuffer e as
+ * consultas de tempo.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (destrutor).
+ *
+ ******************************************************************************/
+ShadowMaps::~ShadowMaps() {
+	glDeleteQueries(QUERY_COUNT, queries);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteTextures(1, &staticMap);
+	glDeleteTextures(1, &dynamicMap);
+}
+
+
+/*****************************************************************************
+ * GLuint ShadowMaps::CreateDepthArray() const
+ *
+ * Descrição:
+ * ----------
+ * Cria um array de texturas de profundidade com uma camada por luz. A comparação
+ * com a profundidade do fragmento é feita pelo amostrador (sampler2DArrayShadow),
+ * com filtragem linear entre os 4 texels vizinhos. Fora do mapa a profundidade é
+ * 1, ou seja, sem sombra.
+ *
+ * Retorno:
+ * --------
+ * - GLuint: A textura criada.
+ *
+ ******************************************************************************/
+GLuint ShadowMaps::CreateDepthArray() const {
+	const GLfloat border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, SIZE, SIZE, Lights::SHADOW_LIGHT_COUNT);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+	return texture;
+}
+
+
+/*****************************************************************************
+ * bool ShadowMaps::Create(GLuint shadowProgram)
+ *
+ * Descrição:
+ * ----------
+ * Cria os dois arrays de profundidade (guardado e do quadro), o framebuffer sem
+ * cor usado para os desenhar e as consultas de tempo.
+ *
+ * Parâmetros:
+ * -----------
+ * - shadowProgram: O programa que desenha a profundidade (shadow.vert/shadow.frag).
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se o framebuffer estiver completo, `false` caso contrário.
+ *
+ ******************************************************************************/
+bool ShadowMaps::Create(GLuint shadowProgram) {
+	program = shadowProgram;
+
+	staticMap = CreateDepthArray();
+	dynamicMap = CreateDepthArray();
+	sampledMap = staticMap;
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, staticMap, 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "Shadow map framebuffer is incomplete (0x" << std::hex << status << std::dec << ")" << std::endl;
+		return false;
+	}
+
+	glGenQueries(QUERY_COUNT, queries);
+
+	std::cout << "Shadow maps: " << Lights::SHADOW_LIGHT_COUNT << " x " << SIZE << "x" << SIZE << ", cached" << std::endl;
+	return true;
+}
+
+
+/*****************************************************************************
+ * bool ShadowMaps::IsStaticValid(const Lights& lights, const std::vector<ShadowCaster>& casters) const
+ *
+ * Descrição:
+ * ----------
+ * Verifica se o mapa guardado ainda corresponde à cena: as luzes não mudaram de
+ * estado (ToggleLight), as matrizes das luzes são as mesmas (nenhuma luz se moveu
+ * em relação à mesa) e o conjunto de objetos parados é o mesmo.
+ *
+ * Parâmetros:
+ * -----------
+ * - lights: As luzes da cena.
+ * - casters: Os objetos que projetam sombras no quadro atual.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se o mapa guardado puder ser reutilizado.
+ *
+ ******************************************************************************/
+bool ShadowMaps::IsStaticValid(const Lights& lights, const std::vector<ShadowCaster>& casters) const {
+	if (!staticValid || lightVersion != lights.GetStateVersion() || staticMask.size() != casters.size())
+		return false;
+
+	for (int i = 0; i < Lights::SHADOW_LIGHT_COUNT; i++)
+		if (lightViewProjection[i] != lights.GetShadowViewProjection(i))
+			return false;
+
+	for (size_t i = 0; i < casters.size(); i++)
+		if ((staticMask[i] != 0) != casters[i].isStatic)
+			return false;
+
+	return true;
+}
+
+
+/*****************************************************************************
+ * void ShadowMaps::DrawLayers(const Lights& lights, GLuint target, bool clear,
+ * FrameUploadBuffer& uploadBuffer, GLStateCache& cache)
+ *
+ * Descrição:
+ * ----------
+ * Desenha o lote atual na camada de cada luz ativa de um array de profundidade.
+ * A matriz da luz é enviada como bloco CameraData (vista = matriz da luz,
+ * projeção = identidade), por isso o programa das sombras usa o mesmo bloco que
+ * os outros shaders.
+ *
+ * Parâmetros:
+ * -----------
+ * - lights: As luzes da cena.
+ * - target: O array de profundidade onde desenhar.
+ * - clear: Indica se cada camada é limpa antes de desenhar.
+ * - uploadBuffer: O buffer do quadro.
+ * - cache: A cache do estado OpenGL.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void ShadowMaps::DrawLayers(const Lights& lights, GLuint target, bool clear, FrameUploadBuffer& uploadBuffer, GLStateCache& cache) {
+	for (int i = 0; i < Lights::SHADOW_LIGHT_COUNT; i++) {
+		if (!lights.IsShadowLightEnabled(i))
+			continue;
+
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, 0, i);
+		if (clear)
+			glClear(GL_DEPTH_BUFFER_BIT);
+
+		if (batch.Size() == 0)
+			continue;
+
+		CameraBlock lightCamera;
+		lightCamera.view = lights.GetShadowViewProjection(i);
+		lightCamera.projection = glm::mat4(1.0f);
+		uploadBuffer.Upload(CAMERA_BLOCK_BINDING, lightCamera);
+
+		batch.Submit(uploadBuffer, cache);
+	}
+}
+
+
+/*****************************************************************************
+ * void ShadowMaps::Render(const Lights& lights, const std::vector<ShadowCaster>& casters,
+ * GLuint vertexArray, FrameUploadBuffer& uploadBuffer, GLStateCache& cache)
+ *
+ * Descrição:
+ * ----------
+ * Atualiza os mapas das luzes ativas. No modo CACHED, o mapa guardado só é
+ * desenhado de novo quando deixa de ser válido (`IsStaticValid`); em cada quadro
+ * é copiado para o mapa do quadro e só os objetos em movimento são desenhados por
+ * cima. Se nenhum objeto se mover, os shaders leem diretamente o mapa guardado e
+ * o quadro não desenha nada. No modo FULL_REDRAW todos os objetos são desenhados
+ * em cada quadro.
+ *
+ * Deve ser chamada antes de a câmera do quadro ser escrita no buffer do quadro,
+ * porque usa o bloco CameraData para a matriz de cada luz. O framebuffer e o
+ * viewport são repostos no fim.
+ *
+ * Parâmetros:
+ * -----------
+ * - lights: As luzes da cena (já atualizadas com `Lights::Update`).
+ * - casters: Os objetos que projetam sombras.
+ * - vertexArray: O VAO do buffer de geometria partilhado.
+ * - uploadBuffer: O buffer do quadro.
+ * - cache: A cache do estado OpenGL.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void ShadowMaps::Render(const Lights& lights, const std::vector<ShadowCaster>& casters, GLuint vertexArray, FrameUploadBuffer& uploadBuffer, GLStateCache& cache) {
+	bool anyLight = false;
+	for (int i = 0; i < Lights::SHADOW_LIGHT_COUNT; i++)
+		anyLight = anyLight || lights.IsShadowLightEnabled(i);
+
+	if (!anyLight)
+		return;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	ReadQuery(queryIndex);
+	glBeginQuery(GL_TIME_ELAPSED, queries[queryIndex]);
+
+	// O quadro pode ser desenhado num framebuffer próprio (modo --headless), por isso é esse que é reposto no fim
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	GLint sceneFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &sceneFramebuffer);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, SIZE, SIZE);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(SHADOW_OFFSET_FACTOR, SHADOW_OFFSET_UNITS);
+
+	cache.UseProgram(program);
+	cache.BindVertexArray(vertexArray);
+
+	if (mode == CACHED) {
+		if (!IsStaticValid(lights, casters)) {
+			batch.Clear();
+			staticMask.resize(casters.size());
+			for (size_t i = 0; i < casters.size(); i++) {
+				staticMask[i] = casters[i].isStatic;
+				if (casters[i].isStatic)
+					batch.Add(casters[i].mesh, { casters[i].model });
+			}
+
+			DrawLayers(lights, staticMap, true, uploadBuffer, cache);
+
+			for (int i = 0; i < Lights::SHADOW_LIGHT_COUNT; i++)
+				lightViewProjection[i] = lights.GetShadowViewProjection(i);
+			lightVersion = lights.GetStateVersion();
+			staticValid = true;
+			stats.staticRedraws++;
+		}
+
+		batch.Clear();
+		for (const ShadowCaster& caster : casters)
+			if (!caster.isStatic)
+				batch.Add(caster.mesh, { caster.model });
+
+		if (batch.Size() > 0) {
+			glCopyImageSubData(staticMap, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, dynamicMap, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, SIZE, SIZE, Lights::SHADOW_LIGHT_COUNT);
+			DrawLayers(lights, dynamicMap, false, uploadBuffer, cache);
+			sampledMap = dynamicMap;
+		}
+		else {
+			sampledMap = staticMap;
+		}
+	}
+	else {
+		batch.Clear();
+		for (const ShadowCaster& caster : casters)
+			batch.Add(caster.mesh, { caster.model });
+
+		DrawLayers(lights, dynamicMap, true, uploadBuffer, cache);
+		sampledMap = dynamicMap;
+	}
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	glEndQuery(GL_TIME_ELAPSED);
+	queryPending[queryIndex] = true;
+	queryIndex = (queryIndex + 1) % QUERY_COUNT;
+
+	stats.frames++;
+	stats.cpuTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+/*****************************************************************************
+ * void ShadowMaps::ReadQuery(GLuint index)
+ *
+ * Descrição:
+ * ----------
+ * Soma às estatísticas o tempo de GPU de uma consulta feita QUERY_COUNT quadros
+ * antes. Se o resultado ainda não estiver disponível, a medição é descartada em
+ * vez de esperar pela GPU.
+ *
+ * Parâmetros:
+ * -----------
+ * - index: O índice da consulta.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void ShadowMaps::ReadQuery(GLuint index) {
+	if (!queryPending[index])
+		return;
+
+	queryPending[index] = false;
+
+	GLint available = 0;
+	glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return;
+
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &elapsed);
+	stats.gpuTime += elapsed * 1e-9;
+	stats.gpuSamples++;
+}
+
+
+/*****************************************************************************
+ * void ShadowMaps::ToggleMode()
+ *
+ * Descrição:
+ * ----------
+ * Alterna entre os modos CACHED e FULL_REDRAW e recomeça a contagem do custo,
+ * para que as estatísticas seguintes sejam só do novo modo. O mapa guardado é
+ * invalidado, porque o modo FULL_REDRAW não o mantém.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void ShadowMaps::ToggleMode() {
+	mode = (mode == CACHED) ? FULL_REDRAW : CACHED;
+	staticValid = false;
+	ResetStats();
+
+	std::cout << "Shadow maps: " << (mode == CACHED ? "cached" : "full redraw") << std::endl;
+}
+
+
+/*****************************************************************************
+ * void ShadowMaps::ResetStats()
+ *
+ * Descrição:
+ * ----------
+ * Recomeça a contagem do custo dos mapas.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void ShadowMaps::ResetStats() {
+	stats = {};
+}
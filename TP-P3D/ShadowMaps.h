@@ -0,0 +1,81 @@
+﻿#ifndef SHADOW_MAPS_H
+#define SHADOW_MAPS_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Lights.h"
+#include "GeometryBuffer.h"
+#include "IndirectBatch.h"
+#include "FrameUploadBuffer.h"
+#include "GLStateCache.h"
+
+// Objeto que projeta sombras, no espaço das posições das bolas
+struct ShadowCaster {
+	MeshRange mesh;   // Malha no buffer de geometria partilhado
+	glm::mat4 model;  // Matriz de modelo
+	bool isStatic;    // Objetos parados vão para o mapa guardado; os outros são desenhados em cada quadro
+};
+
+// Mapas de sombras das luzes direcional e spot, com a profundidade dos objetos parados guardada entre quadros
+class ShadowMaps {
+public:
+	static const GLsizei SIZE = 1024;       // Largura e altura de cada mapa, em píxeis
+	static const GLuint TEXTURE_UNIT = 1;   // Unidade de textura lida pelos shaders (layout(binding = 1))
+
+	// Modo de atualização dos mapas
+	enum Mode {
+		CACHED,     // Só os objetos em movimento são desenhados em cada quadro, por cima da cópia do mapa guardado
+		FULL_REDRAW // Todos os objetos são desenhados em cada quadro
+	};
+
+	// Custo acumulado desde o último ResetStats
+	struct Stats {
+		GLuint frames;        // Quadros com pelo menos uma luz com sombras
+		GLuint staticRedraws; // Vezes que o mapa guardado foi desenhado de novo
+		double cpuTime;       // Tempo de CPU gasto nos mapas, em segundos
+		double gpuTime;       // Tempo de GPU medido, em segundos
+		GLuint gpuSamples;    // Quadros com o tempo de GPU já disponível
+	};
+
+	ShadowMaps();
+	~ShadowMaps();
+
+	bool Create(GLuint shadowProgram); // Cria as texturas de profundidade e o framebuffer
+	void Render(const Lights& lights, const std::vector<ShadowCaster>& casters, GLuint vertexArray, FrameUploadBuffer& uploadBuffer, GLStateCache& cache); // Atualiza os mapas das luzes ativas
+	void ToggleMode(); // Alterna entre CACHED e FULL_REDRAW
+
+	GLuint GetTexture() const { return sampledMap; } // Array de profundidade a ler no quadro atual (uma camada por luz)
+	Mode GetMode() const { return mode; }
+	const Stats& GetStats() const { return stats; }
+	void ResetStats(); // Recomeça a contagem do custo
+
+private:
+	static const GLuint QUERY_COUNT = 3; // Consultas de tempo em uso ao mesmo tempo (uma por quadro em voo)
+
+	GLuint program;     // Programa que só escreve a profundidade
+	GLuint framebuffer; // Framebuffer sem cor, com uma camada de um dos arrays de profundidade
+	GLuint staticMap;   // Profundidade dos objetos parados (guardada entre quadros)
+	GLuint dynamicMap;  // Cópia do mapa guardado com os objetos em movimento, ou todos os objetos em FULL_REDRAW
+	GLuint sampledMap;  // staticMap ou dynamicMap, conforme o que foi desenhado no quadro
+
+	Mode mode;
+	bool staticValid;              // Indica se staticMap corresponde ao estado guardado abaixo
+	unsigned int lightVersion;     // Lights::GetStateVersion() quando staticMap foi desenhado
+	glm::mat4 lightViewProjection[Lights::SHADOW_LIGHT_COUNT]; // Matrizes das luzes quando staticMap foi desenhado
+	std::vector<char> staticMask;  // isStatic de cada objeto quando staticMap foi desenhado
+
+	IndirectBatch batch; // Lote reutilizado em cada passagem
+
+	GLuint queries[QUERY_COUNT]; // Consultas GL_TIME_ELAPSED
+	bool queryPending[QUERY_COUNT];
+	GLuint queryIndex;
+	Stats stats;
+
+	GLuint CreateDepthArray() const; // Cria um array de profundidade com uma camada por luz
+	bool IsStaticValid(const Lights& lights, const std::vector<ShadowCaster>& casters) const;
+	void DrawLayers(const Lights& lights, GLuint target, bool clear, FrameUploadBuffer& uploadBuffer, GLStateCache& cache);
+	void ReadQuery(GLuint index); // Soma o tempo de uma consulta terminada às estatísticas
+};
+
+#endif // SHADOW_MAPS_H
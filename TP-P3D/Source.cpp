@@ -10,19 +10,93 @@
  * - Configurar a cãmera e as luzes do jogo.
  * - Criar e carregar os objetos da mesa e das bolas.
  * - Executar o loop principal do jogo, onde as bolas são atualizadas e renderizadas, e a cãmera responde aos comandos do utilizador.
+ * - Recortar as bolas e a mesa que estão fora do volume de visualização da câmera antes de as renderizar.
+ * - Escrever os dados de cada quadro (câmera, luzes e matrizes de cada objeto) num buffer de uniforms mapeado de forma persistente.
+ * - Juntar a geometria, os materiais e as texturas da cena em buffers partilhados, para desenhar as bolas com uma
+ *   única chamada de desenho indireto (glMultiDrawElementsIndirect) por quadro.
+ * - Ordenar os desenhos de cada quadro numa fila (RenderQueue) e fazer as mudanças de estado através de uma cache
+ *   (GLStateCache), mostrando no título da janela quantas ligações foram evitadas.
+ * - Atribuir as luzes pontuais aos clusters do volume de visualização em cada quadro, para que as bolas e a mesa
+ *   só calculem as luzes que tocam cada fragmento.
+ * - Atualizar os mapas de sombras das luzes direcional e spot, desenhando de novo em cada quadro apenas as bolas em
+ *   movimento, e mostrar no título da janela o custo dos mapas no modo atual (guardado ou redesenho completo).
+ * - Carregar as texturas das bolas em segundo plano, para que o desenho comece antes de todas terem chegado.
+ * - Medir as etapas do quadro com o profiler (tecla P) e escrever o traço no formato do Chrome (tecla T).
+ * - Manter a duração pedida para os quadros com o regulador da qualidade (tecla Q, --target-fps N), que baixa a
+ *   resolução interna, o detalhe das bolas e as luzes caras quando os quadros são lentos.
+ * - Com janela, só desenhar quando a cena muda (câmera, luzes, bolas em movimento, texturas a chegar ou eventos) e,
+ *   com a cena parada, esperar por eventos com glfwWaitEventsTimeout em vez de desenhar sempre o mesmo quadro.
+ * - Gravar os quadros desenhados (tecla V, ou --capture no modo --headless) em PNG, YUV ou com o ffmpeg, lendo-os com
+ *   pixel buffer objects alguns quadros depois, sem parar o desenho.
+ * - Desenhar quatro vistas da mesa (livre, de cima, de lado e atrás da bola escolhida) na mesma passagem (tecla M,
+ *   --multi-view), com as bolas e a mesa recortadas uma vez contra a união das vistas e enviadas uma única vez.
+ * - Mostrar a sala de bilhar (tecla H, --hall N): mil mesas à volta da mesa principal, recortadas e com o detalhe das
+ *   bolas escolhido primeiro por mesa, desenhadas com as mesas e as bolas principais nos mesmos comandos instanciados.
+ * - No modo --headless, desenhar sem janela num framebuffer próprio (EGL sem superfície em Linux) um número fixo de
+ *   quadros de uma cena programada, e mostrar os quadros por segundo e o tempo de cada etapa.
  *
  * Funções principais:
  * - handleKeypress(GLFWwindow* window, int key, int scancode, int action, int mods): Callback para eventos de teclado.
- * - main(): Função principal do programa.
+ * - pickBall(const glm::vec2& cursor, const glm::vec2& windowSize, RayHit& hit): Procura a bola debaixo do cursor.
+ * - selectBallUnderCursor(GLFWwindow* window): Escolhe a bola debaixo do cursor (botão direito do rato).
+ * - requestRedraw(): Pede o desenho dos próximos quadros depois de um evento.
+ * - isRedrawNeeded(RedrawState& drawn, bool streaming): Indica se a cena mudou desde o último quadro desenhado.
+ * - getTime(): Segundos desde o arranque (sem a GLFW, que não é inicializada no modo --headless).
+ * - runHeadlessScript(int frame, int frameCount): Ações da cena programada do modo --headless.
+ * - printHeadlessReport(int frameCount, double elapsed): Mostra o resultado do modo --headless.
+ * - main(int argc, char** argv): Função principal do programa.
  *
  * Variáveis e constantes importantes:
  * - window: Ponteiro para a janela do jogo.
- * - shaderProgram: Referência ao programa de shader das bolas.
- * - tableProgram: Referência ao programa de shader da mesa.
+ * - ballPrograms: Programas de shader das bolas, um por variante de iluminação (Lights::GetShaderVariant).
+ * - tablePrograms: Programas de shader da mesa, um por variante de iluminação.
+ * - impostorPrograms: Programas de shader dos impostores das bolas, um por variante de iluminação.
+ * - useImpostors: Indica se as bolas são desenhadas como impostores (true) ou com a malha (false).
+ * - multiViewBallPrograms, multiViewTablePrograms: Variantes MULTI_VIEW dos programas das bolas e da mesa, compiladas
+ *   quando as vistas extra são pedidas pela primeira vez.
  * - ballPositions: Vetor com as posições iniciais das bolas.
- * - balls: Vetor que armazena os objetos das bolas.
+ * - ballModels: Modelos das bolas (malha, material e textura), um por ficheiro Ball*.obj.
+ * - scene: Registo das entidades da cena (as bolas da mesa principal e as da sala), com os componentes em arrays densos.
+ * - ballEntities: Entidades das bolas da mesa principal, pela ordem de ballPositions.
+ * - jobs: Threads de trabalho onde os sistemas da cena correm em paralelo.
+ * - physics, renderList: Sistemas da cena com estado próprio entre quadros (física e lista de desenho).
  * - cameraPtr: Ponteiro para o objeto da câmera.
  * - lightsPtr: Ponteiro para o objeto das luzes.
+ * - multiView: Vistas desenhadas no quadro, com os seus volumes de visualização (só a vista livre, sem a tecla M).
+ * - multiViewRequested: As vistas extra foram pedidas (tecla M ou --multi-view).
+ * - poolHall: Mesas e bolas da sala de bilhar, criadas quando a sala é pedida pela primeira vez.
+ * - hallRequested, hallTableCount: A sala está a ser mostrada (tecla H ou --hall N) e o número das suas mesas.
+ * - tablePositions: Posições das mesas visíveis no quadro (a mesa principal e as da sala), desenhadas num só lote.
+ * - ballBounds: Lote SoA com as esferas envolventes das bolas, testado em SIMD.
+ * - visibleBalls: Índices (em ballEntities) das bolas visíveis no quadro atual.
+ * - ballGrid: Grelha com as esferas envolventes das bolas do último quadro, usada para escolher bolas com o rato.
+ * - selectedBall: Índice da bola escolhida, que a tecla espaço põe a rolar.
+ * - ballLOD: Níveis de detalhe partilhados pelas bolas, escolhidos em cada quadro pelo tamanho no ecrã.
+ * - uploadBuffer: Buffer de uniforms de cada quadro (anel de 3 regiões sincronizado com fences).
+ * - UPLOAD_BUFFER_FRAME_SIZE: Tamanho de cada região do buffer de uniforms, em bytes.
+ * - geometry: Buffer de geometria partilhado (malha das bolas, níveis de detalhe e mesa) com um único VAO.
+ * - renderQueue: Fila de desenho do quadro, ordenada por programa, textura, malha e profundidade.
+ * - stateCache: Cache do estado OpenGL usada pela fila, com os contadores de ligações enviadas e evitadas.
+ * - STATS_INTERVAL: Intervalo, em segundos, entre atualizações dos contadores no título da janela.
+ * - materialBuffer: Buffer de armazenamento estático com os materiais de todos os objetos.
+ * - ballTextures: Texturas das bolas (uma camada por bola), com os mipmaps pequenos sempre carregados e os níveis
+ *   detalhados carregados em segundo plano para as bolas grandes no ecrã.
+ * - BALL_TEXTURE_BUDGET: Memória máxima das texturas das bolas na GPU, em bytes.
+ * - BALL_TEXTURES_FILE: Ficheiro KTX2 com as texturas das bolas já comprimidas, escrito pelo TextureCooker.
+ * - shadowProgram: Referência ao programa de shader que desenha a profundidade dos mapas de sombras.
+ * - shadowMapsPtr: Ponteiro para os mapas de sombras das luzes direcional e spot.
+ * - shadowCasters: Objetos que projetam sombras no quadro atual (a mesa e todas as bolas, visíveis ou não).
+ * - profilerPtr: Ponteiro para o profiler das etapas do quadro (zonas da CPU e da GPU).
+ * - PROFILER_TRACE_FILE: Ficheiro onde o traço do profiler é escrito.
+ * - frameCapturePtr: Ponteiro para a gravação dos quadros.
+ * - captureFormat: Destino dos quadros gravados (--capture png|yuv|pipe).
+ * - governorPtr: Ponteiro para o regulador da qualidade.
+ * - DEFAULT_TARGET_FPS: Quadros por segundo pedidos ao regulador sem --target-fps.
+ * - redrawFrames: Quadros que ainda têm de ser desenhados antes de a janela poder esperar por eventos.
+ * - REDRAW_FRAMES, IDLE_WAIT_TIMEOUT: Quadros desenhados depois de cada mudança e espera máxima por eventos com a cena parada.
+ * - dynamicResolution: Framebuffer da resolução interna escolhida pelo regulador, ampliado para a saída.
+ * - HEADLESS_FRAMES, HEADLESS_TIME_STEP, HEADLESS_CAMERA_SPEED: Quadros, passo de tempo fixo e rotação da câmera
+ *   por quadro do modo --headless.
  *
  ******************************************************************************/
 
@@ -33,7 +107,12 @@
 #include "stb_image.h"
 
 #include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
 #include <vector>
+#include <string>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -50,16 +129,224 @@
 #include "LoadShaders.h"
 #include "Camera.h"
 #include "Lights.h"
+#include "Frustum.h"
+#include "SphereLOD.h"
+#include "FrameUploadBuffer.h"
+#include "GeometryBuffer.h"
+#include "RenderQueue.h"
+#include "GLStateCache.h"
+#include "TextureResidency.h"
+#include "ShadowMaps.h"
+#include "FrameProfiler.h"
+#include "HeadlessContext.h"
+#include "FrameCapture.h"
+#include "QualityGovernor.h"
+#include "DynamicResolution.h"
+#include "SphereGrid.h"
+#include "MultiView.h"
+#include "PoolHall.h"
+#include "SceneRegistry.h"
+#include "SceneSystems.h"
+#include "JobSystem.h"
+#include "UniformBlocks.h"
 
-float currentBallRotation = 0.0f;
+// Espaço reservado por quadro para os blocos de uniforms (câmera, luzes, clusters de luzes, dados dos objetos e comandos de desenho)
+const GLsizeiptr UPLOAD_BUFFER_FRAME_SIZE = 1024 * 1024;
+
+// Intervalo entre atualizações dos contadores de estado no título da janela, em segundos
+const double STATS_INTERVAL = 1.0;
+
+// Texturas das bolas comprimidas em BC1 com todos os mipmaps (gerado pelo TextureCooker a partir de PoolBalluv*.jpg)
+const char* BALL_TEXTURES_FILE = "PoolBalls.ktx2";
+
+// Memória máxima das texturas das bolas na GPU: os níveis detalhados só são carregados para as bolas que cabem
+const size_t BALL_TEXTURE_BUDGET = 16 * 1024 * 1024;
+
+// Traço do profiler, para abrir em chrome://tracing ou ui.perfetto.dev
+const char* PROFILER_TRACE_FILE = "FrameTrace.json";
+
+// Modo --headless: quadros desenhados por omissão (--frames N), passo de tempo fixo da simulação, para que a cena seja a
+// mesma em todas as máquinas, e rotação da câmera em cada quadro, em graus
+const int HEADLESS_FRAMES = 600;
+const float HEADLESS_TIME_STEP = 1.0f / 60.0f;
+const float HEADLESS_CAMERA_SPEED = 0.6f;
+
+// Quadros por segundo que o regulador da qualidade tenta manter com janela (--target-fps N muda o valor e liga-o também
+// no modo --headless)
+const double DEFAULT_TARGET_FPS = 60.0;
 
-GLuint VAO, VBO, EBO;
+// Desenho por eventos: quadros desenhados depois de cada mudança (o segundo mostra o que só chega um quadro depois, como
+// os blocos das texturas) e espera máxima, em segundos, por um evento quando a cena está parada
+const int REDRAW_FRAMES = 2;
+const double IDLE_WAIT_TIMEOUT = 0.5;
+
+float currentBallRotation = 0.0f;
 
 std::vector<glm::vec3> ballPositions = Ball::GetBallInitialPositions();
-std::vector<Ball> balls;
+std::vector<Ball> ballModels;
+
+SceneRegistry scene;
+std::vector<Entity> ballEntities;
+JobSystem jobs;
+PhysicsSystem physics;
+RenderListSystem renderList;
 
 Camera* cameraPtr = new Camera();
 Lights* lightsPtr = new Lights();
+ShadowMaps* shadowMapsPtr = new ShadowMaps();
+FrameProfiler* profilerPtr = new FrameProfiler();
+FrameCapture* frameCapturePtr = new FrameCapture();
+FrameCapture::Format captureFormat = FrameCapture::FORMAT_PNG;
+QualityGovernor* governorPtr = new QualityGovernor();
+
+SphereGrid ballGrid;
+int selectedBall = 8;
+
+MultiView multiView;
+bool multiViewRequested = false;
+
+PoolHall poolHall;
+bool hallRequested = false;
+int hallTableCount = PoolHall::DEFAULT_TABLE_COUNT;
+
+int redrawFrames = REDRAW_FRAMES;
+
+// Estado da cena no último quadro desenhado, comparado antes de cada quadro para saber se é preciso desenhar
+struct RedrawState {
+	GLfloat zoom;
+	glm::vec3 rotationAngles;
+	unsigned int lightsVersion;
+};
+
+bool useImpostors = false;
+
+/*****************************************************************************
+ * void requestRedraw()
+ *
+ * Descrição:
+ * ----------
+ * Pede o desenho dos próximos REDRAW_FRAMES quadros. É chamada pelos eventos
+ * que mudam a cena sem passar pelo estado comparado em `isRedrawNeeded` (teclas
+ * e pedidos do sistema para desenhar a janela de novo).
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void requestRedraw() {
+	redrawFrames = REDRAW_FRAMES;
+}
+
+/*****************************************************************************
+ * bool isRedrawNeeded(RedrawState& drawn, bool streaming)
+ *
+ * Descrição:
+ * ----------
+ * Indica se o próximo quadro tem de ser desenhado. A cena mudou se o zoom, os
+ * ângulos da câmera ou o estado das luzes (ToggleLight) forem diferentes dos do
+ * último quadro desenhado, e continua a mudar enquanto a câmera roda, alguma
+ * bola está em movimento, há texturas a chegar ou a gravação está ligada. Cada
+ * mudança pede REDRAW_FRAMES quadros; depois disso a janela pode esperar por
+ * eventos.
+ *
+ * Parâmetros:
+ * -----------
+ * - drawn: O estado do último quadro desenhado (atualizado pela função).
+ * - streaming: true se há níveis das texturas das bolas a caminho.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o quadro tem de ser desenhado.
+ *
+ ******************************************************************************/
+bool isRedrawNeeded(RedrawState& drawn, bool streaming) {
+	bool changed = cameraPtr->zoom != drawn.zoom
+		|| cameraPtr->rotationAngles != drawn.rotationAngles
+		|| lightsPtr->GetStateVersion() != drawn.lightsVersion;
+
+	// Enquanto o botão do rato está premido, rotationAngles é a rotação aplicada à órbita da câmera em cada quadro
+	bool animating = cameraPtr->rotationAngles.x != 0.0f || cameraPtr->rotationAngles.y != 0.0f || streaming || frameCapturePtr->IsRecording();
+	if (!animating)
+		animating = PhysicsSystem::IsAnyMoving(scene);
+
+	if (changed || animating)
+		redrawFrames = REDRAW_FRAMES;
+
+	drawn.zoom = cameraPtr->zoom;
+	drawn.rotationAngles = cameraPtr->rotationAngles;
+	drawn.lightsVersion = lightsPtr->GetStateVersion();
+	return redrawFrames > 0;
+}
+
+/*****************************************************************************
+ * bool pickBall(const glm::vec2& cursor, const glm::vec2& windowSize, RayHit& hit)
+ *
+ * Descrição:
+ * ----------
+ * Procura a bola debaixo de um ponto da janela: o raio da câmera que passa pelo
+ * ponto é lançado contra a grelha das esferas envolventes das bolas, que só
+ * testa as bolas das células atravessadas. Usa as posições e as matrizes do
+ * último quadro desenhado, que são as que estão no ecrã. Serve para escolher a
+ * bola da tacada e para ferramentas de edição da cena.
+ *
+ * Parâmetros:
+ * -----------
+ * - cursor: O ponto na janela (origem no canto superior esquerdo).
+ * - windowSize: O tamanho da janela, nas mesmas unidades do ponto.
+ * - hit: Recebe o índice da bola em `ballEntities`, o ponto atingido e a distância.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se alguma bola estiver debaixo do ponto.
+ *
+ ******************************************************************************/
+bool pickBall(const glm::vec2& cursor, const glm::vec2& windowSize, RayHit& hit) {
+	glm::vec3 origin, direction;
+	cameraPtr->getPickRay(cursor, windowSize, origin, direction);
+	return ballGrid.Raycast(origin, direction, hit);
+}
+
+/*****************************************************************************
+ * void selectBallUnderCursor(GLFWwindow* window)
+ *
+ * Descrição:
+ * ----------
+ * Escolhe a bola debaixo do cursor (botão direito do rato). A tecla espaço põe
+ * a bola escolhida a rolar. Um clique fora das bolas mantém a escolha anterior.
+ * Com as vistas extra, só a vista livre (o quarto superior esquerdo da janela)
+ * usa a câmera principal, por isso os cliques nas outras vistas são ignorados.
+ *
+ * Parâmetros:
+ * -----------
+ * - window: Ponteiro para a janela da GLFW.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void selectBallUnderCursor(GLFWwindow* window) {
+	double xpos, ypos;
+	int windowWidth, windowHeight;
+	glfwGetCursorPos(window, &xpos, &ypos);
+	glfwGetWindowSize(window, &windowWidth, &windowHeight);
+
+	glm::vec2 cursor((float)xpos, (float)ypos);
+	glm::vec2 windowSize((float)windowWidth, (float)windowHeight);
+	if (multiView.IsEnabled()) {
+		windowSize *= 0.5f;
+		if (cursor.x >= windowSize.x || cursor.y >= windowSize.y)
+			return;
+	}
+
+	RayHit hit;
+	if (!pickBall(cursor, windowSize, hit))
+		return;
+
+	selectedBall = hit.index;
+	std::cout << "Selected ball " << selectedBall + 1 << " (hit at " << hit.point.x << ", " << hit.point.y << ", " << hit.point.z << ")" << std::endl;
+}
 
 /*****************************************************************************
  * void handleKeypress(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -67,7 +354,8 @@ Lights* lightsPtr = new Lights();
  * Descrição:
  * ----------
  * Esta é a função de callback chamada pela GLFW sempre que uma tecla é pressionada ou liberada.
- * Ela lida com eventos específicos de teclas, como iniciar o movimento da bola 9 e alternar as luzes.
+ * Ela lida com eventos específicos de teclas, como iniciar o movimento da bola escolhida, alternar as luzes
+ * e alternar entre a malha e os impostores das bolas.
  *
  * Parâmetros:
  * -----------
@@ -87,10 +375,12 @@ void handleKeypress(GLFWwindow* window, int key, int scancode, int action, int m
 	if (action != GLFW_PRESS)
 		return;
 
+	requestRedraw();
+
 	switch (key) {
 	case GLFW_KEY_SPACE:
-		balls[8].isMoving = true;
-		std::cout << "Ball 9 started rolling!" << std::endl;
+		scene.bodies.Get(ballEntities[selectedBall]).isMoving = true;
+		std::cout << "Ball " << selectedBall + 1 << " started rolling!" << std::endl;
 		break;
 	case GLFW_KEY_1:
 		lightsPtr->ToggleLight(1);
@@ -104,13 +394,138 @@ void handleKeypress(GLFWwindow* window, int key, int scancode, int action, int m
 	case GLFW_KEY_4:
 		lightsPtr->ToggleLight(4);
 		break;
+	case GLFW_KEY_5:
+		lightsPtr->ToggleLight(5);
+		break;
+	case GLFW_KEY_I:
+		useImpostors = !useImpostors;
+		std::cout << "Ball renderer: " << (useImpostors ? "impostors" : "mesh") << std::endl;
+		break;
+	case GLFW_KEY_C:
+		shadowMapsPtr->ToggleMode();
+		break;
+	case GLFW_KEY_M:
+		multiViewRequested = !multiViewRequested;
+		break;
+	case GLFW_KEY_H:
+		hallRequested = !hallRequested;
+		std::cout << "Pool hall: " << (hallRequested ? "on" : "off") << std::endl;
+		break;
+	case GLFW_KEY_P:
+		profilerPtr->SetEnabled(!profilerPtr->IsEnabled());
+		break;
+	case GLFW_KEY_T:
+		profilerPtr->WriteChromeTrace(PROFILER_TRACE_FILE);
+		break;
+	case GLFW_KEY_Q:
+		governorPtr->SetEnabled(!governorPtr->IsEnabled());
+		break;
+	case GLFW_KEY_V:
+		if (frameCapturePtr->IsRecording()) {
+			frameCapturePtr->Stop();
+		}
+		else {
+			int framebufferWidth, framebufferHeight;
+			glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+			frameCapturePtr->Start(captureFormat, framebufferWidth, framebufferHeight);
+		}
+		break;
 	default:
 		break;
 	}
 }
 
 /*****************************************************************************
- * int main(void)
+ * double getTime()
+ *
+ * Descrição:
+ * ----------
+ * Devolve os segundos passados desde a primeira chamada, com o relógio
+ * monótono. Substitui `glfwGetTime`, porque a GLFW não é inicializada no modo
+ * --headless.
+ *
+ * Retorno:
+ * --------
+ * - double: Os segundos passados desde a primeira chamada.
+ *
+ ******************************************************************************/
+double getTime() {
+	static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*****************************************************************************
+ * void runHeadlessScript(int frame, int frameCount)
+ *
+ * Descrição:
+ * ----------
+ * Faz as ações da cena programada do modo --headless no início de um quadro,
+ * em vez das teclas e do rato: a câmera roda sempre à mesma velocidade, a bola
+ * 9 começa a rolar no primeiro quadro, os candeeiros da sala acendem-se a um
+ * quarto dos quadros e as bolas passam a impostores a meio, para que o
+ * relatório cubra os caminhos principais do renderizador.
+ *
+ * Parâmetros:
+ * -----------
+ * - frame: O índice do quadro, a partir de 0.
+ * - frameCount: O número de quadros da execução.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void runHeadlessScript(int frame, int frameCount) {
+	if (frame == 0) {
+		cameraPtr->rotationAngles.y = HEADLESS_CAMERA_SPEED;
+		scene.bodies.Get(ballEntities[selectedBall]).isMoving = true;
+	}
+	if (frame == frameCount / 4)
+		lightsPtr->ToggleLight(5);
+	if (frame == frameCount / 2)
+		useImpostors = true;
+}
+
+/*****************************************************************************
+ * void printHeadlessReport(int frameCount, double elapsed)
+ *
+ * Descrição:
+ * ----------
+ * Mostra o resultado do modo --headless: os quadros por segundo e o tempo
+ * médio por quadro de cada etapa medida pelo profiler, na CPU e na GPU.
+ *
+ * Parâmetros:
+ * -----------
+ * - frameCount: O número de quadros desenhados.
+ * - elapsed: O tempo total dos quadros, em segundos.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void printHeadlessReport(int frameCount, double elapsed) {
+	printf("Headless: %d frames in %.3f s (%.1f FPS, %.3f ms per frame)\n",
+		frameCount, elapsed, frameCount / elapsed, elapsed * 1000.0 / frameCount);
+
+	std::vector<ProfileSummary> summaries = profilerPtr->Summarize();
+	for (const ProfileSummary& cpu : summaries) {
+		if (cpu.gpu)
+			continue;
+
+		printf("  %-18s %8.3f ms CPU", cpu.name, cpu.total / 1000.0 / cpu.count);
+		for (const ProfileSummary& gpu : summaries)
+			if (gpu.gpu && strcmp(gpu.name, cpu.name) == 0)
+				printf(", %8.3f ms GPU", gpu.total / 1000.0 / gpu.count);
+		printf("\n");
+	}
+
+	if (profilerPtr->GetStats().droppedGpuFrames > 0)
+		printf("  (%u frames without GPU times)\n", profilerPtr->GetStats().droppedGpuFrames);
+}
+
+/*****************************************************************************
+ * int main(int argc, char** argv)
  *
  * Descrição:
  * ----------
@@ -121,23 +536,49 @@ void handleKeypress(GLFWwindow* window, int key, int scancode, int action, int m
  * O programa cria uma mesa de bilhar e 16 bolas. A câmera pode ser movida ao clicar
  * e ao arrastar com o botão esquerdo do rato, e o zoom pode ser ajustado com o scroll
  * do rato. A barra de espaço inicia o movimento da bola 9, e as teclas 1, 2, 3 e 4
- * alternam a luz ambiente, direcional, luz pontual e spot, respectivamente.
+ * alternam a luz ambiente, direcional, luz pontual e spot, respectivamente. A tecla I
+ * alterna entre desenhar as bolas com a malha ou como impostores. A tecla P liga e
+ * desliga o profiler, e a tecla T escreve as zonas medidas num traço do Chrome.
+ * A tecla V começa e termina a gravação dos quadros no formato de `--capture`.
+ * A tecla Q liga e desliga o regulador da qualidade, que começa ligado com
+ * janela e tenta manter `--target-fps` quadros por segundo (60 por omissão).
+ * A tecla M (ou `--multi-view`) divide a janela em quatro vistas (livre, de
+ * cima, de lado e atrás da bola escolhida), desenhadas na mesma passagem.
+ * A tecla H (ou `--hall N`) mostra a sala de bilhar, com N mesas (1000 por
+ * omissão) à volta da mesa principal.
+ * Com a cena parada, a janela não é desenhada de novo até chegar um evento.
+ *
+ * Com `--headless [--frames N] [--size LxA]`, não cria nenhuma janela: desenha
+ * N quadros da cena de `runHeadlessScript` num framebuffer próprio, com um
+ * passo de tempo fixo e o profiler ligado, e mostra o relatório, escreve o
+ * traço e termina (com erro se o OpenGL tiver registado algum erro). Com
+ * `--capture png|yuv|pipe`, grava todos os quadros da execução. O regulador
+ * só é ligado no modo --headless com `--target-fps N`.
  *
  * Fluxo do Programa:
  * 1. Inicialização:
+ *  - Lê os argumentos da linha de comandos.
  *  - Inicializa GLFW e GLEW.
- *  - Cria a janela do jogo.
+ *  - Cria a janela do jogo (ou o contexto sem janela e o framebuffer, no modo --headless).
  *  - Define o contexto OpenGL.
  *  - Habilita o teste de profundidade.
  *  - Registra callbacks para eventos de teclado, rato e scroll.
  *  - Configura a posição e o alvo da câmera.
  *  - Carrega os shaders para as bolas e a mesa.
  *  - Cria os objetos da mesa e das bolas.
+ *  - Gera os níveis de detalhe das bolas a partir da malha carregada.
+ *  - Envia a geometria, os materiais e as texturas da cena para buffers partilhados.
  * 2. Loop Principal:
  *  - Enquanto a janela não for fechada:
+ *   - Se nada mudou desde o último quadro, espera por eventos e não desenha.
+ *   - Atualiza o regulador da qualidade e liga o framebuffer da resolução interna.
  *   - Limpa o buffer de cor e profundidade.
- *   - Atualiza a matriz de modelo da câmera com base na rotação.
- *   - Renderiza as bolas e a mesa.
+ *   - Roda a câmera à volta da mesa com base na rotação (a vista só é recalculada quando a órbita muda).
+ *   - Atualiza as bolas.
+ *   - Calcula as vistas do quadro e recorta as bolas e a mesa contra a união dos seus volumes de visualização.
+ *   - Adiciona as bolas visíveis e a mesa à fila de desenho, que as ordena e desenha por lotes.
+ *   - Amplia o quadro para a janela, se foi desenhado com uma resolução interna menor.
+ *   - Mostra no título da janela as ligações de estado enviadas e evitadas.
  *   - Troca os buffers da janela para mostrar o quadro renderizado.
  *   - Processa eventos de entrada.
  * 3. Finalização:
@@ -147,54 +588,134 @@ void handleKeypress(GLFWwindow* window, int key, int scancode, int action, int m
  *
  ******************************************************************************/
 
-int main(void) {
-	glfwInit();
+int main(int argc, char** argv) {
+	bool headless = false;
+	int headlessFrames = HEADLESS_FRAMES;
+	int width = 800, height = 800;
+	bool capture = false;
+	double targetFps = 0.0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0)
+			headless = true;
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			headlessFrames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+			sscanf(argv[++i], "%dx%d", &width, &height);
+		else if (strcmp(argv[i], "--target-fps") == 0 && i + 1 < argc)
+			targetFps = atof(argv[++i]);
+		else if (strcmp(argv[i], "--multi-view") == 0)
+			multiViewRequested = true;
+		else if (strcmp(argv[i], "--hall") == 0 && i + 1 < argc) {
+			hallTableCount = atoi(argv[++i]);
+			hallRequested = true;
+		}
+		else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc && FrameCapture::ParseFormat(argv[i + 1], captureFormat)) {
+			capture = true;
+			i++;
+		}
+		else
+			std::cout << "Ignoring unknown argument " << argv[i] << std::endl;
+	}
 
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	if (headlessFrames <= 0 || width <= 0 || height <= 0 || targetFps < 0.0 || hallTableCount <= 0) {
+		std::cout << "Usage: TP-P3D [--headless [--frames N] [--size WIDTHxHEIGHT]] [--target-fps N] [--multi-view] [--hall N] [--capture png|yuv|pipe]" << std::endl;
+		return EXIT_FAILURE;
+	}
 
-	GLFWwindow* window = glfwCreateWindow(800, 800, "PoolTable", NULL, NULL);
+	GLFWwindow* window = NULL;
+	HeadlessContext headlessContext;
 
-	if (window == NULL) {
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
+	if (headless) {
+		// O llvmpipe do Mesa só tem o OpenGL 4.5, que chega para os shaders (#version 440)
+		if (!headlessContext.Create(4, 6) && !headlessContext.Create(4, 5)) {
+			std::cout << "Failed to create headless OpenGL context" << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::cout << "Headless context: " << headlessContext.GetDescription() << ", " << width << "x" << height << std::endl;
 	}
+	else {
+		glfwInit();
+
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		window = glfwCreateWindow(width, height, "PoolTable", NULL, NULL);
+
+		if (window == NULL) {
+			std::cout << "Failed to create GLFW window" << std::endl;
+			glfwTerminate();
+		}
 
-	glfwMakeContextCurrent(window);
+		glfwMakeContextCurrent(window);
+	}
 
 	glewExperimental = GL_TRUE;
-	glewInit();
+	GLenum glewStatus = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// A GLEW compilada para GLX carrega as funções do OpenGL e só depois falha por não haver um display X, o que é
+	// normal com o contexto EGL sem superfície do modo --headless
+	if (headless && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY)
+		glewStatus = GLEW_OK;
+#endif
+	if (glewStatus != GLEW_OK) {
+		std::cout << "Failed to initialize GLEW: " << glewGetErrorString(glewStatus) << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (headless && !headlessContext.CreateFramebuffer(width, height))
+		return EXIT_FAILURE;
 
 	glEnable(GL_DEPTH_TEST);
 
-	glfwSetKeyCallback(window, handleKeypress);
-	glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods) {
-		cameraPtr->mouseClickCallback(window, button, action, mods);
-		});
-	glfwSetCursorPosCallback(window, [](GLFWwindow* window, double xpos, double ypos) {
-		cameraPtr->mouseMovementCallback(window, xpos, ypos);
-		});
-	glfwSetScrollCallback(window, [](GLFWwindow* window, double xoffset, double yoffset) {
-		cameraPtr->scrollCallback(window, xoffset, yoffset);
-		});
+	if (!headless) {
+		glfwSetKeyCallback(window, handleKeypress);
+		glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods) {
+			cameraPtr->mouseClickCallback(window, button, action, mods);
+			if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
+				selectBallUnderCursor(window);
+			});
+		glfwSetCursorPosCallback(window, [](GLFWwindow* window, double xpos, double ypos) {
+			cameraPtr->mouseMovementCallback(window, xpos, ypos);
+			});
+		glfwSetScrollCallback(window, [](GLFWwindow* window, double xoffset, double yoffset) {
+			cameraPtr->scrollCallback(window, xoffset, yoffset);
+			});
+		glfwSetWindowRefreshCallback(window, [](GLFWwindow* window) {
+			requestRedraw();
+			});
+	}
 
 	glm::vec3 cameraPosition(0.0f, 10.0f, 20.0f);
 	glm::vec3 cameraTarget(0.0f);
-	float aspectRatio = 800.0f / 800.0f;
+	float aspectRatio = (float)width / (float)height;
 	cameraPtr->setupCamera(cameraPosition, cameraTarget, aspectRatio);
 
+	int framebufferWidth = width, framebufferHeight = height;
+	if (!headless)
+		glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+	cameraPtr->viewportSize = glm::vec2(framebufferWidth, framebufferHeight);
+
 	ShaderInfo shaders[] = {
 		{ GL_VERTEX_SHADER, "Shaders/ball.vert" },
 		{ GL_FRAGMENT_SHADER, "Shaders/ball.frag" },
+		{ GL_FRAGMENT_SHADER, "Shaders/ballLighting.frag" },
 		{ GL_NONE, NULL }
 	};
 
-	GLuint shaderProgram = LoadShaders(shaders);
-	if (!shaderProgram)
-		exit(EXIT_FAILURE);
+	// Uma variante de cada programa de iluminação por combinação de luzes ligadas: mudar as luzes só muda o programa
+	std::string variantDefines[Lights::VARIANT_COUNT];
+	const char* variantDefinePtrs[Lights::VARIANT_COUNT];
+	for (int variant = 0; variant < Lights::VARIANT_COUNT; variant++) {
+		variantDefines[variant] = Lights::GetShaderVariantDefines(variant);
+		variantDefinePtrs[variant] = variantDefines[variant].c_str();
+	}
+
+	double variantStartTime = getTime();
 
-	glUseProgram(shaderProgram);
+	GLuint ballPrograms[Lights::VARIANT_COUNT];
+	if (!LoadShaderVariants(shaders, variantDefinePtrs, Lights::VARIANT_COUNT, ballPrograms))
+		exit(EXIT_FAILURE);
 
 	ShaderInfo tableshaders[] = {
 		{ GL_VERTEX_SHADER, "Shaders/table.vert" },
@@ -202,58 +723,435 @@ int main(void) {
 		{ GL_NONE, NULL }
 	};
 
-	GLuint tableProgram = LoadShaders(tableshaders);
+	GLuint tablePrograms[Lights::VARIANT_COUNT];
+	if (!LoadShaderVariants(tableshaders, variantDefinePtrs, Lights::VARIANT_COUNT, tablePrograms))
+		exit(EXIT_FAILURE);
+
+	ShaderInfo impostorShaders[] = {
+		{ GL_VERTEX_SHADER, "Shaders/ballImpostor.vert" },
+		{ GL_FRAGMENT_SHADER, "Shaders/ballImpostor.frag" },
+		{ GL_FRAGMENT_SHADER, "Shaders/ballLighting.frag" },
+		{ GL_NONE, NULL }
+	};
 
-	Table table(tableProgram, cameraPtr, lightsPtr);
+	GLuint impostorPrograms[Lights::VARIANT_COUNT];
+	if (!LoadShaderVariants(impostorShaders, variantDefinePtrs, Lights::VARIANT_COUNT, impostorPrograms))
+		exit(EXIT_FAILURE);
 
-	for (int i = 0; i < ballPositions.size(); ++i) {
+	std::cout << "Loaded " << 3 * Lights::VARIANT_COUNT << " lighting shader variants in "
+		<< (getTime() - variantStartTime) * 1000.0 << " ms" << std::endl;
 
-		Ball ball(ballPositions[i], i + 1, shaderProgram, cameraPtr, lightsPtr);
-		ball.Load("Ball" + std::to_string(i + 1) + ".obj");
-		ball.Install();
-		balls.push_back(ball);
+	// Variantes MULTI_VIEW das bolas e da mesa, compiladas só quando as vistas extra são pedidas pela primeira vez. Os
+	// impostores não têm esta variante: o quadrado de cada bola está virado para a câmera principal
+	std::string multiViewDefines[Lights::VARIANT_COUNT];
+	const char* multiViewDefinePtrs[Lights::VARIANT_COUNT];
+	for (int variant = 0; variant < Lights::VARIANT_COUNT; variant++) {
+		multiViewDefines[variant] = variantDefines[variant] + "#define MULTI_VIEW\n";
+		multiViewDefinePtrs[variant] = multiViewDefines[variant].c_str();
 	}
 
-	float lastFrameTime = 0.0f;
-	while (!glfwWindowShouldClose(window)) {
+	GLuint multiViewBallPrograms[Lights::VARIANT_COUNT] = {};
+	GLuint multiViewTablePrograms[Lights::VARIANT_COUNT] = {};
+	bool multiViewLoaded = false;
+
+	ShaderInfo shadowShaders[] = {
+		{ GL_VERTEX_SHADER, "Shaders/shadow.vert" },
+		{ GL_FRAGMENT_SHADER, "Shaders/shadow.frag" },
+		{ GL_NONE, NULL }
+	};
+
+	GLuint shadowProgram = LoadShaders(shadowShaders);
+
+	// Os objetos com recursos OpenGL (buffers, texturas, framebuffers e as threads que os preenchem) são destruídos no
+	// fim deste bloco, enquanto o contexto ainda existe; a janela e a GLFW só são libertadas depois
+	int exitCode = 0;
+	{
+		// Cada região do buffer tem também espaço para os objetos de todas as mesas e bolas da sala, que a tecla H pode ligar
+		FrameUploadBuffer uploadBuffer;
+		if (!uploadBuffer.Create(UPLOAD_BUFFER_FRAME_SIZE + PoolHall::GetUploadSize(hallTableCount, ballPositions.size())))
+			return EXIT_FAILURE;
+
+		// Todas as malhas estáticas da cena são juntadas num único buffer de vértices e de índices, com um só VAO
+		GeometryBuffer geometry;
 
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		Table table(tablePrograms, cameraPtr, lightsPtr, geometry);
+		table.SetUploadBuffer(&uploadBuffer);
 
-		cameraPtr->model = glm::rotate(cameraPtr->model, glm::radians(cameraPtr->rotationAngles.y), glm::vec3(0.0f, 1.0f, 0.0f));
+		for (int i = 0; i < ballPositions.size(); ++i) {
 
-		glm::mat4 matrizZoom = cameraPtr->getMatrizZoom();
+			Ball ball(i);
+			ball.Load("Ball" + std::to_string(i + 1) + ".obj");
+			ball.Install();
+			ballModels.push_back(ball);
+		}
+
+		// Os ficheiros Ball*.obj têm a mesma geometria e só diferem na textura, por isso a malha é enviada uma única vez
+		MeshRange ballMesh = geometry.AddTriangles(ballModels[0].vertices, ballModels[0].normals, ballModels[0].uvs);
 
-		glBindVertexArray(VAO);
+		// Todas as bolas usam a mesma esfera, por isso os níveis de detalhe são gerados uma vez e partilhados
+		SphereLOD ballLOD;
+		ballLOD.Build(ballModels[0].GetBounds().radius, geometry);
+		for (size_t i = 0; i < ballModels.size(); ++i)
+			ballModels[i].SetMesh(ballMesh);
 
-		glUseProgram(shaderProgram);
+		geometry.Upload();
+
+		// Materiais de todos os objetos num buffer imutável: um por bola, seguido do material da mesa
+		std::vector<MaterialBlock> materials;
+		for (size_t i = 0; i < ballModels.size(); ++i) {
+			ballModels[i].SetMaterialIndex((GLint)materials.size());
+			materials.push_back(ballModels[i].GetMaterial());
+		}
+		table.SetMaterialIndex((GLint)materials.size());
+		materials.push_back(table.GetMaterial());
 
-		float currentFrameTime = glfwGetTime();
-		float deltaTime = currentFrameTime - lastFrameTime;
-		lastFrameTime = currentFrameTime;
+		GLuint materialBuffer;
+		glGenBuffers(1, &materialBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialBuffer);
+		glBufferStorage(GL_SHADER_STORAGE_BUFFER, materials.size() * sizeof(MaterialBlock), materials.data(), 0);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BLOCK_BINDING, materialBuffer);
 
-		for (size_t i = 0; i < balls.size(); ++i) {
-			balls[i].Update(deltaTime, balls);
-			balls[i].Render(balls[i].position, balls[i].orientation);
-			balls[i].Update(deltaTime, balls);
+		// As bolas da mesa principal são entidades com corpo rígido, criadas a partir dos modelos já com malha e material;
+		// a física, as matrizes e a lista de desenho são calculadas pelos sistemas da cena nas threads de trabalho
+		for (size_t i = 0; i < ballModels.size(); ++i)
+			ballEntities.push_back(ballModels[i].CreateEntity(scene, ballPositions[i], glm::vec3(0.0f), &ballLOD, true));
+		jobs.Start(JobSystem::GetDefaultWorkerCount());
 
-			balls[i].Render(balls[i].position, balls[i].orientation);
+		// Texturas das bolas (a camada i é a textura da bola i), carregadas em segundo plano do array comprimido
+		// preparado pelo TextureCooker se existir, ou das imagens. Os mipmaps pequenos chegam primeiro (até lá, a bola é
+		// desenhada com uma cor provisória) e os níveis detalhados são carregados conforme o tamanho das bolas no ecrã.
+		TextureResidency ballTextures(BALL_TEXTURE_BUDGET);
+		if (!ballTextures.StartCompressed(BALL_TEXTURES_FILE)) {
+			std::vector<std::string> ballTextureFiles;
+			for (size_t i = 0; i < ballModels.size(); ++i)
+				ballTextureFiles.push_back(ballModels[i].GetTextureFile());
+
+			if (!ballTextures.StartImages(ballTextureFiles))
+				return EXIT_FAILURE;
+			std::cout << "Streaming ball textures from images; run TextureCooker to create " << BALL_TEXTURES_FILE << std::endl;
 		}
+		std::cout << "Ball texture arrays: " << ballTextures.GetMemorySize() / 1024 << " KB" << std::endl;
 
-		table.Render();
+		// Mapas de sombras das luzes direcional e spot, lidos pelos shaders na unidade ShadowMaps::TEXTURE_UNIT
+		if (!shadowMapsPtr->Create(shadowProgram))
+			return EXIT_FAILURE;
+		std::vector<ShadowCaster> shadowCasters;
 
-		glfwSwapBuffers(window);
+		// Sem as consultas, o profiler só mede as zonas da CPU; no modo --headless mede todos os quadros
+		profilerPtr->Create();
+		if (headless)
+			profilerPtr->SetEnabled(true);
 
-		glfwPollEvents();
-	}
+		// No modo --headless, --capture grava a execução inteira; com janela, a gravação começa com a tecla V
+		if (headless && capture && !frameCapturePtr->Start(captureFormat, framebufferWidth, framebufferHeight))
+			return EXIT_FAILURE;
+
+		// O quadro é desenhado com a resolução interna do regulador da qualidade e ampliado para a saída no fim
+		DynamicResolution dynamicResolution;
+		if (!dynamicResolution.Create(framebufferWidth, framebufferHeight))
+			return EXIT_FAILURE;
+		GLuint outputFramebuffer = headless ? headlessContext.GetFramebuffer() : 0;
+
+		governorPtr->SetTargetFrameTime(1.0 / (targetFps > 0.0 ? targetFps : DEFAULT_TARGET_FPS));
+		if (!headless || targetFps > 0.0)
+			governorPtr->SetEnabled(true);
+
+		RenderQueue renderQueue;
+		GLStateCache stateCache;
+		double lastStatsTime = 0.0;
+
+		SphereBatch ballBounds;
+		std::vector<int> visibleBalls;
+		std::vector<glm::vec3> tablePositions;
+
+		float lastFrameTime = 0.0f;
+		int frameIndex = 0;
+		double headlessStartTime = getTime();
+		RedrawState drawnState = { cameraPtr->zoom, cameraPtr->rotationAngles, lightsPtr->GetStateVersion() };
+		bool resumed = false;
+		while (headless ? frameIndex < headlessFrames : !glfwWindowShouldClose(window)) {
+			// Com a cena parada, a janela dorme até ao próximo evento (ou IDLE_WAIT_TIMEOUT) em vez de repetir o quadro
+			if (!headless && !isRedrawNeeded(drawnState, ballTextures.IsStreaming())) {
+				glfwWaitEventsTimeout(IDLE_WAIT_TIMEOUT);
+				resumed = true;
+				continue;
+			}
+
+			if (headless)
+				runHeadlessScript(frameIndex, headlessFrames);
+			frameIndex++;
+			if (redrawFrames > 0)
+				redrawFrames--;
+
+			// As zonas só são medidas com o profiler ligado; os tempos da GPU chegam FRAME_LATENCY quadros depois
+			profilerPtr->BeginFrame();
+			ProfileZone frameZone(*profilerPtr, "frame");
+
+			// O primeiro quadro depois de uma espera por eventos não avança a simulação nem conta para o regulador
+			float currentFrameTime = getTime();
+			float frameInterval = currentFrameTime - lastFrameTime;
+			float deltaTime = headless ? HEADLESS_TIME_STEP : (resumed ? 0.0f : frameInterval);
+			lastFrameTime = currentFrameTime;
+
+			// O regulador decide com a duração real dos quadros (também no modo --headless, onde a simulação tem um passo fixo);
+			// as luzes e o detalhe das bolas seguem o nível atual e os clusters usam o tamanho da resolução interna
+			if (!resumed)
+				governorPtr->Update(frameInterval);
+			resumed = false;
+			const QualityLevel& quality = governorPtr->GetSettings();
+			lightsPtr->SetQualityLimits(quality.hallLights, quality.spotLight);
+			ballLOD.SetDetailScale(quality.lodScale);
+
+			// As vistas extra trocam os programas das bolas e da mesa pelas variantes MULTI_VIEW (compiladas da primeira vez)
+			if (multiViewRequested != multiView.IsEnabled()) {
+				if (multiViewRequested && !MultiView::IsSupported()) {
+					std::cout << "Multi-view rendering needs GL_ARB_viewport_array and GL_ARB_shader_viewport_layer_array" << std::endl;
+					multiViewRequested = false;
+				}
+				if (multiViewRequested && !multiViewLoaded) {
+					multiViewLoaded = LoadShaderVariants(shaders, multiViewDefinePtrs, Lights::VARIANT_COUNT, multiViewBallPrograms);
+					if (multiViewLoaded && !LoadShaderVariants(tableshaders, multiViewDefinePtrs, Lights::VARIANT_COUNT, multiViewTablePrograms)) {
+						for (int variant = 0; variant < Lights::VARIANT_COUNT; variant++)
+							glDeleteProgram(multiViewBallPrograms[variant]);
+						multiViewLoaded = false;
+					}
+					if (!multiViewLoaded) {
+						std::cout << "Failed to load the multi-view shader variants" << std::endl;
+						multiViewRequested = false;
+					}
+				}
+				if (multiViewRequested != multiView.IsEnabled()) {
+					multiView.SetEnabled(multiViewRequested);
+					table.SetPrograms(multiView.IsEnabled() ? multiViewTablePrograms : tablePrograms, multiView.GetViewCount());
+				}
+			}
+
+			// Sem janela não há framebuffer por omissão: a saída é o framebuffer do contexto sem janela. Com as vistas extra,
+			// a câmera principal só ocupa um quarto do quadro (o tamanho usado pelos níveis de detalhe e pelos clusters)
+			dynamicResolution.Begin(quality.renderScale, outputFramebuffer);
+			cameraPtr->viewportSize = multiView.GetViewSize(dynamicResolution.GetRenderWidth(), dynamicResolution.GetRenderHeight());
+
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			// A cena fica parada e a câmera orbita à volta dela: rodar a mesa em +y equivale a rodar a câmera em -y
+			if (cameraPtr->rotationAngles.x != 0.0f || cameraPtr->rotationAngles.y != 0.0f)
+				cameraPtr->orbit(-glm::radians(cameraPtr->rotationAngles.y), glm::radians(cameraPtr->rotationAngles.x));
+
+			// Vista com o zoom e vista-projeção, partilhadas por todos os objetos do quadro (só recalculadas quando mudam)
+			cameraPtr->updateFrameMatrices();
+
+			stateCache.BeginFrame();
+
+			{
+				ProfileZone updateZone(*profilerPtr, "update");
+				physics.Update(scene, deltaTime, jobs);
+				TransformSystem::Update(scene, jobs);
+			}
+
+			// Dados partilhados por todos os objetos do quadro: escritos uma única vez e ligados aos seus pontos de ligação
+			// (espera pela fence da região do buffer usada FrameUploadBuffer::FRAME_COUNT quadros antes, se a GPU estiver atrasada)
+			{
+				ProfileZone waitZone(*profilerPtr, "upload wait");
+				uploadBuffer.BeginFrame();
+			}
+
+			// Matrizes e volumes de todas as vistas; os planos ficam no espaço das posições das bolas (a vista livre inclui o zoom)
+			multiView.Update(*cameraPtr, table.GetBoundingSphere(), scene.transforms.Get(ballEntities[selectedBall]).position);
+			multiView.Upload(uploadBuffer);
+
+			// As luzes pontuais ativas são atribuídas aos clusters e as matrizes das sombras são calculadas antes de os
+			// blocos de luzes das bolas e da mesa serem preenchidos (com as vistas extra, os clusters cobrem a mesa inteira)
+			{
+				ProfileZone lightsZone(*profilerPtr, "lights");
+				lightsPtr->Update(cameraPtr->zoomView, cameraPtr->zoom, multiView.GetClusterProjection(), multiView.GetClusterNear(), multiView.GetClusterFar(), cameraPtr->viewportSize);
+				lightsPtr->Upload(uploadBuffer);
+			}
+
+			// Os mapas de sombras usam o bloco CameraData para a matriz de cada luz, por isso são desenhados antes de a câmera ser escrita
+			// (só na CPU: ShadowMaps tem a sua própria consulta GL_TIME_ELAPSED, que não pode estar dentro de outra)
+			{
+				ProfileZone shadowZone(*profilerPtr, "shadows");
+				shadowCasters.clear();
+				shadowCasters.push_back(table.GetShadowCaster());
+				RenderListSystem::GatherShadowCasters(scene, ballEntities, shadowCasters);
+				shadowMapsPtr->Render(*lightsPtr, shadowCasters, geometry.GetVertexArray(), uploadBuffer, stateCache);
+			}
+
+			CameraBlock cameraBlock;
+			cameraBlock.view = cameraPtr->zoomView;
+			cameraBlock.projection = cameraPtr->proj;
+			uploadBuffer.Upload(CAMERA_BLOCK_BINDING, cameraBlock);
+
+			// As luzes das bolas são ligadas pela fila antes do primeiro lote de bolas
+			LightBlock ballLights = lightsPtr->GetBallLights();
+			GLintptr ballLightOffset = uploadBuffer.Allocate(&ballLights, sizeof(LightBlock));
 
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
-	glDeleteProgram(shaderProgram);
 
-	glfwDestroyWindow(window);
+			// As bolas visíveis e a mesa vão para a fila, que as ordena e desenha cada estado numa única chamada; por isso
+			// as zonas das bolas e da mesa só medem a CPU, e o tempo de GPU do desenho de ambas fica na zona "draw". Com as
+			// vistas extra, cada objeto visível em alguma delas entra uma vez na fila e é desenhado com uma instância por vista
+			{
+				ProfileZone ballZone(*profilerPtr, "ball render");
+				CullingSystem::GatherBounds(scene, ballEntities, ballBounds);
+				multiView.CullSpheres(ballBounds, visibleBalls);
+				ballGrid.Build(ballBounds);
 
-	glfwTerminate();
+				// Sala de bilhar: as mesas são recortadas primeiro e só as bolas das mesas visíveis são testadas
+				if (hallRequested && !poolHall.IsBuilt())
+					poolHall.Build(hallTableCount, table.GetBoundingSphere(), ballPositions, ballModels, &ballLOD, scene);
+				if (hallRequested)
+					poolHall.Cull(multiView, *cameraPtr, ballLOD, scene);
+
+				bool impostors = useImpostors && !multiView.IsEnabled();
+				const GLuint* programs = multiView.IsEnabled() ? multiViewBallPrograms : (impostors ? impostorPrograms : ballPrograms);
+				DrawState ballState = { programs[lightsPtr->GetShaderVariant()], geometry.GetVertexArray(), ballTextures.GetTailTexture(), ballLightOffset, impostors, multiView.GetViewCount() };
+				renderList.Build(scene, ballEntities, visibleBalls, *cameraPtr, &ballTextures, jobs);
+				if (hallRequested)
+					renderList.Build(scene, poolHall.GetBallCandidates(), poolHall.GetVisibleBalls(), *cameraPtr, &ballTextures, jobs);
+				renderList.Submit(renderQueue, ballState, &ballTextures);
+			}
+
+			// A mesa principal e as mesas visíveis da sala partilham o bloco de luzes e são desenhadas como instâncias da mesma malha
+			{
+				ProfileZone tableZone(*profilerPtr, "table render");
+				tablePositions.clear();
+				if (multiView.IsSphereVisible(table.GetBoundingSphere()))
+					tablePositions.push_back(glm::vec3(0.0f));
+				if (hallRequested)
+					tablePositions.insert(tablePositions.end(), poolHall.GetVisibleTableOffsets().begin(), poolHall.GetVisibleTableOffsets().end());
+				table.RenderInstances(renderQueue, tablePositions.data(), tablePositions.size());
+			}
+
+			// As bolas pediram os níveis de que precisam; os níveis já carregados de cada bola vão para o bloco TextureResidencyData
+			{
+				ProfileZone textureZone(*profilerPtr, "texture streaming", true);
+				ballTextures.Update(uploadBuffer);
+			}
+
+			{
+				ProfileZone drawZone(*profilerPtr, "draw", true);
+				stateCache.BindTexture(ShadowMaps::TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, shadowMapsPtr->GetTexture());
+				stateCache.BindTexture(TextureResidency::DETAIL_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, ballTextures.GetDetailTexture());
+				multiView.SetViewports(dynamicResolution.GetRenderWidth(), dynamicResolution.GetRenderHeight());
+				renderQueue.Flush(stateCache, uploadBuffer);
+				if (multiView.IsEnabled())
+					glViewport(0, 0, dynamicResolution.GetRenderWidth(), dynamicResolution.GetRenderHeight());
+			}
+
+			{
+				ProfileZone upscaleZone(*profilerPtr, "upscale", true);
+				dynamicResolution.Resolve();
+			}
+
+			// A cópia do quadro só é pedida aqui; os píxeis são lidos pela thread de codificação alguns quadros depois
+			{
+				ProfileZone captureZone(*profilerPtr, "capture");
+				frameCapturePtr->Capture();
+			}
+
+			if (!headless && currentFrameTime - lastStatsTime >= STATS_INTERVAL) {
+				const GLStateCache::Counters& counters = stateCache.GetCounters();
+				std::string title = "PoolTable - state changes: " + std::to_string(counters.issued) + " issued, " + std::to_string(counters.saved) + " saved";
+
+				// Custo médio por quadro dos mapas de sombras no modo atual, para comparar os dois modos (tecla C)
+				const ShadowMaps::Stats& shadowStats = shadowMapsPtr->GetStats();
+				if (shadowStats.frames > 0) {
+					char shadowText[128];
+					snprintf(shadowText, sizeof(shadowText), " - shadows (%s): %.3f ms GPU, %.3f ms CPU, %u static redraws",
+						shadowMapsPtr->GetMode() == ShadowMaps::CACHED ? "cached" : "full redraw",
+						shadowStats.gpuSamples > 0 ? shadowStats.gpuTime * 1000.0 / shadowStats.gpuSamples : 0.0,
+						shadowStats.cpuTime * 1000.0 / shadowStats.frames,
+						shadowStats.staticRedraws);
+					title += shadowText;
+				}
+				shadowMapsPtr->ResetStats();
+
+				// Memória ocupada pelos níveis detalhados face ao orçamento, e camadas reutilizadas por outras bolas
+				char textureText[128];
+				snprintf(textureText, sizeof(textureText), " - ball textures: %zu / %zu KB detail, %u levels loaded, %u evictions",
+					ballTextures.GetDetailResidentSize() / 1024, ballTextures.GetBudget() / 1024,
+					ballTextures.GetStats().levelsLoaded, ballTextures.GetStats().evictions);
+				title += textureText;
+				ballTextures.ResetStats();
+
+				if (governorPtr->IsEnabled()) {
+					char qualityText[64];
+					snprintf(qualityText, sizeof(qualityText), " - quality level %d (%.0f%% resolution)",
+						governorPtr->GetLevel(), quality.renderScale * 100.0f);
+					title += qualityText;
+				}
+
+				if (hallRequested) {
+					char hallText[96];
+					snprintf(hallText, sizeof(hallText), " - hall: %zu / %zu tables, %zu balls visible",
+						poolHall.GetVisibleTableOffsets().size(), poolHall.GetTableCount(), poolHall.GetVisibleBallCount());
+					title += hallText;
+				}
+
+				if (frameCapturePtr->IsRecording()) {
+					char captureText[64];
+					snprintf(captureText, sizeof(captureText), " - recording: %u frames, %u dropped",
+						frameCapturePtr->GetStats().captured, frameCapturePtr->GetStats().dropped);
+					title += captureText;
+				}
+
+				glfwSetWindowTitle(window, title.c_str());
+				lastStatsTime = currentFrameTime;
+			}
+
+			// (com renderizadores por software, como o llvmpipe, o quadro só é desenhado quando a fence é enviada)
+			{
+				ProfileZone fenceZone(*profilerPtr, "upload fence");
+				uploadBuffer.EndFrame();
+			}
+
+			{
+				ProfileZone swapZone(*profilerPtr, "swap");
+				if (headless)
+					glFlush();
+				else
+					glfwSwapBuffers(window);
+			}
+
+			if (!headless)
+				glfwPollEvents();
+		}
+
+		if (headless) {
+			glFinish();
+			printHeadlessReport(headlessFrames, getTime() - headlessStartTime);
+			profilerPtr->WriteChromeTrace(PROFILER_TRACE_FILE);
+
+			// Para a integração contínua: a execução falha se o OpenGL registou algum erro
+			GLenum error = glGetError();
+			if (error != GL_NO_ERROR) {
+				std::cout << "OpenGL error 0x" << std::hex << error << std::dec << " during the headless run" << std::endl;
+				exitCode = EXIT_FAILURE;
+			}
+		}
+
+		// Depois do relatório, para que o tempo do modo --headless não inclua a codificação dos últimos quadros
+		frameCapturePtr->Stop();
+
+		glDeleteBuffers(1, &materialBuffer);
+		for (int variant = 0; variant < Lights::VARIANT_COUNT; variant++) {
+			glDeleteProgram(ballPrograms[variant]);
+			glDeleteProgram(tablePrograms[variant]);
+			glDeleteProgram(impostorPrograms[variant]);
+			if (multiViewLoaded) {
+				glDeleteProgram(multiViewBallPrograms[variant]);
+				glDeleteProgram(multiViewTablePrograms[variant]);
+			}
+		}
+		glDeleteProgram(shadowProgram);
+	}
+
+	if (!headless) {
+		glfwDestroyWindow(window);
+
+		glfwTerminate();
+	}
 
-	return 0;
+	return exitCode;
 }
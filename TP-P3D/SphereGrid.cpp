@@ -0,0 +1,269 @@
+﻿/*****************************************************************************
+ * SphereGrid.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe SphereGrid, a fase larga usada para escolher bolas com o rato. A classe
+ * SphereGrid é responsável por:
+ * - Distribuir as esferas de um lote (as esferas envolventes das bolas, já calculadas para o recorte) por uma grelha
+ *   uniforme no plano da mesa, com duas passagens (contagem e preenchimento) para um layout contíguo por célula.
+ * - Percorrer as células atravessadas por um raio, por ordem, com o algoritmo de Amanatides e Woo, e testar só as
+ *   esferas dessas células; a procura para logo que a esfera mais próxima atingida esteja antes da saída da célula.
+ *
+ * Funções principais:
+ * - Build(const SphereBatch& spheres): Constrói a grelha a partir de um lote de esferas.
+ * - Raycast(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit): Procura a esfera mais próxima atingida.
+ *
+ * Variáveis e constantes importantes:
+ * - cellSize: Lado de cada célula (o diâmetro da maior esfera, para que cada esfera toque no máximo 4 células).
+ * - MAX_CELLS_PER_SPHERE: Limita o tamanho da grelha quando as esferas estão muito espalhadas.
+ * - cellStart, cellItems: Índices das esferas de cada célula.
+ *
+ ******************************************************************************/
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+#include "SphereGrid.h"
+
+
+/*****************************************************************************
+ * SphereGrid::SphereGrid()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `SphereGrid`. A grelha começa vazia; é preenchida em `Build`.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+SphereGrid::SphereGrid()
+	: gridMin(0.0f),
+	cellSize(1.0f),
+	columns(0),
+	rows(0),
+	minY(0.0f),
+	maxY(0.0f) {
+}
+
+
+/*****************************************************************************
+ * void SphereGrid::Build(const SphereBatch& spheres)
+ *
+ * Descrição:
+ * ----------
+ * Constrói a grelha a partir das esferas de um lote. O lado das células é o
+ * diâmetro da maior esfera, aumentado se a grelha ficasse com mais de
+ * MAX_CELLS_PER_SPHERE células por esfera. Cada esfera é guardada em todas as
+ * células que o seu quadrado envolvente no plano xz toca. Os índices das esferas
+ * são os índices do lote.
+ *
+ * Parâmetros:
+ * -----------
+ * - spheres: O lote de esferas (centro e raio).
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void SphereGrid::Build(const SphereBatch& spheres) {
+	size_t count = spheres.Size();
+	centers.resize(count);
+	columns = rows = 0;
+	if (count == 0)
+		return;
+
+	glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+	float maxRadius = 0.0f;
+	for (size_t i = 0; i < count; i++) {
+		centers[i] = glm::vec4(spheres.x[i], spheres.y[i], spheres.z[i], spheres.r[i]);
+		glm::vec3 center(centers[i]);
+		boundsMin = glm::min(boundsMin, center - spheres.r[i]);
+		boundsMax = glm::max(boundsMax, center + spheres.r[i]);
+		maxRadius = std::max(maxRadius, spheres.r[i]);
+	}
+
+	gridMin = glm::vec2(boundsMin.x, boundsMin.z);
+	minY = boundsMin.y;
+	maxY = boundsMax.y;
+
+	glm::vec2 extent(boundsMax.x - boundsMin.x, boundsMax.z - boundsMin.z);
+	cellSize = std::max(2.0f * maxRadius, 1e-4f);
+	double maxCells = (double)MAX_CELLS_PER_SPHERE * count;
+	double cells = std::ceil(extent.x / cellSize) * std::ceil(extent.y / cellSize);
+	if (cells > maxCells)
+		cellSize *= (float)std::sqrt(cells / maxCells) * 1.001f;
+
+	columns = std::max(1, (int)std::ceil(extent.x / cellSize));
+	rows = std::max(1, (int)std::ceil(extent.y / cellSize));
+
+	// Primeira passagem: número de esferas de cada célula; a soma prefixa dá o início de cada célula
+	cellStart.assign(columns * rows + 1, 0);
+	for (size_t i = 0; i < count; i++) {
+		int x0 = std::min(columns - 1, (int)((centers[i].x - centers[i].w - gridMin.x) / cellSize));
+		int x1 = std::min(columns - 1, (int)((centers[i].x + centers[i].w - gridMin.x) / cellSize));
+		int z0 = std::min(rows - 1, (int)((centers[i].z - centers[i].w - gridMin.y) / cellSize));
+		int z1 = std::min(rows - 1, (int)((centers[i].z + centers[i].w - gridMin.y) / cellSize));
+		for (int z = z0; z <= z1; z++)
+			for (int x = x0; x <= x1; x++)
+				cellStart[z * columns + x + 1]++;
+	}
+	for (int cell = 0; cell < columns * rows; cell++)
+		cellStart[cell + 1] += cellStart[cell];
+
+	// Segunda passagem: os índices das esferas, pela mesma ordem
+	cellItems.resize(cellStart.back());
+	cellCursor.assign(cellStart.begin(), cellStart.end() - 1);
+	for (size_t i = 0; i < count; i++) {
+		int x0 = std::min(columns - 1, (int)((centers[i].x - centers[i].w - gridMin.x) / cellSize));
+		int x1 = std::min(columns - 1, (int)((centers[i].x + centers[i].w - gridMin.x) / cellSize));
+		int z0 = std::min(rows - 1, (int)((centers[i].z - centers[i].w - gridMin.y) / cellSize));
+		int z1 = std::min(rows - 1, (int)((centers[i].z + centers[i].w - gridMin.y) / cellSize));
+		for (int z = z0; z <= z1; z++)
+			for (int x = x0; x <= x1; x++)
+				cellItems[cellCursor[z * columns + x]++] = (int)i;
+	}
+}
+
+
+/*****************************************************************************
+ * bool SphereGrid::Raycast(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit) const
+ *
+ * Descrição:
+ * ----------
+ * Procura a esfera mais próxima atingida por um raio. O raio é primeiro cortado
+ * pela caixa da grelha (incluindo as alturas das esferas) e depois percorre as
+ * células que atravessa, da mais próxima para a mais distante. Como uma esfera
+ * pode estar em várias células, um ponto atingido só é aceite quando está antes
+ * da saída da célula atual; até lá as células seguintes ainda podem ter uma
+ * esfera mais próxima.
+ *
+ * Parâmetros:
+ * -----------
+ * - origin: A origem do raio.
+ * - direction: A direção do raio (não precisa de estar normalizada).
+ * - hit: Recebe o índice da esfera, o ponto atingido e a distância.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o raio atingir alguma esfera.
+ *
+ ******************************************************************************/
+bool SphereGrid::Raycast(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit) const {
+	hit.index = -1;
+	hit.distance = FLT_MAX;
+	if (columns == 0 || glm::length(direction) == 0.0f)
+		return false;
+
+	glm::vec3 dir = glm::normalize(direction);
+	glm::vec3 boxMin(gridMin.x, minY, gridMin.y);
+	glm::vec3 boxMax(gridMin.x + columns * cellSize, maxY, gridMin.y + rows * cellSize);
+
+	// Corte do raio pela caixa da grelha (método das placas)
+	float tEnter = 0.0f, tExit = FLT_MAX;
+	for (int axis = 0; axis < 3; axis++) {
+		if (dir[axis] == 0.0f) {
+			if (origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis])
+				return false;
+			continue;
+		}
+		float t0 = (boxMin[axis] - origin[axis]) / dir[axis];
+		float t1 = (boxMax[axis] - origin[axis]) / dir[axis];
+		if (t0 > t1)
+			std::swap(t0, t1);
+		tEnter = std::max(tEnter, t0);
+		tExit = std::min(tExit, t1);
+	}
+	if (tEnter > tExit)
+		return false;
+
+	// Célula onde o raio entra na grelha e parâmetros do percurso
+	glm::vec3 entry = origin + dir * tEnter;
+	int cellX = glm::clamp((int)((entry.x - gridMin.x) / cellSize), 0, columns - 1);
+	int cellZ = glm::clamp((int)((entry.z - gridMin.y) / cellSize), 0, rows - 1);
+	int stepX = dir.x > 0.0f ? 1 : -1;
+	int stepZ = dir.z > 0.0f ? 1 : -1;
+	float nextX = dir.x != 0.0f ? (gridMin.x + (cellX + (stepX > 0 ? 1 : 0)) * cellSize - origin.x) / dir.x : FLT_MAX;
+	float nextZ = dir.z != 0.0f ? (gridMin.y + (cellZ + (stepZ > 0 ? 1 : 0)) * cellSize - origin.z) / dir.z : FLT_MAX;
+	float deltaX = dir.x != 0.0f ? cellSize / std::fabs(dir.x) : FLT_MAX;
+	float deltaZ = dir.z != 0.0f ? cellSize / std::fabs(dir.z) : FLT_MAX;
+
+	for (;;) {
+		int cell = cellZ * columns + cellX;
+		for (int item = cellStart[cell]; item < cellStart[cell + 1]; item++) {
+			int sphere = cellItems[item];
+			float distance;
+			if (sphere != hit.index && IntersectSphere(sphere, origin, dir, distance) && distance < hit.distance) {
+				hit.index = sphere;
+				hit.distance = distance;
+			}
+		}
+
+		float cellExit = std::min(std::min(nextX, nextZ), tExit);
+		if (hit.index >= 0 && hit.distance <= cellExit)
+			break;
+		if (cellExit >= tExit)
+			break;
+
+		if (nextX < nextZ) {
+			cellX += stepX;
+			nextX += deltaX;
+		}
+		else {
+			cellZ += stepZ;
+			nextZ += deltaZ;
+		}
+		if (cellX < 0 || cellX >= columns || cellZ < 0 || cellZ >= rows)
+			break;
+	}
+
+	if (hit.index < 0)
+		return false;
+
+	hit.point = origin + dir * hit.distance;
+	return true;
+}
+
+
+/*****************************************************************************
+ * bool SphereGrid::IntersectSphere(int sphere, const glm::vec3& origin, const glm::vec3& direction, float& distance) const
+ *
+ * Descrição:
+ * ----------
+ * Interseção de um raio com uma esfera da grelha. Devolve o primeiro ponto de
+ * entrada à frente da origem (ou o ponto de saída, se a origem estiver dentro
+ * da esfera). O discriminante é calculado a partir da distância do centro ao
+ * ponto do raio mais próximo dele, e não como b * b - c, que perde a precisão
+ * quando a esfera é muito pequena em relação à sua distância à origem.
+ *
+ * Parâmetros:
+ * -----------
+ * - sphere: O índice da esfera.
+ * - origin: A origem do raio.
+ * - direction: A direção do raio, normalizada.
+ * - distance: Recebe a distância da origem ao ponto atingido.
+ *
+ * Retorno:
+ * --------
+ * - bool: true se o raio atingir a esfera.
+ *
+ ******************************************************************************/
+bool SphereGrid::IntersectSphere(int sphere, const glm::vec3& origin, const glm::vec3& direction, float& distance) const {
+	glm::vec3 offset = origin - glm::vec3(centers[sphere]);
+	float radius = centers[sphere].w;
+	float b = glm::dot(offset, direction);
+	glm::vec3 closest = offset - b * direction;
+	float discriminant = radius * radius - glm::dot(closest, closest);
+	if (discriminant < 0.0f)
+		return false;
+
+	float root = std::sqrt(discriminant);
+	distance = -b - root;
+	if (distance < 0.0f)
+		distance = -b + root;
+	return distance >= 0.0f;
+}
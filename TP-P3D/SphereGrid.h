@@ -0,0 +1,42 @@
+﻿#ifndef SPHERE_GRID_H
+#define SPHERE_GRID_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+
+// Resultado de um raio lançado contra as esferas da grelha
+struct RayHit {
+	int index;        // Índice da esfera atingida no lote (o mesmo índice da bola), ou -1
+	glm::vec3 point;  // Ponto atingido na superfície da esfera
+	float distance;   // Distância da origem do raio ao ponto, em unidades do raio
+};
+
+// Grelha uniforme no plano xz com as esferas de um lote (fase larga): cada célula guarda as esferas que a tocam, para que
+// um raio só teste as esferas das células que atravessa, pela ordem em que as atravessa
+class SphereGrid {
+public:
+	static const int MAX_CELLS_PER_SPHERE = 4; // Limite do número de células em relação ao número de esferas
+
+	SphereGrid();
+
+	void Build(const SphereBatch& spheres); // Distribui as esferas pelas células (uma vez por quadro)
+	bool Raycast(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit) const; // Esfera mais próxima atingida pelo raio
+
+	size_t GetSphereCount() const { return centers.size(); }
+
+private:
+	std::vector<glm::vec4> centers; // Centro (xyz) e raio (w) de cada esfera
+	std::vector<int> cellStart;     // Primeiro índice de cada célula em cellItems (mais um elemento no fim)
+	std::vector<int> cellItems;     // Índices das esferas, agrupados por célula
+	std::vector<int> cellCursor;    // Posição de escrita de cada célula durante o Build (reutilizado entre quadros)
+
+	glm::vec2 gridMin;   // Canto mínimo da grelha no plano xz
+	float cellSize;      // Lado de cada célula
+	int columns, rows;   // Número de células em x e em z
+	float minY, maxY;    // Alturas mínima e máxima das esferas (o raio só é percorrido entre elas)
+
+	bool IntersectSphere(int sphere, const glm::vec3& origin, const glm::vec3& direction, float& distance) const;
+};
+
+#endif // SPHERE_GRID_H
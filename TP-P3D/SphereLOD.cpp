@@ -0,0 +1,255 @@
+﻿/*****************************************************************************
+ * SphereLOD.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe SphereLOD, que gere os níveis de detalhe (LOD) das bolas. A classe SphereLOD é responsável por:
+ * - Gerar esferas UV com cada vez menos divisões, com o mesmo raio da malha carregada do ficheiro .obj.
+ * - Gerar as coordenadas de textura com o mesmo mapeamento e a mesma costura (seam) das malhas Ball*.obj,
+ *   para que as texturas PoolBalluv*.jpg fiquem alinhadas em todos os níveis.
+ * - Escolher o nível de cada bola a partir do seu raio projetado no ecrã, com histerese para evitar trocas constantes.
+ *
+ * Funções principais:
+ * - SphereLOD(): Construtor da classe SphereLOD.
+ * - Build(float radius, GeometryBuffer& geometry): Gera os níveis 1 a LEVEL_COUNT - 1 no buffer de geometria partilhado.
+ * - GetMesh(int level): Devolve o intervalo de um nível gerado no buffer de geometria.
+ * - SelectLevel(float screenRadius, int currentLevel): Escolhe o nível de detalhe de uma bola.
+ * - GetTriangleCount(int level): Número de triângulos de um nível.
+ * - SetDetailScale(float scale): Reduz o detalhe de todas as bolas (usada pelo QualityGovernor).
+ *
+ * Variáveis e constantes importantes:
+ * - LEVEL_COUNT: Número de níveis, incluindo o nível 0 (a malha original da bola, com 8064 triângulos).
+ * - LEVEL_DIVISIONS: Divisões (longitude x latitude) de cada nível gerado.
+ * - SCREEN_RADIUS_THRESHOLDS: Raio mínimo no ecrã, em píxeis, para usar cada nível.
+ * - HYSTERESIS: Margem relativa que o raio tem de ultrapassar antes de trocar de nível.
+ * - detailScale: Escala aplicada ao raio no ecrã antes de o comparar com os limites.
+ *
+ ******************************************************************************/
+
+#include <cfloat>
+#include <glm/gtc/constants.hpp>
+
+#include "SphereLOD.h"
+
+// Divisões (longitude, latitude) dos níveis gerados; o nível 0 é a malha 64x64 dos ficheiros Ball*.obj
+static const int LEVEL_DIVISIONS[SphereLOD::LEVEL_COUNT][2] = {
+	{ 64, 64 },
+	{ 32, 32 },
+	{ 24, 16 },
+	{ 16, 10 },
+	{ 8, 6 }
+};
+
+// Deslocamento da longitude usado nas coordenadas de textura das malhas Ball*.obj (u = 0.765625 - longitude / 2pi)
+static const float U_OFFSET = 0.765625f;
+
+const float SphereLOD::SCREEN_RADIUS_THRESHOLDS[SphereLOD::LEVEL_COUNT - 1] = { 64.0f, 24.0f, 10.0f, 4.0f };
+const float SphereLOD::HYSTERESIS = 0.15f;
+
+
+/*****************************************************************************
+ * SphereLOD::SphereLOD()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `SphereLOD`. Apenas inicializa os níveis vazios; as
+ * malhas são geradas em `Build`, depois de a malha da bola ter sido carregada.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+SphereLOD::SphereLOD() : detailScale(1.0f) {
+	for (int i = 0; i < LEVEL_COUNT; i++) {
+		levels[i].mesh = { 0, 0, 0 };
+		levels[i].slices = LEVEL_DIVISIONS[i][0];
+		levels[i].stacks = LEVEL_DIVISIONS[i][1];
+	}
+}
+
+
+/*****************************************************************************
+ * void SphereLOD::Build(float radius, GeometryBuffer& geometry)
+ *
+ * Descrição:
+ * ----------
+ * Gera os níveis de detalhe 1 a LEVEL_COUNT - 1. O raio deve ser o da malha
+ * carregada (já escalada em `Ball::Install`), para que todos os níveis tenham o
+ * mesmo tamanho que o nível 0. As malhas são acrescentadas ao buffer de
+ * geometria partilhado, que deve ser enviado para a GPU depois desta chamada.
+ *
+ * Parâmetros:
+ * -----------
+ * - radius: O raio da malha original da bola.
+ * - geometry: O buffer de geometria partilhado pela cena.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void SphereLOD::Build(float radius, GeometryBuffer& geometry) {
+	for (int i = 1; i < LEVEL_COUNT; i++) {
+		BuildLevel(levels[i], radius, geometry);
+	}
+}
+
+
+/*****************************************************************************
+ * void SphereLOD::BuildLevel(Level& level, float radius, GeometryBuffer& geometry)
+ *
+ * Descrição:
+ * ----------
+ * Gera uma esfera UV com `level.slices` divisões em longitude e `level.stacks`
+ * em latitude e acrescenta-a ao buffer de geometria partilhado, com o formato
+ * de vértice comum (posição, normal e coordenada de textura).
+ *
+ * As coordenadas de textura seguem o mapeamento das malhas Ball*.obj:
+ * u = 0.765625 - longitude / 2pi e v = 1 - latitude / pi. A coluna da costura
+ * (u = 0 e u = 1) é duplicada, e nos polos cada triângulo tem o seu próprio
+ * vértice com u no centro da fatia, como nos ficheiros originais.
+ *
+ * Parâmetros:
+ * -----------
+ * - level: O nível a gerar (slices e stacks já definidos).
+ * - radius: O raio da esfera.
+ * - geometry: O buffer de geometria partilhado pela cena.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void SphereLOD::BuildLevel(Level& level, float radius, GeometryBuffer& geometry) {
+	std::vector<Vertex> vertices;
+	std::vector<GLuint> indices;
+
+	const int slices = level.slices;
+	const int stacks = level.stacks;
+
+	for (int i = 0; i <= stacks; i++) {
+		float v = 1.0f - (float)i / stacks;
+		float theta = glm::pi<float>() * i / stacks;
+
+		for (int j = 0; j <= slices; j++) {
+			float u = (float)j / slices;
+
+			// Nos polos todos os vértices coincidem, mas cada triângulo usa o u do centro da sua fatia
+			if (i == 0 || i == stacks)
+				u = (j + 0.5f) / slices;
+
+			float phi = glm::two_pi<float>() * (U_OFFSET - u);
+			glm::vec3 normal(glm::sin(theta) * glm::cos(phi), glm::cos(theta), glm::sin(theta) * glm::sin(phi));
+			glm::vec3 position = normal * radius;
+
+			vertices.push_back({ position, normal, glm::vec2(u, v) });
+		}
+	}
+
+	for (int i = 0; i < stacks; i++) {
+		for (int j = 0; j < slices; j++) {
+			GLuint a = i * (slices + 1) + j;
+			GLuint b = (i + 1) * (slices + 1) + j;
+			GLuint c = b + 1;
+			GLuint d = a + 1;
+
+			if (i != 0)
+				indices.insert(indices.end(), { a, b, d });
+			if (i != stacks - 1)
+				indices.insert(indices.end(), { d, b, c });
+		}
+	}
+
+	level.mesh = geometry.AddMesh(vertices, indices);
+}
+
+
+/*****************************************************************************
+ * const MeshRange& SphereLOD::GetMesh(int level)
+ *
+ * Descrição:
+ * ----------
+ * Devolve o intervalo de um nível gerado no buffer de geometria partilhado, para
+ * ser usado num comando de desenho indireto. O nível 0 é a malha da própria bola.
+ *
+ * Parâmetros:
+ * -----------
+ * - level: O nível (1 a LEVEL_COUNT - 1).
+ *
+ * Retorno:
+ * --------
+ * - const MeshRange&: O intervalo do nível (vazio para níveis inválidos).
+ *
+ ******************************************************************************/
+const MeshRange& SphereLOD::GetMesh(int level) const {
+	if (level <= 0 || level >= LEVEL_COUNT)
+		return levels[0].mesh;
+
+	return levels[level].mesh;
+}
+
+
+/*****************************************************************************
+ * int SphereLOD::SelectLevel(float screenRadius, int currentLevel)
+ *
+ * Descrição:
+ * ----------
+ * Escolhe o nível de detalhe de uma bola a partir do seu raio projetado no ecrã.
+ * O nível atual é mantido enquanto o raio estiver dentro dos limites desse nível
+ * alargados pela histerese, para que uma bola perto de um limite não troque de
+ * malha em todos os quadros. O raio é primeiro multiplicado pela escala de
+ * `SetDetailScale`, que o QualityGovernor baixa para usar níveis mais simples.
+ *
+ * Parâmetros:
+ * -----------
+ * - screenRadius: O raio da bola projetado no ecrã, em píxeis.
+ * - currentLevel: O nível usado no quadro anterior.
+ *
+ * Retorno:
+ * --------
+ * - int: O nível a usar neste quadro (0 = malha original).
+ *
+ ******************************************************************************/
+int SphereLOD::SelectLevel(float screenRadius, int currentLevel) const {
+	screenRadius *= detailScale;
+
+	if (currentLevel >= 0 && currentLevel < LEVEL_COUNT) {
+		float lower = currentLevel < LEVEL_COUNT - 1 ? SCREEN_RADIUS_THRESHOLDS[currentLevel] * (1.0f - HYSTERESIS) : 0.0f;
+		float upper = currentLevel > 0 ? SCREEN_RADIUS_THRESHOLDS[currentLevel - 1] * (1.0f + HYSTERESIS) : FLT_MAX;
+
+		if (screenRadius >= lower && screenRadius < upper)
+			return currentLevel;
+	}
+
+	int level = 0;
+	while (level < LEVEL_COUNT - 1 && screenRadius < SCREEN_RADIUS_THRESHOLDS[level])
+		level++;
+
+	return level;
+}
+
+
+/*****************************************************************************
+ * int SphereLOD::GetTriangleCount(int level)
+ *
+ * Descrição:
+ * ----------
+ * Devolve o número de triângulos de um nível.
+ *
+ * Parâmetros:
+ * -----------
+ * - level: O nível (0 a LEVEL_COUNT - 1).
+ *
+ * Retorno:
+ * --------
+ * - int: O número de triângulos do nível, ou 0 se o nível não existir.
+ *
+ ******************************************************************************/
+int SphereLOD::GetTriangleCount(int level) const {
+	if (level < 0 || level >= LEVEL_COUNT)
+		return 0;
+
+	const Level& l = levels[level];
+	return 2 * l.slices * (l.stacks - 1);
+}
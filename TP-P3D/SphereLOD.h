@@ -0,0 +1,36 @@
+﻿#ifndef SPHERE_LOD_H
+#define SPHERE_LOD_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "GeometryBuffer.h"
+
+class SphereLOD {
+public:
+	static const int LEVEL_COUNT = 5; // Nível 0 = malha original da bola, níveis 1 a 4 = esferas geradas
+
+	SphereLOD();
+
+	void Build(float radius, GeometryBuffer& geometry); // Gera as esferas dos níveis 1 a LEVEL_COUNT - 1 no buffer de geometria
+	const MeshRange& GetMesh(int level) const; // Malha de um nível gerado (o nível 0 é a malha da própria bola)
+	int SelectLevel(float screenRadius, int currentLevel) const; // Escolhe o nível a partir do raio projetado, com histerese
+	int GetTriangleCount(int level) const; // Número de triângulos de um nível gerado
+	void SetDetailScale(float scale) { detailScale = scale; } // Multiplica o raio no ecrã antes de escolher o nível (< 1 = menos detalhe)
+
+private:
+	struct Level {
+		MeshRange mesh;     // Intervalo do nível no buffer de geometria partilhado
+		int slices, stacks; // Divisões em longitude e latitude
+	};
+
+	Level levels[LEVEL_COUNT]; // Níveis de detalhe (levels[0] não é usado)
+	float detailScale;         // Escala do raio no ecrã definida pelo QualityGovernor (1 = limites originais)
+
+	static const float SCREEN_RADIUS_THRESHOLDS[LEVEL_COUNT - 1]; // Raio mínimo (píxeis) para usar cada nível
+	static const float HYSTERESIS; // Margem relativa antes de trocar de nível
+
+	void BuildLevel(Level& level, float radius, GeometryBuffer& geometry);
+};
+
+#endif // SPHERE_LOD_H
@@ -5,21 +5,33 @@
  * ----------
  * Este arquivo contm a implementao da classe Table, que representa a mesa de bilhar no jogo. A classe Table  responsvel por:
  * - Carregar e definir os vrtices e ndices que compem a geometria da mesa.
- * - Configurar os buffers de vrtices (VBO) e de elementos (EBO) para armazenar os dados da mesa.
- * - Renderizar a mesa no ecr ao utilizar um programa de shader especfico.
- * - Configurar a iluminao da mesa, que inclui a luz ambiente, direcional, luz pontual e spot.
+ * - Acrescentar a geometria da mesa ao buffer de geometria partilhado pela cena (GeometryBuffer).
+ * - Adicionar a mesa  fila de desenho de cada quadro, com um programa de shader especfico.
+ * - Configurar a iluminao da mesa, que inclui a luz ambiente, direcional, luz pontual e spot, escrevendo
+ *   os blocos de uniforms da mesa no buffer de cada quadro (FrameUploadBuffer).
  *
  * Funes principais:
- * - Table(GLuint tableProgram, Camera* camera, Lights* lights): Construtor da classe Table.
- * - ~Table(): Destrutor da classe Table, que libera os recursos alocados.
- * - Load(): Carrega os dados da mesa (vrtices, ndices) e configura os buffers.
- * - Render(): Renderiza a mesa no ecr, ao aplicar as transformaes de cmera e configuraes de luz.
+ * - Table(const GLuint* tablePrograms, Camera* camera, Lights* lights, GeometryBuffer& geometry): Construtor da classe Table.
+ * - Load(GeometryBuffer& geometry): Acrescenta os dados da mesa (vrtices, ndices) ao buffer de geometria.
+ * - Render(RenderQueue& queue): Adiciona a mesa  fila de desenho, com as transformaes de cmera e as suas luzes.
+ * - RenderInstances(RenderQueue& queue, const glm::vec3* positions, size_t count): Adiciona vrias cpias da mesa (a
+ *   mesa principal e as mesas da sala de bilhar), com um nico bloco de luzes, para que fiquem no mesmo lote.
+ * - SetUploadBuffer(FrameUploadBuffer* uploadBuffer): Define o buffer de uniforms de cada quadro.
+ * - SetPrograms(const GLuint* tablePrograms, GLuint viewCount): Troca os programas da mesa (variantes com vrias vistas).
+ * - GetBoundingSphere(): Retorna a esfera envolvente da mesa, usada no recorte por volume de visualizao.
+ * - GetShadowCaster(): Retorna a mesa como objeto que projeta sombras.
+ * - GetMaterial(): Retorna o material da mesa, guardado no buffer de materiais da cena.
  *
  * Variveis e constantes importantes:
- * - VAO, VBO, EBO: Identificadores dos objetos de vertex array, vertex buffer e element buffer, respectivamente.
- * - tableProgram: Identificador do programa de shader usado para renderizar a mesa.
+ * - mesh: Intervalo da malha da mesa no buffer de geometria partilhado.
+ * - materialIndex: ndice do material da mesa no buffer de materiais.
+ * - geometryPtr: Buffer de geometria partilhado, cujo VAO  usado para desenhar a mesa.
+ * - tablePrograms: Programas de shader usados para renderizar a mesa, um por variante de iluminao.
+ * - viewCount: Vistas desenhadas na mesma passagem pelos programas atuais (MultiView).
  * - cameraPtr: Ponteiro para o objeto da cmera.
  * - lightsPtr: Ponteiro para o objeto das luzes.
+ * - bounds: Esfera envolvente da geometria da mesa.
+ * - uploadPtr: Buffer de uniforms de cada quadro, onde a mesa escreve as suas luzes e matrizes.
  * - vertices: Array que armazena as coordenadas dos vrtices da mesa.
  * - indices: Array que armazena os ndices dos vrtices para formar os tringulos da mesa.
  *
@@ -29,20 +41,22 @@
 #include "LoadShaders.h"
 
  /*****************************************************************************
- * Table::Table(GLuint tableProgram, Camera* camera, Lights* lights)
+ * Table::Table(const GLuint* tablePrograms, Camera* camera, Lights* lights, GeometryBuffer& geometry)
  *
  * Descrio:
  * ----------
  * Este  o construtor da classe `Table`, responsvel por inicializar uma nova
- * instncia da mesa de bilhar. Ele recebe como parmetros o programa de shader
- * a ser utilizado para renderizar a mesa, um apontador para a cmera e um apontador
- * para as luzes do jogo.
+ * instncia da mesa de bilhar. Ele recebe como parmetros os programas de shader
+ * a serem utilizados para renderizar a mesa (um por variante de iluminao), um apontador para a cmera, um apontador
+ * para as luzes do jogo e o buffer de geometria onde a malha da mesa  guardada.
  *
  * Parmetros:
  * -----------
- * - tableProgram: O identificador do programa de shader a ser utilizado para renderizar a mesa.
+ * - tablePrograms: Os programas de shader da mesa, indexados por `Lights::GetShaderVariant`
+ *  (Lights::VARIANT_COUNT programas, que tm de existir enquanto a mesa existir).
  * - camera: Ponteiro para o objeto da cmera do jogo.
  * - lights: Ponteiro para o objeto das luzes do jogo.
+ * - geometry: O buffer de geometria partilhado pela cena (ainda no enviado para a GPU).
  *
  * Retorno:
  * --------
@@ -56,63 +70,31 @@
  *  que os dados da mesa estejam prontos para a renderizao.
  *
  ******************************************************************************/
-Table::Table(GLuint tableProgram, Camera* camera, Lights* lights) : tableProgram(tableProgram), cameraPtr(camera), lightsPtr(lights) {
-	Load();
+Table::Table(const GLuint* tablePrograms, Camera* camera, Lights* lights, GeometryBuffer& geometry) : mesh(), materialIndex(0), geometryPtr(&geometry), tablePrograms(tablePrograms), cameraPtr(camera), lightsPtr(lights), bounds(), uploadPtr(nullptr), viewCount(1) {
+	Load(geometry);
 }
 
 
 /*****************************************************************************
- * Table::~Table()
+ * void Table::Load(GeometryBuffer& geometry)
  *
  * Descrio:
  * ----------
- * Este  o destrutor da classe `Table`, responsvel por liberar os recursos
- * alocados durante a criao e utilizao da mesa de bilhar, como os buffers
- * OpenGL (Vertex Array Object - VAO, Vertex Buffer Object - VBO e Element Buffer Object - EBO).
+ * Esta funo membro da classe `Table`  responsvel por carregar os dados da geometria da mesa de bilhar.
+ * Ela define os vrtices e ndices que compem a mesa e acrescenta-os ao buffer de geometria partilhado,
+ * que  enviado para a placa grfica (GPU) em Source.cpp, depois de todas as malhas da cena terem sido
+ * adicionadas. Assim a mesa e as bolas so desenhadas com o mesmo VAO.
  *
  * Parmetros:
  * -----------
- * - Nenhum.
- *
- * Retorno:
- * --------
- * - Nenhum (destrutor).
- *
- * Observaes:
- * -----------
- * - O destrutor  chamado automaticamente quando um objeto da classe `Table`  destrudo.
- * - A liberao dos recursos OpenGL  importante para evitar vazamentos de memria
- *  e garantir que os recursos da GPU sejam utilizados de forma eficiente.
- *
- ******************************************************************************/
-Table::~Table() {
-	// Cleanup
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
-}
-
-
-/*****************************************************************************
- * void Table::Load()
- *
- * Descrio:
- * ----------
- * Esta funo membro da classe `Table`  responsvel por carregar os dados da geometria da mesa de bilhar
- * e configurar os buffers OpenGL necessrios para a renderizao. Ela define os vrtices e ndices que
- * compem a mesa, cria e vincula os objetos Vertex Array Object (VAO), Vertex Buffer Object (VBO) e
- * Element Buffer Object (EBO), e envia os dados para a placa grfica (GPU).
- *
- * Parmetros:
- * -----------
- * - Nenhum.
+ * - geometry: O buffer de geometria partilhado pela cena.
  *
  * Retorno:
  * --------
  * - Nenhum (void).
  *
  ******************************************************************************/
-void Table::Load() {
+void Table::Load(GeometryBuffer& geometry) {
 
 	GLfloat vertices[] = {
 		// Frente       //Normal
@@ -178,134 +160,216 @@ void Table::Load() {
 		22, 23, 20
 	};
 
-	// Gera um nico objeto de VAO (Vertex Array Object)
-	glGenVertexArrays(1, &VAO);
-
-	// Gera um nico buffer de vrtices (VBO) e um nico buffer de elementos (EBO)
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
-
-	// Define o VAO atual, vincula-o
-	glBindVertexArray(VAO);
-
-	// Vincula o VBO como um buffer do tipo GL_ARRAY_BUFFER
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-	// Armazena os vrtices no VBO
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW); // Tipo de buffer, tamanho, dados, uso dos dados
+	// Esfera envolvente calculada a partir das posies (6 floats por vrtice: posio + normal)
+	bounds = ComputeBoundingSphere(vertices, sizeof(vertices) / (6 * sizeof(GLfloat)), 6);
 
-	// Vincula o EBO como um buffer do tipo GL_ELEMENT_ARRAY_BUFFER
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	// Configura o VAO para o OpenGL saber como ler o VBO
-	// Especifica o layout do atributo de vrtice 0
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-
-	// Especifica o layout do atributo de vrtice 1
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-
-	// Habilita o atributo de vrtice 0
-	glEnableVertexAttribArray(0);
-	// Habilita o atributo de vrtice 1
-	glEnableVertexAttribArray(1);
+	// Converte para o formato de vrtice comum; a mesa no tem textura, por isso as coordenadas de textura so zero
+	std::vector<Vertex> meshVertices;
+	for (size_t i = 0; i < sizeof(vertices) / sizeof(GLfloat); i += 6) {
+		glm::vec3 position(vertices[i], vertices[i + 1], vertices[i + 2]);
+		glm::vec3 normal(vertices[i + 3], vertices[i + 4], vertices[i + 5]);
+		meshVertices.push_back({ position, normal, glm::vec2(0.0f) });
+	}
 
-	// No obrigatrio, mas para garantir que no alteramos o VAO e o VBO acidentalmente
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	std::vector<GLuint> meshIndices(indices, indices + sizeof(indices) / sizeof(GLuint));
+	mesh = geometry.AddMesh(meshVertices, meshIndices);
+}
 
-	// Isso deve ser feito aps o VAO, porque o EBO est armazenado no VAO
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
+/*****************************************************************************
+ * MaterialBlock Table::GetMaterial() const
+ *
+ * Descrio:
+ * ----------
+ * Devolve o material da mesa, no layout do buffer de materiais. O material 
+ * constante e  guardado, com os materiais das bolas, num buffer imutvel criado
+ * em Source.cpp.
+ *
+ * Parmetros:
+ * -----------
+ * - Nenhum.
+ *
+ * Retorno:
+ * --------
+ * - MaterialBlock: O material da mesa.
+ *
+ ******************************************************************************/
+MaterialBlock Table::GetMaterial() const {
+	MaterialBlock material = {};
+	material.ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+	material.diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
+	material.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+	material.shininess = 32.0f;
+
+	return material;
 }
 
 /*****************************************************************************
- * void Table::Render()
+ * void Table::Render(RenderQueue& queue)
  *
  * Descrio:
  * ----------
  * Esta funo membro da classe `Table`  responsvel por renderizar a mesa de
- * bilhar na cena. Ela utiliza o Vertex Array Object (VAO) previamente carregado,
- * configura as matrizes de transformao (modelo, visualizao e projeo) e
- * os parmetros de iluminao do shader, e finalmente desenha a mesa no ecr.
+ * bilhar na cena. Ela escreve no buffer de uniforms do quadro as luzes da mesa e
+ * adiciona a mesa  fila de desenho, com o programa da mesa e os dados de objeto
+ * (matrizes de modelo e modelo-vista e ndice do material). A fila troca o
+ * programa e o bloco de luzes s quando chega  mesa, por isso a mesa j no
+ * repe o programa no fim. As matrizes da cmera (bloco CameraData) so escritas
+ * em Source.cpp.
  *
  * Parmetros:
  * -----------
- * - Nenhum.
+ * - queue: A fila de desenho do quadro.
  *
  * Retorno:
  * --------
  * - Nenhum (void).
  *
  ******************************************************************************/
-void Table::Render()
+void Table::Render(RenderQueue& queue)
 {
-	glBindVertexArray(VAO);
-
-	glUseProgram(tableProgram);
-
-	int modelLoc = glGetUniformLocation(tableProgram, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(cameraPtr->model));
-	int viewLoc = glGetUniformLocation(tableProgram, "view");
-	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(cameraPtr->view * cameraPtr->getMatrizZoom()));
-	int projLoc = glGetUniformLocation(tableProgram, "proj");
-	glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(cameraPtr->proj));
-
-	glUniform1i(glGetUniformLocation(tableProgram, "ambientLightEnabled"), lightsPtr->isAmbientLightEnabled);
-	glUniform1i(glGetUniformLocation(tableProgram, "directionalLightEnabled"), lightsPtr->isDirectionalLightEnabled);
-	glUniform1i(glGetUniformLocation(tableProgram, "pointLightEnabled"), lightsPtr->isPointLightEnabled);
-	glUniform1i(glGetUniformLocation(tableProgram, "spotLightEnabled"), lightsPtr->isSpotLightEnabled);
+	glm::vec3 origin(0.0f);
+	RenderInstances(queue, &origin, 1);
+}
 
-	glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "material.ambient"), 1, glm::value_ptr(glm::vec3(0.2f, 0.2f, 0.2f)));
-	glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "material.diffuse"), 1, glm::value_ptr(glm::vec3(0.8f, 0.8f, 0.8f)));
-	glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "material.specular"), 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 1.0f)));
-	glProgramUniform1f(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "material.shininess"), 32.0f);
 
-	if (lightsPtr->isAmbientLightEnabled) {
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "ambientLight.ambient"), 1, glm::value_ptr(glm::vec3(0.8, 0.8, 0.8)));
+/*****************************************************************************
+ * void Table::RenderInstances(RenderQueue& queue, const glm::vec3* positions, size_t count)
+ *
+ * Descrio:
+ * ----------
+ * Adiciona  fila uma cpia da mesa em cada posio. O bloco de luzes da mesa
+ *  escrito uma nica vez e partilhado por todas as cpias, por isso tm todas
+ * o mesmo estado e a fila desenha-as num s comando instanciado. As cpias s
+ * diferem na translao, por isso a matriz das normais  a mesma para todas.
+ *
+ * Parmetros:
+ * -----------
+ * - queue: A fila de desenho do quadro.
+ * - positions: As posies das cpias (a mesa principal est na origem).
+ * - count: O nmero de cpias.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Table::RenderInstances(RenderQueue& queue, const glm::vec3* positions, size_t count)
+{
+	if (uploadPtr == nullptr || count == 0)
+		return;
+
+	// As luzes da mesa tm intensidades diferentes das luzes das bolas, por isso a mesa escreve o seu prprio bloco
+	LightBlock lights = lightsPtr->GetTableLights();
+	GLintptr lightOffset = uploadPtr->Allocate(&lights, sizeof(LightBlock));
+	if (lightOffset < 0)
+		return;
+
+	ObjectBlock object = {};
+	object.normalMatrix = Camera::getNormalMatrix(cameraPtr->zoomView);
+	object.materialIndex = materialIndex;
+
+	DrawState state = { tablePrograms[lightsPtr->GetShaderVariant()], geometryPtr->GetVertexArray(), 0, lightOffset, false, viewCount };
+	for (size_t i = 0; i < count; i++) {
+		object.model = glm::translate(glm::mat4(1.0f), positions[i]);
+		object.modelView = cameraPtr->zoomView * object.model;
+		queue.Add(state, mesh, object);
 	}
+}
 
-	if (lightsPtr->isDirectionalLightEnabled) {
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "directionalLight.direction"), 1, glm::value_ptr(glm::vec3(1.0, -0.5, 0.0)));
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "directionalLight.ambient"), 1, glm::value_ptr(glm::vec3(0.2, 0.2, 0.2)));
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "directionalLight.diffuse"), 1, glm::value_ptr(glm::vec3(1.0, 1.0, 1.0)));
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "directionalLight.specular"), 1, glm::value_ptr(glm::vec3(0.5, 0.5, 0.5)));
-	}
 
-	if (lightsPtr->isPointLightEnabled) {
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "pointLight.position"), 1, glm::value_ptr(glm::vec3(0.0, 0.0, 0.0)));
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "pointLight.ambient"), 1, glm::value_ptr(glm::vec3(0.1, 0.1, 0.1)));
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "pointLight.diffuse"), 1, glm::value_ptr(glm::vec3(2.0, 2.0, 2.0)));
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "pointLight.specular"), 1, glm::value_ptr(glm::vec3(2.0, 2.0, 2.0)));
-		glProgramUniform1f(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "pointLight.constant"), 1.0f);
-		glProgramUniform1f(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "pointLight.linear"), 0.06f);
-		glProgramUniform1f(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "pointLight.quadratic"), 0.02f);
-	}
+/*****************************************************************************
+ * BoundingSphere Table::GetBoundingSphere() const
+ *
+ * Descrio:
+ * ----------
+ * Devolve a esfera envolvente da mesa, calculada em `Load` a partir dos seus
+ * vrtices. A mesa  desenhada com a matriz de modelo identidade, por isso a
+ * esfera j est no mesmo espao que as posies das bolas.
+ *
+ * Parmetros:
+ * -----------
+ * - Nenhum.
+ *
+ * Retorno:
+ * --------
+ * - BoundingSphere: A esfera envolvente da mesa.
+ *
+ ******************************************************************************/
+BoundingSphere Table::GetBoundingSphere() const {
+	return bounds;
+}
 
-	glm::vec3 spotLightPosition(0.0f, 2.0f, 0.0f);    // Posio da luz (acima da mesa)
-	glm::vec3 spotLightDirection(0.0f, -1.0f, 0.0f);  // Direo da luz (para baixo)
-	if (lightsPtr->isSpotLightEnabled) {
 
+/*****************************************************************************
+ * ShadowCaster Table::GetShadowCaster() const
+ *
+ * Descrio:
+ * ----------
+ * Devolve a mesa como objeto que projeta sombras. A mesa nunca se move, por
+ * isso fica sempre no mapa de sombras guardado.
+ *
+ * Parmetros:
+ * -----------
+ * - Nenhum.
+ *
+ * Retorno:
+ * --------
+ * - ShadowCaster: A malha da mesa, com a matriz identidade.
+ *
+ ******************************************************************************/
+ShadowCaster Table::GetShadowCaster() const {
+	ShadowCaster caster;
+	caster.mesh = mesh;
+	caster.model = glm::mat4(1.0f);
+	caster.isStatic = true;
 
-		// Define a posio da luz spot
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "spotLight.position"), 1, glm::value_ptr(spotLightPosition));
+	return caster;
+}
 
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "spotLight.direction"), 1, glm::value_ptr(glm::vec3(1.0, -0.5, 0.0)));
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "spotLight.ambient"), 1, glm::value_ptr(glm::vec3(0.1f, 0.1f, 0.1f)));
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "spotLight.diffuse"), 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 1.0f)));
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "spotLight.specular"), 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 1.0f)));
-		glProgramUniform1f(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "spotLight.constant"), 1.0f);
-		glProgramUniform1f(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "spotLight.linear"), 0.09f);
-		glProgramUniform1f(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "spotLight.quadratic"), 0.032f);
-		glProgramUniform1f(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "spotLight.spotCutoff"), glm::cos(glm::radians(25.0f)));
-		glProgramUniform1f(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "spotLight.spotExponent"), 3.0f);
 
-		// Define a direo da luz spot
-		glProgramUniform3fv(tableProgram, glGetProgramResourceLocation(tableProgram, GL_UNIFORM, "spotLight.spotDirection"), 1, glm::value_ptr(spotLightDirection));
-	}
+/*****************************************************************************
+ * void Table::SetUploadBuffer(FrameUploadBuffer* uploadBuffer)
+ *
+ * Descrio:
+ * ----------
+ * Define o buffer de uniforms de cada quadro, onde `Render` escreve o bloco
+ * LightData da mesa.
+ *
+ * Parmetros:
+ * -----------
+ * - uploadBuffer: Ponteiro para o buffer de uniforms de cada quadro.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Table::SetUploadBuffer(FrameUploadBuffer* uploadBuffer) {
+	uploadPtr = uploadBuffer;
+}
 
-	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
 
-	glUseProgram(0);
+/*****************************************************************************
+ * void Table::SetPrograms(const GLuint* tablePrograms, GLuint viewCount)
+ *
+ * Descrio:
+ * ----------
+ * Troca os programas de shader com que a mesa  desenhada, por exemplo pelas
+ * variantes compiladas com MULTI_VIEW, que desenham a mesa em todas as vistas
+ * da mesma passagem (viewCount instncias).
+ *
+ * Parmetros:
+ * -----------
+ * - tablePrograms: Os programas da mesa, indexados por `Lights::GetShaderVariant`.
+ * - viewCount: O nmero de vistas desenhadas por esses programas (1 sem MultiView).
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void Table::SetPrograms(const GLuint* tablePrograms, GLuint viewCount) {
+	this->tablePrograms = tablePrograms;
+	this->viewCount = viewCount;
 }
-
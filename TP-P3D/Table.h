@@ -7,22 +7,39 @@
 #include <glm/gtc/type_ptr.hpp>
 #include "Camera.h"
 #include "Lights.h"
+#include "Frustum.h"
+#include "FrameUploadBuffer.h"
+#include "GeometryBuffer.h"
+#include "RenderQueue.h"
+#include "ShadowMaps.h"
+#include "UniformBlocks.h"
 
 class Table {
 public:
-	Table(GLuint tableProgram, Camera* camera, Lights* lights); // Construtor da mesa
-	~Table(); // Destrutor da mesa
+	Table(const GLuint* tablePrograms, Camera* camera, Lights* lights, GeometryBuffer& geometry); // Construtor da mesa
 
-	void Render(); // Renderiza a mesa
+	void Render(RenderQueue& queue); // Adiciona a mesa  fila de desenho
+	void RenderInstances(RenderQueue& queue, const glm::vec3* positions, size_t count); // Adiciona cpias da mesa (PoolHall) no mesmo lote
+	BoundingSphere GetBoundingSphere() const; // Esfera envolvente da mesa
+	ShadowCaster GetShadowCaster() const; // Mesa como objeto que projeta sombras (sempre parada)
+	void SetUploadBuffer(FrameUploadBuffer* uploadBuffer); // Define o buffer de uniforms de cada quadro
+	void SetPrograms(const GLuint* tablePrograms, GLuint viewCount); // Troca os programas da mesa e as vistas que desenham
+	void SetMaterialIndex(GLint index) { materialIndex = index; } // Define o ndice do material da mesa
+	MaterialBlock GetMaterial() const; // Material da mesa
 
 private:
-	GLuint VAO, VBO, EBO; // Vertex Array Object, Vertex Buffer Object e Element Buffer Object
+	MeshRange mesh;       // Malha da mesa no buffer de geometria partilhado
+	GLint materialIndex;  // ndice do material da mesa no buffer de materiais
+	GeometryBuffer* geometryPtr; // Buffer de geometria onde est a malha da mesa
 
-	GLuint tableProgram;  // Programa de shader da mesa
+	const GLuint* tablePrograms; // Programas de shader da mesa, um por variante de iluminao (Lights::VARIANT_COUNT)
 	Camera* cameraPtr;  // Ponteiro para a cmera
 	Lights* lightsPtr;  // Ponteiro para as luzes
+	BoundingSphere bounds; // Esfera envolvente da geometria da mesa
+	FrameUploadBuffer* uploadPtr; // Ponteiro para o buffer de uniforms de cada quadro
+	GLuint viewCount;   // Vistas desenhadas na mesma passagem pelos programas atuais
 
-	void Load(); // Carrega os dados da mesa (vrtices, ndices, etc.)
+	void Load(GeometryBuffer& geometry); // Carrega os dados da mesa (vrtices, ndices, etc.)
 };
 
 #endif // TABLE_H
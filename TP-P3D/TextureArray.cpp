@@ -0,0 +1,264 @@
+﻿/*****************************************************************************
+ * TextureArray.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe TextureArray, que junta as texturas das bolas num único array de texturas.
+ * A classe TextureArray é responsável por:
+ * - Criar a textura GL_TEXTURE_2D_ARRAY sem conteúdo, que o TextureStreamer preenche camada a camada e nível a nível
+ *   (a partir de PoolBalls.ktx2, preparado offline pelo TextureCooker, ou das imagens PoolBalluv*.jpg).
+ * - Registar os níveis já enviados de cada camada, para que todas as bolas sejam desenhadas sem trocar de textura;
+ *   cada bola escolhe a sua camada no shader.
+ * - Ler e validar o cabeçalho dos ficheiros KTX2.
+ *
+ * Funções principais:
+ * - TextureArray(): Construtor da classe TextureArray.
+ * - ~TextureArray(): Destrutor, que liberta a textura.
+ * - Allocate(...): Cria o array sem conteúdo, para ser preenchido camada a camada (TextureStreamer).
+ * - SetResidentLevel(GLint layer, GLint level): Marca os níveis de uma camada que já foram enviados.
+ * - ComputeMemorySize(...): Calcula a memória ocupada por um array com um dado formato e tamanho.
+ * - ReadKTX2(...): Lê e valida o cabeçalho de um ficheiro KTX2.
+ *
+ * Variáveis e constantes importantes:
+ * - texture: Identificador da textura GL_TEXTURE_2D_ARRAY.
+ * - memorySize: Memória ocupada pela textura na GPU (mostrada na consola, para comparar os dois formatos).
+ * - residentLevel: Nível mais detalhado já enviado de cada camada; as camadas sem nenhum nível são desenhadas com uma
+ *   cor provisória, e as restantes não são amostradas abaixo desse nível.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+#include "TextureArray.h"
+
+
+/*****************************************************************************
+ * TextureArray::TextureArray()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `TextureArray`. A textura é criada em `Load`.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+TextureArray::TextureArray() : texture(0), memorySize(0), levelCount(0) {
+}
+
+
+/*****************************************************************************
+ * TextureArray::~TextureArray()
+ *
+ * Descrição:
+ * ----------
+ * Destrutor da classe `TextureArray`, que liberta a textura.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (destrutor).
+ *
+ ******************************************************************************/
+TextureArray::~TextureArray() {
+	glDeleteTextures(1, &texture);
+}
+
+
+/*****************************************************************************
+ * void TextureArray::Allocate(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers, GLsizei levels)
+ *
+ * Descrição:
+ * ----------
+ * Cria a textura com o armazenamento de todas as camadas e níveis
+ * (`glTexStorage3D`), sem dados, e deixa-a ligada a GL_TEXTURE0. Nenhuma
+ * camada fica marcada como carregada: o conteúdo é enviado depois, por `Load`,
+ * `LoadCompressed` ou pelo TextureStreamer, que marcam os níveis enviados de
+ * cada camada com `SetResidentLevel`.
+ *
+ * Parâmetros:
+ * -----------
+ * - internalFormat: O formato dos texels (GL_RGB8 ou um formato comprimido).
+ * - width, height: As dimensões do nível 0.
+ * - layers: O número de camadas.
+ * - levels: O número de níveis de mipmap.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void TextureArray::Allocate(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers, GLsizei levels) {
+	glGenTextures(1, &texture);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, internalFormat, width, height, layers);
+	SetSamplerParameters();
+
+	memorySize = ComputeMemorySize(internalFormat, width, height, layers, levels);
+	levelCount = levels;
+	residentLevel.assign(layers, levels);
+}
+
+
+/*****************************************************************************
+ * void TextureArray::SetResidentLevel(GLint layer, GLint level)
+ *
+ * Descrição:
+ * ----------
+ * Marca os níveis de uma camada a partir de `level` como enviados. Os níveis
+ * são enviados do menos para o mais detalhado, por isso basta guardar o mais
+ * detalhado; um nível menos detalhado do que o já marcado não muda nada.
+ *
+ * Parâmetros:
+ * -----------
+ * - layer: A camada.
+ * - level: O nível mais detalhado enviado.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void TextureArray::SetResidentLevel(GLint layer, GLint level) {
+	residentLevel[layer] = std::min(residentLevel[layer], level);
+}
+
+
+/*****************************************************************************
+ * size_t TextureArray::ComputeMemorySize(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers, GLsizei levels)
+ *
+ * Descrição:
+ * ----------
+ * Calcula a memória ocupada na GPU por um array de texturas, somando todos os
+ * níveis de mipmap de todas as camadas. Os formatos comprimidos usam blocos de
+ * 4x4 texels; os drivers guardam GL_RGB8 com 4 bytes por texel.
+ *
+ * Parâmetros:
+ * -----------
+ * - internalFormat: O formato dos texels (GL_RGB8 ou um formato comprimido).
+ * - width, height: As dimensões do nível 0.
+ * - layers: O número de camadas.
+ * - levels: O número de níveis de mipmap.
+ *
+ * Retorno:
+ * --------
+ * - size_t: O tamanho em bytes.
+ *
+ ******************************************************************************/
+size_t TextureArray::ComputeMemorySize(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers, GLsizei levels) {
+	GLsizei blockSize = (internalFormat == GL_COMPRESSED_RGBA_BPTC_UNORM) ? 16 : 8;
+	size_t size = 0;
+	for (GLsizei level = 0; level < levels; level++) {
+		GLsizei levelWidth = std::max(width >> level, 1);
+		GLsizei levelHeight = std::max(height >> level, 1);
+		if (internalFormat == GL_RGB8)
+			size += (size_t)levelWidth * levelHeight * 4 * layers;
+		else
+			size += (size_t)((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockSize * layers;
+	}
+	return size;
+}
+
+
+/*****************************************************************************
+ * bool TextureArray::ReadKTX2(std::ifstream& file, const std::string& fileName, KTX2::Header& header,
+ *                             std::vector<KTX2::LevelIndex>& levelIndex, GLenum& internalFormat)
+ *
+ * Descrição:
+ * ----------
+ * Lê o cabeçalho e o índice dos níveis de um ficheiro KTX2 e verifica se o
+ * array pode ser criado: só são aceites ficheiros 2D sem supercompressão, em
+ * BC1, BC7 ou ETC2, cujo formato seja suportado pelo driver e cujos níveis
+ * tenham o tamanho esperado (todas as camadas de cada nível são contíguas).
+ *
+ * Parâmetros:
+ * -----------
+ * - file: O ficheiro, aberto em modo binário e posicionado no início.
+ * - fileName: O nome do ficheiro (para as mensagens de erro).
+ * - header: Recebe o cabeçalho.
+ * - levelIndex: Recebe a posição e o tamanho de cada nível.
+ * - internalFormat: Recebe o formato OpenGL dos blocos.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se o ficheiro pode ser usado, `false` caso contrário.
+ *
+ ******************************************************************************/
+bool TextureArray::ReadKTX2(std::ifstream& file, const std::string& fileName, KTX2::Header& header,
+	std::vector<KTX2::LevelIndex>& levelIndex, GLenum& internalFormat) {
+	if (!file.read((char*)&header, sizeof(header)) || std::memcmp(header.identifier, KTX2::IDENTIFIER, sizeof(KTX2::IDENTIFIER)) != 0) {
+		std::cout << "Invalid KTX2 file: " << fileName << std::endl;
+		return false;
+	}
+
+	bool supported;
+	switch (header.vkFormat) {
+	case KTX2::FORMAT_BC1_RGB_UNORM:
+		internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		supported = GLEW_EXT_texture_compression_s3tc;
+		break;
+	case KTX2::FORMAT_BC7_UNORM:
+		internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+		supported = GLEW_ARB_texture_compression_bptc;
+		break;
+	case KTX2::FORMAT_ETC2_R8G8B8_UNORM:
+		internalFormat = GL_COMPRESSED_RGB8_ETC2; // Obrigatório desde o OpenGL 4.3
+		supported = true;
+		break;
+	default:
+		internalFormat = GL_NONE;
+		supported = false;
+		break;
+	}
+
+	if (!supported || header.supercompressionScheme != 0 || header.faceCount != 1 || header.pixelDepth != 0
+		|| header.pixelWidth == 0 || header.pixelHeight == 0 || header.levelCount == 0) {
+		std::cout << "Unsupported KTX2 texture format in " << fileName << std::endl;
+		return false;
+	}
+
+	levelIndex.resize(header.levelCount);
+	if (!file.read((char*)levelIndex.data(), levelIndex.size() * sizeof(KTX2::LevelIndex))) {
+		std::cout << "Invalid KTX2 file: " << fileName << std::endl;
+		return false;
+	}
+
+	uint32_t layers = std::max(header.layerCount, 1u);
+	for (uint32_t level = 0; level < header.levelCount; level++) {
+		uint64_t expectedSize = KTX2::LevelSize(header.vkFormat, std::max(header.pixelWidth >> level, 1u),
+			std::max(header.pixelHeight >> level, 1u)) * layers;
+		if (levelIndex[level].byteLength != expectedSize) {
+			std::cout << "Invalid mip level " << level << " in " << fileName << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*****************************************************************************
+ * void TextureArray::SetSamplerParameters()
+ *
+ * Descrição:
+ * ----------
+ * Define os parâmetros de amostragem do array ligado: o texel mais próximo,
+ * como as texturas das bolas já usavam, mas no nível de mipmap mais próximo,
+ * para que as bolas pequenas amostrem os níveis menos detalhados (os únicos
+ * carregados enquanto estão longe).
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void TextureArray::SetSamplerParameters() const {
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
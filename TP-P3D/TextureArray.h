@@ -0,0 +1,42 @@
+﻿#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "KTX2.h"
+
+// Array de texturas 2D (GL_TEXTURE_2D_ARRAY) com uma camada por imagem, todas com o mesmo tamanho
+class TextureArray {
+public:
+	TextureArray();
+	~TextureArray();
+
+	void Allocate(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers, GLsizei levels); // Cria o array vazio (camadas por carregar)
+	GLuint GetTexture() const { return texture; } // Textura GL_TEXTURE_2D_ARRAY (para a fila de desenho)
+	size_t GetMemorySize() const { return memorySize; } // Memória ocupada pela textura na GPU, em bytes (estimada no caso RGB8)
+
+	void SetResidentLevel(GLint layer, GLint level); // Marca os níveis a partir de `level` de uma camada como carregados
+	GLint GetResidentLevel(GLint layer) const { return residentLevel[layer]; } // Nível mais detalhado carregado (GetLevelCount() se nenhum)
+	bool IsLayerResident(GLint layer) const { return layer >= 0 && layer < (GLint)residentLevel.size() && residentLevel[layer] < levelCount; } // A camada já pode ser amostrada?
+	void ClearResidency(GLint layer) { residentLevel[layer] = levelCount; } // Marca a camada como vazia (para ser reutilizada)
+	GLsizei GetLevelCount() const { return levelCount; } // Número de níveis de mipmap
+
+	// Memória ocupada na GPU por um array com este formato e tamanho, em bytes (estimada no caso RGB8)
+	static size_t ComputeMemorySize(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei layers, GLsizei levels);
+
+	// Lê e valida o cabeçalho e o índice dos níveis de um ficheiro KTX2, e devolve o formato OpenGL dos blocos
+	static bool ReadKTX2(std::ifstream& file, const std::string& fileName, KTX2::Header& header,
+		std::vector<KTX2::LevelIndex>& levelIndex, GLenum& internalFormat);
+
+private:
+	GLuint texture;                  // Textura GL_TEXTURE_2D_ARRAY
+	size_t memorySize;                // Bytes de todas as camadas e níveis de mipmap
+	GLsizei levelCount;               // Níveis de mipmap de cada camada
+	std::vector<GLint> residentLevel; // Nível mais detalhado já enviado de cada camada (os seguintes também foram enviados)
+
+	void SetSamplerParameters() const; // Parâmetros de amostragem do array (texel e nível de mipmap mais próximos)
+};
+
+#endif // TEXTURE_ARRAY_H
@@ -0,0 +1,374 @@
+﻿/*****************************************************************************
+ * TextureResidency.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe TextureResidency, que mantém as texturas das bolas na GPU com uma
+ * memória limitada, qualquer que seja o número de bolas. A classe TextureResidency é responsável por:
+ * - Carregar primeiro, para todas as camadas, só os mipmaps com a maior dimensão até TAIL_SIZE (poucos KB por camada),
+ *   num array próprio; até chegarem, a bola é desenhada com a cor provisória.
+ * - Receber, em cada quadro, o raio no ecrã de cada bola desenhada e calcular o nível de mipmap de que precisa.
+ * - Carregar os níveis mais detalhados das bolas grandes no ecrã, um nível de cada vez (do menos para o mais
+ *   detalhado), numa camada de um conjunto de tamanho fixo; o número de camadas do conjunto é definido pelo orçamento
+ *   de memória. Quando não há camadas livres, a camada usada há mais tempo por uma bola que não a pediu no quadro é
+ *   retirada a essa bola.
+ * - Escrever, para os shaders, a camada do conjunto e o nível mais detalhado carregado de cada bola.
+ *
+ * Funções principais:
+ * - StartCompressed(const std::string& fileName): Começa a carregar do array KTX2 preparado pelo TextureCooker.
+ * - StartImages(const std::vector<std::string>& fileNames): Começa a carregar das imagens, uma por camada.
+ * - Request(GLint layer, float screenRadius): Pede os níveis adequados ao tamanho de uma bola no ecrã.
+ * - Update(FrameUploadBuffer& uploadBuffer): Atende os pedidos do quadro e escreve o bloco TextureResidencyData.
+ *
+ * Variáveis e constantes importantes:
+ * - budget: Memória máxima dos dois arrays na GPU, em bytes.
+ * - tail: Mipmaps pequenos de todas as camadas (sempre carregados).
+ * - detail: Conjunto de camadas com os níveis detalhados.
+ * - slots: Bola que usa cada camada do conjunto, nível em carregamento e último quadro em que foi pedida.
+ * - failedLayers: Bolas cuja textura não pôde ser lida; ficam com a cor provisória ou com os níveis já carregados.
+ * - tailFirstLevel: Nível da textura completa que corresponde ao nível 0 de tail.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "TextureResidency.h"
+
+
+/*****************************************************************************
+ * TextureResidency::TextureResidency(size_t budget)
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `TextureResidency`. Os arrays são criados em
+ * `StartCompressed` ou `StartImages`, quando o tamanho das texturas é conhecido.
+ *
+ * Parâmetros:
+ * -----------
+ * - budget: A memória máxima das texturas na GPU, em bytes.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+TextureResidency::TextureResidency(size_t budget)
+	: budget(budget),
+	tailFirstLevel(0),
+	levelCount(0),
+	tailComplete(false),
+	frame(0),
+	stats() {
+}
+
+
+/*****************************************************************************
+ * bool TextureResidency::StartCompressed(const std::string& fileName)
+ *
+ * Descrição:
+ * ----------
+ * Começa a carregar as texturas do array KTX2 escrito pelo TextureCooker, já
+ * comprimido e com todos os mipmaps (cada pedido lê só os níveis de que precisa).
+ *
+ * Parâmetros:
+ * -----------
+ * - fileName: O nome do ficheiro KTX2.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se o carregamento começou, `false` se o ficheiro não existir ou não puder ser usado.
+ *
+ ******************************************************************************/
+bool TextureResidency::StartCompressed(const std::string& fileName) {
+	return streamer.OpenCompressed(fileName) && Start();
+}
+
+
+/*****************************************************************************
+ * bool TextureResidency::StartImages(const std::vector<std::string>& fileNames)
+ *
+ * Descrição:
+ * ----------
+ * Começa a carregar as texturas das imagens, uma por camada, em GL_RGB8. Cada
+ * pedido descodifica a imagem e calcula os mipmaps nas threads do
+ * TextureStreamer; como cada camada do conjunto ocupa 8 vezes mais memória do
+ * que em BC1, o mesmo orçamento dá menos camadas detalhadas.
+ *
+ * Parâmetros:
+ * -----------
+ * - fileNames: Os nomes dos ficheiros das imagens.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se o carregamento começou, `false` se a primeira imagem não puder ser lida.
+ *
+ ******************************************************************************/
+bool TextureResidency::StartImages(const std::vector<std::string>& fileNames) {
+	return streamer.OpenImages(fileNames) && Start();
+}
+
+
+/*****************************************************************************
+ * bool TextureResidency::Start()
+ *
+ * Descrição:
+ * ----------
+ * Cria os dois arrays com o formato da fonte e pede os mipmaps pequenos de
+ * todas as camadas (níveis a partir de tailFirstLevel, num só pedido por camada).
+ * O conjunto de níveis detalhados fica com as camadas que cabem no orçamento
+ * depois dos mipmaps pequenos, no máximo uma por bola; se nenhuma couber, as
+ * bolas ficam só com os mipmaps pequenos.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se os arrays foram criados.
+ *
+ ******************************************************************************/
+bool TextureResidency::Start() {
+	GLenum internalFormat = streamer.GetInternalFormat();
+	GLsizei width = streamer.GetWidth();
+	GLsizei height = streamer.GetHeight();
+	GLsizei layerCount = streamer.GetLayerCount();
+	levelCount = streamer.GetLevelCount();
+
+	tailFirstLevel = 0;
+	while (tailFirstLevel < levelCount - 1 && (std::max(width, height) >> tailFirstLevel) > TAIL_SIZE)
+		tailFirstLevel++;
+
+	tail.Allocate(internalFormat, std::max(width >> tailFirstLevel, 1), std::max(height >> tailFirstLevel, 1),
+		layerCount, levelCount - tailFirstLevel);
+
+	size_t slotSize = TextureArray::ComputeMemorySize(internalFormat, width, height, 1, tailFirstLevel);
+	size_t available = budget > tail.GetMemorySize() ? budget - tail.GetMemorySize() : 0;
+	GLsizei slotCount = (tailFirstLevel > 0) ? (GLsizei)std::min(available / slotSize, (size_t)layerCount) : 0;
+	if (slotCount > 0)
+		detail.Allocate(internalFormat, width, height, slotCount, tailFirstLevel);
+
+	slots.assign(slotCount, Slot());
+	layerSlot.assign(layerCount, -1);
+	requestedLevel.assign(layerCount, levelCount);
+	failedLayers.assign(layerCount, false);
+	blocks.resize(layerCount);
+
+	for (GLint layer = 0; layer < layerCount; layer++)
+		streamer.Load(layer, tailFirstLevel, levelCount - tailFirstLevel, tail, layer, tailFirstLevel);
+
+	tailComplete = false;
+	startTime = std::chrono::steady_clock::now();
+
+	std::cout << "Ball textures: " << tail.GetMemorySize() / 1024 << " KB for mips from level " << tailFirstLevel
+		<< ", " << slotCount << " detail slots of " << slotSize / 1024 << " KB (budget " << budget / 1024 << " KB)" << std::endl;
+
+	streamer.Update(failedLoads);
+	return true;
+}
+
+
+/*****************************************************************************
+ * void TextureResidency::Request(GLint layer, float screenRadius)
+ *
+ * Descrição:
+ * ----------
+ * Regista o nível de mipmap de que uma bola precisa no quadro, a partir do seu
+ * raio no ecrã: a textura dá a volta à bola, por isso cerca de metade da sua
+ * largura cobre o diâmetro visível, e o nível é aquele em que um texel cobre
+ * pelo menos um píxel. Quando a mesma camada é pedida várias vezes, fica o
+ * nível mais detalhado.
+ *
+ * Parâmetros:
+ * -----------
+ * - layer: A camada da bola.
+ * - screenRadius: O raio da bola projetado no ecrã, em píxeis.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void TextureResidency::Request(GLint layer, float screenRadius) {
+	if (layer < 0 || layer >= (GLint)requestedLevel.size() || screenRadius <= 0.0f)
+		return;
+
+	float texelsPerPixel = (float)streamer.GetWidth() / (4.0f * screenRadius);
+	GLint level = (GLint)std::floor(std::log2(std::max(texelsPerPixel, 1.0f)));
+	level = std::min(level, levelCount - 1);
+
+	if (requestedLevel[layer] == levelCount)
+		requests.push_back(layer);
+	requestedLevel[layer] = std::min(requestedLevel[layer], level);
+}
+
+
+/*****************************************************************************
+ * void TextureResidency::Update(FrameUploadBuffer& uploadBuffer)
+ *
+ * Descrição:
+ * ----------
+ * Chamada uma vez por quadro, depois de as bolas terem feito os seus pedidos
+ * e antes de serem desenhadas:
+ * - Envia os níveis que as threads do TextureStreamer já leram. Quando uma
+ *   leitura falha, a camada do conjunto deixa de esperar pelo nível (pode
+ *   voltar a ser atribuída) e a bola não volta a pedir níveis.
+ * - Atende os pedidos dos níveis detalhados, dos mais detalhados para os menos,
+ *   para que as bolas maiores no ecrã fiquem com as camadas do conjunto quando
+ *   não há camadas para todas. Cada camada do conjunto recebe um nível de cada
+ *   vez, a seguir ao mais detalhado já carregado, até chegar ao nível pedido.
+ * - Escreve o bloco TextureResidencyData, com a camada do conjunto e o nível
+ *   mais detalhado carregado de cada bola.
+ *
+ * Parâmetros:
+ * -----------
+ * - uploadBuffer: O buffer de uniforms do quadro.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void TextureResidency::Update(FrameUploadBuffer& uploadBuffer) {
+	if (blocks.empty())
+		return;
+
+	streamer.Update(failedLoads);
+	frame++;
+
+	// Sem isto, a camada do conjunto ficaria à espera do nível para sempre, sem poder ser preenchida nem retirada
+	for (const TextureStreamer::FailedLoad& failed : failedLoads) {
+		failedLayers[failed.layer] = true;
+		if (failed.target == &detail)
+			slots[failed.targetLayer].loadingLevel = -1;
+	}
+	failedLoads.clear();
+
+	if (!tailComplete) {
+		tailComplete = true;
+		for (GLint layer = 0; layer < (GLint)layerSlot.size(); layer++)
+			tailComplete = tailComplete && (tail.IsLayerResident(layer) || failedLayers[layer]);
+
+		if (tailComplete) {
+			double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+			std::cout << "Streamed mips from level " << tailFirstLevel << " of " << layerSlot.size() << " texture layers in " << elapsed * 1000.0 << " ms" << std::endl;
+		}
+	}
+
+	for (GLint slot = 0; slot < (GLint)slots.size(); slot++) {
+		if (slots[slot].loadingLevel >= 0 && detail.GetResidentLevel(slot) <= slots[slot].loadingLevel) {
+			slots[slot].loadingLevel = -1;
+			stats.levelsLoaded++;
+		}
+	}
+
+	std::sort(requests.begin(), requests.end(), [this](GLint a, GLint b) { return requestedLevel[a] < requestedLevel[b]; });
+
+	for (GLint layer : requests) {
+		GLint level = requestedLevel[layer];
+		if (level >= tailFirstLevel || !tail.IsLayerResident(layer) || failedLayers[layer])
+			continue;
+
+		GLint slot = layerSlot[layer];
+		if (slot < 0) {
+			slot = AcquireSlot(layer);
+			if (slot < 0)
+				continue;
+		}
+		slots[slot].lastUsedFrame = frame;
+
+		GLint residentLevel = std::min(detail.GetResidentLevel(slot), tailFirstLevel);
+		if (slots[slot].loadingLevel < 0 && residentLevel > level) {
+			slots[slot].loadingLevel = residentLevel - 1;
+			streamer.Load(layer, residentLevel - 1, 1, detail, slot, 0);
+		}
+	}
+
+	for (GLint layer : requests)
+		requestedLevel[layer] = levelCount;
+	requests.clear();
+
+	for (GLint layer = 0; layer < (GLint)blocks.size(); layer++) {
+		GLint slot = layerSlot[layer];
+		bool hasDetail = slot >= 0 && detail.GetResidentLevel(slot) < tailFirstLevel;
+		blocks[layer].detailLayer = hasDetail ? slot : -1;
+		blocks[layer].detailMinLevel = hasDetail ? (float)detail.GetResidentLevel(slot) : (float)tailFirstLevel;
+		blocks[layer].tailFirstLevel = (float)tailFirstLevel;
+		blocks[layer].pad = 0.0f;
+	}
+	uploadBuffer.UploadStorage(TEXTURE_RESIDENCY_BLOCK_BINDING, blocks.data(), blocks.size() * sizeof(TextureResidencyBlock));
+}
+
+
+/*****************************************************************************
+ * GLint TextureResidency::AcquireSlot(GLint layer)
+ *
+ * Descrição:
+ * ----------
+ * Atribui uma camada do conjunto a uma bola: uma camada livre, se houver, ou a
+ * camada usada há mais tempo, desde que a sua bola não a tenha pedido neste
+ * quadro e não esteja à espera de um nível (o pedido ao TextureStreamer ainda
+ * escreveria nela). A camada retirada a outra bola fica marcada como vazia, e
+ * essa bola volta a usar só os mipmaps pequenos.
+ *
+ * Parâmetros:
+ * -----------
+ * - layer: A camada da bola.
+ *
+ * Retorno:
+ * --------
+ * - GLint: A camada do conjunto, ou -1 se nenhuma puder ser usada neste quadro.
+ *
+ ******************************************************************************/
+GLint TextureResidency::AcquireSlot(GLint layer) {
+	GLint chosen = -1;
+	for (GLint slot = 0; slot < (GLint)slots.size(); slot++) {
+		const Slot& candidate = slots[slot];
+		if (candidate.layer < 0) {
+			chosen = slot;
+			break;
+		}
+		if (candidate.lastUsedFrame == frame || candidate.loadingLevel >= 0)
+			continue;
+		if (chosen < 0 || candidate.lastUsedFrame < slots[chosen].lastUsedFrame)
+			chosen = slot;
+	}
+
+	if (chosen < 0)
+		return -1;
+
+	Slot& slot = slots[chosen];
+	if (slot.layer >= 0) {
+		layerSlot[slot.layer] = -1;
+		detail.ClearResidency(chosen);
+		stats.evictions++;
+	}
+	slot.layer = layer;
+	slot.loadingLevel = -1;
+	layerSlot[layer] = chosen;
+	return chosen;
+}
+
+
+/*****************************************************************************
+ * size_t TextureResidency::GetDetailResidentSize()
+ *
+ * Descrição:
+ * ----------
+ * Soma a memória dos níveis detalhados já carregados em todas as camadas do
+ * conjunto (a memória reservada é sempre a do conjunto completo).
+ *
+ * Retorno:
+ * --------
+ * - size_t: O tamanho em bytes.
+ *
+ ******************************************************************************/
+size_t TextureResidency::GetDetailResidentSize() const {
+	size_t size = 0;
+	for (GLint slot = 0; slot < (GLint)slots.size(); slot++) {
+		GLint level = detail.GetResidentLevel(slot);
+		if (level < tailFirstLevel) {
+			size += TextureArray::ComputeMemorySize(streamer.GetInternalFormat(), std::max(streamer.GetWidth() >> level, 1),
+				std::max(streamer.GetHeight() >> level, 1), 1, tailFirstLevel - level);
+		}
+	}
+	return size;
+}
@@ -0,0 +1,75 @@
+﻿#ifndef TEXTURE_RESIDENCY_H
+#define TEXTURE_RESIDENCY_H
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include "TextureArray.h"
+#include "TextureStreamer.h"
+#include "FrameUploadBuffer.h"
+#include "UniformBlocks.h"
+
+// Texturas das bolas carregadas do mipmap menos detalhado para o mais detalhado: os mipmaps pequenos de todas as camadas
+// ficam sempre carregados, e os níveis detalhados só são carregados para as bolas grandes no ecrã, num conjunto de
+// camadas com tamanho fixo (limitado por um orçamento de memória), reutilizadas pela ordem do uso mais antigo
+class TextureResidency {
+public:
+	static const GLuint DETAIL_TEXTURE_UNIT = 2; // Unidade de textura do conjunto de níveis detalhados (layout(binding = 2))
+	static const GLsizei TAIL_SIZE = 64;         // Maior dimensão do nível mais detalhado sempre carregado
+
+	// Contadores desde o último ResetStats
+	struct Stats {
+		GLuint levelsLoaded; // Níveis detalhados carregados
+		GLuint evictions;    // Camadas do conjunto retiradas a uma bola para outra
+	};
+
+	explicit TextureResidency(size_t budget); // budget: memória máxima das texturas na GPU, em bytes
+
+	bool StartCompressed(const std::string& fileName); // Usa o array KTX2 do TextureCooker como fonte
+	bool StartImages(const std::vector<std::string>& fileNames); // Usa uma imagem por camada como fonte
+
+	void Request(GLint layer, float screenRadius); // Pede os níveis adequados a uma bola com este raio no ecrã, em píxeis
+	void Update(FrameUploadBuffer& uploadBuffer); // Atende os pedidos do quadro e escreve o bloco TextureResidencyData
+
+	bool IsLayerResident(GLint layer) const { return tail.IsLayerResident(layer); } // Os mipmaps pequenos da camada já chegaram?
+	bool IsStreaming() const { return !tailComplete || !streamer.IsIdle(); } // Há níveis a caminho (o quadro ainda vai mudar)?
+	GLuint GetTailTexture() const { return tail.GetTexture(); }     // Mipmaps pequenos de todas as camadas (unidade 0)
+	GLuint GetDetailTexture() const { return detail.GetTexture(); } // Conjunto de níveis detalhados (DETAIL_TEXTURE_UNIT)
+	size_t GetMemorySize() const { return tail.GetMemorySize() + detail.GetMemorySize(); } // Memória reservada na GPU
+	size_t GetDetailResidentSize() const; // Memória ocupada pelos níveis detalhados já carregados
+	size_t GetBudget() const { return budget; }
+	const Stats& GetStats() const { return stats; }
+	void ResetStats() { stats = Stats(); }
+
+private:
+	// Camada do conjunto de níveis detalhados
+	struct Slot {
+		GLint layer = -1;        // Camada da bola que a usa (-1 se estiver livre)
+		GLint loadingLevel = -1; // Nível pedido ao TextureStreamer e ainda não enviado (-1 se nenhum)
+		GLuint lastUsedFrame = 0; // Último quadro em que a bola pediu os níveis detalhados
+	};
+
+	size_t budget;
+	TextureStreamer streamer;
+	TextureArray tail;        // Níveis a partir de tailFirstLevel de todas as camadas
+	TextureArray detail;      // Níveis 0 a tailFirstLevel - 1, uma camada do conjunto por bola que os pediu
+	GLint tailFirstLevel;     // Primeiro nível com a maior dimensão até TAIL_SIZE
+	GLint levelCount;         // Níveis de mipmap da textura completa
+	bool tailComplete;        // Todas as camadas já têm os mipmaps pequenos?
+	std::chrono::steady_clock::time_point startTime; // Início do carregamento (para a mensagem do fim dos mipmaps pequenos)
+	std::vector<Slot> slots;
+	std::vector<GLint> layerSlot;      // Camada do conjunto usada por cada bola (-1 se nenhuma)
+	std::vector<GLint> requestedLevel; // Nível mais detalhado pedido por cada bola no quadro (levelCount se nenhum)
+	std::vector<GLint> requests;       // Bolas com pedidos no quadro
+	std::vector<bool> failedLayers;    // Bolas cuja textura não pôde ser lida (os seus níveis não voltam a ser pedidos)
+	std::vector<TextureStreamer::FailedLoad> failedLoads; // Pedidos que falharam, devolvidos pelo TextureStreamer
+	std::vector<TextureResidencyBlock> blocks;
+	GLuint frame;
+	Stats stats;
+
+	bool Start(); // Cria os arrays e pede os mipmaps pequenos de todas as camadas
+	GLint AcquireSlot(GLint layer); // Atribui uma camada do conjunto a uma bola (livre ou a de uso mais antigo)
+};
+
+#endif // TEXTURE_RESIDENCY_H
@@ -0,0 +1,569 @@
+﻿/*****************************************************************************
+ * TextureStreamer.cpp
+ *
+ * Descrição:
+ * ----------
+ * Este arquivo contém a implementação da classe TextureStreamer, que carrega níveis de mipmap das camadas de uma
+ * fonte de texturas sem bloquear a thread do OpenGL. A classe TextureStreamer é responsável por:
+ * - Ler só o cabeçalho da fonte (uma imagem por camada, ou um ficheiro KTX2 com as camadas e os mipmaps) e indicar
+ *   o formato, o tamanho e o número de camadas e de níveis, para que o dono crie os arrays de destino.
+ * - Receber pedidos de níveis de uma camada (por exemplo, só os mipmaps mais pequenos, ou só um nível mais detalhado)
+ *   e colocá-los numa fila até haver um buffer livre.
+ * - Manter um conjunto de pixel buffer objects mapeados de forma persistente, onde as threads de trabalho escrevem os
+ *   níveis de cada pedido (imagem descodificada e reduzida na própria thread, ou os blocos comprimidos lidos do
+ *   ficheiro KTX2).
+ * - Em cada quadro, enviar os pedidos prontos a partir do buffer (`glTextureSubImage3D` com um deslocamento no
+ *   GL_PIXEL_UNPACK_BUFFER), marcar os níveis como carregados no destino, colocar uma fence depois do envio e só
+ *   voltar a usar o buffer quando a fence for sinalizada.
+ *
+ * Funções principais:
+ * - OpenImages(const std::vector<std::string>& fileNames): Usa uma imagem por camada como fonte.
+ * - OpenCompressed(const std::string& fileName): Usa as camadas de um ficheiro KTX2 como fonte.
+ * - Load(GLint layer, GLint firstLevel, GLint levels, TextureArray& target, GLint targetLayer, GLint targetLevelOffset):
+ *   Pede níveis de uma camada para um array de destino.
+ * - Update(std::vector<FailedLoad>& failed): Envia os pedidos prontos, devolve os que falharam e entrega os buffers
+ *   livres às threads (uma vez por quadro).
+ * - IsIdle(): Indica se todos os pedidos foram enviados.
+ * - Close(): Termina as threads e liberta os buffers.
+ *
+ * Variáveis e constantes importantes:
+ * - WORKER_COUNT: Número de threads de trabalho.
+ * - BUFFER_COUNT: Número de pixel buffer objects do conjunto.
+ * - buffers: Os buffers do conjunto e o estado de cada um (livre, em leitura, pronto ou em envio).
+ * - pendingJobs: Pedidos à espera de um buffer livre.
+ * - jobs: Buffers à espera de uma thread de trabalho.
+ * - levelOffsets, levelSizes: Posição e tamanho de cada nível numa camada com todos os níveis.
+ *
+ ******************************************************************************/
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#include "stb_image.h"
+#include "TextureStreamer.h"
+
+
+// Calcula o nível de mipmap seguinte de uma imagem RGB (média de cada grupo de 2x2 texels, repetindo o último
+// texel nas dimensões ímpares), nas threads de trabalho, para não gerar os mipmaps na thread do OpenGL
+static void DownsampleRGB(const unsigned char* source, int sourceWidth, int sourceHeight, unsigned char* destination) {
+	int width = std::max(sourceWidth / 2, 1);
+	int height = std::max(sourceHeight / 2, 1);
+
+	for (int y = 0; y < height; y++) {
+		const unsigned char* row0 = source + (size_t)std::min(y * 2, sourceHeight - 1) * sourceWidth * 3;
+		const unsigned char* row1 = source + (size_t)std::min(y * 2 + 1, sourceHeight - 1) * sourceWidth * 3;
+		for (int x = 0; x < width; x++) {
+			int x0 = std::min(x * 2, sourceWidth - 1) * 3;
+			int x1 = std::min(x * 2 + 1, sourceWidth - 1) * 3;
+			for (int c = 0; c < 3; c++)
+				destination[((size_t)y * width + x) * 3 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+		}
+	}
+}
+
+
+/*****************************************************************************
+ * TextureStreamer::TextureStreamer()
+ *
+ * Descrição:
+ * ----------
+ * Construtor da classe `TextureStreamer`. Os buffers e as threads são criados
+ * em `OpenImages` ou `OpenCompressed`.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (construtor).
+ *
+ ******************************************************************************/
+TextureStreamer::TextureStreamer()
+	: source(SOURCE_IMAGES),
+	internalFormat(GL_NONE),
+	width(0),
+	height(0),
+	layerCount(0),
+	levelCount(0),
+	activeJobs(0),
+	stopping(false) {
+}
+
+
+/*****************************************************************************
+ * TextureStreamer::~TextureStreamer()
+ *
+ * Descrição:
+ * ----------
+ * Destrutor da classe `TextureStreamer`. Espera pelos pedidos que estão a ser
+ * lidos e liberta os buffers.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (destrutor).
+ *
+ ******************************************************************************/
+TextureStreamer::~TextureStreamer() {
+	Close();
+}
+
+
+/*****************************************************************************
+ * bool TextureStreamer::OpenImages(const std::vector<std::string>& fileNames)
+ *
+ * Descrição:
+ * ----------
+ * Usa uma imagem por camada como fonte (a camada i é a imagem fileNames[i]).
+ * Só o cabeçalho da primeira imagem é lido agora, para obter o tamanho das
+ * camadas; a descodificação fica para as threads de trabalho. Como no
+ * carregamento síncrono, os texels são GL_RGB8; os mipmaps de cada camada são
+ * calculados pela thread que a descodifica.
+ *
+ * Parâmetros:
+ * -----------
+ * - fileNames: Os nomes dos ficheiros das imagens.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se a fonte foi aberta, `false` se a primeira imagem não puder ser lida.
+ *
+ ******************************************************************************/
+bool TextureStreamer::OpenImages(const std::vector<std::string>& fileNames) {
+	if (fileNames.empty())
+		return false;
+
+	int imageWidth, imageHeight, nChannels;
+	if (!stbi_info(fileNames[0].c_str(), &imageWidth, &imageHeight, &nChannels)) {
+		std::cout << "Error loading texture: " << fileNames[0] << std::endl;
+		return false;
+	}
+
+	// A inversão é global no stb_image, por isso é definida antes de as threads começarem
+	stbi_set_flip_vertically_on_load(true);
+
+	Close();
+	source = SOURCE_IMAGES;
+	this->fileNames = fileNames;
+	internalFormat = GL_RGB8;
+	width = imageWidth;
+	height = imageHeight;
+	layerCount = (GLsizei)fileNames.size();
+	levelCount = 1;
+	while ((std::max(width, height) >> levelCount) > 0)
+		levelCount++;
+
+	levelOffsets.resize(levelCount);
+	levelSizes.resize(levelCount);
+	GLsizeiptr layerSize = 0;
+	for (GLsizei level = 0; level < levelCount; level++) {
+		levelOffsets[level] = layerSize;
+		levelSizes[level] = (GLsizeiptr)std::max(width >> level, 1) * std::max(height >> level, 1) * 3;
+		layerSize += levelSizes[level];
+	}
+
+	return Start();
+}
+
+
+/*****************************************************************************
+ * bool TextureStreamer::OpenCompressed(const std::string& fileName)
+ *
+ * Descrição:
+ * ----------
+ * Usa as camadas de um ficheiro KTX2 escrito pelo TextureCooker como fonte.
+ * Só o cabeçalho é lido agora; cada pedido lê depois, dos níveis pedidos, a
+ * parte que pertence à sua camada.
+ *
+ * Parâmetros:
+ * -----------
+ * - fileName: O nome do ficheiro KTX2.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se a fonte foi aberta, `false` se o ficheiro não existir ou não puder ser usado.
+ *
+ ******************************************************************************/
+bool TextureStreamer::OpenCompressed(const std::string& fileName) {
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file)
+		return false;
+
+	KTX2::Header header;
+	std::vector<KTX2::LevelIndex> fileLevels;
+	GLenum fileFormat;
+	if (!TextureArray::ReadKTX2(file, fileName, header, fileLevels, fileFormat))
+		return false;
+
+	Close();
+	source = SOURCE_KTX2;
+	fileNames.assign(1, fileName);
+	levelIndex = fileLevels;
+	internalFormat = fileFormat;
+	width = (GLsizei)header.pixelWidth;
+	height = (GLsizei)header.pixelHeight;
+	layerCount = (GLsizei)std::max(header.layerCount, 1u);
+	levelCount = (GLsizei)header.levelCount;
+
+	// Cada nível guarda as camadas seguidas, por isso a parte de uma camada é o nível dividido pelo número de camadas
+	levelOffsets.resize(levelCount);
+	levelSizes.resize(levelCount);
+	GLsizeiptr layerSize = 0;
+	for (GLsizei level = 0; level < levelCount; level++) {
+		levelOffsets[level] = layerSize;
+		levelSizes[level] = (GLsizeiptr)(levelIndex[level].byteLength / layerCount);
+		layerSize += levelSizes[level];
+	}
+
+	return Start();
+}
+
+
+/*****************************************************************************
+ * bool TextureStreamer::Start()
+ *
+ * Descrição:
+ * ----------
+ * Cria os pixel buffer objects do conjunto (cada um com espaço para uma camada
+ * com todos os níveis, o maior pedido possível, mapeado uma única vez com
+ * `GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT`, para que as threads de
+ * trabalho escrevam diretamente na memória do buffer) e as threads de trabalho.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se os buffers foram criados, `false` caso contrário.
+ *
+ ******************************************************************************/
+bool TextureStreamer::Start() {
+	GLsizeiptr bufferSize = levelOffsets.back() + levelSizes.back();
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	buffers.resize(BUFFER_COUNT);
+	for (StagingBuffer& staging : buffers) {
+		glCreateBuffers(1, &staging.buffer);
+		glNamedBufferStorage(staging.buffer, bufferSize, nullptr, flags);
+		staging.data = (unsigned char*)glMapNamedBufferRange(staging.buffer, 0, bufferSize, flags);
+		if (staging.data == nullptr) {
+			std::cout << "Failed to map texture staging buffer" << std::endl;
+			Close();
+			return false;
+		}
+	}
+
+	pendingJobs.clear();
+	activeJobs = 0;
+	stopping = false;
+
+	for (int i = 0; i < WORKER_COUNT; i++)
+		workers.emplace_back(&TextureStreamer::WorkerLoop, this);
+
+	return true;
+}
+
+
+/*****************************************************************************
+ * void TextureStreamer::Close()
+ *
+ * Descrição:
+ * ----------
+ * Pede às threads de trabalho que terminem, espera por elas e liberta os
+ * buffers e as fences que ainda existam. Os pedidos que ainda não foram
+ * enviados são descartados.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void TextureStreamer::Close() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	jobSignal.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+
+	for (StagingBuffer& staging : buffers) {
+		if (staging.fence != nullptr)
+			glDeleteSync(staging.fence);
+		if (staging.data != nullptr)
+			glUnmapNamedBuffer(staging.buffer);
+		glDeleteBuffers(1, &staging.buffer);
+	}
+	buffers.clear();
+	pendingJobs.clear();
+	activeJobs = 0;
+}
+
+
+/*****************************************************************************
+ * void TextureStreamer::Load(GLint layer, GLint firstLevel, GLint levels, TextureArray& target, GLint targetLayer, GLint targetLevelOffset)
+ *
+ * Descrição:
+ * ----------
+ * Pede os níveis [firstLevel, firstLevel + levels) de uma camada da fonte. Os
+ * níveis são lidos por uma thread de trabalho e enviados num quadro seguinte
+ * para a camada `targetLayer` do array de destino, onde o nível n da fonte passa
+ * a ser o nível n - targetLevelOffset (assim um array só com os mipmaps mais
+ * pequenos, ou só com os mais detalhados, pode receber níveis da mesma fonte).
+ * Os pedidos são atendidos pela ordem em que são feitos.
+ *
+ * Parâmetros:
+ * -----------
+ * - layer: A camada da fonte.
+ * - firstLevel: O primeiro nível pedido (o mais detalhado).
+ * - levels: O número de níveis pedidos.
+ * - target: O array de destino (criado com o formato da fonte).
+ * - targetLayer: A camada do destino.
+ * - targetLevelOffset: A diferença entre os níveis da fonte e os do destino.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void TextureStreamer::Load(GLint layer, GLint firstLevel, GLint levels, TextureArray& target, GLint targetLayer, GLint targetLevelOffset) {
+	if (buffers.empty() || layer < 0 || layer >= layerCount || firstLevel < 0 || levels <= 0 || firstLevel + levels > levelCount)
+		return;
+
+	Job job;
+	job.layer = layer;
+	job.firstLevel = firstLevel;
+	job.levels = levels;
+	job.target = &target;
+	job.targetLayer = targetLayer;
+	job.targetLevelOffset = targetLevelOffset;
+	pendingJobs.push_back(job);
+}
+
+
+/*****************************************************************************
+ * void TextureStreamer::Update(std::vector<FailedLoad>& failed)
+ *
+ * Descrição:
+ * ----------
+ * Chamada uma vez por quadro, na thread do OpenGL:
+ * - Envia para os destinos os pedidos que as threads já escreveram nos buffers
+ *   e marca os níveis como carregados (os envios seguintes ao desenho já os veem).
+ * - Acrescenta a `failed` os pedidos que não puderam ser lidos: os seus níveis
+ *   nunca chegam, e quem os pediu tem de deixar de esperar por eles.
+ * - Devolve ao conjunto os buffers cujo envio terminou (fence sinalizada), sem
+ *   esperar pelos outros.
+ * - Entrega os pedidos seguintes às threads, um por buffer livre.
+ *
+ * Parâmetros:
+ * -----------
+ * - failed: Recebe os pedidos que falharam desde a última chamada.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void TextureStreamer::Update(std::vector<FailedLoad>& failed) {
+	if (buffers.empty())
+		return;
+
+	// As threads só mudam o estado dos buffers em leitura, por isso os restantes podem ser usados sem o mutex
+	std::vector<int> ready, uploading;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < buffers.size(); i++) {
+			if (buffers[i].state == BUFFER_READY)
+				ready.push_back((int)i);
+			else if (buffers[i].state == BUFFER_UPLOADING)
+				uploading.push_back((int)i);
+		}
+	}
+
+	for (int index : ready) {
+		StagingBuffer& staging = buffers[index];
+		if (staging.failed) {
+			std::cout << "Error loading texture layer " << staging.job.layer << ": " << fileNames[source == SOURCE_IMAGES ? staging.job.layer : 0] << std::endl;
+			failed.push_back({ staging.job.layer, staging.job.target, staging.job.targetLayer });
+			staging.state = BUFFER_FREE;
+			activeJobs--;
+		}
+		else {
+			UploadJob(staging);
+			staging.state = BUFFER_UPLOADING;
+		}
+	}
+
+	for (int index : uploading) {
+		StagingBuffer& staging = buffers[index];
+		GLenum result = glClientWaitSync(staging.fence, 0, 0);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+			glDeleteSync(staging.fence);
+			staging.fence = nullptr;
+			staging.state = BUFFER_FREE;
+			activeJobs--;
+		}
+	}
+
+	bool hasJobs = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < buffers.size() && !pendingJobs.empty(); i++) {
+			if (buffers[i].state != BUFFER_FREE)
+				continue;
+
+			buffers[i].job = pendingJobs.front();
+			pendingJobs.pop_front();
+			buffers[i].failed = false;
+			buffers[i].state = BUFFER_LOADING;
+			jobs.push_back((int)i);
+			activeJobs++;
+			hasJobs = true;
+		}
+	}
+	if (hasJobs)
+		jobSignal.notify_all();
+}
+
+
+/*****************************************************************************
+ * void TextureStreamer::WorkerLoop()
+ *
+ * Descrição:
+ * ----------
+ * Ciclo de cada thread de trabalho: espera por um buffer com um pedido
+ * atribuído, lê os níveis pedidos para a memória mapeada do buffer e marca-o
+ * como pronto, até `Close` pedir que termine. As threads não fazem chamadas
+ * OpenGL.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void TextureStreamer::WorkerLoop() {
+	for (;;) {
+		int index;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobSignal.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping)
+				return;
+			index = jobs.front();
+			jobs.pop_front();
+		}
+
+		StagingBuffer& staging = buffers[index];
+		bool loaded = LoadJob(staging);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		staging.failed = !loaded;
+		staging.state = BUFFER_READY;
+	}
+}
+
+
+/*****************************************************************************
+ * bool TextureStreamer::LoadJob(StagingBuffer& staging)
+ *
+ * Descrição:
+ * ----------
+ * Lê os níveis do pedido atribuído ao buffer para a sua memória mapeada, numa
+ * thread de trabalho, seguidos a partir do início do buffer. No caso das
+ * imagens, descodifica a imagem e calcula os níveis de mipmap até ao último
+ * pedido numa cópia local (a memória mapeada só deve ser escrita), copiando só
+ * os pedidos; no caso do ficheiro KTX2, lê de cada nível pedido os blocos da
+ * camada.
+ *
+ * Parâmetros:
+ * -----------
+ * - staging: O buffer, com o pedido a ler.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se os níveis foram lidos, `false` se o ficheiro não puder ser lido ou tiver outro tamanho.
+ *
+ ******************************************************************************/
+bool TextureStreamer::LoadJob(StagingBuffer& staging) const {
+	const Job& job = staging.job;
+	GLsizeiptr jobOffset = levelOffsets[job.firstLevel];
+
+	if (source == SOURCE_IMAGES) {
+		int imageWidth, imageHeight, nChannels;
+		unsigned char* imageData = stbi_load(fileNames[job.layer].c_str(), &imageWidth, &imageHeight, &nChannels, 3);
+		if (imageData == nullptr)
+			return false;
+
+		if (imageWidth != width || imageHeight != height) {
+			stbi_image_free(imageData);
+			return false;
+		}
+
+		std::vector<unsigned char> level(imageData, imageData + levelSizes[0]), nextLevel;
+		stbi_image_free(imageData);
+
+		for (GLint i = 0; i < job.firstLevel + job.levels; i++) {
+			if (i > 0) {
+				nextLevel.resize((size_t)levelSizes[i]);
+				DownsampleRGB(level.data(), std::max(width >> (i - 1), 1), std::max(height >> (i - 1), 1), nextLevel.data());
+				level.swap(nextLevel);
+			}
+			if (i >= job.firstLevel)
+				std::memcpy(staging.data + levelOffsets[i] - jobOffset, level.data(), (size_t)levelSizes[i]);
+		}
+		return true;
+	}
+
+	std::ifstream file(fileNames[0], std::ios::binary);
+	for (GLint level = job.firstLevel; level < job.firstLevel + job.levels && file; level++) {
+		file.seekg((std::streamoff)(levelIndex[level].byteOffset + (uint64_t)levelSizes[level] * job.layer));
+		file.read((char*)staging.data + levelOffsets[level] - jobOffset, (std::streamsize)levelSizes[level]);
+	}
+	return (bool)file;
+}
+
+
+/*****************************************************************************
+ * void TextureStreamer::UploadJob(StagingBuffer& staging)
+ *
+ * Descrição:
+ * ----------
+ * Envia os níveis do buffer para o destino, com o buffer ligado a
+ * GL_PIXEL_UNPACK_BUFFER (o ponteiro dos dados passa a ser o deslocamento no
+ * buffer), marca o nível mais detalhado como carregado e coloca a fence que
+ * indica quando o buffer pode ser reutilizado. Usa as funções com acesso direto
+ * à textura, para não mudar as texturas ligadas (que a GLStateCache conhece).
+ *
+ * Parâmetros:
+ * -----------
+ * - staging: O buffer, com os níveis já lidos.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void TextureStreamer::UploadJob(StagingBuffer& staging) {
+	const Job& job = staging.job;
+	GLuint texture = job.target->GetTexture();
+	GLsizeiptr jobOffset = levelOffsets[job.firstLevel];
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (GLint level = job.firstLevel; level < job.firstLevel + job.levels; level++) {
+		GLsizei levelWidth = std::max(width >> level, 1);
+		GLsizei levelHeight = std::max(height >> level, 1);
+		GLint targetLevel = level - job.targetLevelOffset;
+		const void* offset = (const void*)(levelOffsets[level] - jobOffset);
+		if (source == SOURCE_IMAGES) {
+			glTextureSubImage3D(texture, targetLevel, 0, 0, job.targetLayer, levelWidth, levelHeight, 1,
+				GL_RGB, GL_UNSIGNED_BYTE, offset);
+		}
+		else {
+			glCompressedTextureSubImage3D(texture, targetLevel, 0, 0, job.targetLayer, levelWidth, levelHeight, 1,
+				internalFormat, (GLsizei)levelSizes[level], offset);
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	staging.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	job.target->SetResidentLevel(job.targetLayer, job.firstLevel - job.targetLevelOffset);
+}
@@ -0,0 +1,97 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "TextureArray.h"
+#include "KTX2.h"
+
+// Carrega níveis de mipmap das camadas de uma fonte (imagens ou ficheiro KTX2) em segundo plano: threads de trabalho
+// leem e descodificam cada pedido diretamente para um conjunto de pixel buffer objects mapeados, e a thread do OpenGL
+// envia-os para o array de destino a partir desses buffers, reutilizando cada buffer quando a sua fence for sinalizada
+class TextureStreamer {
+public:
+	static const int WORKER_COUNT = 2; // Threads que leem e descodificam os pedidos
+	static const int BUFFER_COUNT = 4; // Pixel buffer objects do conjunto (pedidos em preparação ou em envio ao mesmo tempo)
+
+	// Pedido cuja leitura falhou, devolvido por Update para que quem o fez possa voltar a usar o destino
+	struct FailedLoad {
+		GLint layer;          // Camada da fonte
+		TextureArray* target; // Array de destino
+		GLint targetLayer;    // Camada do destino
+	};
+
+	TextureStreamer();
+	~TextureStreamer(); // Termina as threads e liberta os buffers
+
+	bool OpenImages(const std::vector<std::string>& fileNames); // Fonte com uma imagem por camada (mipmaps calculados nas threads)
+	bool OpenCompressed(const std::string& fileName); // Fonte com as camadas e os mipmaps de um ficheiro KTX2
+	void Close(); // Termina as threads e liberta os buffers (os pedidos por enviar são descartados)
+
+	// Pede os níveis [firstLevel, firstLevel + levels) da camada `layer` da fonte, para a camada `targetLayer` do
+	// array de destino; o nível n da fonte vai para o nível n - targetLevelOffset do destino
+	void Load(GLint layer, GLint firstLevel, GLint levels, TextureArray& target, GLint targetLayer, GLint targetLevelOffset);
+	void Update(std::vector<FailedLoad>& failed); // Uma vez por quadro: envia os pedidos prontos, acrescenta a `failed` os que falharam e entrega os buffers livres às threads
+	bool IsIdle() const { return pendingJobs.empty() && activeJobs == 0; } // Todos os pedidos foram enviados?
+
+	GLenum GetInternalFormat() const { return internalFormat; } // Formato dos texels da fonte
+	GLsizei GetWidth() const { return width; }           // Largura do nível 0
+	GLsizei GetHeight() const { return height; }         // Altura do nível 0
+	GLsizei GetLayerCount() const { return layerCount; } // Número de camadas da fonte
+	GLsizei GetLevelCount() const { return levelCount; } // Número de níveis de mipmap de cada camada
+	GLsizeiptr GetLevelSize(GLint level) const { return levelSizes[level]; } // Bytes de um nível de uma camada
+
+private:
+	enum Source { SOURCE_IMAGES, SOURCE_KTX2 };
+	enum BufferState { BUFFER_FREE, BUFFER_LOADING, BUFFER_READY, BUFFER_UPLOADING };
+
+	// Pedido de níveis de uma camada
+	struct Job {
+		GLint layer;             // Camada da fonte
+		GLint firstLevel;        // Primeiro nível pedido (o mais detalhado)
+		GLint levels;            // Número de níveis pedidos
+		TextureArray* target;    // Array de destino
+		GLint targetLayer;       // Camada do destino
+		GLint targetLevelOffset; // Diferença entre os níveis da fonte e os do destino
+	};
+
+	// Pixel buffer object do conjunto, mapeado de forma persistente
+	struct StagingBuffer {
+		GLuint buffer = 0;             // GL_PIXEL_UNPACK_BUFFER
+		unsigned char* data = nullptr; // Memória mapeada, escrita pelas threads de trabalho
+		BufferState state = BUFFER_FREE;
+		Job job = {};                  // Pedido em preparação ou em envio (os níveis ficam seguidos, a partir do início)
+		bool failed = false;           // A leitura falhou (os níveis não são enviados)
+		GLsync fence = nullptr;        // Sinalizada quando o envio a partir do buffer termina
+	};
+
+	Source source;
+	GLenum internalFormat;
+	GLsizei width, height;
+	GLsizei layerCount, levelCount;
+	std::vector<std::string> fileNames;              // Imagens de cada camada (SOURCE_IMAGES) ou o ficheiro KTX2
+	std::vector<KTX2::LevelIndex> levelIndex;        // Níveis do ficheiro KTX2
+	std::vector<GLsizeiptr> levelOffsets, levelSizes; // Posição e tamanho de cada nível de uma camada com todos os níveis
+
+	std::vector<StagingBuffer> buffers;
+	std::deque<Job> pendingJobs; // Pedidos à espera de um buffer livre (só usados pela thread do OpenGL)
+	int activeJobs;              // Pedidos entregues às threads ou em envio
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;                  // Protege `jobs`, `stopping` e o estado dos buffers em leitura
+	std::condition_variable jobSignal; // Acorda as threads quando há trabalho ou no fim
+	std::deque<int> jobs;              // Índices dos buffers à espera de uma thread
+	bool stopping;
+
+	bool Start(); // Cria os buffers e as threads
+	void WorkerLoop(); // Ciclo de cada thread de trabalho
+	bool LoadJob(StagingBuffer& staging) const; // Lê os níveis pedidos para o buffer (nas threads de trabalho)
+	void UploadJob(StagingBuffer& staging); // Envia os níveis do buffer para o destino (na thread do OpenGL)
+};
+
+#endif // TEXTURE_STREAMER_H
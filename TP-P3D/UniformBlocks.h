@@ -0,0 +1,130 @@
+﻿#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Pontos de ligação dos blocos, iguais aos layout(binding = N) dos shaders
+const GLuint CAMERA_BLOCK_BINDING = 0;   // CameraData (uniforms): matrizes de visualização e projeção (uma vez por quadro)
+const GLuint LIGHT_BLOCK_BINDING = 1;    // LightData (uniforms): parâmetros e estado das luzes (uma vez por quadro e por programa)
+const GLuint OBJECT_BLOCK_BINDING = 2;   // ObjectData (armazenamento): um ObjectBlock por objeto de um lote
+const GLuint MATERIAL_BLOCK_BINDING = 3; // MaterialData (armazenamento): todos os materiais da cena (buffer estático)
+const GLuint MESH_BLOCK_BINDING = 4;     // MeshData (armazenamento): caixa envolvente de cada malha, para desquantizar as posições
+const GLuint POINT_LIGHT_BLOCK_BINDING = 5; // PointLightData (armazenamento): luzes pontuais do quadro, no espaço da câmera
+const GLuint CLUSTER_BLOCK_BINDING = 6;     // ClusterData (armazenamento): primeiro índice e número de luzes de cada cluster
+const GLuint LIGHT_INDEX_BLOCK_BINDING = 7; // LightIndexData (armazenamento): índices das luzes de todos os clusters, seguidos
+const GLuint TEXTURE_RESIDENCY_BLOCK_BINDING = 8; // TextureResidencyData (armazenamento): níveis carregados da textura de cada bola
+const GLuint MULTI_VIEW_BLOCK_BINDING = 9;  // MultiViewData (uniforms): matrizes das vistas desenhadas na mesma passagem (MultiView)
+
+// Número máximo de vistas desenhadas na mesma passagem (tamanho do array do bloco MultiViewData)
+const GLuint MAX_VIEWS = 4;
+
+// Camada escrita em ObjectBlock::textureLayer enquanto a textura da bola não é carregada; os shaders usam uma cor provisória
+const GLint PLACEHOLDER_TEXTURE_LAYER = -1;
+
+// As estruturas seguintes reproduzem o layout std140 (uniforms) e std430 (armazenamento) dos blocos dos shaders:
+// cada vec3 ocupa 16 bytes, exceto quando é seguido de um float, que aproveita os 4 bytes livres.
+// Os campos "pad" só ocupam espaço. Com estes tipos, os dois layouts coincidem.
+
+struct CameraBlock {
+	glm::mat4 view;       // Matriz de visualização (já com o zoom)
+	glm::mat4 projection; // Matriz de projeção
+};
+
+struct AmbientLightBlock {
+	glm::vec3 ambient; float pad0;
+};
+
+struct DirectionalLightBlock {
+	glm::vec3 direction; float pad0;
+	glm::vec3 ambient; float pad1;
+	glm::vec3 diffuse; float pad2;
+	glm::vec3 specular; float pad3;
+};
+
+struct PointLightBlock {
+	glm::vec3 position; float range;    // Posição e alcance da luz no espaço da câmera
+	glm::vec3 ambient; float constant;  // Componente ambiente e coeficiente de atenuação constante
+	glm::vec3 diffuse; float linear;    // Componente difusa e coeficiente de atenuação linear
+	glm::vec3 specular; float quadratic; // Componente especular e coeficiente de atenuação quadrática
+};
+
+struct SpotLightBlock {
+	glm::vec3 position; float pad0;
+	glm::vec3 ambient; float pad1;
+	glm::vec3 diffuse; float pad2;
+	glm::vec3 specular;
+	float constant;
+	float linear;
+	float quadratic;
+	float spotCutoff;
+	float spotExponent;
+	glm::vec3 spotDirection; float pad3;
+};
+
+struct LightBlock {
+	AmbientLightBlock ambientLight;
+	DirectionalLightBlock directionalLight;
+	SpotLightBlock spotLight;
+	GLuint clusterGrid[3];         // Número de clusters em x, y (ecrã) e z (profundidade)
+	GLuint pointLightCount;        // Número de luzes pontuais em PointLightData
+	glm::vec2 clusterTileSize;     // Tamanho de cada cluster no ecrã, em píxeis
+	float clusterScale;            // Fatia de profundidade = log(profundidade) * clusterScale + clusterBias
+	float clusterBias;
+	glm::mat4 shadowMatrix[2];     // Do espaço da câmera para as coordenadas dos mapas de sombras (0: direcional, 1: spot)
+	glm::mat4 clusterProjection;   // Projeção com que os clusters foram construídos (lida pelas variantes MULTI_VIEW)
+};
+
+struct ObjectBlock {
+	glm::mat4 model;     // Matriz de modelo do objeto
+	glm::mat4 modelView; // Matriz modelo-vista do objeto
+	glm::mat3x4 normalMatrix; // mat3 no shader: inversa transposta da modelo-vista, calculada uma vez por objeto
+	float radius;        // Raio da esfera no espaço da câmera (impostores)
+	GLint textureLayer;  // Camada do array de texturas das bolas
+	GLint materialIndex; // Índice do material no bloco MaterialData
+	GLint meshIndex;     // Índice da malha no bloco MeshData (preenchido pelo IndirectBatch)
+};
+
+// Uma vista do desenho com várias vistas: os vértices chegam no espaço da câmera principal (ObjectBlock::modelView)
+struct ViewBlock {
+	glm::mat4 clipFromEye; // Do espaço da câmera principal para o espaço de recorte da vista
+	glm::vec4 eyePosition; // Posição da câmera da vista no espaço da câmera principal (xyz), para a iluminação especular
+};
+
+struct MultiViewBlock {
+	ViewBlock views[MAX_VIEWS];
+	GLuint viewCount; // Vistas desenhadas (instâncias por objeto)
+	GLuint pad[3];
+};
+
+struct MaterialBlock {
+	glm::vec3 emissive; float pad0;
+	glm::vec3 ambient; float pad1;
+	glm::vec3 diffuse; float pad2;
+	glm::vec3 specular;
+	float shininess;
+};
+
+struct MeshBlock {
+	glm::vec3 positionOffset; float pad0; // Canto mínimo da caixa envolvente da malha
+	glm::vec3 positionScale; float pad1;  // Tamanho da caixa envolvente (posição = offset + valor normalizado * tamanho)
+};
+
+// Níveis carregados da textura de uma bola (um bloco por camada do array das bolas, escritos por TextureResidency)
+struct TextureResidencyBlock {
+	GLint detailLayer;    // Camada do conjunto de níveis detalhados (-1 se a bola só tiver os mipmaps menos detalhados)
+	float detailMinLevel; // Nível mais detalhado carregado nessa camada
+	float tailFirstLevel; // Nível da textura completa que corresponde ao nível 0 do array dos mipmaps menos detalhados
+	float pad;
+};
+
+static_assert(sizeof(CameraBlock) == 128, "CameraBlock does not match the std140 layout");
+static_assert(sizeof(LightBlock) == 400, "LightBlock does not match the std140 layout");
+static_assert(sizeof(ObjectBlock) == 192, "ObjectBlock does not match the std140 layout");
+static_assert(sizeof(MultiViewBlock) == 336, "MultiViewBlock does not match the std140 layout");
+static_assert(sizeof(MaterialBlock) == 64, "MaterialBlock does not match the std140 layout");
+static_assert(sizeof(MeshBlock) == 32, "MeshBlock does not match the std430 layout");
+static_assert(sizeof(PointLightBlock) == 64, "PointLightBlock does not match the std430 layout");
+static_assert(sizeof(TextureResidencyBlock) == 16, "TextureResidencyBlock does not match the std430 layout");
+
+#endif // UNIFORM_BLOCKS_H
@@ -0,0 +1,471 @@
+﻿/*****************************************************************************
+ * TextureCooker.cpp
+ *
+ * Descrição:
+ * ----------
+ * Ferramenta offline que prepara as texturas das bolas para o TP-P3D. O programa é responsável por:
+ * - Ler as imagens (JPEG, PNG, ...) indicadas na linha de comandos, uma por camada de um array de texturas.
+ * - Calcular a cadeia completa de mipmaps de cada imagem (filtro de caixa 2x2), em vez de a gerar no arranque.
+ * - Comprimir todos os níveis em BC1 (DXT1, 8 bytes por bloco de 4x4 texels).
+ * - Escrever o resultado num ficheiro KTX2, que o TextureArray envia diretamente para a GPU.
+ *
+ * Utilização:
+ * - TextureCooker <saída.ktx2> <imagem da camada 0> [<imagem da camada 1> ...]
+ *
+ * Funções principais:
+ * - LoadLayers(...): Lê as imagens, todas com o tamanho da primeira.
+ * - Downsample(...): Calcula o nível de mipmap seguinte de uma imagem.
+ * - EncodeBlock(...): Comprime um bloco de 4x4 texels em BC1.
+ * - EncodeLevel(...): Comprime um nível de mipmap inteiro.
+ * - WriteKTX2(...): Escreve os níveis comprimidos num ficheiro KTX2.
+ * - main(): Função principal do programa.
+ *
+ * Variáveis e constantes importantes:
+ * - CHANNELS: Número de canais das imagens lidas (RGB).
+ * - LEVEL_ALIGNMENT: Alinhamento, em bytes, de cada nível de mipmap no ficheiro.
+ *
+ ******************************************************************************/
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../TP-P3D/stb_image.h"
+#include "../TP-P3D/KTX2.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+const int CHANNELS = 3;
+const uint64_t LEVEL_ALIGNMENT = 8; // mmc(tamanho do bloco BC1, 4)
+
+// Imagem RGB de 8 bits por canal
+struct Image {
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> pixels;
+};
+
+
+/*****************************************************************************
+ * bool LoadLayers(const std::vector<std::string>& fileNames, std::vector<Image>& layers)
+ *
+ * Descrição:
+ * ----------
+ * Lê as imagens indicadas, uma por camada, invertidas na vertical como no
+ * carregamento das texturas do TP-P3D (a primeira linha da textura é a de baixo).
+ * Todas as imagens têm de ter o tamanho da primeira.
+ *
+ * Parâmetros:
+ * -----------
+ * - fileNames: Os nomes dos ficheiros das imagens.
+ * - layers: Recebe as imagens lidas.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se todas as imagens foram lidas, `false` caso contrário.
+ *
+ ******************************************************************************/
+bool LoadLayers(const std::vector<std::string>& fileNames, std::vector<Image>& layers) {
+	stbi_set_flip_vertically_on_load(true);
+
+	for (const std::string& fileName : fileNames) {
+		int width, height, nChannels;
+		unsigned char* data = stbi_load(fileName.c_str(), &width, &height, &nChannels, CHANNELS);
+		if (data == nullptr) {
+			std::cout << "Error loading image: " << fileName << std::endl;
+			return false;
+		}
+
+		if (!layers.empty() && (width != layers[0].width || height != layers[0].height)) {
+			std::cout << "Image " << fileName << " does not match the size of the first layer" << std::endl;
+			stbi_image_free(data);
+			return false;
+		}
+
+		Image image;
+		image.width = width;
+		image.height = height;
+		image.pixels.assign(data, data + (size_t)width * height * CHANNELS);
+		layers.push_back(std::move(image));
+		stbi_image_free(data);
+	}
+
+	return true;
+}
+
+
+/*****************************************************************************
+ * Image Downsample(const Image& image)
+ *
+ * Descrição:
+ * ----------
+ * Calcula o nível de mipmap seguinte, com metade da largura e da altura (no
+ * mínimo 1), fazendo a média de cada grupo de 2x2 texels. Nas dimensões ímpares
+ * o último texel é repetido.
+ *
+ * Parâmetros:
+ * -----------
+ * - image: O nível anterior.
+ *
+ * Retorno:
+ * --------
+ * - Image: O nível seguinte.
+ *
+ ******************************************************************************/
+Image Downsample(const Image& image) {
+	Image result;
+	result.width = std::max(image.width / 2, 1);
+	result.height = std::max(image.height / 2, 1);
+	result.pixels.resize((size_t)result.width * result.height * CHANNELS);
+
+	for (int y = 0; y < result.height; y++) {
+		int y0 = std::min(y * 2, image.height - 1);
+		int y1 = std::min(y * 2 + 1, image.height - 1);
+		for (int x = 0; x < result.width; x++) {
+			int x0 = std::min(x * 2, image.width - 1);
+			int x1 = std::min(x * 2 + 1, image.width - 1);
+			for (int c = 0; c < CHANNELS; c++) {
+				int sum = image.pixels[((size_t)y0 * image.width + x0) * CHANNELS + c]
+					+ image.pixels[((size_t)y0 * image.width + x1) * CHANNELS + c]
+					+ image.pixels[((size_t)y1 * image.width + x0) * CHANNELS + c]
+					+ image.pixels[((size_t)y1 * image.width + x1) * CHANNELS + c];
+				result.pixels[((size_t)y * result.width + x) * CHANNELS + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+
+	return result;
+}
+
+
+// Converte uma cor RGB de 8 bits para RGB565
+static uint16_t PackRGB565(const float color[3]) {
+	int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+	int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+	int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+// Converte uma cor RGB565 para RGB de 8 bits, como a GPU a descomprime
+static void UnpackRGB565(uint16_t packed, float color[3]) {
+	color[0] = (float)((packed >> 11) & 31) * 255.0f / 31.0f;
+	color[1] = (float)((packed >> 5) & 63) * 255.0f / 63.0f;
+	color[2] = (float)(packed & 31) * 255.0f / 31.0f;
+}
+
+
+/*****************************************************************************
+ * void EncodeBlock(const float texels[16][3], unsigned char* block)
+ *
+ * Descrição:
+ * ----------
+ * Comprime um bloco de 4x4 texels em BC1 (modo de 4 cores, sem transparência).
+ * As duas cores extremas são escolhidas ao longo do eixo principal das cores do
+ * bloco (calculado por iteração de potência sobre a matriz de covariância) e
+ * cada texel recebe o índice da cor mais próxima da paleta interpolada.
+ *
+ * Parâmetros:
+ * -----------
+ * - texels: As cores dos 16 texels do bloco, linha a linha.
+ * - block: Recebe os 8 bytes do bloco comprimido.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void EncodeBlock(const float texels[16][3], unsigned char* block) {
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			mean[c] += texels[i][c] / 16.0f;
+
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }; // rr, rg, rb, gg, gb, bb
+	for (int i = 0; i < 16; i++) {
+		float d[3] = { texels[i][0] - mean[0], texels[i][1] - mean[1], texels[i][2] - mean[2] };
+		covariance[0] += d[0] * d[0];
+		covariance[1] += d[0] * d[1];
+		covariance[2] += d[0] * d[2];
+		covariance[3] += d[1] * d[1];
+		covariance[4] += d[1] * d[2];
+		covariance[5] += d[2] * d[2];
+	}
+
+	// Eixo principal: iteração de potência a partir da diagonal (suficiente para 16 pontos)
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[3] = {
+			covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+			covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+			covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+		};
+		float length = std::max({ std::fabs(next[0]), std::fabs(next[1]), std::fabs(next[2]) });
+		if (length < 1e-6f)
+			break;
+		for (int c = 0; c < 3; c++)
+			axis[c] = next[c] / length;
+	}
+
+	// Extremos das projeções dos texels sobre o eixo
+	float minProjection = 1e30f, maxProjection = -1e30f;
+	for (int i = 0; i < 16; i++) {
+		float projection = (texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] + (texels[i][2] - mean[2]) * axis[2];
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+
+	float axisLengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	float endpoints[2][3];
+	for (int c = 0; c < 3; c++) {
+		endpoints[0][c] = mean[c] + axis[c] * maxProjection / axisLengthSquared;
+		endpoints[1][c] = mean[c] + axis[c] * minProjection / axisLengthSquared;
+	}
+
+	uint16_t color0 = PackRGB565(endpoints[0]);
+	uint16_t color1 = PackRGB565(endpoints[1]);
+
+	// O modo de 4 cores exige color0 > color1; com cores iguais todos os índices são 0
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		float palette[4][3];
+		UnpackRGB565(color0, palette[0]);
+		UnpackRGB565(color1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+
+		for (int i = 0; i < 16; i++) {
+			int bestIndex = 0;
+			float bestDistance = 1e30f;
+			for (int p = 0; p < 4; p++) {
+				float dr = texels[i][0] - palette[p][0];
+				float dg = texels[i][1] - palette[p][1];
+				float db = texels[i][2] - palette[p][2];
+				float distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+			indices |= (uint32_t)bestIndex << (2 * i);
+		}
+	}
+
+	block[0] = (unsigned char)(color0 & 0xFF);
+	block[1] = (unsigned char)(color0 >> 8);
+	block[2] = (unsigned char)(color1 & 0xFF);
+	block[3] = (unsigned char)(color1 >> 8);
+	for (int i = 0; i < 4; i++)
+		block[4 + i] = (unsigned char)((indices >> (8 * i)) & 0xFF);
+}
+
+
+/*****************************************************************************
+ * void EncodeLevel(const Image& image, std::vector<unsigned char>& output)
+ *
+ * Descrição:
+ * ----------
+ * Comprime um nível de mipmap inteiro em BC1, bloco a bloco, e junta os blocos
+ * ao fim de `output`. Nos níveis cujas dimensões não são múltiplas de 4, os
+ * texels de fora da imagem repetem o último texel da linha ou da coluna.
+ *
+ * Parâmetros:
+ * -----------
+ * - image: O nível a comprimir.
+ * - output: Recebe os blocos comprimidos.
+ *
+ * Retorno:
+ * --------
+ * - Nenhum (void).
+ *
+ ******************************************************************************/
+void EncodeLevel(const Image& image, std::vector<unsigned char>& output) {
+	int blocksX = (image.width + 3) / 4;
+	int blocksY = (image.height + 3) / 4;
+
+	for (int by = 0; by < blocksY; by++) {
+		for (int bx = 0; bx < blocksX; bx++) {
+			float texels[16][3];
+			for (int y = 0; y < 4; y++) {
+				int sy = std::min(by * 4 + y, image.height - 1);
+				for (int x = 0; x < 4; x++) {
+					int sx = std::min(bx * 4 + x, image.width - 1);
+					for (int c = 0; c < 3; c++)
+						texels[y * 4 + x][c] = image.pixels[((size_t)sy * image.width + sx) * CHANNELS + c];
+				}
+			}
+
+			unsigned char block[8];
+			EncodeBlock(texels, block);
+			output.insert(output.end(), block, block + 8);
+		}
+	}
+}
+
+
+/*****************************************************************************
+ * std::vector<uint32_t> BuildDataFormatDescriptor()
+ *
+ * Descrição:
+ * ----------
+ * Constrói o descritor do formato dos dados (Khronos Data Format, bloco básico)
+ * exigido pelo KTX2, para blocos BC1 RGB lineares de 4x4 texels.
+ *
+ * Retorno:
+ * --------
+ * - std::vector<uint32_t>: As palavras do descritor, começando pelo tamanho total.
+ *
+ ******************************************************************************/
+std::vector<uint32_t> BuildDataFormatDescriptor() {
+	const uint32_t blockSize = 24 + 16; // Bloco básico com uma amostra
+
+	std::vector<uint32_t> words;
+	words.push_back(4 + blockSize);                         // Tamanho total do descritor
+	words.push_back(0);                                     // Vendor Khronos, tipo básico
+	words.push_back(2 | (blockSize << 16));                 // Versão 2, tamanho do bloco
+	words.push_back(KTX2::DFD_MODEL_BC1A | (1 << 8) | (1 << 16)); // Modelo BC1A, primárias BT.709, transferência linear
+	words.push_back(3 | (3 << 8));                          // Blocos de 4x4x1x1 texels (dimensões - 1)
+	words.push_back(8);                                     // 8 bytes no plano 0
+	words.push_back(0);
+	words.push_back(0 | (63 << 16));                        // Amostra: bits 0 a 63, canal de cor
+	words.push_back(0);                                     // Posição da amostra
+	words.push_back(0);                                     // Valor mínimo
+	words.push_back(0xFFFFFFFF);                            // Valor máximo
+	return words;
+}
+
+
+/*****************************************************************************
+ * bool WriteKTX2(const std::string& fileName, int width, int height, uint32_t layerCount,
+ *                const std::vector<std::vector<unsigned char>>& levels)
+ *
+ * Descrição:
+ * ----------
+ * Escreve os níveis comprimidos num ficheiro KTX2: cabeçalho, índice dos níveis,
+ * descritor do formato e os dados. Como manda o formato, os níveis são guardados
+ * do mais pequeno para o maior, cada um alinhado a LEVEL_ALIGNMENT bytes.
+ *
+ * Parâmetros:
+ * -----------
+ * - fileName: O nome do ficheiro de saída.
+ * - width, height: As dimensões do nível 0.
+ * - layerCount: O número de camadas do array.
+ * - levels: Os dados de cada nível, com as camadas seguidas.
+ *
+ * Retorno:
+ * --------
+ * - bool: `true` se o ficheiro foi escrito, `false` caso contrário.
+ *
+ ******************************************************************************/
+bool WriteKTX2(const std::string& fileName, int width, int height, uint32_t layerCount,
+	const std::vector<std::vector<unsigned char>>& levels) {
+	std::vector<uint32_t> dfd = BuildDataFormatDescriptor();
+
+	KTX2::Header header = {};
+	std::memcpy(header.identifier, KTX2::IDENTIFIER, sizeof(KTX2::IDENTIFIER));
+	header.vkFormat = KTX2::FORMAT_BC1_RGB_UNORM;
+	header.typeSize = 1;
+	header.pixelWidth = (uint32_t)width;
+	header.pixelHeight = (uint32_t)height;
+	header.pixelDepth = 0;
+	header.layerCount = layerCount;
+	header.faceCount = 1;
+	header.levelCount = (uint32_t)levels.size();
+	header.supercompressionScheme = 0;
+	header.dfdByteOffset = (uint32_t)(sizeof(KTX2::Header) + levels.size() * sizeof(KTX2::LevelIndex));
+	header.dfdByteLength = (uint32_t)(dfd.size() * sizeof(uint32_t));
+
+	// Posição de cada nível, do mais pequeno (último) para o maior (nível 0)
+	std::vector<KTX2::LevelIndex> levelIndex(levels.size());
+	uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+	for (size_t i = levels.size(); i-- > 0;) {
+		offset = (offset + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+		levelIndex[i].byteOffset = offset;
+		levelIndex[i].byteLength = levels[i].size();
+		levelIndex[i].uncompressedByteLength = levels[i].size();
+		offset += levels[i].size();
+	}
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file) {
+		std::cout << "Error creating file: " << fileName << std::endl;
+		return false;
+	}
+
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)levelIndex.data(), levelIndex.size() * sizeof(KTX2::LevelIndex));
+	file.write((const char*)dfd.data(), dfd.size() * sizeof(uint32_t));
+
+	for (size_t i = levels.size(); i-- > 0;) {
+		static const char padding[LEVEL_ALIGNMENT] = {};
+		uint64_t position = (uint64_t)file.tellp();
+		file.write(padding, (std::streamsize)(levelIndex[i].byteOffset - position));
+		file.write((const char*)levels[i].data(), levels[i].size());
+	}
+
+	return (bool)file;
+}
+
+
+/*****************************************************************************
+ * int main(int argc, char** argv)
+ *
+ * Descrição:
+ * ----------
+ * Lê as imagens, calcula os mipmaps de cada camada, comprime-os em BC1 e escreve
+ * o array de texturas no ficheiro KTX2 indicado.
+ *
+ * Retorno:
+ * --------
+ * - int: 0 em caso de sucesso, 1 em caso de erro.
+ *
+ ******************************************************************************/
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::cout << "Usage: TextureCooker <output.ktx2> <layer 0 image> [<layer 1 image> ...]" << std::endl;
+		return 1;
+	}
+
+	std::string outputFile = argv[1];
+	std::vector<std::string> inputFiles(argv + 2, argv + argc);
+
+	std::vector<Image> layers;
+	if (!LoadLayers(inputFiles, layers))
+		return 1;
+
+	int width = layers[0].width;
+	int height = layers[0].height;
+
+	// Cadeia completa de mipmaps, até 1x1
+	size_t levelCount = 1;
+	while ((std::max(width, height) >> levelCount) > 0)
+		levelCount++;
+
+	std::vector<std::vector<unsigned char>> levels(levelCount);
+	for (Image& layer : layers) {
+		Image image = std::move(layer);
+		for (size_t level = 0; level < levelCount; level++) {
+			EncodeLevel(image, levels[level]);
+			if (level + 1 < levelCount)
+				image = Downsample(image);
+		}
+	}
+
+	if (!WriteKTX2(outputFile, width, height, (uint32_t)layers.size(), levels))
+		return 1;
+
+	uint64_t compressedSize = 0;
+	for (const std::vector<unsigned char>& level : levels)
+		compressedSize += level.size();
+
+	std::cout << "Cooked " << layers.size() << " layers of " << width << "x" << height << " with " << levelCount
+		<< " mip levels into " << outputFile << " (" << compressedSize / 1024 << " KB BC1)" << std::endl;
+	return 0;
+}